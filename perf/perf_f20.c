@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "glme.h"
+
+#define NUMTESTS 20
+
+#define MSG_F20_ID 32
+
+// 20 scalar fields; generic and fast field macros, descriptor table
+// interpreter and compiled descriptor
+
+typedef struct f20 {
+  int i0, i1, i2, i3, i4, i5;
+  unsigned int u0, u1, u2, u3, u4, u5;
+  int64_t l0, l1, l2, l3;
+  double d0, d1, d2, d3;
+} f20_t;
+
+int encode_f20(glme_buf_t *enc, const void *ptr)
+{
+  const f20_t *p = (const f20_t *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_INT(enc, p->i0, 0);
+  GLME_ENCODE_FLD_INT(enc, p->i1, 0);
+  GLME_ENCODE_FLD_INT(enc, p->i2, 0);
+  GLME_ENCODE_FLD_INT(enc, p->i3, 0);
+  GLME_ENCODE_FLD_INT(enc, p->i4, 0);
+  GLME_ENCODE_FLD_INT(enc, p->i5, 0);
+  GLME_ENCODE_FLD_UINT(enc, p->u0, 0);
+  GLME_ENCODE_FLD_UINT(enc, p->u1, 0);
+  GLME_ENCODE_FLD_UINT(enc, p->u2, 0);
+  GLME_ENCODE_FLD_UINT(enc, p->u3, 0);
+  GLME_ENCODE_FLD_UINT(enc, p->u4, 0);
+  GLME_ENCODE_FLD_UINT(enc, p->u5, 0);
+  GLME_ENCODE_FLD_INT(enc, p->l0, 0);
+  GLME_ENCODE_FLD_INT(enc, p->l1, 0);
+  GLME_ENCODE_FLD_INT(enc, p->l2, 0);
+  GLME_ENCODE_FLD_INT(enc, p->l3, 0);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->d0, 0.0);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->d1, 0.0);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->d2, 0.0);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->d3, 0.0);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int decode_f20(glme_buf_t *dec, void *ptr)
+{
+  f20_t *p = (f20_t *)ptr;
+  GLME_DECODE_STDDEF(dec);
+  GLME_DECODE_STRUCT_START(dec);
+  GLME_DECODE_FLD_INT(dec, p->i0, 0);
+  GLME_DECODE_FLD_INT(dec, p->i1, 0);
+  GLME_DECODE_FLD_INT(dec, p->i2, 0);
+  GLME_DECODE_FLD_INT(dec, p->i3, 0);
+  GLME_DECODE_FLD_INT(dec, p->i4, 0);
+  GLME_DECODE_FLD_INT(dec, p->i5, 0);
+  GLME_DECODE_FLD_UINT(dec, p->u0, 0);
+  GLME_DECODE_FLD_UINT(dec, p->u1, 0);
+  GLME_DECODE_FLD_UINT(dec, p->u2, 0);
+  GLME_DECODE_FLD_UINT(dec, p->u3, 0);
+  GLME_DECODE_FLD_UINT(dec, p->u4, 0);
+  GLME_DECODE_FLD_UINT(dec, p->u5, 0);
+  GLME_DECODE_FLD_INT(dec, p->l0, 0);
+  GLME_DECODE_FLD_INT(dec, p->l1, 0);
+  GLME_DECODE_FLD_INT(dec, p->l2, 0);
+  GLME_DECODE_FLD_INT(dec, p->l3, 0);
+  GLME_DECODE_FLD_DOUBLE(dec, p->d0, 0.0);
+  GLME_DECODE_FLD_DOUBLE(dec, p->d1, 0.0);
+  GLME_DECODE_FLD_DOUBLE(dec, p->d2, 0.0);
+  GLME_DECODE_FLD_DOUBLE(dec, p->d3, 0.0);
+  GLME_DECODE_STRUCT_END(dec);
+  GLME_DECODE_RETURN(dec);
+}
+
+int fast_encode_f20(glme_buf_t *enc, const void *ptr)
+{
+  const f20_t *p = (const f20_t *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->i0, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->i1, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->i2, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->i3, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->i4, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->i5, 0);
+  GLME_FAST_ENCODE_FLD_UINT(enc, p->u0, 0);
+  GLME_FAST_ENCODE_FLD_UINT(enc, p->u1, 0);
+  GLME_FAST_ENCODE_FLD_UINT(enc, p->u2, 0);
+  GLME_FAST_ENCODE_FLD_UINT(enc, p->u3, 0);
+  GLME_FAST_ENCODE_FLD_UINT(enc, p->u4, 0);
+  GLME_FAST_ENCODE_FLD_UINT(enc, p->u5, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->l0, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->l1, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->l2, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->l3, 0);
+  GLME_FAST_ENCODE_FLD_DOUBLE(enc, p->d0, 0.0);
+  GLME_FAST_ENCODE_FLD_DOUBLE(enc, p->d1, 0.0);
+  GLME_FAST_ENCODE_FLD_DOUBLE(enc, p->d2, 0.0);
+  GLME_FAST_ENCODE_FLD_DOUBLE(enc, p->d3, 0.0);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int fast_decode_f20(glme_buf_t *dec, void *ptr)
+{
+  f20_t *p = (f20_t *)ptr;
+  GLME_DECODE_STDDEF(dec);
+  GLME_DECODE_STRUCT_START(dec);
+  GLME_FAST_DECODE_FLD_INT(dec, p->i0, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->i1, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->i2, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->i3, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->i4, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->i5, 0);
+  GLME_FAST_DECODE_FLD_UINT(dec, p->u0, 0);
+  GLME_FAST_DECODE_FLD_UINT(dec, p->u1, 0);
+  GLME_FAST_DECODE_FLD_UINT(dec, p->u2, 0);
+  GLME_FAST_DECODE_FLD_UINT(dec, p->u3, 0);
+  GLME_FAST_DECODE_FLD_UINT(dec, p->u4, 0);
+  GLME_FAST_DECODE_FLD_UINT(dec, p->u5, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->l0, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->l1, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->l2, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->l3, 0);
+  GLME_FAST_DECODE_FLD_DOUBLE(dec, p->d0, 0.0);
+  GLME_FAST_DECODE_FLD_DOUBLE(dec, p->d1, 0.0);
+  GLME_FAST_DECODE_FLD_DOUBLE(dec, p->d2, 0.0);
+  GLME_FAST_DECODE_FLD_DOUBLE(dec, p->d3, 0.0);
+  GLME_DECODE_STRUCT_END(dec);
+  GLME_DECODE_RETURN(dec);
+}
+
+// same structure with field descriptor table; interpreted and compiled
+glme_field_t f20_fields[] = {
+  GLME_FIELD_INT(f20_t, i0, 0), GLME_FIELD_INT(f20_t, i1, 0),
+  GLME_FIELD_INT(f20_t, i2, 0), GLME_FIELD_INT(f20_t, i3, 0),
+  GLME_FIELD_INT(f20_t, i4, 0), GLME_FIELD_INT(f20_t, i5, 0),
+  GLME_FIELD_UINT(f20_t, u0, 0), GLME_FIELD_UINT(f20_t, u1, 0),
+  GLME_FIELD_UINT(f20_t, u2, 0), GLME_FIELD_UINT(f20_t, u3, 0),
+  GLME_FIELD_UINT(f20_t, u4, 0), GLME_FIELD_UINT(f20_t, u5, 0),
+  GLME_FIELD_INT(f20_t, l0, 0), GLME_FIELD_INT(f20_t, l1, 0),
+  GLME_FIELD_INT(f20_t, l2, 0), GLME_FIELD_INT(f20_t, l3, 0),
+  GLME_FIELD_DOUBLE(f20_t, d0, 0.0), GLME_FIELD_DOUBLE(f20_t, d1, 0.0),
+  GLME_FIELD_DOUBLE(f20_t, d2, 0.0), GLME_FIELD_DOUBLE(f20_t, d3, 0.0)
+};
+glme_desc_t f20_desc = GLME_DESC(MSG_F20_ID, f20_t, f20_fields);
+
+int desc_encode_f20(glme_buf_t *enc, const void *ptr)
+{
+  return glme_encode_desc(enc, &f20_desc, ptr);
+}
+
+int desc_decode_f20(glme_buf_t *dec, void *ptr)
+{
+  return glme_decode_desc(dec, &f20_desc, ptr);
+}
+
+static inline
+int64_t read_tsc()
+{
+  unsigned reslo, reshi;
+
+  // serialize (save ebx)
+  __asm__ __volatile__  (
+			 "xorl %%eax,%%eax \n cpuid \n"
+			 ::: "%eax", "%ebx", "%ecx", "%edx");
+
+  // read TSC, store edx:eax in res
+  __asm__ __volatile__  (
+			 "rdtsc\n"
+			 : "=a" (reslo), "=d" (reshi) );
+
+  // serialize again
+  __asm__ __volatile__  (
+			 "xorl %%eax,%%eax \n cpuid \n"
+			 ::: "%eax", "%ebx", "%ecx", "%edx");
+
+  return ((uint64_t)reshi << 32) | reslo;
+}
+
+// minimum clocks of NUMTESTS rounds encoding nmsg messages
+uint64_t run_encode(glme_buf_t *encoder, f20_t *msg, long nmsg, glme_encoder_f efunc)
+{
+  int k;
+  long j;
+  uint64_t before, clocks, tmin = 0;
+
+  for (k = 0; k < NUMTESTS; k++) {
+    glme_buf_clear(encoder);
+    before = read_tsc();
+    for (j = 0; j < nmsg; j++)
+      glme_encode_struct(encoder, MSG_F20_ID, &msg[j & 0xFF], efunc);
+    clocks = read_tsc() - before;
+    if (k == 0 || clocks < tmin)
+      tmin = clocks;
+  }
+  return tmin;
+}
+
+// minimum clocks of NUMTESTS rounds decoding all messages in the decoder
+uint64_t run_decode(glme_buf_t *decoder, long nmsg, glme_decoder_f dfunc)
+{
+  int k;
+  long j;
+  f20_t rcv, *rp = &rcv;
+  uint64_t before, clocks, tmin = 0;
+
+  for (k = 0; k < NUMTESTS; k++) {
+    glme_buf_reset(decoder);
+    before = read_tsc();
+    for (j = 0; j < nmsg; j++)
+      glme_decode_struct(decoder, MSG_F20_ID, (void **)&rp, 0, dfunc);
+    clocks = read_tsc() - before;
+    if (k == 0 || clocks < tmin)
+      tmin = clocks;
+  }
+  return tmin;
+}
+
+int main(int argc, char **argv)
+{
+  int k, opt;
+  long nmsg;
+  f20_t msg[256];
+  glme_buf_t encoder;
+  uint64_t nbytes, tenc, tdec, tfenc, tfdec, tdenc, tddec, tjenc, tjdec;
+  glme_spec_t spec;
+  glme_jit_t jit;
+  double clockrate;
+
+  clockrate = 2.40;  // GHz
+  nmsg = 100000;
+
+  while ((opt = getopt(argc, argv, "R:")) != -1) {
+    switch (opt) {
+    case 'R':
+      clockrate = strtod(optarg, (char **)0);
+      break;
+    default:
+      printf("perf_f20 [-R clockrate] [nmsg]\n");
+      exit(1);
+    }
+  }
+
+  if (optind < argc)
+    nmsg = strtol(argv[optind], (char **)0, 10);
+
+  // values of varying encoded length; some fields at their defaults
+  srand48(time(0));
+  for (k = 0; k < 256; k++) {
+    msg[k] = (f20_t){(int)mrand48(), k, -k, (int)mrand48() >> (k & 31), 0, 1,
+                     (unsigned)lrand48(), k, 0, 1u << (k & 31), 128, 7,
+                     (int64_t)mrand48() * 1048576, -k, 0, INT64_MAX >> (k & 63),
+                     drand48(), (double)k, 0.0, -1e10 * drand48()};
+  }
+
+  glme_buf_init(&encoder, nmsg * 200);
+
+  tenc = run_encode(&encoder, msg, nmsg, encode_f20);
+  tdec = run_decode(&encoder, nmsg, decode_f20);
+  tfenc = run_encode(&encoder, msg, nmsg, fast_encode_f20);
+  nbytes = glme_buf_len(&encoder);
+  tfdec = run_decode(&encoder, nmsg, fast_decode_f20);
+  glme_desc_init(&f20_desc);
+  tdenc = run_encode(&encoder, msg, nmsg, desc_encode_f20);
+  tddec = run_decode(&encoder, nmsg, desc_decode_f20);
+  if (glme_jit_compile(&jit, &spec, &f20_desc, GLME_JIT_PERFMAP) <= 0) {
+    printf("descriptor compiling not available\n");
+    spec.encoder = desc_encode_f20;
+    spec.decoder = desc_decode_f20;
+  }
+  tjenc = run_encode(&encoder, msg, nmsg, spec.encoder);
+  tjdec = run_decode(&encoder, nmsg, spec.decoder);
+
+  printf("%ld messages, %ld bytes, %.2f GHz\n", nmsg, nbytes, clockrate);
+  printf("generic encode: %7.1f cycles/msg  %.3f GB/s\n",
+         (double)tenc/nmsg, clockrate/((double)tenc/nbytes));
+  printf("fast encode   : %7.1f cycles/msg  %.3f GB/s  (%.2fx)\n",
+         (double)tfenc/nmsg, clockrate/((double)tfenc/nbytes), (double)tenc/tfenc);
+  printf("generic decode: %7.1f cycles/msg  %.3f GB/s\n",
+         (double)tdec/nmsg, clockrate/((double)tdec/nbytes));
+  printf("fast decode   : %7.1f cycles/msg  %.3f GB/s  (%.2fx)\n",
+         (double)tfdec/nmsg, clockrate/((double)tfdec/nbytes), (double)tdec/tfdec);
+  printf("desc encode   : %7.1f cycles/msg  %.3f GB/s  (%.2fx)\n",
+         (double)tdenc/nmsg, clockrate/((double)tdenc/nbytes), (double)tenc/tdenc);
+  printf("jit encode    : %7.1f cycles/msg  %.3f GB/s  (%.2fx)\n",
+         (double)tjenc/nmsg, clockrate/((double)tjenc/nbytes), (double)tenc/tjenc);
+  printf("desc decode   : %7.1f cycles/msg  %.3f GB/s  (%.2fx)\n",
+         (double)tddec/nmsg, clockrate/((double)tddec/nbytes), (double)tdec/tddec);
+  printf("jit decode    : %7.1f cycles/msg  %.3f GB/s  (%.2fx)\n",
+         (double)tjdec/nmsg, clockrate/((double)tjdec/nbytes), (double)tdec/tjdec);
+  glme_jit_release(&jit);
+  return 0;
+}
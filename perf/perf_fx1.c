@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "glme.h"
+
+#define NUMTESTS 20
+
+#define MSG_SERIES_ID 32
+
+// floating point time series; plain and XOR compressed arrays
+
+typedef struct series {
+  double *vec;
+  size_t vlen;
+} series_t;
+
+int encode_plain(glme_buf_t *enc, const void *ptr)
+{
+  const series_t *p = (const series_t *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_FLOAT_ARRAY(enc, p->vec, p->vlen, glme_encode_value_double);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int encode_xor(glme_buf_t *enc, const void *ptr)
+{
+  const series_t *p = (const series_t *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_FLOAT_XOR(enc, p->vec, p->vlen);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+// decodes both encodings; target array preallocated
+int decode_series(glme_buf_t *dec, void *ptr)
+{
+  series_t *p = (series_t *)ptr;
+  GLME_DECODE_STDDEF(dec);
+  GLME_DECODE_STRUCT_START(dec);
+  GLME_DECODE_FLD_FLOAT_ARRAY(dec, p->vec, p->vlen, glme_decode_value_double);
+  GLME_DECODE_STRUCT_END(dec);
+  GLME_DECODE_RETURN(dec);
+}
+
+static inline
+int64_t read_tsc()
+{
+  unsigned reslo, reshi;
+
+  // serialize (save ebx)
+  __asm__ __volatile__  (
+			 "xorl %%eax,%%eax \n cpuid \n"
+			 ::: "%eax", "%ebx", "%ecx", "%edx");
+
+  // read TSC, store edx:eax in res
+  __asm__ __volatile__  (
+			 "rdtsc\n"
+			 : "=a" (reslo), "=d" (reshi) );
+
+  // serialize again
+  __asm__ __volatile__  (
+			 "xorl %%eax,%%eax \n cpuid \n"
+			 ::: "%eax", "%ebx", "%ecx", "%edx");
+
+  return ((uint64_t)reshi << 32) | reslo;
+}
+
+// minimum clocks of NUMTESTS rounds encoding the series
+uint64_t run_encode(glme_buf_t *encoder, series_t *msg, glme_encoder_f efunc)
+{
+  int k;
+  uint64_t before, clocks, tmin = 0;
+
+  for (k = 0; k < NUMTESTS; k++) {
+    glme_buf_clear(encoder);
+    before = read_tsc();
+    glme_encode_struct(encoder, MSG_SERIES_ID, msg, efunc);
+    clocks = read_tsc() - before;
+    if (k == 0 || clocks < tmin)
+      tmin = clocks;
+  }
+  return tmin;
+}
+
+// minimum clocks of NUMTESTS rounds decoding the series
+uint64_t run_decode(glme_buf_t *decoder, series_t *rcv, size_t vlen)
+{
+  int k;
+  uint64_t before, clocks, tmin = 0;
+
+  for (k = 0; k < NUMTESTS; k++) {
+    glme_buf_reset(decoder);
+    rcv->vlen = vlen;
+    before = read_tsc();
+    glme_decode_struct(decoder, MSG_SERIES_ID, (void **)&rcv, 0, decode_series);
+    clocks = read_tsc() - before;
+    if (k == 0 || clocks < tmin)
+      tmin = clocks;
+  }
+  return tmin;
+}
+
+void run_series(const char *name, glme_buf_t *encoder, series_t *msg, double clockrate)
+{
+  series_t rcv, *rp = &rcv;
+  uint64_t nplain, nxor, tpenc, tpdec, txenc, txdec;
+  size_t nbytes = msg->vlen * sizeof(double);
+
+  rcv.vec = malloc(nbytes);
+  tpenc = run_encode(encoder, msg, encode_plain);
+  nplain = glme_buf_len(encoder);
+  tpdec = run_decode(encoder, rp, msg->vlen);
+  txenc = run_encode(encoder, msg, encode_xor);
+  nxor = glme_buf_len(encoder);
+  txdec = run_decode(encoder, rp, msg->vlen);
+  if (rcv.vlen != msg->vlen || memcmp(rcv.vec, msg->vec, nbytes) != 0)
+    printf("%s: decoded values differ\n", name);
+
+  // rates relative to size of the decoded array
+  printf("%s: plain %ld bytes, xor %ld bytes (%.2f bits/value)\n",
+         name, nplain, nxor, 8.0*nxor/msg->vlen);
+  printf("  plain encode: %.3f GB/s  decode: %.3f GB/s\n",
+         clockrate/((double)tpenc/nbytes), clockrate/((double)tpdec/nbytes));
+  printf("  xor encode  : %.3f GB/s  decode: %.3f GB/s\n",
+         clockrate/((double)txenc/nbytes), clockrate/((double)txdec/nbytes));
+  free(rcv.vec);
+}
+
+int main(int argc, char **argv)
+{
+  int opt;
+  long k, vlen, cents;
+  series_t msg;
+  glme_buf_t encoder;
+  double clockrate;
+
+  clockrate = 2.40;  // GHz
+  vlen = 100000;
+
+  while ((opt = getopt(argc, argv, "R:")) != -1) {
+    switch (opt) {
+    case 'R':
+      clockrate = strtod(optarg, (char **)0);
+      break;
+    default:
+      printf("perf_fx1 [-R clockrate] [arraylen]\n");
+      exit(1);
+    }
+  }
+
+  if (optind < argc)
+    vlen = strtol(argv[optind], (char **)0, 10);
+
+  glme_buf_init(&encoder, 10*vlen + 64);
+  msg.vec = malloc(vlen*sizeof(double));
+  msg.vlen = vlen;
+  srand48(time(0));
+  printf("%ld values, %.2f GHz\n", vlen, clockrate);
+
+  // price in cents; unchanged most of the time, otherwise one or two ticks
+  for (k = 0, cents = 10000; k < vlen; k++) {
+    if (lrand48() % 4 == 0)
+      cents += lrand48() % 5 - 2;
+    msg.vec[k] = cents / 100.0;
+  }
+  run_series("price", &encoder, &msg, clockrate);
+
+  // gauge reading in steps of 0.1 drifting slowly
+  for (k = 0, cents = 2000; k < vlen; k++) {
+    if (lrand48() % 16 == 0)
+      cents += lrand48() % 2 ? 10 : -10;
+    msg.vec[k] = cents / 100.0;
+  }
+  run_series("gauge", &encoder, &msg, clockrate);
+
+  // counter sampled at regular intervals
+  for (k = 0; k < vlen; k++)
+    msg.vec[k] = 1000.0 + 0.5 * k;
+  run_series("counter", &encoder, &msg, clockrate);
+
+  // random values; worst case
+  for (k = 0; k < vlen; k++)
+    msg.vec[k] = drand48();
+  run_series("random", &encoder, &msg, clockrate);
+
+  free(msg.vec);
+  glme_buf_close(&encoder);
+  return 0;
+}
@@ -0,0 +1,194 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "glme.h"
+#include "perf_g1_msg.h"
+
+#define NUMTESTS 20
+
+// encoding and decoding with glmec generated functions
+
+static inline
+int64_t read_tsc()
+{
+  unsigned reslo, reshi;
+
+  // serialize (save ebx)
+  __asm__ __volatile__  (
+			 "xorl %%eax,%%eax \n cpuid \n"
+			 ::: "%eax", "%ebx", "%ecx", "%edx");
+
+  // read TSC, store edx:eax in res
+  __asm__ __volatile__  (
+			 "rdtsc\n"
+			 : "=a" (reslo), "=d" (reshi) );
+
+  // serialize again
+  __asm__ __volatile__  (               
+			 "xorl %%eax,%%eax \n cpuid \n"
+			 ::: "%eax", "%ebx", "%ecx", "%edx");
+
+  return ((uint64_t)reshi << 32) | reslo;
+}
+
+uint64_t run_encode(uint64_t clocks[], glme_buf_t *encoder, struct sample *msg)
+{
+  int k, n;
+  uint64_t before, nb;
+
+  for (k = 0; k < NUMTESTS; k++) {
+    before = read_tsc();
+    // ------ start of test ---
+
+    n = glme_encode_struct(encoder, SAMPLE_ID, msg, sample_encode);
+
+    // ------ end of test -----
+    clocks[k] = read_tsc() - before;
+
+    glme_buf_clear(encoder);
+    if (k == 0)
+      nb = (uint64_t)n;
+  }
+
+  return n <= 0 ? 0 : nb;
+}
+
+uint64_t run_decode(uint64_t clocks[], glme_buf_t *decoder, struct sample *msg)
+{
+  int k, n;
+  uint64_t before, nb;
+  void *ptr = msg;
+
+  for (k = 0; k < NUMTESTS; k++) {
+    glme_buf_reset(decoder);
+    memset(msg, 0, sizeof(*msg));
+    before = read_tsc();
+    // ------ start of test ---
+
+    n = glme_decode_struct(decoder, SAMPLE_ID, &ptr, sizeof(*msg), sample_decode);
+
+    // ------ end of test -----
+    clocks[k] = read_tsc() - before;
+
+    sample_free(decoder, msg);
+    if (k == 0)
+      nb = (uint64_t)n;
+  }
+
+  return n <= 0 ? 0 : nb;
+}
+
+int main(int argc, char **argv)
+{
+  int n, i, k, opt, decode;
+  uint64_t before, overhead, clocks[NUMTESTS];
+  uint64_t tmin, tmax;
+  double tavg, bps_min, bps_avg, bps_max, clockrate;
+
+  struct sample msg, rcv;
+  glme_buf_t encoder;
+  uint64_t nbytes, sbytes;
+
+  long vlen;
+
+  clockrate = 2.40;  // GHz
+  vlen = 100000;
+  decode = 0;
+
+  memset(&msg, 0, sizeof(msg));
+  memset(&rcv, 0, sizeof(rcv));
+
+  while ((opt = getopt(argc, argv, "R:d")) != -1) {
+    switch (opt) {
+    case 'R':
+      clockrate = strtod(optarg, (char **)0);
+      break;
+    case 'd':
+      decode = 1;
+      break;
+    default:
+      printf("perf_g1 [-R clockrate] [-d] [arraylen]\n");
+      exit(1);
+    }
+  }
+
+  if (optind < argc)
+    vlen = strtol(argv[optind], (char **)0, 10);
+
+  glme_buf_init(&encoder, sample_size(&msg) + 30*vlen);
+
+  // generate random doubles and points
+  srand48(time(0));
+  msg.id = 1;
+  msg.name = "sample";
+  msg.vals = malloc(vlen*sizeof(double));
+  msg.vals_len = vlen;
+  msg.pts = calloc(vlen, sizeof(struct point));
+  msg.pts_len = vlen;
+  for (k = 0; k < vlen; k++) {
+    msg.vals[k] = drand48();
+    msg.pts[k].x = mrand48();
+    msg.pts[k].y = mrand48();
+  }
+  sbytes = vlen*(sizeof(double) + sizeof(struct point)) + sizeof(msg);
+
+  // calculate overhead
+  for (i = 0; i < NUMTESTS; i++) {
+    before = read_tsc();
+    clocks[i] = read_tsc() - before;
+  }
+  overhead = clocks[0];
+  for (i = 0; i < NUMTESTS; i++) {
+    if (clocks[i] < overhead)
+      overhead = clocks[i];
+  }
+
+  // -------------------------------------------------------
+  // run & measure
+  if (decode) {
+    if (glme_encode_struct(&encoder, SAMPLE_ID, &msg, sample_encode) <= 0) {
+      printf("encode failed: %d\n", encoder.last_error);
+      exit(1);
+    }
+    nbytes = run_decode(clocks, &encoder, &rcv);
+  } else {
+    nbytes = run_encode(clocks, &encoder, &msg);
+  }
+
+  // -------------------------------------------------------
+
+  tmin = clocks[0];
+  tmax = overhead;
+  tavg = 0.0;
+  for (i = 0; i < NUMTESTS; i++) {
+    if (clocks[i] >= overhead) {
+      clocks[i] -= overhead;
+    } else {
+      clocks[i] = 0;
+    }
+    if (clocks[i] < tmin)
+      tmin = clocks[i];
+    if (clocks[i] > tmax)
+      tmax = clocks[i];
+  }
+  n = 0;
+  for (i = 0; i < NUMTESTS; i++) {
+    tavg += ((double)clocks[i] - tavg) / (n+1);
+    n++;
+  }
+  // bytes per sec (GB/s)
+  bps_max = clockrate/((double)tmin/sbytes);
+  bps_avg = clockrate/((double)tavg/sbytes);
+  bps_min = clockrate/((double)tmax/sbytes);
+  printf("[%7ld -> %7ld]: %.5f  %.5f  %.5f (GB/s)\n",
+	 sbytes, nbytes, bps_min, bps_avg, bps_max);
+
+  free(msg.vals);
+  free(msg.pts);
+  glme_buf_close(&encoder);
+  return 0;
+}
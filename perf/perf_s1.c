@@ -62,6 +62,32 @@ int decode_link(glme_buf_t *gb, void *ptr)
 }
 
 
+// iterative encoding of the list
+int encode_link_tail(glme_buf_t *gb, const void *vptr)
+{
+  const struct link *lnk = (const struct link *)vptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+
+  GLME_ENCODE_FLD_INT(gb, lnk->val, 0);
+  GLME_ENCODE_FLD_STRUCT_TAIL(gb, MSG_LINK_ID, lnk->next, encode_link_tail);
+
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_list_tail(glme_buf_t *gb, const void *ptr)
+{
+  const struct list *l = (const struct list *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+
+  GLME_ENCODE_FLD_STRUCT_TAIL(gb, MSG_LINK_ID, l->head, encode_link_tail);
+
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
 int encode_list(glme_buf_t *gb, const void *ptr)
 {
   const struct list *l = (const struct list *)ptr;
@@ -109,7 +135,7 @@ int64_t read_tsc()
   return ((uint64_t)reshi << 32) | reslo;
 }
 
-uint64_t run_test(uint64_t clocks[], glme_buf_t *encoder, list_t *msg)
+uint64_t run_test(uint64_t clocks[], glme_buf_t *encoder, list_t *msg, glme_encoder_f efunc)
 {
   int i, j, k, n;
   uint64_t before, nb;
@@ -118,7 +144,7 @@ uint64_t run_test(uint64_t clocks[], glme_buf_t *encoder, list_t *msg)
     before = read_tsc();
     // ------ start of test ---
 
-    n = glme_encode_struct(encoder, MSG_LIST_ID, msg, encode_list);
+    n = glme_encode_struct(encoder, MSG_LIST_ID, msg, efunc);
 
     // ------ end of test -----
     clocks[k] = read_tsc() - before;
@@ -141,13 +167,14 @@ double gbytes_per_sec(double cycles_per_byte, double clockrate)
 
 int main(int argc, char **argv)
 {
-  int n, i, k, minind, maxind, encode, opt;
+  int n, i, k, minind, maxind, encode, opt, shuffle;
   uint64_t before, overhead, clocks[NUMTESTS];
   uint64_t tmin, tmax;
   double tavg, tcalc, bps_min, bps_avg, bps_max, clockrate;
 
   list_t lst;
-  link_t *elems;
+  link_t *elems, *tmp;
+  glme_encoder_f efunc = encode_list;
   
   glme_buf_t encoder;
   uint64_t rlen, nbytes, sbytes;
@@ -157,16 +184,25 @@ int main(int argc, char **argv)
   clockrate = 2.40;  // GHz
   // this many list entries --> max depth recursive calls 
   vlen = 20000;
+  shuffle = 0;
 
   memset(&lst, 0, sizeof(lst));
 
-  while ((opt = getopt(argc, argv, "R:")) != -1) {
+  while ((opt = getopt(argc, argv, "R:ts")) != -1) {
     switch (opt) {
     case 'R':
       clockrate = strtod(optarg, (char **)0);
       break;
+    case 't':
+      // iterative encoding of tail fields
+      efunc = encode_list_tail;
+      break;
+    case 's':
+      // links in random memory order
+      shuffle = 1;
+      break;
     default:
-      printf("perf_da1 [-R clockrate] [arraylen]\n");
+      printf("perf_s1 [-R clockrate] [-t] [-s] [listlen]\n");
       exit(1);
     }
   }
@@ -187,6 +223,23 @@ int main(int argc, char **argv)
   elems[vlen-1].next = (link_t *)0;
   lst.head = elems;
 
+  if (shuffle) {
+    link_t **order = (link_t **)malloc(vlen*sizeof(link_t *));
+    for (k = 0; k < vlen; k++)
+      order[k] = &elems[k];
+    srand(1);
+    for (k = vlen-1; k > 0; k--) {
+      i = rand() % (k+1);
+      tmp = order[k]; order[k] = order[i]; order[i] = tmp;
+    }
+    for (k = 0; k < vlen; k++) {
+      order[k]->val = k;
+      order[k]->next = k < vlen-1 ? order[k+1] : (link_t *)0;
+    }
+    lst.head = order[0];
+    free(order);
+  }
+
   
   sbytes = vlen*sizeof(link_t) + sizeof(list_t);
 
@@ -203,7 +256,7 @@ int main(int argc, char **argv)
 
   // -------------------------------------------------------
   // run & measure
-  nbytes = run_test(clocks, &encoder, &lst);
+  nbytes = run_test(clocks, &encoder, &lst, efunc);
 
   // -------------------------------------------------------
 
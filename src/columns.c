@@ -0,0 +1,532 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "glme.h"
+#include "descriptor.h"
+#include "packed.h"
+
+/*
+ * Columnar structure arrays. Header is structure type id and number of rows
+ * followed by one field per column with field deltas as in structures. Column
+ * value is the field of every row as an array; integers are sent as packed,
+ * delta or plain array whichever is smallest, floating point values as XOR
+ * delta array unless packed is smaller. Column of default values is omitted.
+ *
+ * Columns are gathered from and scattered to rows through a scratch array of
+ * one column so that the array kernels run over contiguous elements. Column
+ * arrays given by caller are decoded in place.
+ */
+
+// type id, structure type id and count
+#define __HEADER_MAX 20
+
+// only scalar fields can be columns
+static
+int __columns_check(const glme_desc_t *desc)
+{
+  int k;
+
+  if (!desc->ops)
+    return GLME_E_INVAL;
+  for (k = 0; k < desc->nfields; k++) {
+    if (!__GLME_OP_SCALAR(desc->ops[k].op))
+      return GLME_E_TYPE;
+  }
+  return 0;
+}
+
+// column element as 64 bit value; signed elements are sign extended
+static inline
+uint64_t __load(int op, const char *p)
+{
+  switch (op) {
+  case GLME_OP_I8:
+    return (uint64_t)*(const int8_t *)p;
+  case GLME_OP_I16:
+    return (uint64_t)*(const int16_t *)p;
+  case GLME_OP_I32:
+    return (uint64_t)*(const int32_t *)p;
+  case GLME_OP_U8:
+    return *(const uint8_t *)p;
+  case GLME_OP_U16:
+    return *(const uint16_t *)p;
+  case GLME_OP_U32:
+  case GLME_OP_F32:
+    return *(const uint32_t *)p;
+  }
+  return *(const uint64_t *)p;
+}
+
+static inline
+void __store(size_t esize, char *p, uint64_t v)
+{
+  switch (esize) {
+  case 1:
+    *(uint8_t *)p = (uint8_t)v;
+    break;
+  case 2:
+    *(uint16_t *)p = (uint16_t)v;
+    break;
+  case 4:
+    *(uint32_t *)p = (uint32_t)v;
+    break;
+  default:
+    *(uint64_t *)p = v;
+    break;
+  }
+}
+
+// copy field of len rows to column
+static
+void __gather(char *col, const char *p, size_t len, size_t stride, size_t esize)
+{
+  size_t k;
+
+  switch (esize) {
+  case 1:
+    for (k = 0; k < len; k++, p += stride)
+      col[k] = *p;
+    break;
+  case 2:
+    for (k = 0; k < len; k++, p += stride)
+      ((uint16_t *)col)[k] = *(const uint16_t *)p;
+    break;
+  case 4:
+    for (k = 0; k < len; k++, p += stride)
+      ((uint32_t *)col)[k] = *(const uint32_t *)p;
+    break;
+  default:
+    for (k = 0; k < len; k++, p += stride)
+      ((uint64_t *)col)[k] = *(const uint64_t *)p;
+    break;
+  }
+}
+
+// copy column to field of len rows
+static
+void __scatter(char *p, const char *col, size_t len, size_t stride, size_t esize)
+{
+  size_t k;
+
+  switch (esize) {
+  case 1:
+    for (k = 0; k < len; k++, p += stride)
+      *p = col[k];
+    break;
+  case 2:
+    for (k = 0; k < len; k++, p += stride)
+      *(uint16_t *)p = ((const uint16_t *)col)[k];
+    break;
+  case 4:
+    for (k = 0; k < len; k++, p += stride)
+      *(uint32_t *)p = ((const uint32_t *)col)[k];
+    break;
+  default:
+    for (k = 0; k < len; k++, p += stride)
+      *(uint64_t *)p = ((const uint64_t *)col)[k];
+    break;
+  }
+}
+
+// encoded length of unsigned value
+static inline
+size_t __uvlen(uint64_t u)
+{
+  return u < 0x80 ? 1 : 1 + (71 - __builtin_clzll(u)) / 8;
+}
+
+static
+int __all_default(const glme_field_t *f, int op, const char *col, size_t len)
+{
+  char defval[8];
+  size_t k;
+
+  __glme_desc_default(f, op, defval);
+  for (k = 0; k < len; k++) {
+    if (memcmp(&col[k*f->esize], defval, f->esize) != 0)
+      return 0;
+  }
+  return 1;
+}
+
+// plain array of varints
+static
+int __encode_plain(glme_buf_t *enc, const glme_field_t *f, int op, const char *col, size_t len)
+{
+  size_t k;
+  uint64_t v;
+  char *p;
+
+  if (len > (SIZE_MAX - __HEADER_MAX) / 9) {
+    enc->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+  if (glme_buf_reserve(enc, __HEADER_MAX + 9 * len) < 0)
+    return GLME_E_NOMEM;
+  p = &enc->buf[enc->count];
+  *p++ = (char)(GLME_ARRAY << 1);
+  p = glme_put_uint64(p, glme_zigzag(f->type));
+  p = glme_put_uint64(p, len);
+  for (k = 0; k < len; k++) {
+    v = __load(op, &col[k*f->esize]);
+    p = glme_put_uint64(p, f->type == GLME_INT ? glme_zigzag((int64_t)v) : v);
+  }
+  enc->count = p - enc->buf;
+  return 0;
+}
+
+// integer column as smallest of packed, delta and plain array
+static
+int __encode_ints(glme_buf_t *enc, const glme_field_t *f, int op, const char *col, size_t len)
+{
+  size_t k, nplain = 0, nd1 = 0, nd2 = 0, npacked = len * f->esize;
+  uint64_t v, d, prev = 0, step = 0;
+
+  for (k = 0; k < len; k++) {
+    v = __load(op, &col[k*f->esize]);
+    d = v - prev;
+    nplain += __uvlen(f->type == GLME_INT ? glme_zigzag((int64_t)v) : v);
+    nd1 += __uvlen(glme_zigzag((int64_t)d));
+    nd2 += __uvlen(glme_zigzag((int64_t)(k > 0 ? d - step : d)));
+    prev = v;
+    step = d;
+  }
+  if (npacked <= nplain && npacked <= nd1 && npacked <= nd2)
+    return glme_encode_packed(enc, GLME_PACKED_KIND(f->type, f->esize), col, len, 0);
+  if (nd1 < nplain || nd2 < nplain)
+    return glme_encode_delta(enc, f->type, col, len, f->esize, nd2 < nd1 ? 2 : 1);
+  return __encode_plain(enc, f, op, col, len);
+}
+
+// floating point column as XOR delta array unless packed is smaller
+static
+int __encode_floats(glme_buf_t *enc, const glme_field_t *f, const char *col, size_t len)
+{
+  uint64_t __at_start = enc->count;
+  int n;
+
+  if ((n = glme_encode_delta(enc, GLME_FLOAT, col, len, f->esize, 1)) < 0)
+    return n;
+  if ((size_t)n <= len * f->esize)
+    return n;
+  enc->count = __at_start;
+  return glme_encode_packed(enc, GLME_PACKED_KIND(GLME_FLOAT, f->esize), col, len, 0);
+}
+
+int glme_encode_columns(glme_buf_t *enc, const glme_desc_t *desc, const void *vec, size_t len)
+{
+  const glme_field_t *f;
+  uint64_t delta, __at_start = enc->count;
+  char *col = (char *)0;
+  int k, n, op;
+
+  if ((n = __columns_check(desc)) < 0) {
+    enc->last_error = n;
+    return n;
+  }
+  if (len > 0 && !(col = (char *)glme_malloc(enc, len * sizeof(uint64_t)))) {
+    enc->last_error = GLME_E_NOMEM;
+    return GLME_E_NOMEM;
+  }
+  if ((n = glme_buf_reserve(enc, __HEADER_MAX)) < 0)
+    goto error;
+  enc->buf[enc->count++] = (char)(GLME_COLUMNS << 1);
+  enc->count = glme_put_uint64(&enc->buf[enc->count], glme_zigzag(desc->typeid)) - enc->buf;
+  enc->count = glme_put_uint64(&enc->buf[enc->count], len) - enc->buf;
+
+  for (k = 0, delta = 1; k < desc->nfields; k++, delta++) {
+    f = &desc->fields[k];
+    op = desc->ops[k].op;
+    __gather(col, (const char *)vec + f->offset, len, desc->size, f->esize);
+    if (__all_default(f, op, col, len))
+      continue;
+    if ((n = glme_buf_reserve(enc, 10)) < 0)
+      goto error;
+    enc->count = glme_put_uint64(&enc->buf[enc->count], delta) - enc->buf;
+    if (f->type == GLME_FLOAT)
+      n = __encode_floats(enc, f, col, len);
+    else
+      n = __encode_ints(enc, f, op, col, len);
+    if (n < 0)
+      goto error;
+    delta = 0;
+  }
+  if ((n = glme_buf_reserve(enc, 1)) < 0)
+    goto error;
+  enc->buf[enc->count++] = 0;
+  glme_free(enc, col);
+  return enc->count - __at_start;
+
+ error:
+  glme_free(enc, col);
+  enc->count = __at_start;
+  return n;
+}
+
+// decode column of rows elements to col
+static
+int __decode_column(glme_buf_t *dec, const glme_field_t *f, int op, char *col, size_t rows)
+{
+  const void *data;
+  size_t len;
+  uint64_t k, u;
+  int n, kind, typeid;
+
+  if (rows == 0 || dec->current >= dec->count)
+    return rows == 0 ? GLME_E_INVAL : GLME_E_UFLOW;
+
+  switch (dec->buf[dec->current]) {
+  case (char)(GLME_PACKED << 1):
+    if ((n = glme_decode_packed(dec, &kind, &data, &len)) < 0)
+      return n;
+    if (kind != GLME_PACKED_KIND(f->type, f->esize))
+      return GLME_E_TYPE;
+    if (len != rows)
+      return GLME_E_INVAL;
+    __glme_packed_copy(col, (const char *)data, len, f->esize);
+    return 0;
+
+  case (char)(GLME_DELTA << 1):
+    typeid = f->type;
+    len = rows;
+    if ((n = glme_decode_delta(dec, &typeid, (void **)&col, &len, f->esize)) < 0)
+      return n;
+    return len == rows ? 0 : GLME_E_INVAL;
+
+  case (char)(GLME_ARRAY << 1):
+    dec->current++;
+    if (glme_decode_type(dec, &typeid) < 0 || glme_get_uint64(dec, &u) < 0)
+      return GLME_E_UFLOW;
+    if (typeid != f->type && !(typeid == GLME_FLOAT32 && f->type == GLME_FLOAT))
+      return GLME_E_TYPE;
+    if (u != rows)
+      return GLME_E_INVAL;
+    for (k = 0; k < rows; k++, col += f->esize) {
+      if (glme_get_uint64(dec, &u) < 0)
+        return GLME_E_UFLOW;
+      if (op == GLME_OP_F32)
+        *(float *)col = typeid == GLME_FLOAT32 ? glme_unflip_float(u) : (float)glme_unflip_double(u);
+      else if (op == GLME_OP_F64)
+        *(double *)col = typeid == GLME_FLOAT32 ? glme_unflip_float(u) : glme_unflip_double(u);
+      else
+        __store(f->esize, col, typeid == GLME_INT ? (uint64_t)glme_unzigzag(u) : u);
+    }
+    return 0;
+  }
+  return GLME_E_TYPE;
+}
+
+// read header; read pointer left at first column
+static
+int __columns_start(glme_buf_t *dec, const glme_desc_t *desc, uint64_t *rows)
+{
+  int n, typeid;
+
+  if ((n = __columns_check(desc)) < 0)
+    return n;
+  if (dec->current >= dec->count)
+    return GLME_E_UFLOW;
+  if (dec->buf[dec->current] != (char)(GLME_COLUMNS << 1))
+    return GLME_E_TYPE;
+  dec->current++;
+  if (glme_decode_type(dec, &typeid) < 0 || glme_get_uint64(dec, rows) < 0)
+    return GLME_E_UFLOW;
+  return typeid == desc->typeid ? 0 : GLME_E_TYPE;
+}
+
+// fill column k with default value
+static
+void __column_default(const glme_desc_t *desc, int k, size_t rows, char *vec, char *col)
+{
+  const glme_field_t *f = &desc->fields[k];
+  size_t j;
+
+  for (j = 0; vec && j < rows; j++)
+    __glme_desc_default(f, desc->ops[k].op, &vec[j*desc->size + f->offset]);
+  for (j = 0; col && j < rows; j++)
+    __glme_desc_default(f, desc->ops[k].op, &col[j*f->esize]);
+}
+
+// decode columns to rows of vec or to column arrays cols; scratch is one column
+static
+int __decode_columns(glme_buf_t *dec, const glme_desc_t *desc, size_t rows,
+                     char *vec, char **cols, char *scratch)
+{
+  const glme_field_t *f;
+  uint64_t delta;
+  unsigned int k, next;
+  int n, op;
+
+  for (k = 0; ; k = next + 1) {
+    if (glme_get_uint64(dec, &delta) < 0)
+      return GLME_E_UFLOW;
+    if (delta == 0)
+      break;
+    if (delta > desc->nfields - k)
+      // column not in this descriptor
+      return GLME_E_TYPE;
+    next = k + delta - 1;
+    // omitted columns get default values
+    for (; k < next; k++)
+      __column_default(desc, k, rows, vec, cols ? cols[k] : (char *)0);
+
+    f = &desc->fields[next];
+    op = desc->ops[next].op;
+    if (vec) {
+      if ((n = __decode_column(dec, f, op, scratch, rows)) < 0)
+        return n;
+      __scatter(&vec[f->offset], scratch, rows, desc->size, f->esize);
+    } else if (cols[next]) {
+      if ((n = __decode_column(dec, f, op, cols[next], rows)) < 0)
+        return n;
+    } else if ((n = glme_skip(dec)) < 0) {
+      return n;
+    }
+  }
+  for (; k < desc->nfields; k++)
+    __column_default(desc, k, rows, vec, cols ? cols[k] : (char *)0);
+  return 0;
+}
+
+int glme_decode_columns(glme_buf_t *dec, const glme_desc_t *desc, void **vec, size_t *len)
+{
+  uint64_t rows, __at_start = dec->current;
+  char *ptr = (char *)*vec, *scratch = (char *)0;
+  int n;
+
+  if ((n = __columns_start(dec, desc, &rows)) < 0)
+    goto error;
+  n = GLME_E_OFLOW;
+  if (ptr && *len < rows)
+    goto error;
+  // omitted columns take no input; rows of allocated array are bounded by input
+  n = GLME_E_UFLOW;
+  if (!ptr && rows > dec->count - dec->current)
+    goto error;
+  n = GLME_E_NOMEM;
+  if (!ptr && rows > 0 && !(ptr = (char *)glme_calloc(dec, rows, desc->size)))
+    goto error;
+  if (rows > 0 && !(scratch = (char *)glme_malloc(dec, rows * sizeof(uint64_t)))) {
+    if (!*vec)
+      glme_free(dec, ptr);
+    goto error;
+  }
+
+  n = __decode_columns(dec, desc, rows, ptr, (char **)0, scratch);
+  glme_free(dec, scratch);
+  if (n < 0) {
+    if (!*vec)
+      glme_free(dec, ptr);
+    goto error;
+  }
+  *vec = ptr;
+  *len = rows;
+  return dec->current - __at_start;
+
+ error:
+  dec->current = __at_start;
+  dec->last_error = n;
+  return n;
+}
+
+int glme_decode_column_arrays(glme_buf_t *dec, const glme_desc_t *desc, void **cols, size_t *len)
+{
+  uint64_t rows, __at_start = dec->current;
+  int n;
+
+  if ((n = __columns_start(dec, desc, &rows)) < 0)
+    goto error;
+  n = GLME_E_OFLOW;
+  if (rows > *len)
+    goto error;
+  if ((n = __decode_columns(dec, desc, rows, (char *)0, (char **)cols, (char *)0)) < 0)
+    goto error;
+  *len = rows;
+  return dec->current - __at_start;
+
+ error:
+  dec->current = __at_start;
+  dec->last_error = n;
+  return n;
+}
+
+int glme_encode_field_columns(glme_buf_t *enc, int *delta, const glme_desc_t *desc,
+                              const void *vptr, size_t nlen)
+{
+  uint64_t __at_start = enc->count;
+
+  if (!vptr || nlen == 0) {
+    // empty array is omitted
+    *delta += 1;
+    return 0;
+  }
+  if (glme_encode_value_uint(enc, (unsigned int *)delta) < 0)
+    return -1;
+  if (glme_encode_columns(enc, desc, vptr, nlen) < 0) {
+    enc->count = __at_start;
+    return -1;
+  }
+  *delta = 1;
+  return enc->count - __at_start;
+}
+
+int glme_decode_field_columns(glme_buf_t *dec, unsigned int *delta, const glme_desc_t *desc,
+                              void *vptr, size_t *nlen)
+{
+  uint64_t offset, __at_start = dec->current;
+  int n;
+
+  if ((n = glme_decode_peek_uint64(dec, &offset)) < 0)
+    return n;
+  if (offset == 0 || *delta == 0) {
+    // end of struct or we have already seen end of struct
+    *delta = 0;
+    return 0;
+  }
+  if (*delta < offset) {
+    *delta += 1;
+    return 0;
+  }
+  dec->current += n;
+  if ((n = glme_decode_columns(dec, desc, (void **)vptr, nlen)) < 0) {
+    dec->current = __at_start;
+    return n;
+  }
+  *delta = 1;
+  return dec->current - __at_start;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
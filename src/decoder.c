@@ -35,6 +35,13 @@
 
 #include "gobber.h"
 #include "glme.h"
+#include "descriptor.h"
+#include "refs.h"
+#include "dict.h"
+#include "glimits.h"
+#include "map.h"
+#include "packed.h"
+#include "delta.h"
 
 static inline
 int __peek_base_type(glme_buf_t *dec, int id)
@@ -45,6 +52,13 @@ int __peek_base_type(glme_buf_t *dec, int id)
   return (dec->buf[dec->current] == (char)u) ? 1 : -1;
 }
 
+// field element type accepts wire type; single precision for floats
+static inline
+int __etype_match(int etype, int typeid)
+{
+  return typeid == etype || (etype == GLME_FLOAT && typeid == GLME_FLOAT32);
+}
+
 static inline
 int __read_base_type(glme_buf_t *dec, int *id)
 {
@@ -101,7 +115,7 @@ int glme_decode_value_int64(glme_buf_t *dec, int64_t *v)
   if (n < 0) {
     // under flow
     dec->last_error = GLME_E_UFLOW;
-    return -n;
+    return n;
   }
   dec->current += n;
   return n;
@@ -114,7 +128,7 @@ int glme_decode_peek_int64(glme_buf_t *dec, int64_t *v)
   if (n < 0) {
     // under flow
     dec->last_error = GLME_E_UFLOW;
-    return -n;
+    return n;
   }
   return n;
 }
@@ -180,7 +194,7 @@ int glme_decode_value_double(glme_buf_t *dec, double *v)
   if (n < 0) {
     // under flow
     dec->last_error = GLME_E_UFLOW;
-    return -n;
+    return n;
   }
   dec->current += n;
   return n;
@@ -195,6 +209,36 @@ int glme_decode_value_float(glme_buf_t *dec, float *v)
   return n;
 }
 
+int glme_decode_value_float32(glme_buf_t *dec, float *v)
+{
+  uint64_t u;
+  int n;
+  n = glme_decode_value_uint64(dec, &u);
+  *v = n < 0 ? 0.0 : glme_unflip_float(u);
+  return n;
+}
+
+// single precision element to double target
+static
+int __decode_value_float32_double(glme_buf_t *dec, double *v)
+{
+  float f;
+  int n = glme_decode_value_float32(dec, &f);
+  *v = f;
+  return n;
+}
+
+// element decoder for GLME_FLOAT32 elements in place of float value decoders
+static inline
+glme_decoder_f __float32_decoder(glme_decoder_f dfunc)
+{
+  if (dfunc == (glme_decoder_f)glme_decode_value_double)
+    return (glme_decoder_f)__decode_value_float32_double;
+  if (dfunc == (glme_decoder_f)glme_decode_value_float)
+    return (glme_decoder_f)glme_decode_value_float32;
+  return dfunc;
+}
+
 int glme_decode_value_complex128(glme_buf_t *dec, double complex *v)
 {
   int n;
@@ -202,7 +246,7 @@ int glme_decode_value_complex128(glme_buf_t *dec, double complex *v)
   if (n < 0) {
     // under flow
     dec->last_error = GLME_E_UFLOW;
-    return -n;
+    return n;
   }
   dec->current += n;
   return n;
@@ -284,22 +328,51 @@ int glme_decode_int(glme_buf_t *dec, int *v)
   return n < 0 ? n : n+1;
 }
 
+// floating point type of either precision
+static inline
+int __decode_float_type(glme_buf_t *dec)
+{
+  if (__peek_base_type(dec, GLME_FLOAT32) > 0) {
+    dec->current++;
+    return GLME_FLOAT32;
+  }
+  return __decode_base_type(dec, GLME_FLOAT) < 0 ? -1 : GLME_FLOAT;
+}
+
 int glme_decode_double(glme_buf_t *dec, double *v)
 {
-  if (__decode_base_type(dec, GLME_FLOAT) < 0)
+  int n, typeid;
+  float f;
+
+  if ((typeid = __decode_float_type(dec)) < 0)
     return -1;
-  int n = glme_decode_value_double(dec, v);
+  if (typeid == GLME_FLOAT32) {
+    n = glme_decode_value_float32(dec, &f);
+    *v = f;
+  } else {
+    n = glme_decode_value_double(dec, v);
+  }
   return n < 0 ? n : n+1;
 }
 
 int glme_decode_float(glme_buf_t *dec, float *v)
 {
-  if (__decode_base_type(dec, GLME_FLOAT) < 0)
+  int n, typeid;
+
+  if ((typeid = __decode_float_type(dec)) < 0)
     return -1;
-  int n = glme_decode_value_float(dec, v);
+  if (typeid == GLME_FLOAT32)
+    n = glme_decode_value_float32(dec, v);
+  else
+    n = glme_decode_value_float(dec, v);
   return n < 0 ? n : n+1;
 }
 
+int glme_decode_float32(glme_buf_t *dec, float *v)
+{
+  return glme_decode_float(dec, v);
+}
+
 int glme_decode_complex128(glme_buf_t *dec, double complex *v)
 {
   if (__decode_base_type(dec, GLME_COMPLEX) < 0)
@@ -391,10 +464,20 @@ int glme_decode_bytes(glme_buf_t *dec, void **s, size_t len)
 
 int glme_decode_string(glme_buf_t *dec, char **s)
 {
-  int n;
+  int n, typeid;
   uint64_t dlen = 0;
   char *nb;
-
+  glme_dict_t *dict = __glme_dicts ? __glme_dict_of(dec) : (glme_dict_t *)0;
+
+  if (dict && glme_decode_peek_type(dec, &typeid) > 0 && typeid < 0) {
+    // reference to string in dictionary
+    n = glme_decode_type(dec, &typeid);
+    if (__glme_dict_get(dec, dict, typeid, s) < 0) {
+      dec->current -= n;
+      return GLME_E_INVAL;
+    }
+    return n;
+  }
   if (__decode_base_type(dec, GLME_STRING) < 0)
     return -1;
 
@@ -410,13 +493,22 @@ int glme_decode_string(glme_buf_t *dec, char **s)
     return -(dlen+n);
   }
   *s = (char *)0;
+  if (dict) {
+    if (__glme_dict_add(dec, dict, &dec->buf[dec->current+n], dlen, s) < 0)
+      return GLME_E_NOMEM;
+    dec->current += dlen+n;
+    return dlen+n+1;
+  }
   nb = glme_malloc(dec, dlen+1);
-  if (nb) {
-    memcpy(nb, &dec->buf[dec->current+n], dlen);
-    nb[dlen] = '\0';
-    *s = nb;
+  if (!nb) {
+    dec->last_error = GLME_E_NOMEM;
+    return -1;
   }
-  return nb ? dlen+n+1 : -1;
+  memcpy(nb, &dec->buf[dec->current+n], dlen);
+  nb[dlen] = '\0';
+  *s = nb;
+  dec->current += dlen+n;
+  return dlen+n+1;
 }
 
 // ----------------------------------------------------------------
@@ -459,206 +551,1044 @@ int glme_decode_delta_test(glme_buf_t *dec, unsigned int delta)
   return delta == offset ? 1 : 0;
 }
 
-int glme_decode_field(glme_buf_t *dec, unsigned int *delta, int etype, int flags, 
-                      void *vptr, size_t *nlen, size_t esize, glme_decoder_f dfunc)
-{
-  int n, typeid;
-  uint64_t offset, alen, __at_start = dec->current;
-  void *nptr;
+// ---------------------------------------------------------------------
+// Skipping elements
 
-  // read offset at read pointer
-  n = gob_decode_uint64(&offset, &dec->buf[dec->current], dec->count - dec->current);
-  if (n < 0) {
-    dec->last_error = GLME_E_UFLOW;
-    return n;
-  }
+/*
+ * Elements are skipped with the wire format only. Unsigned values that fit
+ * one byte have the high bit clear, multi-byte values start with byte count
+ * 0xF8..0xFF. Runs of scalar values are scanned eight bytes at a time; single
+ * byte values are stepped over by the count of leading bytes with high bit clear.
+ */
 
-  if (offset == 0 || *delta == 0) {
-    // end of struct or we have already seen end of struct
-    *delta = 0;
-    return 0;
-  }
+#define __HIGHBITS 0x8080808080808080ull
 
-  if (*delta < offset) {
-    // not yet
-    *delta += 1;
+// length of unsigned value at p; zero if truncated, negative if malformed
+static inline
+int __uint_len(const unsigned char *p, const unsigned char *end)
+{
+  int nb;
+  if (p >= end)
     return 0;
-  }
-  // decode; set delta to 1, move read pointer and call glme_decoder_f function
-  dec->current += n;
-  if (glme_decode_peek_type(dec, &typeid) < 0)
+  if (*p < 0x80)
+    return 1;
+  nb = 256 - *p;
+  if (nb > 8)
     return -1;
+  return end - p > nb ? nb + 1 : 0;
+}
 
-  if (typeid == GLME_ARRAY && ((flags & GLME_F_ARRAY) == 0)) {
-    // not expecting array
-    dec->last_error = GLME_E_TYPE;
-    return -1;
+// skip n unsigned values
+static
+int __skip_uints(glme_buf_t *dec, uint64_t n)
+{
+  const unsigned char *p = (const unsigned char *)&dec->buf[dec->current];
+  const unsigned char *end = (const unsigned char *)&dec->buf[dec->count];
+  uint64_t w, m;
+  int k;
+
+  while (n >= 8 && end - p >= 8) {
+    memcpy(&w, p, sizeof(w));
+    if ((m = w & __HIGHBITS) == 0) {
+      p += 8;
+      n -= 8;
+      continue;
+    }
+    // single byte values before first multi-byte value
+    k = __builtin_ctzll(m) >> 3;
+    p += k;
+    n -= k;
+    if ((k = __uint_len(p, end)) <= 0)
+      goto error;
+    p += k;
+    n--;
   }
-  if (etype != 0 && typeid != GLME_ARRAY && typeid != etype) {
-    // not this type
-    dec->last_error = GLME_E_TYPE;
-    return -1;
+  for (; n > 0; n--) {
+    if ((k = __uint_len(p, end)) <= 0)
+      goto error;
+    p += k;
   }
+  dec->current = (const char *)p - dec->buf;
+  return 0;
 
-  switch (typeid) {
-  case GLME_ARRAY:
-    if ((n = glme_decode_array_start(dec, &typeid, &alen)) < 0)
-      return n;
-    if (etype != 0 && typeid != etype) {
-      dec->last_error = GLME_E_TYPE;
-      return -1;
-    }
+ error:
+  dec->last_error = k < 0 ? GLME_E_INVAL : GLME_E_UFLOW;
+  return dec->last_error;
+}
 
-    // assume that we need to allocate array element space
-    nptr = (void *)0;
-    if (*nlen > 0) {
-      // if nlen > 0 expecting fixed size array; space provided
-      nptr = (void *)(*((uint64_t **)vptr));
-      // fixed size array must have enough space
-      if (*nlen < alen)
-        return -1;
-    }
-    if ((n = glme_decode_array_data(dec, &nptr, alen, esize, dfunc)) < 0)
-      return n;
-    if (*nlen == 0) {
-      // return allocated pointer and actual length;
-      *nlen = alen;
-      *((uint64_t **)vptr) = nptr;
-    }
-    break;
+/*
+ * Skipping is iterative. Arrays and maps of compound elements are kept on a
+ * stack of frames; structures only count open field lists in the frame they
+ * are in, so chains of nested structures, e.g. linked lists, take no stack.
+ * Nested structures are charged against decode limits of the buffer.
+ */
 
-  case GLME_STRING:
-    // variable string
-    n = glme_decode_string(dec, (char **)&nptr);
-    if (n < 0)
-      return -n;
-    *((uint64_t **)vptr) = nptr;
-    break;
+struct __skip_frame
+{
+  int etype;                    // array element or map value type
+  int ktype;                    // map key type, negative for arrays
+  int value;                    // map key read, value next
+  uint64_t count;               // elements or entries left
+  uint64_t nstructs;            // structures open in this frame
+};
+
+struct __skip_ctx
+{
+  glme_limits_t *limits;        // active limits or null
+  uint64_t nopen;               // nested structures open
+  int depth;                    // number of frames
+  struct __skip_frame st[GLME_READER_DEPTH];
+};
 
-  case GLME_VECTOR:
-    // fixed size byte vector; esize is 1 and nlen is number of bytes
-    n = glme_decode_vector(dec, vptr, *nlen);
-    break;
+static inline
+int __skip_error(glme_buf_t *dec, int err)
+{
+  dec->last_error = err;
+  return err;
+}
+
+// enter structure value; fields are read by the caller loop
+static inline
+int __skip_struct(glme_buf_t *dec, struct __skip_ctx *c)
+{
+  glme_limits_t *l = c->limits;
+
+  if (l && l->maxdepth && l->depth + c->nopen >= l->maxdepth) {
+    l->exceeded = 1;
+    return __skip_error(dec, GLME_E_LIMIT);
+  }
+  c->nopen++;
+  c->st[c->depth-1].nstructs++;
+  return 0;
+}
+
+static inline
+int __skip_push(glme_buf_t *dec, struct __skip_ctx *c, int ktype, int etype, uint64_t count)
+{
+  if (c->depth == GLME_READER_DEPTH)
+    return __skip_error(dec, GLME_E_LIMIT);
+  c->st[c->depth++] = (struct __skip_frame){etype, ktype, 0, count, 0};
+  return 0;
+}
 
+// skip value of typeid; compound values are entered
+static
+int __skip_open(glme_buf_t *dec, struct __skip_ctx *c, int typeid)
+{
+  uint64_t len, nbytes;
+  int n, ktype;
+
+  if (typeid < 0)
+    // back-reference has no value
+    return 0;
+
+  switch (typeid) {
+  case GLME_BOOLEAN:
   case GLME_INT:
   case GLME_UINT:
   case GLME_FLOAT:
+  case GLME_FLOAT32:
+    return __skip_uints(dec, 1);
+
   case GLME_COMPLEX:
-    if (!dfunc) {
-      dec->last_error = GLME_E_NODEC;
-      return -1;
+    return __skip_uints(dec, 2);
+
+  case GLME_VECTOR:
+  case GLME_STRING:
+    if ((n = glme_decode_value_uint64(dec, &len)) < 0)
+      return n;
+    if (len > dec->count - dec->current)
+      return __skip_error(dec, GLME_E_UFLOW);
+    dec->current += len;
+    return 0;
+
+  case GLME_DELTA:
+    if ((n = __glme_delta_header(dec, &typeid, &ktype, &len, &nbytes)) < 0)
+      return n;
+    if (typeid == GLME_FLOAT) {
+      dec->current += nbytes;
+      return 0;
     }
-    n = (*dfunc)(dec, vptr);
-    break;
+    return __skip_uints(dec, len);
 
-  default:
+  case GLME_PACKED:
+    if ((n = __glme_packed_start(dec, &ktype, &len)) < 0)
+      return n;
+    dec->current += __glme_packed_len(ktype, len);
+    return 0;
+
+  case GLME_ARRAY:
     if ((n = glme_decode_type(dec, &typeid)) < 0)
       return n;
-    if (etype != 0 && etype != typeid) {
-      dec->last_error = GLME_E_TYPE;
-      return -1;
-    }
-    // embedded structure  or structure pointer
-    if (flags & GLME_F_PTR) {
-      // vptr is pointer to pointer (void **);
-      if (esize == 0) {
-        if ((esize = glme_get_typesize(dec, typeid)) == 0) {
-          dec->last_error = GLME_E_NOSIZE;
-          return -1;
-        }
-      }
-      nptr = glme_malloc(dec, esize);
-      if (! nptr) {
-        dec->last_error = GLME_E_NOMEM;
-        return -1;
-      }
-    } else {
-      nptr = vptr;
-    }
-    if (!dfunc) {
-      dfunc = glme_get_decoder(dec, typeid);
-      if (!dfunc) {
-        dec->last_error = GLME_E_NODEC;
-        return -1;
-      }
-    }
-    if ((n = (*dfunc)(dec, nptr)) < 0) {
-      // if we have allocated memory, release it.
-      if (flags & GLME_F_PTR)
-        free(nptr);
+    if ((n = glme_decode_value_uint64(dec, &len)) < 0)
       return n;
+    // elements have no references; every element takes at least one byte
+    if (typeid < 0)
+      return __skip_error(dec, GLME_E_TYPE);
+    if (len > dec->count - dec->current)
+      return __skip_error(dec, GLME_E_UFLOW);
+    switch (typeid) {
+    case GLME_BOOLEAN:
+    case GLME_INT:
+    case GLME_UINT:
+    case GLME_FLOAT:
+    case GLME_FLOAT32:
+      return __skip_uints(dec, len);
+    case GLME_COMPLEX:
+      return __skip_uints(dec, 2*len);
     }
-    if (flags & GLME_F_PTR) {
-      // it was a struct pointer needing 
-      // return pointer to the memory block
-      *((uintptr_t **)vptr) = nptr;
-    }
-    break;
-  }
-  if (n > 0)
-    *delta = 1;
-  return n < 0 ? n : dec->current - __at_start;
-}
+    return len > 0 ? __skip_push(dec, c, -1, typeid, len) : 0;
 
+  case GLME_MAP:
+    if ((n = glme_decode_type(dec, &ktype)) < 0 || (n = glme_decode_type(dec, &typeid)) < 0)
+      return n;
+    if ((n = glme_decode_value_uint64(dec, &len)) < 0)
+      return n;
+    if (ktype < 0 || typeid < 0)
+      return __skip_error(dec, GLME_E_TYPE);
+    if (len > (dec->count - dec->current) / 2)
+      return __skip_error(dec, GLME_E_UFLOW);
+    return len > 0 ? __skip_push(dec, c, ktype, typeid, len) : 0;
 
-int glme_decode_struct(glme_buf_t *dec, int typeid, void **dptr, size_t esize, glme_decoder_f dfunc)
-{
-  uint64_t __at_start = dec->current;
-  int n, typ;
-  void *nptr, *sptr = (*dptr);
+  case GLME_COLUMNS:
+    if ((n = glme_decode_type(dec, &typeid)) < 0)
+      return n;
+    if ((n = glme_decode_value_uint64(dec, &len)) < 0)
+      return n;
+    if (typeid <= GLME_BASE_MAX)
+      return __skip_error(dec, GLME_E_TYPE);
+    return __skip_struct(dec, c);
+  }
 
-  if (! dfunc)
-    return -1;
+  if (typeid <= GLME_BASE_MAX)
+    return __skip_error(dec, GLME_E_TYPE);
+  return __skip_struct(dec, c);
+}
 
-  if (glme_decode_type(dec, &typ) < 0)
-    return -1;
+// skip value of typeid, or fields up to and including end of structure
+static
+int __skip(glme_buf_t *dec, int typeid, int fields)
+{
+  struct __skip_ctx c;
+  struct __skip_frame *f;
+  uint64_t delta;
+  int n;
 
-  // if specified type id is non-zero check decoded id.
-  if (typeid != 0 && typ != typeid) {
-    dec->last_error = GLME_E_TYPE;
-    return -1;
-  }
+  c.limits = __glme_limits ? __glme_limits_of(dec) : (glme_limits_t *)0;
+  c.nopen = 0;
+  c.depth = 1;
+  c.st[0] = (struct __skip_frame){0, -1, 0, 0, fields ? 1 : 0};
+  if (!fields && (n = __skip_open(dec, &c, typeid)) < 0)
+    return n;
 
-  if (!dfunc) {
-    // try to find decoder function
-    if (!(dfunc = glme_get_decoder(dec, typeid))) {
-      dec->last_error = GLME_E_NODEC;
-      return -1;
+  while (c.depth > 1 || c.st[0].nstructs > 0) {
+    f = &c.st[c.depth-1];
+    if (f->nstructs > 0) {
+      // field of innermost structure
+      if ((n = glme_decode_value_uint64(dec, &delta)) < 0)
+        return n;
+      if (delta == 0) {
+        f->nstructs--;
+        if (c.nopen > 0)
+          c.nopen--;
+        continue;
+      }
+      if ((n = glme_decode_type(dec, &typeid)) < 0)
+        return n;
+    } else if (f->count == 0) {
+      c.depth--;
+      continue;
+    } else if (f->ktype >= 0 && !f->value) {
+      typeid = f->ktype;
+      f->value = 1;
+    } else {
+      typeid = f->etype;
+      f->value = 0;
+      f->count--;
+      if (typeid == GLME_ANY && (n = glme_decode_type(dec, &typeid)) < 0)
+        return n;
     }
+    if ((n = __skip_open(dec, &c, typeid)) < 0)
+      return n;
   }
+  return 0;
+}
 
-  nptr = sptr;
-  if (!sptr) {
-    // allocate space
-    if (esize == 0 && (esize = glme_get_typesize(dec, typ)) == 0) {
-      dec->last_error = GLME_E_NOSIZE;
-      return -1;
-    }
-    nptr = glme_malloc(dec, esize);
-    if (!nptr) {
-      dec->last_error = GLME_E_NOMEM;
-      return -1;
-    }
-  }
-  if ((n = (*dfunc)(dec, nptr) ) < 0) {
-    if (!sptr)
-      glme_free(dec, nptr);
+int glme_skip(glme_buf_t *dec)
+{
+  uint64_t __at_start = dec->current;
+  int typeid, n;
+
+  if ((n = glme_decode_type(dec, &typeid)) < 0 || (n = __skip(dec, typeid, 0)) < 0) {
+    dec->current = __at_start;
     return n;
   }
-  if (!sptr)
-    *dptr = nptr;
   return dec->current - __at_start;
 }
 
-int glme_decode_value_struct(glme_buf_t *dec, void **dptr, size_t esize, glme_decoder_f dfunc)
+int glme_skip_fields(glme_buf_t *dec)
 {
   uint64_t __at_start = dec->current;
   int n;
-  void *nptr, *sptr = (*dptr);
 
-  if (!dfunc) {
-    dec->last_error = GLME_E_NODEC;
-    return -1;
+  if ((n = __skip(dec, 0, 1)) < 0) {
+    dec->current = __at_start;
+    return n;
+  }
+  return dec->current - __at_start;
+}
+
+int glme_decode_field_skip(glme_buf_t *dec, unsigned int *delta)
+{
+  uint64_t offset, __at_start = dec->current;
+  int n, typeid;
+
+  n = gob_decode_uint64(&offset, &dec->buf[dec->current], dec->count - dec->current);
+  if (n < 0) {
+    dec->last_error = GLME_E_UFLOW;
+    return n;
+  }
+  if (offset == 0 || *delta == 0) {
+    *delta = 0;
+    return 0;
+  }
+  if (*delta < offset) {
+    *delta += 1;
+    return 0;
+  }
+  dec->current += n;
+  if ((n = glme_decode_type(dec, &typeid)) < 0 || (n = __skip(dec, typeid, 0)) < 0) {
+    dec->current = __at_start;
+    return n;
+  }
+  *delta = 1;
+  return dec->current - __at_start;
+}
+
+// ---------------------------------------------------------------------
+// Maps
+
+/*
+ * Map entries are decoded with keys, strings and encoded values referring to
+ * the decode buffer and given to an insert function. Map table copies them to
+ * a block sized by the encoded length of the whole map, which bounds the
+ * copies: a string takes at least one length byte more on the wire than its
+ * terminated copy.
+ */
+
+// string or vector data at read pointer
+static
+int __map_bytes(glme_buf_t *dec, const char **ptr, size_t *len)
+{
+  uint64_t dlen;
+  int n;
+
+  if ((n = glme_decode_value_uint64(dec, &dlen)) < 0)
+    return n;
+  if (dlen > dec->count - dec->current) {
+    dec->last_error = GLME_E_UFLOW;
+    return GLME_E_UFLOW;
+  }
+  *ptr = &dec->buf[dec->current];
+  *len = dlen;
+  dec->current += dlen;
+  return 0;
+}
+
+static
+int __map_key(glme_buf_t *dec, int ktype, glme_mapent_t *e)
+{
+  switch (ktype) {
+  case GLME_INT:
+    return glme_decode_value_int64(dec, &e->key.i);
+  case GLME_UINT:
+    return glme_decode_value_uint64(dec, &e->key.u);
+  }
+  return __map_bytes(dec, &e->key.s.ptr, &e->key.s.len);
+}
+
+static
+int __map_value(glme_buf_t *dec, int type, glme_mapent_t *e)
+{
+  size_t at = dec->current;
+  int n;
+
+  e->type = type;
+  switch (type) {
+  case GLME_INT:
+    return glme_decode_value_int64(dec, &e->v.i);
+  case GLME_BOOLEAN:
+  case GLME_UINT:
+    return glme_decode_value_uint64(dec, &e->v.u);
+  case GLME_FLOAT:
+    return glme_decode_value_double(dec, &e->v.f);
+  case GLME_FLOAT32:
+    return __decode_value_float32_double(dec, &e->v.f);
+  case GLME_COMPLEX:
+    return glme_decode_value_complex128(dec, &e->v.c);
+  case GLME_STRING:
+  case GLME_VECTOR:
+    return __map_bytes(dec, &e->v.s.ptr, &e->v.s.len);
+  }
+  if ((n = __skip(dec, type, 0)) < 0)
+    return n;
+  e->v.s.ptr = &dec->buf[at];
+  e->v.s.len = dec->current - at;
+  return 0;
+}
+
+// decode map header and entries after map type id
+static
+int __decode_map(glme_buf_t *dec, glme_map_insert_f insert, void *table)
+{
+  glme_mapent_t e;
+  uint64_t k, count;
+  int n, ktype, etype, type;
+
+  if ((n = glme_decode_type(dec, &ktype)) < 0 || (n = glme_decode_type(dec, &etype)) < 0)
+    return n;
+  if ((n = glme_decode_value_uint64(dec, &count)) < 0)
+    return n;
+  if (ktype != GLME_INT && ktype != GLME_UINT && ktype != GLME_STRING) {
+    dec->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  // key and value take one byte at least
+  if (count > (dec->count - dec->current) / 2) {
+    dec->last_error = GLME_E_UFLOW;
+    return GLME_E_UFLOW;
+  }
+  if ((n = (*insert)(table, ktype, etype, count, (glme_mapent_t *)0)) < 0)
+    return n;
+  for (k = 0; k < count; k++) {
+    if ((n = __map_key(dec, ktype, &e)) < 0)
+      return n;
+    type = etype;
+    if (etype == GLME_ANY && (n = glme_decode_type(dec, &type)) < 0)
+      return n;
+    if ((n = __map_value(dec, type, &e)) < 0)
+      return n;
+    if ((n = (*insert)(table, ktype, etype, count, &e)) < 0)
+      return n;
+  }
+  return 0;
+}
+
+struct __map_ctx {
+  glme_buf_t *dec;
+  glme_map_t *map;
+  size_t len;                   // encoded length of map
+  char *data;                   // next free byte of copy block
+};
+
+static inline
+const char *__map_copy(struct __map_ctx *c, const char *ptr, size_t len, int term)
+{
+  char *p = c->data;
+  memcpy(p, ptr, len);
+  if (term)
+    p[len] = '\0';
+  c->data += len + term;
+  return p;
+}
+
+// insert function of map table
+static
+int __map_insert(void *table, int ktype, int etype, uint64_t count, const glme_mapent_t *e)
+{
+  struct __map_ctx *c = (struct __map_ctx *)table;
+  glme_map_t *map = c->map;
+  glme_mapent_t t;
+  int n;
+
+  if (!e) {
+    if (map->count > 0 && map->ktype != ktype) {
+      c->dec->last_error = GLME_E_TYPE;
+      return GLME_E_TYPE;
+    }
+    map->ktype = ktype;
+    map->etype = etype;
+    if ((n = __glme_map_reserve(c->dec, map, map->count + count)) < 0)
+      return n;
+    if (count > 0 && (ktype == GLME_STRING || etype == GLME_ANY ||
+                      (etype > GLME_COMPLEX && etype != GLME_FLOAT32) ||
+                      etype == GLME_STRING || etype == GLME_VECTOR)) {
+      if (!(c->data = __glme_map_block(c->dec, map, c->len)))
+        return GLME_E_NOMEM;
+    }
+    return 0;
+  }
+  t = *e;
+  if (ktype == GLME_STRING)
+    t.key.s.ptr = __map_copy(c, e->key.s.ptr, e->key.s.len, 1);
+  switch (e->type) {
+  case GLME_BOOLEAN:
+  case GLME_INT:
+  case GLME_UINT:
+  case GLME_FLOAT:
+  case GLME_FLOAT32:
+  case GLME_COMPLEX:
+    break;
+  default:
+    t.v.s.ptr = __map_copy(c, e->v.s.ptr, e->v.s.len,
+                           e->type == GLME_STRING || e->type == GLME_VECTOR);
+  }
+  return glme_map_put(c->dec, map, &t);
+}
+
+int glme_decode_map(glme_buf_t *dec, glme_map_t *map)
+{
+  struct __map_ctx c = {dec, map, 0, (char *)0};
+  uint64_t __at_start = dec->current;
+  int n;
+
+  // encoded length bounds copied strings and values
+  if ((n = glme_skip(dec)) < 0)
+    return n;
+  c.len = n;
+  dec->current = __at_start;
+  if (__decode_base_type(dec, GLME_MAP) < 0) {
+    dec->current = __at_start;
+    dec->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  if ((n = __decode_map(dec, __map_insert, &c)) < 0) {
+    dec->current = __at_start;
+    return n;
+  }
+  return dec->current - __at_start;
+}
+
+int glme_decode_map_to(glme_buf_t *dec, glme_map_insert_f insert, void *table)
+{
+  uint64_t __at_start = dec->current;
+  int n;
+
+  if (__decode_base_type(dec, GLME_MAP) < 0) {
+    dec->current = __at_start;
+    dec->last_error = dec->current < dec->count ? GLME_E_TYPE : GLME_E_UFLOW;
+    return dec->last_error;
+  }
+  if ((n = __decode_map(dec, insert, table)) < 0) {
+    dec->current = __at_start;
+    return n;
+  }
+  return dec->current - __at_start;
+}
+
+// ---------------------------------------------------------------------
+// Field index
+
+/*
+ * Index records position of every field of a structure; field values are
+ * skipped, not decoded. Field numbers are ascending, entries are looked up
+ * with binary search. Indexed field is decoded with glme_decode_field from
+ * its delta with decoder's field counter past any delta.
+ */
+
+int glme_index_struct(glme_buf_t *dec, glme_index_t *index)
+{
+  uint64_t delta, pos, __at_start = dec->current;
+  unsigned int fno = 0;
+  glme_index_entry_t *e;
+  size_t size;
+  int n, typeid;
+
+  index->count = 0;
+  index->start = __at_start;
+  if ((n = glme_decode_type(dec, &index->typeid)) < 0)
+    goto error;
+  if (index->typeid <= GLME_BASE_MAX) {
+    dec->last_error = n = GLME_E_TYPE;
+    goto error;
+  }
+  for (;;) {
+    pos = dec->current;
+    if ((n = glme_decode_value_uint64(dec, &delta)) < 0)
+      goto error;
+    if (delta == 0)
+      break;
+    if ((n = glme_decode_type(dec, &typeid)) < 0)
+      goto error;
+    if (index->count == index->size) {
+      size = index->size ? 2*index->size : 16;
+      e = (glme_index_entry_t *)glme_realloc(dec, index->fields, size * sizeof(glme_index_entry_t));
+      if (!e) {
+        dec->last_error = n = GLME_E_NOMEM;
+        goto error;
+      }
+      index->fields = e;
+      index->size = size;
+    }
+    fno += delta;
+    index->fields[index->count++] = (glme_index_entry_t){fno - 1, typeid, pos};
+    if ((n = __skip(dec, typeid, 0)) < 0)
+      goto error;
+  }
+  index->end = dec->current;
+  return dec->current - __at_start;
+
+ error:
+  index->count = 0;
+  dec->current = __at_start;
+  return n;
+}
+
+const glme_index_entry_t *glme_index_find(const glme_index_t *index, unsigned int fno)
+{
+  size_t lo = 0, hi = index->count, mid;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (index->fields[mid].fno < fno)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < index->count && index->fields[lo].fno == fno)
+    return &index->fields[lo];
+  return (const glme_index_entry_t *)0;
+}
+
+int glme_decode_indexed(glme_buf_t *dec, const glme_index_t *index, unsigned int fno,
+                        int etype, int flags, void *vptr, size_t *nlen, size_t esize,
+                        glme_decoder_f dfunc)
+{
+  const glme_index_entry_t *e;
+  uint64_t current = dec->current;
+  unsigned int delta = ~0u;
+  int n;
+
+  if (!(e = glme_index_find(index, fno)))
+    return 0;
+  dec->current = e->offset;
+  n = glme_decode_field(dec, &delta, etype, flags, vptr, nlen, esize, dfunc);
+  dec->current = current;
+  return n;
+}
+
+void glme_index_release(glme_buf_t *dec, glme_index_t *index)
+{
+  if (index->fields)
+    glme_free(dec, index->fields);
+  glme_index_init(index);
+}
+
+// ---------------------------------------------------------------------
+// Tail structure pointer fields
+
+/*
+ * Decoder functions are called through __decode_value which installs a tail
+ * context for the decoder. Structure pointer decoded with glme_decode_field_tail
+ * is then only allocated and linked and left pending in the context; the
+ * decoder function finishes and __decode_value calls the decoder of the
+ * pending structure next. Linked lists decode in a loop without C stack growth.
+ * End markers of structures with deferred tail follow the tail structure in
+ * the stream and are read after the whole chain. Linked node slots are kept
+ * on a heap allocated stack for unlinking on errors.
+ *
+ * Decoder functions called outside __decode_value see no context and decode
+ * tail fields recursively.
+ */
+
+struct __tail_ctx {
+  glme_buf_t *dec;
+  glme_decoder_f dfunc;         // decoder of pending structure
+  glme_spec_t *spec;            // or its spec
+  void *ptr;                    // pending structure; null if none
+  size_t nends;                 // deferred end markers
+  int skip;                     // skip unknown fields before end markers
+  size_t nslots;                // linked node slots
+  size_t size;
+  void ***slots;
+};
+
+static __thread struct __tail_ctx *__tail;
+
+// decode structure value with decoder function or spec; deferred tails in a loop
+static
+int __decode_value(glme_buf_t *dec, glme_decoder_f dfunc, glme_spec_t *spec, void *ptr)
+{
+  struct __tail_ctx t, *outer = __tail;
+  glme_limits_t *limits;
+  int n;
+
+  limits = __glme_depth_enter(dec, &n);
+  if (n < 0)
+    return n;
+  t = (struct __tail_ctx){dec, (glme_decoder_f)0, (glme_spec_t *)0, (void *)0, 0, 0, 0, 0,
+                          (void ***)0};
+  __tail = &t;
+  for (;;) {
+    n = dfunc ? (*dfunc)(dec, ptr) :
+      spec->decoder ? (*spec->decoder)(dec, ptr) : glme_decode_desc(dec, spec->desc, ptr);
+    if (n < 0 || !t.ptr)
+      break;
+    ptr = t.ptr;
+    dfunc = t.dfunc;
+    spec = t.spec;
+    t.ptr = (void *)0;
+  }
+  __tail = outer;
+
+  for (; n >= 0 && t.nends > 0; t.nends--) {
+    if (t.skip) {
+      if (__skip(dec, 0, 1) < 0)
+        n = -1;
+      continue;
+    }
+    if (dec->current >= dec->count || dec->buf[dec->current] != 0) {
+      dec->last_error = dec->current >= dec->count ? GLME_E_UFLOW : GLME_E_TYPE;
+      n = -1;
+      break;
+    }
+    dec->current++;
+  }
+  if (n < 0) {
+    // unlink and release deferred nodes, last first
+    for (; t.nslots > 0; t.nslots--) {
+      glme_free(dec, *t.slots[t.nslots-1]);
+      *t.slots[t.nslots-1] = (void *)0;
+    }
+  }
+  if (t.slots)
+    glme_free(dec, t.slots);
+  __glme_depth_leave(limits);
+  return n;
+}
+
+int glme_decode_field_tail(glme_buf_t *dec, unsigned int *delta, int typeid,
+                           void *vptr, size_t esize, glme_decoder_f dfunc)
+{
+  struct __tail_ctx *t = __tail;
+  glme_spec_t *spec = (glme_spec_t *)0;
+  glme_refs_t *refs;
+  uint64_t offset, __at_start = dec->current;
+  void ***slots, *nptr;
+  int n, typ;
+
+  if (!t || t->dec != dec || t->ptr)
+    return glme_decode_field(dec, delta, typeid, GLME_F_PTR, vptr, (size_t *)0, esize, dfunc);
+
+  n = gob_decode_uint64(&offset, &dec->buf[dec->current], dec->count - dec->current);
+  if (n < 0) {
+    dec->last_error = GLME_E_UFLOW;
+    return n;
+  }
+  if (offset == 0 || *delta == 0) {
+    *delta = 0;
+    return 0;
+  }
+  if (*delta < offset) {
+    *delta += 1;
+    return 0;
+  }
+  dec->current += n;
+  if (glme_decode_type(dec, &typ) < 0)
+    return -1;
+  if (typ < 0) {
+    if ((n = __glme_refs_get(dec, typ, typeid, (void **)vptr)) < 0)
+      return n;
+    *delta = 1;
+    return dec->current - __at_start;
+  }
+  if (typeid != 0 && typ != typeid) {
+    dec->last_error = GLME_E_TYPE;
+    return -1;
+  }
+  if (!dfunc) {
+    spec = glme_get_spec(dec, typ);
+    if (!spec || (!spec->decoder && !spec->desc)) {
+      dec->last_error = GLME_E_NODEC;
+      return -1;
+    }
+  }
+  if (esize == 0 && (esize = glme_get_typesize(dec, typ)) == 0) {
+    dec->last_error = GLME_E_NOSIZE;
+    return -1;
+  }
+  if (t->nslots == t->size) {
+    slots = (void ***)glme_realloc(dec, t->slots, (t->size ? 2*t->size : 64) * sizeof(void **));
+    if (!slots) {
+      dec->last_error = GLME_E_NOMEM;
+      return -1;
+    }
+    t->slots = slots;
+    t->size = t->size ? 2*t->size : 64;
+  }
+  if (!(nptr = glme_malloc(dec, esize))) {
+    dec->last_error = GLME_E_NOMEM;
+    return -1;
+  }
+  if ((refs = __glme_refs_of(dec)) && __glme_refs_add(dec, refs, nptr, typ) < 0) {
+    glme_free(dec, nptr);
+    return -1;
+  }
+  *(void **)vptr = nptr;
+  t->slots[t->nslots++] = (void **)vptr;
+  t->ptr = nptr;
+  t->dfunc = dfunc;
+  t->spec = spec;
+  *delta = 1;
+  return dec->current - __at_start;
+}
+
+int glme_decode_field(glme_buf_t *dec, unsigned int *delta, int etype, int flags, 
+                      void *vptr, size_t *nlen, size_t esize, glme_decoder_f dfunc)
+{
+  int n, typeid;
+  uint64_t offset, alen, __at_start = dec->current;
+  size_t dlen;
+  void *nptr;
+  glme_spec_t *spec = (glme_spec_t *)0;
+  glme_refs_t *refs;
+
+  // read offset at read pointer
+  n = gob_decode_uint64(&offset, &dec->buf[dec->current], dec->count - dec->current);
+  if (n < 0) {
+    dec->last_error = GLME_E_UFLOW;
+    return n;
+  }
+
+  if (offset == 0 || *delta == 0) {
+    // end of struct or we have already seen end of struct
+    *delta = 0;
+    return 0;
+  }
+
+  if (*delta < offset) {
+    // not yet
+    *delta += 1;
+    return 0;
+  }
+  // decode; set delta to 1, move read pointer and call glme_decoder_f function
+  dec->current += n;
+  if (glme_decode_peek_type(dec, &typeid) < 0)
+    return -1;
+
+  if (typeid < 0 && etype == GLME_STRING && !(flags & GLME_F_ARRAY)) {
+    // reference to string in dictionary
+    if ((n = glme_decode_string(dec, (char **)vptr)) < 0)
+      return n;
+    *delta = 1;
+    return dec->current - __at_start;
+  }
+  if (typeid < 0) {
+    // back-reference to structure decoded earlier; pointer fields only
+    if ((flags & (GLME_F_PTR|GLME_F_ARRAY)) != GLME_F_PTR) {
+      dec->last_error = GLME_E_TYPE;
+      return -1;
+    }
+    if ((n = glme_decode_type(dec, &typeid)) < 0)
+      return n;
+    if ((n = __glme_refs_get(dec, typeid, etype, (void **)vptr)) < 0)
+      return n;
+    *delta = 1;
+    return dec->current - __at_start;
+  }
+
+  if ((typeid == GLME_ARRAY || typeid == GLME_DELTA) && ((flags & GLME_F_ARRAY) == 0)) {
+    // not expecting array
+    dec->last_error = GLME_E_TYPE;
+    return -1;
+  }
+  if (etype != 0 && typeid != GLME_ARRAY && typeid != GLME_DELTA && !__etype_match(etype, typeid)) {
+    // not this type
+    dec->last_error = GLME_E_TYPE;
+    return -1;
+  }
+
+  switch (typeid) {
+  case GLME_ARRAY:
+    if ((n = glme_decode_array_start(dec, &typeid, &alen)) < 0)
+      return n;
+    if (etype != 0 && !__etype_match(etype, typeid)) {
+      dec->last_error = GLME_E_TYPE;
+      return -1;
+    }
+    if (typeid == GLME_FLOAT32)
+      dfunc = __float32_decoder(dfunc);
+
+    // assume that we need to allocate array element space
+    nptr = (void *)0;
+    if (*nlen > 0) {
+      // if nlen > 0 expecting fixed size array; space provided
+      nptr = (void *)(*((uint64_t **)vptr));
+      // fixed size array must have enough space
+      if (*nlen < alen)
+        return -1;
+    }
+    if ((n = glme_decode_array_data(dec, &nptr, alen, esize, dfunc)) < 0)
+      return n;
+    if (*nlen == 0) {
+      // return allocated pointer and actual length;
+      *nlen = alen;
+      *((uint64_t **)vptr) = nptr;
+    }
+    break;
+
+  case GLME_DELTA:
+    // delta encoded numeric array
+    nptr = *nlen > 0 ? (void *)(*((uint64_t **)vptr)) : (void *)0;
+    dlen = *nlen;
+    if ((n = glme_decode_delta(dec, &etype, &nptr, &dlen, esize)) < 0)
+      return n;
+    if (*nlen == 0) {
+      *nlen = dlen;
+      *((uint64_t **)vptr) = nptr;
+    }
+    break;
+
+  case GLME_STRING:
+    // variable string
+    n = glme_decode_string(dec, (char **)&nptr);
+    if (n < 0)
+      return n;
+    *((uint64_t **)vptr) = nptr;
+    break;
+
+  case GLME_VECTOR:
+    // fixed size byte vector; esize is 1 and nlen is number of bytes
+    n = glme_decode_vector(dec, vptr, *nlen);
+    break;
+
+  case GLME_MAP:
+    n = glme_decode_map(dec, (glme_map_t *)vptr);
+    break;
+
+  case GLME_INT:
+  case GLME_UINT:
+  case GLME_FLOAT:
+  case GLME_FLOAT32:
+  case GLME_COMPLEX:
+    if (!dfunc) {
+      dec->last_error = GLME_E_NODEC;
+      return -1;
+    }
+    n = (*dfunc)(dec, vptr);
+    break;
+
+  default:
+    if ((n = glme_decode_type(dec, &typeid)) < 0)
+      return n;
+    if (etype != 0 && etype != typeid) {
+      dec->last_error = GLME_E_TYPE;
+      return -1;
+    }
+    // embedded structure  or structure pointer
+    if (flags & GLME_F_PTR) {
+      // vptr is pointer to pointer (void **);
+      if (esize == 0) {
+        if ((esize = glme_get_typesize(dec, typeid)) == 0) {
+          dec->last_error = GLME_E_NOSIZE;
+          return -1;
+        }
+      }
+      nptr = glme_malloc(dec, esize);
+      if (! nptr) {
+        dec->last_error = GLME_E_NOMEM;
+        return -1;
+      }
+    } else {
+      nptr = vptr;
+    }
+    if ((refs = __glme_refs_of(dec)) && __glme_refs_add(dec, refs, nptr, typeid) < 0) {
+      if (flags & GLME_F_PTR)
+        glme_free(dec, nptr);
+      return -1;
+    }
+    if (!dfunc) {
+      // registered decoder function or descriptor table
+      spec = glme_get_spec(dec, typeid);
+      if (!spec || (!spec->decoder && !spec->desc)) {
+        dec->last_error = GLME_E_NODEC;
+        return -1;
+      }
+    }
+    n = __decode_value(dec, dfunc, spec, nptr);
+    if (n < 0) {
+      // if we have allocated memory, release it.
+      if (flags & GLME_F_PTR)
+        free(nptr);
+      return n;
+    }
+    if (flags & GLME_F_PTR) {
+      // it was a struct pointer needing 
+      // return pointer to the memory block
+      *((uintptr_t **)vptr) = nptr;
+    }
+    break;
+  }
+  if (n > 0)
+    *delta = 1;
+  return n < 0 ? n : dec->current - __at_start;
+}
+
+
+int glme_decode_struct(glme_buf_t *dec, int typeid, void **dptr, size_t esize, glme_decoder_f dfunc)
+{
+  uint64_t __at_start = dec->current;
+  int n, typ;
+  void *nptr, *sptr = (*dptr);
+  glme_spec_t *spec = (glme_spec_t *)0;
+  glme_refs_t *refs;
+
+  if (glme_decode_type(dec, &typ) < 0)
+    return -1;
+
+  // if specified type id is non-zero check decoded id.
+  if (typeid != 0 && typ != typeid) {
+    dec->last_error = GLME_E_TYPE;
+    return -1;
+  }
+
+  if (!dfunc) {
+    // try to find decoder function or descriptor table
+    spec = glme_get_spec(dec, typ);
+    if (!spec || (!spec->decoder && !spec->desc)) {
+      dec->last_error = GLME_E_NODEC;
+      return -1;
+    }
+  }
+
+  nptr = sptr;
+  if (!sptr) {
+    // allocate space
+    if (esize == 0 && (esize = glme_get_typesize(dec, typ)) == 0) {
+      dec->last_error = GLME_E_NOSIZE;
+      return -1;
+    }
+    nptr = glme_malloc(dec, esize);
+    if (!nptr) {
+      dec->last_error = GLME_E_NOMEM;
+      return -1;
+    }
+  }
+  if ((refs = __glme_refs_of(dec)) && __glme_refs_add(dec, refs, nptr, typ) < 0) {
+    if (!sptr)
+      glme_free(dec, nptr);
+    return -1;
+  }
+  n = __decode_value(dec, dfunc, spec, nptr);
+  if (n < 0) {
+    if (!sptr)
+      glme_free(dec, nptr);
+    return n;
+  }
+  if (!sptr)
+    *dptr = nptr;
+  return dec->current - __at_start;
+}
+
+int glme_decode_value_struct(glme_buf_t *dec, void **dptr, size_t esize, glme_decoder_f dfunc)
+{
+  uint64_t __at_start = dec->current;
+  int n;
+  void *nptr, *sptr = (*dptr);
+
+  if (!dfunc) {
+    dec->last_error = GLME_E_NODEC;
+    return -1;
   }
 
   nptr = sptr;
@@ -674,7 +1604,7 @@ int glme_decode_value_struct(glme_buf_t *dec, void **dptr, size_t esize, glme_de
     }
   }
   // decode
-  if ((n = (*dfunc)(dec, nptr) ) < 0) {
+  if ((n = __decode_value(dec, dfunc, (glme_spec_t *)0, nptr)) < 0) {
     if (!sptr)
       glme_free(dec, nptr);
     return n;
@@ -697,6 +1627,12 @@ int glme_decode_end_struct(glme_buf_t *dec)
 {
   int n;
   uint64_t endm;
+
+  if (__tail && __tail->ptr && __tail->dec == dec) {
+    // end marker follows deferred tail structure
+    __tail->nends++;
+    return 1;
+  }
   n = gob_decode_uint64(&endm, &dec->buf[dec->current], dec->count-dec->current);
   if (n != 1) {
     return -1;
@@ -708,6 +1644,16 @@ int glme_decode_end_struct(glme_buf_t *dec)
   return n;
 }
 
+int glme_decode_end_struct_skip(glme_buf_t *dec)
+{
+  if (__tail && __tail->ptr && __tail->dec == dec) {
+    __tail->nends++;
+    __tail->skip = 1;
+    return 1;
+  }
+  return glme_skip_fields(dec);
+}
+
 // ---------------------------------------------------------------------
 // Array decoding functions
 
@@ -740,22 +1686,42 @@ int glme_decode_array_data(glme_buf_t *dec, void **dst,
                            size_t len, size_t esize, glme_decoder_f func)
 {
   char *ptr = (char *)(*dst);
+  struct __tail_ctx *outer = __tail;
+  glme_limits_t *limits;
   int k, n;
   size_t i, __at_start = dec->current;
 
   if (len == 0)
     return 0;
+  // every element takes at least one byte; reject counts before allocating
+  if (len > dec->count - dec->current) {
+    dec->last_error = GLME_E_UFLOW;
+    return -1;
+  }
+  limits = __glme_depth_enter(dec, &n);
+  if (n < 0)
+    return n;
 
   if (! ptr) {
     ptr = (char *)glme_calloc(dec, len, esize);
-    if (! ptr)
-      return -1; 
+    if (! ptr) {
+      __glme_depth_leave(limits);
+      dec->last_error = GLME_E_NOMEM;
+      return -1;
+    }
     *(char **)dst = ptr;
   }
+  // element decoders decode tail fields recursively
+  __tail = (struct __tail_ctx *)0;
   for (k = 0, i = 0; k < len; k++, i += esize) {
-    if ((n = (*func)(dec, (void *)&ptr[i])) < 0)
+    if ((n = (*func)(dec, (void *)&ptr[i])) < 0) {
+      __tail = outer;
+      __glme_depth_leave(limits);
       return n;
+    }
   }
+  __tail = outer;
+  __glme_depth_leave(limits);
   return dec->current - __at_start;
 }
 
@@ -766,6 +1732,10 @@ int glme_decode_array(glme_buf_t *dec, int *typeid, void **dst,
   size_t alen;
   uint64_t __at_start = dec->current;
 
+  if (dec->current < dec->count && dec->buf[dec->current] == (char)(GLME_DELTA << 1)) {
+    *typeid = 0;
+    return glme_decode_delta(dec, typeid, dst, len, esize);
+  }
   if (__decode_base_type(dec, GLME_ARRAY) < 0)
     return -1;
   
@@ -774,6 +1744,8 @@ int glme_decode_array(glme_buf_t *dec, int *typeid, void **dst,
 
   if (*len > 0 && *len < alen)
     return -1;
+  if (*typeid == GLME_FLOAT32)
+    dfunc = __float32_decoder(dfunc);
   
   if (glme_decode_array_data(dec, dst, alen, esize, dfunc) < 0)
     return -1;
@@ -794,6 +1766,8 @@ int glme_decode_value_array(glme_buf_t *dec, int *typeid, void **dst,
 
   if (*len > 0 && *len < alen)
     return -1;
+  if (*typeid == GLME_FLOAT32)
+    dfunc = __float32_decoder(dfunc);
   
   if (glme_decode_array_data(dec, dst, alen, esize, dfunc) < 0)
     return -1;
@@ -802,6 +1776,406 @@ int glme_decode_value_array(glme_buf_t *dec, int *typeid, void **dst,
 }
 
 
+// ---------------------------------------------------------------------
+// Descriptor table decoding
+
+// read unsigned varint; single byte values without function call
+static inline
+int __desc_uint64(glme_buf_t *dec, uint64_t *v)
+{
+  int n;
+  if (dec->current < dec->count && (signed char)dec->buf[dec->current] >= 0) {
+    *v = (unsigned char)dec->buf[dec->current++];
+    return 1;
+  }
+  n = gob_decode_uint64(v, &dec->buf[dec->current], dec->count - dec->current);
+  if (n < 0)
+    return GLME_E_UFLOW;
+  dec->current += n;
+  return n;
+}
+
+static inline
+void __desc_store(int op, void *p, uint64_t u)
+{
+  switch (op) {
+  case GLME_OP_I8:
+  case GLME_OP_U8:
+    *(uint8_t *)p = (uint8_t)u;
+    break;
+  case GLME_OP_I16:
+  case GLME_OP_U16:
+    *(uint16_t *)p = (uint16_t)u;
+    break;
+  case GLME_OP_I32:
+  case GLME_OP_U32:
+    *(uint32_t *)p = (uint32_t)u;
+    break;
+  case GLME_OP_I64:
+  case GLME_OP_U64:
+    *(uint64_t *)p = u;
+    break;
+  }
+}
+
+static inline
+int __desc_lenop(int lensize)
+{
+  return lensize == 1 ? GLME_OP_U8 : lensize == 2 ? GLME_OP_U16 :
+    lensize == 4 ? GLME_OP_U32 : GLME_OP_U64;
+}
+
+// decode scalar value without type information
+static inline
+int __desc_scalar(glme_buf_t *dec, int op, void *p)
+{
+  union { uint64_t u; double d; } v;
+
+  if (__desc_uint64(dec, &v.u) < 0)
+    return GLME_E_UFLOW;
+  switch (op) {
+  case GLME_OP_I8:
+  case GLME_OP_I16:
+  case GLME_OP_I32:
+  case GLME_OP_I64:
+    __desc_store(op, p, v.u & 1 ? ~(v.u >> 1) : v.u >> 1);
+    break;
+  case GLME_OP_F32:
+    v.u = __builtin_bswap64(v.u);
+    *(float *)p = (float)v.d;
+    break;
+  case GLME_OP_F64:
+    v.u = __builtin_bswap64(v.u);
+    *(double *)p = v.d;
+    break;
+  default:
+    __desc_store(op, p, v.u);
+    break;
+  }
+  return 0;
+}
+
+// decode single precision value to float or double
+static inline
+int __desc_float32(glme_buf_t *dec, int op, void *p)
+{
+  uint64_t u;
+
+  if (__desc_uint64(dec, &u) < 0)
+    return GLME_E_UFLOW;
+  if (op == GLME_OP_F32)
+    *(float *)p = glme_unflip_float(u);
+  else
+    *(double *)p = glme_unflip_float(u);
+  return 0;
+}
+
+void __glme_desc_default(const glme_field_t *f, int op, char *p)
+{
+  switch (op) {
+  case GLME_OP_F32:
+    *(float *)p = (float)f->defval.f;
+    break;
+  case GLME_OP_F64:
+    *(double *)p = f->defval.f;
+    break;
+  case GLME_OP_STRING:
+  case GLME_OP_STRUCT_PTR:
+    *(void **)p = (void *)0;
+    break;
+  case GLME_OP_ARRAY:
+    *(void **)p = (void *)0;
+    __desc_store(__desc_lenop(f->lensize), (char *)p - f->offset + f->lenoff, 0);
+    break;
+  case GLME_OP_BYTES:
+  case GLME_OP_VECTOR:
+    memset(p, 0, f->nelem * f->esize);
+    break;
+  case GLME_OP_STRUCT:
+    memset(p, 0, f->esize);
+    break;
+  default:
+    __desc_store(op, p, f->defval.u);
+    break;
+  }
+}
+
+// decode structure value of field or array element
+static
+int __desc_struct_value(glme_buf_t *dec, const glme_field_t *f, void *p)
+{
+  glme_spec_t *spec = (glme_spec_t *)0;
+  glme_limits_t *limits;
+  int n;
+
+  if (!f->nested && !(spec = glme_get_spec(dec, f->type))) {
+    dec->last_error = GLME_E_NODEC;
+    return GLME_E_NODEC;
+  }
+  if (!f->nested && spec->decoder)
+    return __decode_value(dec, spec->decoder, spec, p);
+  if (!f->nested && !spec->desc) {
+    dec->last_error = GLME_E_NODEC;
+    return GLME_E_NODEC;
+  }
+  limits = __glme_depth_enter(dec, &n);
+  if (n < 0)
+    return n;
+  n = glme_decode_desc(dec, f->nested ? f->nested : spec->desc, p);
+  __glme_depth_leave(limits);
+  return n;
+}
+
+static
+int __desc_array(glme_buf_t *dec, const glme_field_t *f,
+                 const struct glme_fieldop_s *op, char *p)
+{
+  int n, typeid;
+  uint64_t k, len;
+  char *ptr;
+
+  if (glme_decode_type(dec, &typeid) < 0 || __desc_uint64(dec, &len) < 0)
+    return GLME_E_UFLOW;
+  if (!__etype_match(f->type, typeid))
+    return GLME_E_TYPE;
+  // every element takes at least one byte
+  if (len > dec->count - dec->current)
+    return GLME_E_UFLOW;
+
+  if (op->op == GLME_OP_VECTOR) {
+    if (len > f->nelem)
+      return GLME_E_OFLOW;
+    ptr = p;
+  } else {
+    ptr = (char *)0;
+    if (len > 0 && !(ptr = (char *)glme_calloc(dec, len, f->esize)))
+      return GLME_E_NOMEM;
+  }
+
+  for (k = 0, n = 0; k < len && n >= 0; k++) {
+    if (op->eop == GLME_OP_STRUCT)
+      n = __desc_struct_value(dec, f, &ptr[k*f->esize]);
+    else if (typeid == GLME_FLOAT32)
+      n = __desc_float32(dec, op->eop, &ptr[k*f->esize]);
+    else
+      n = __desc_scalar(dec, op->eop, &ptr[k*f->esize]);
+  }
+  if (n < 0) {
+    if (op->op == GLME_OP_ARRAY)
+      glme_free(dec, ptr);
+    return n;
+  }
+
+  if (op->op == GLME_OP_VECTOR) {
+    memset(&p[len*f->esize], 0, (f->nelem - len)*f->esize);
+  } else {
+    *(char **)p = ptr;
+    __desc_store(__desc_lenop(f->lensize), p - f->offset + f->lenoff, len);
+  }
+  return 0;
+}
+
+static
+int __desc_delta(glme_buf_t *dec, const glme_field_t *f,
+                 const struct glme_fieldop_s *op, char *p)
+{
+  int n, typeid = f->type;
+  size_t len = op->op == GLME_OP_VECTOR ? f->nelem : 0;
+  char *ptr = op->op == GLME_OP_VECTOR ? p : (char *)0;
+
+  if (op->eop == GLME_OP_STRUCT)
+    return GLME_E_TYPE;
+  if ((n = glme_decode_delta(dec, &typeid, (void **)&ptr, &len, f->esize)) < 0)
+    return n;
+  if (op->op == GLME_OP_VECTOR) {
+    memset(&p[len*f->esize], 0, (f->nelem - len)*f->esize);
+  } else {
+    *(char **)p = ptr;
+    __desc_store(__desc_lenop(f->lensize), p - f->offset + f->lenoff, len);
+  }
+  return 0;
+}
+
+// structure array sent as columns
+static
+int __desc_columns(glme_buf_t *dec, const glme_field_t *f,
+                   const struct glme_fieldop_s *op, char *p)
+{
+  const glme_desc_t *desc = f->nested;
+  glme_spec_t *spec;
+  size_t len = op->op == GLME_OP_VECTOR ? f->nelem : 0;
+  char *ptr = op->op == GLME_OP_VECTOR ? p : (char *)0;
+  int n;
+
+  if (!desc && (spec = glme_get_spec(dec, f->type)))
+    desc = spec->desc;
+  if (!desc)
+    return GLME_E_NODEC;
+  if (desc->size != f->esize)
+    return GLME_E_INVAL;
+  if ((n = glme_decode_columns(dec, desc, (void **)&ptr, &len)) < 0)
+    return n;
+  if (op->op == GLME_OP_VECTOR) {
+    memset(&p[len*f->esize], 0, (f->nelem - len)*f->esize);
+  } else {
+    *(char **)p = ptr;
+    __desc_store(__desc_lenop(f->lensize), p - f->offset + f->lenoff, len);
+  }
+  return 0;
+}
+
+int __glme_desc_field(glme_buf_t *dec, const glme_field_t *f,
+                     const struct glme_fieldop_s *op, char *p)
+{
+  int n, typeid;
+  uint64_t len;
+  char *nptr;
+  glme_refs_t *refs;
+  glme_dict_t *dict;
+
+  if (dec->current >= dec->count)
+    return GLME_E_UFLOW;
+
+  switch (op->op) {
+  case GLME_OP_STRUCT:
+  case GLME_OP_STRUCT_PTR:
+    if (glme_decode_type(dec, &typeid) < 0)
+      return GLME_E_UFLOW;
+    if (typeid < 0 && op->op == GLME_OP_STRUCT_PTR)
+      return __glme_refs_get(dec, typeid, f->type, (void **)p);
+    if (typeid != f->type)
+      return GLME_E_TYPE;
+    refs = __glme_refs_of(dec);
+    if (op->op == GLME_OP_STRUCT) {
+      if (refs && __glme_refs_add(dec, refs, p, typeid) < 0)
+        return GLME_E_NOMEM;
+      return __desc_struct_value(dec, f, p);
+    }
+    if (!(nptr = (char *)glme_malloc(dec, f->esize)))
+      return GLME_E_NOMEM;
+    if (refs && __glme_refs_add(dec, refs, nptr, typeid) < 0) {
+      glme_free(dec, nptr);
+      return GLME_E_NOMEM;
+    }
+    if ((n = __desc_struct_value(dec, f, nptr)) < 0) {
+      glme_free(dec, nptr);
+      return n;
+    }
+    *(char **)p = nptr;
+    return 0;
+  }
+
+  // structure arrays may be sent as columns
+  if (dec->buf[dec->current] == (char)(GLME_COLUMNS << 1) && op->eop == GLME_OP_STRUCT)
+    return __desc_columns(dec, f, op, p);
+
+  // numeric arrays may be delta encoded
+  if (dec->buf[dec->current] == (char)(GLME_DELTA << 1) &&
+      (op->op == GLME_OP_ARRAY || op->op == GLME_OP_VECTOR))
+    return __desc_delta(dec, f, op, p);
+
+  // floating point fields accept single precision values
+  if (dec->buf[dec->current] == (char)(GLME_FLOAT32 << 1) &&
+      (op->op == GLME_OP_F32 || op->op == GLME_OP_F64)) {
+    dec->current++;
+    return __desc_float32(dec, op->op, p);
+  }
+
+  // strings may be references to dictionary
+  dict = op->op == GLME_OP_STRING && __glme_dicts ? __glme_dict_of(dec) : (glme_dict_t *)0;
+  if (dict && dec->buf[dec->current] != (char)op->wtype) {
+    if (glme_decode_type(dec, &typeid) < 0)
+      return GLME_E_UFLOW;
+    return typeid < 0 ? __glme_dict_get(dec, dict, typeid, (char **)p) : GLME_E_TYPE;
+  }
+
+  // base types; check encoded type byte, byte vectors accept strings too
+  if (dec->buf[dec->current] != (char)op->wtype &&
+      (op->op != GLME_OP_BYTES || dec->buf[dec->current] != (char)(GLME_STRING << 1)))
+    return GLME_E_TYPE;
+  dec->current++;
+
+  switch (op->op) {
+  case GLME_OP_ARRAY:
+  case GLME_OP_VECTOR:
+    return __desc_array(dec, f, op, p);
+
+  case GLME_OP_BYTES:
+    if (__desc_uint64(dec, &len) < 0 || len > dec->count - dec->current)
+      return GLME_E_UFLOW;
+    memcpy(p, &dec->buf[dec->current], len < f->nelem ? len : f->nelem);
+    if (len < f->nelem)
+      memset(&p[len], 0, f->nelem - len);
+    dec->current += len;
+    return 0;
+
+  case GLME_OP_STRING:
+    if (__desc_uint64(dec, &len) < 0 || len > dec->count - dec->current)
+      return GLME_E_UFLOW;
+    if (dict) {
+      if (__glme_dict_add(dec, dict, &dec->buf[dec->current], len, (char **)p) < 0)
+        return GLME_E_NOMEM;
+      dec->current += len;
+      return 0;
+    }
+    if (!(nptr = (char *)glme_malloc(dec, len+1)))
+      return GLME_E_NOMEM;
+    memcpy(nptr, &dec->buf[dec->current], len);
+    nptr[len] = '\0';
+    *(char **)p = nptr;
+    dec->current += len;
+    return 0;
+
+  default:
+    return __desc_scalar(dec, op->op, p);
+  }
+}
+
+int glme_decode_desc(glme_buf_t *dec, const glme_desc_t *desc, void *ptr)
+{
+  const struct glme_fieldop_s *ops = desc->ops;
+  const glme_field_t *fields = desc->fields;
+  uint64_t delta, at, __at_start = dec->current;
+  unsigned int k, next;
+  int n;
+
+  if (!ops) {
+    dec->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+
+  for (k = 0; ; k = next + 1) {
+    at = dec->current;
+    if (__desc_uint64(dec, &delta) < 0) {
+      dec->last_error = GLME_E_UFLOW;
+      return GLME_E_UFLOW;
+    }
+    if (delta == 0)
+      break;
+    if (delta > desc->nfields - k) {
+      // fields from newer encoder; skip them and default the rest
+      dec->current = at;
+      if (glme_skip_fields(dec) < 0)
+        return dec->last_error;
+      break;
+    }
+    next = k + delta - 1;
+    // omitted fields get default values
+    for (; k < next; k++)
+      __glme_desc_default(&fields[k], ops[k].op, (char *)ptr + fields[k].offset);
+
+    n = __glme_desc_field(dec, &fields[next], &ops[next], (char *)ptr + fields[next].offset);
+    if (n < 0) {
+      dec->last_error = n;
+      return n;
+    }
+  }
+  for (; k < desc->nfields; k++)
+    __glme_desc_default(&fields[k], ops[k].op, (char *)ptr + fields[k].offset);
+
+  return dec->current - __at_start;
+}
+
 // Local Variables:
 // indent-tabs-mode: nil
 // End:
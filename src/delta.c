@@ -0,0 +1,525 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "glme.h"
+#include "delta.h"
+
+/*
+ * Delta encoded integer arrays. Header is element type, order and count;
+ * elements are zigzag encoded differences as unsigned values. Order one
+ * sends the first value and differences to previous value, order two the
+ * first value, first difference and then differences of differences.
+ * Differences are computed modulo 2^64, so any integer sequence round trips.
+ *
+ * Decoder reads differences to a chunk of 64 bit values, runs of eight one
+ * byte values are recognized from a single word, and sums the chunk in place
+ * before storing elements. Arrays of 64 bit elements are decoded directly
+ * into the target.
+ *
+ * Floating point arrays use XOR of consecutive values, order is always one.
+ * Elements follow as a bit stream preceded by its length in bytes. The first
+ * value is sent as its 64 bits. For each following value the XOR with the
+ * previous value is sent as
+ *
+ *   0                           value equals previous value
+ *   10 <bits>                   meaningful bits fit in previous window
+ *   11 <lead:6> <len-1:6> <bits> new window of len bits after lead zeros
+ *
+ * Bits are written high bit first; float elements are widened to double.
+ */
+
+#define __CHUNK 256
+#define __HIGHBITS 0x8080808080808080ull
+
+static inline
+int __etype_valid(int typeid, size_t esize)
+{
+  if (typeid == GLME_FLOAT)
+    return esize == 4 || esize == 8;
+  if (typeid != GLME_INT && typeid != GLME_UINT)
+    return 0;
+  return esize == 1 || esize == 2 || esize == 4 || esize == 8;
+}
+
+// element as 64 bit value; signed elements are sign extended
+static inline
+uint64_t __load(const char *p, size_t esize, int sign)
+{
+  switch (esize) {
+  case 1:
+    return sign ? (uint64_t)*(const int8_t *)p : *(const uint8_t *)p;
+  case 2:
+    return sign ? (uint64_t)*(const int16_t *)p : *(const uint16_t *)p;
+  case 4:
+    return sign ? (uint64_t)*(const int32_t *)p : *(const uint32_t *)p;
+  }
+  return *(const uint64_t *)p;
+}
+
+static
+void __store(char *dst, const uint64_t *v, size_t n, size_t esize)
+{
+  size_t k;
+
+  switch (esize) {
+  case 1:
+    for (k = 0; k < n; k++)
+      ((uint8_t *)dst)[k] = (uint8_t)v[k];
+    break;
+  case 2:
+    for (k = 0; k < n; k++)
+      ((uint16_t *)dst)[k] = (uint16_t)v[k];
+    break;
+  case 4:
+    for (k = 0; k < n; k++)
+      ((uint32_t *)dst)[k] = (uint32_t)v[k];
+    break;
+  }
+}
+
+// read n zigzag values to v
+static
+int __get_deltas(glme_buf_t *dec, uint64_t *v, size_t n)
+{
+  const unsigned char *p = (const unsigned char *)&dec->buf[dec->current];
+  const unsigned char *end = (const unsigned char *)&dec->buf[dec->count];
+  uint64_t w, u;
+  size_t k = 0;
+  int j, nb;
+
+  while (k < n) {
+    if (n - k >= 8 && end - p >= 8) {
+      memcpy(&w, p, sizeof(w));
+      if ((w & __HIGHBITS) == 0) {
+        // eight one byte values
+        for (j = 0; j < 8; j++)
+          v[k+j] = p[j];
+        p += 8;
+        k += 8;
+        continue;
+      }
+    }
+    if (p >= end)
+      return GLME_E_UFLOW;
+    if (*p < 0x80) {
+      v[k++] = *p++;
+      continue;
+    }
+    if ((nb = 256 - *p) > 8 || end - p <= nb)
+      return GLME_E_UFLOW;
+    for (u = 0, j = 1; j <= nb; j++)
+      u = (u << 8) | p[j];
+    v[k++] = u;
+    p += nb + 1;
+  }
+  dec->current = (const char *)p - dec->buf;
+  return 0;
+}
+
+#define __UNZIGZAG(u) (((u) >> 1) ^ -((u) & 1))
+
+// running sums of order over decoded differences
+static
+void __sum(uint64_t *v, size_t n, int order, uint64_t *last, uint64_t *step)
+{
+  uint64_t x = *last, d = *step;
+  size_t k;
+
+  if (order == 1) {
+    for (k = 0; k < n; k++)
+      v[k] = x += __UNZIGZAG(v[k]);
+  } else {
+    for (k = 0; k < n; k++) {
+      d += __UNZIGZAG(v[k]);
+      v[k] = x += d;
+    }
+  }
+  *last = x;
+  *step = d;
+}
+
+int __glme_delta_header(glme_buf_t *dec, int *typeid, int *order, uint64_t *len,
+                        uint64_t *nbytes)
+{
+  uint64_t u;
+  int n;
+
+  *nbytes = 0;
+  if ((n = glme_decode_type(dec, typeid)) < 0 ||
+      (n = glme_decode_value_uint64(dec, &u)) < 0 ||
+      (n = glme_decode_value_uint64(dec, len)) < 0)
+    return n;
+  if (*typeid == GLME_FLOAT && u == 1) {
+    if ((n = glme_decode_value_uint64(dec, nbytes)) < 0)
+      return n;
+    // first value takes 64 bits, others at least one
+    if (*nbytes > dec->count - dec->current ||
+        (*len > 0 && (*nbytes < 8 || *len - 1 > 8 * (*nbytes - 8)))) {
+      dec->last_error = GLME_E_UFLOW;
+      return GLME_E_UFLOW;
+    }
+    *order = 1;
+    return 0;
+  }
+  if ((*typeid != GLME_INT && *typeid != GLME_UINT) || (u != 1 && u != 2)) {
+    dec->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  // every element takes at least one byte
+  if (*len > dec->count - dec->current) {
+    dec->last_error = GLME_E_UFLOW;
+    return GLME_E_UFLOW;
+  }
+  *order = (int)u;
+  return 0;
+}
+
+// bit stream writer; n pending bits high bit first in acc, less than eight
+struct __bitwr {
+  unsigned char *p;
+  uint64_t acc;
+  int n;
+};
+
+// write k bits, k at most 32
+static inline
+void __put(struct __bitwr *w, uint64_t v, int k)
+{
+  w->acc |= v << (64 - w->n - k);
+  w->n += k;
+  while (w->n >= 8) {
+    *w->p++ = (unsigned char)(w->acc >> 56);
+    w->acc <<= 8;
+    w->n -= 8;
+  }
+}
+
+// write k bits, k at most 64
+static inline
+void __put64(struct __bitwr *w, uint64_t v, int k)
+{
+  if (k > 32) {
+    __put(w, v >> 32, k - 32);
+    k = 32;
+  }
+  __put(w, v & (k < 32 ? (1ull << k) - 1 : 0xffffffffull), k);
+}
+
+// bit stream reader; n bits high bit first in acc
+struct __bitrd {
+  const unsigned char *p, *end;
+  uint64_t acc;
+  int n;
+};
+
+static inline
+void __fill(struct __bitrd *r)
+{
+  while (r->n <= 56 && r->p < r->end) {
+    r->acc |= (uint64_t)*r->p++ << (56 - r->n);
+    r->n += 8;
+  }
+}
+
+// read k bits, k from 1 to 32; -1 if stream ends
+static inline
+int64_t __get(struct __bitrd *r, int k)
+{
+  uint64_t v;
+
+  if (r->n < k) {
+    __fill(r);
+    if (r->n < k)
+      return -1;
+  }
+  v = r->acc >> (64 - k);
+  r->acc <<= k;
+  r->n -= k;
+  return (int64_t)v;
+}
+
+static inline
+uint64_t __double_bits(const char *p, size_t esize)
+{
+  union { double d; uint64_t u; } v;
+  v.d = esize == 4 ? (double)*(const float *)p : *(const double *)p;
+  return v.u;
+}
+
+static inline
+void __double_store(char *p, uint64_t u, size_t esize)
+{
+  union { double d; uint64_t u; } v = { .u = u };
+  if (esize == 4)
+    *(float *)p = (float)v.d;
+  else
+    *(double *)p = v.d;
+}
+
+// encode float elements as XOR bit stream after header
+static
+int __encode_xor(glme_buf_t *enc, const char *ptr, size_t len, size_t esize)
+{
+  struct __bitwr w;
+  uint64_t x, prev, max;
+  size_t k, pos, nbytes;
+  int lead, trail, mlen, plead = 0, plen = 0;
+  char tmp[10], *p;
+
+  // two control bits, 12 bits of window and 64 bits per value
+  max = len > 0 ? 8 + 10 * (len - 1) + 1 : 0;
+  if (glme_buf_reserve(enc, max + 10) < 0)
+    return GLME_E_NOMEM;
+  pos = enc->count;
+  w = (struct __bitwr){(unsigned char *)&enc->buf[pos + 1], 0, 0};
+  for (k = 0, prev = 0; k < len; k++) {
+    x = __double_bits(&ptr[k*esize], esize);
+    if (k == 0) {
+      __put64(&w, x, 64);
+      prev = x;
+      continue;
+    }
+    x ^= prev;
+    prev ^= x;
+    if (x == 0) {
+      __put(&w, 0, 1);
+      continue;
+    }
+    lead = __builtin_clzll(x);
+    trail = __builtin_ctzll(x);
+    if (plen > 0 && lead >= plead && trail >= 64 - plead - plen) {
+      __put(&w, 2, 2);
+      __put64(&w, x >> (64 - plead - plen), plen);
+      continue;
+    }
+    mlen = 64 - lead - trail;
+    __put(&w, 3, 2);
+    __put(&w, lead, 6);
+    __put(&w, mlen - 1, 6);
+    __put64(&w, x >> trail, mlen);
+    plead = lead;
+    plen = mlen;
+  }
+  if (w.n > 0)
+    __put(&w, 0, 8 - w.n);
+  // length in front of the stream; moved if longer than one byte
+  nbytes = (char *)w.p - &enc->buf[pos + 1];
+  p = glme_put_uint64(tmp, nbytes);
+  if (p - tmp > 1)
+    memmove(&enc->buf[pos + (p - tmp)], &enc->buf[pos + 1], nbytes);
+  memcpy(&enc->buf[pos], tmp, p - tmp);
+  enc->count = pos + (p - tmp) + nbytes;
+  return 0;
+}
+
+// decode XOR bit stream of nbytes to len elements
+static
+int __decode_xor(glme_buf_t *dec, char *ptr, size_t len, size_t esize, uint64_t nbytes)
+{
+  struct __bitrd r;
+  uint64_t x, prev = 0;
+  int64_t c, hi;
+  size_t k;
+  int plead = 0, plen = 0, lo;
+
+  r = (struct __bitrd){(const unsigned char *)&dec->buf[dec->current],
+                       (const unsigned char *)&dec->buf[dec->current + nbytes], 0, 0};
+  for (k = 0; k < len; k++) {
+    if (k == 0) {
+      if ((hi = __get(&r, 32)) < 0 || (c = __get(&r, 32)) < 0)
+        return GLME_E_UFLOW;
+      prev = ((uint64_t)hi << 32) | (uint64_t)c;
+      __double_store(ptr, prev, esize);
+      continue;
+    }
+    if ((c = __get(&r, 1)) < 0)
+      return GLME_E_UFLOW;
+    if (c) {
+      if ((c = __get(&r, 1)) < 0)
+        return GLME_E_UFLOW;
+      if (c) {
+        if ((hi = __get(&r, 12)) < 0)
+          return GLME_E_UFLOW;
+        plead = (int)(hi >> 6);
+        plen = (int)(hi & 0x3f) + 1;
+        if (plead + plen > 64)
+          return GLME_E_INVAL;
+      } else if (plen == 0) {
+        return GLME_E_INVAL;
+      }
+      // meaningful bits of window
+      lo = plen > 32 ? 32 : plen;
+      hi = 0;
+      if (plen > 32 && (hi = __get(&r, plen - 32)) < 0)
+        return GLME_E_UFLOW;
+      if ((c = __get(&r, lo)) < 0)
+        return GLME_E_UFLOW;
+      x = ((uint64_t)hi << 32 | (uint64_t)c) << (64 - plead - plen);
+      prev ^= x;
+    }
+    __double_store(&ptr[k*esize], prev, esize);
+  }
+  dec->current += nbytes;
+  return 0;
+}
+
+int glme_encode_delta(glme_buf_t *enc, int typeid, const void *vptr, size_t len,
+                      size_t esize, int order)
+{
+  const char *ptr = (const char *)vptr;
+  size_t k, end, __at_start = enc->count;
+  uint64_t x, prev = 0, step = 0, d;
+  int sign = typeid == GLME_INT;
+  char *p;
+
+  if (!__etype_valid(typeid, esize) || (order != 1 && order != 2) ||
+      (typeid == GLME_FLOAT && order != 1)) {
+    enc->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+  if (glme_buf_reserve(enc, 3 + 10) < 0)
+    return GLME_E_NOMEM;
+  p = &enc->buf[enc->count];
+  *p++ = (char)(GLME_DELTA << 1);
+  p = glme_put_uint64(p, glme_zigzag(typeid));
+  p = glme_put_uint64(p, order);
+  p = glme_put_uint64(p, len);
+  enc->count = p - enc->buf;
+
+  if (typeid == GLME_FLOAT) {
+    if (__encode_xor(enc, ptr, len, esize) < 0) {
+      enc->count = __at_start;
+      return GLME_E_NOMEM;
+    }
+    return enc->count - __at_start;
+  }
+
+  for (k = 0; k < len; k = end) {
+    end = len - k > __CHUNK ? k + __CHUNK : len;
+    if (glme_buf_reserve(enc, (end - k) * 10) < 0) {
+      enc->count = __at_start;
+      return GLME_E_NOMEM;
+    }
+    p = &enc->buf[enc->count];
+    for (; k < end; k++) {
+      x = __load(&ptr[k*esize], esize, sign);
+      d = x - prev;
+      prev = x;
+      if (order == 2 && k > 0) {
+        // difference of differences; first difference as is
+        x = d - step;
+        step = d;
+      } else if (k > 0) {
+        x = d;
+      }
+      p = glme_put_uint64(p, glme_zigzag((int64_t)x));
+    }
+    enc->count = p - enc->buf;
+  }
+  return enc->count - __at_start;
+}
+
+// decode len integer elements of esize
+static
+int __decode_ints(glme_buf_t *dec, char *ptr, size_t len, size_t esize, int order)
+{
+  uint64_t chunk[__CHUNK], *v, last = 0, step = 0;
+  size_t k, n;
+  int rc;
+
+  for (k = 0; k < len; k += n) {
+    n = len - k > __CHUNK ? __CHUNK : len - k;
+    v = esize == 8 ? (uint64_t *)&ptr[k*esize] : chunk;
+    if ((rc = __get_deltas(dec, v, n)) < 0)
+      return rc;
+    if (k == 0 && order == 2) {
+      // first value as is
+      last = v[0] = __UNZIGZAG(v[0]);
+      __sum(&v[1], n - 1, order, &last, &step);
+    } else {
+      __sum(v, n, order, &last, &step);
+    }
+    if (esize < 8)
+      __store(&ptr[k*esize], v, n, esize);
+  }
+  return 0;
+}
+
+int glme_decode_delta(glme_buf_t *dec, int *typeid, void **dst, size_t *len, size_t esize)
+{
+  uint64_t alen, nbytes, __at_start = dec->current;
+  char *ptr = (char *)*dst;
+  int rc, order, etype;
+
+  if (dec->current >= dec->count || dec->buf[dec->current] != (char)(GLME_DELTA << 1)) {
+    dec->last_error = dec->current < dec->count ? GLME_E_TYPE : GLME_E_UFLOW;
+    return dec->last_error;
+  }
+  dec->current++;
+  if ((rc = __glme_delta_header(dec, &etype, &order, &alen, &nbytes)) < 0)
+    goto error;
+  rc = GLME_E_TYPE;
+  if ((*typeid != 0 && *typeid != etype) || !__etype_valid(etype, esize))
+    goto error;
+  rc = GLME_E_OFLOW;
+  if (ptr && *len > 0 && *len < alen)
+    goto error;
+  if (!ptr && alen > 0 && !(ptr = (char *)glme_malloc(dec, alen * esize))) {
+    rc = GLME_E_NOMEM;
+    goto error;
+  }
+
+  if (etype == GLME_FLOAT)
+    rc = __decode_xor(dec, ptr, alen, esize, nbytes);
+  else
+    rc = __decode_ints(dec, ptr, alen, esize, order);
+  if (rc < 0) {
+    if (!*dst)
+      glme_free(dec, ptr);
+    goto error;
+  }
+  *typeid = etype;
+  *dst = ptr;
+  *len = alen;
+  return dec->current - __at_start;
+
+ error:
+  dec->current = __at_start;
+  dec->last_error = rc;
+  return rc;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "glme.h"
+#include "descriptor.h"
+
+/*
+ * Field descriptors are checked once here and translated to compact operation
+ * codes that encode the storage width so that encoder and decoder loops need
+ * no further checks per message.
+ */
+
+// scalar operation for kind and size; GLME_OP_NONE if not valid
+static
+int __scalar_op(int type, size_t esize)
+{
+  switch (type) {
+  case GLME_INT:
+    switch (esize) {
+    case 1: return GLME_OP_I8;
+    case 2: return GLME_OP_I16;
+    case 4: return GLME_OP_I32;
+    case 8: return GLME_OP_I64;
+    }
+    break;
+  case GLME_UINT:
+    switch (esize) {
+    case 1: return GLME_OP_U8;
+    case 2: return GLME_OP_U16;
+    case 4: return GLME_OP_U32;
+    case 8: return GLME_OP_U64;
+    }
+    break;
+  case GLME_FLOAT:
+    switch (esize) {
+    case 4: return GLME_OP_F32;
+    case 8: return GLME_OP_F64;
+    }
+    break;
+  }
+  return GLME_OP_NONE;
+}
+
+static
+int __nested_check(const glme_field_t *f)
+{
+  if (f->type <= GLME_BASE_MAX)
+    return GLME_E_TYPE;
+  if (f->nested) {
+    if (f->nested->typeid != f->type)
+      return GLME_E_TYPE;
+    if (!f->nested->ops)
+      return glme_desc_init((glme_desc_t *)f->nested);
+  }
+  return 0;
+}
+
+static
+int __field_compile(struct glme_fieldop_s *op, const glme_field_t *f)
+{
+  int n;
+
+  op->op = op->eop = GLME_OP_NONE;
+  op->wtype = op->etype = 0;
+  op->nrun = 0;
+
+  switch (f->kind) {
+  case GLME_K_INT:
+  case GLME_K_UINT:
+  case GLME_K_FLOAT:
+    if (f->type != (f->kind == GLME_K_INT ? GLME_INT : f->kind == GLME_K_UINT ? GLME_UINT : GLME_FLOAT))
+      return GLME_E_TYPE;
+    if ((op->op = __scalar_op(f->type, f->esize)) == GLME_OP_NONE)
+      return GLME_E_INVAL;
+    op->wtype = f->type << 1;
+    return 0;
+
+  case GLME_K_BYTES:
+    if (f->nelem == 0)
+      return GLME_E_INVAL;
+    op->op = GLME_OP_BYTES;
+    op->wtype = GLME_VECTOR << 1;
+    return 0;
+
+  case GLME_K_STRING:
+    if (f->esize != sizeof(char *))
+      return GLME_E_INVAL;
+    op->op = GLME_OP_STRING;
+    op->wtype = GLME_STRING << 1;
+    return 0;
+
+  case GLME_K_STRUCT:
+  case GLME_K_STRUCT_PTR:
+    if (f->esize == 0)
+      return GLME_E_NOSIZE;
+    if ((n = __nested_check(f)) < 0)
+      return n;
+    op->op = f->kind == GLME_K_STRUCT ? GLME_OP_STRUCT : GLME_OP_STRUCT_PTR;
+    return 0;
+
+  case GLME_K_ARRAY:
+  case GLME_K_VECTOR:
+    if (f->esize == 0)
+      return GLME_E_NOSIZE;
+    if (f->kind == GLME_K_VECTOR && f->nelem == 0)
+      return GLME_E_INVAL;
+    if (f->kind == GLME_K_ARRAY && __scalar_op(GLME_UINT, f->lensize) == GLME_OP_NONE)
+      return GLME_E_INVAL;
+    if (f->type > GLME_BASE_MAX) {
+      if ((n = __nested_check(f)) < 0)
+        return n;
+      op->eop = GLME_OP_STRUCT;
+    } else if ((op->eop = __scalar_op(f->type, f->esize)) == GLME_OP_NONE) {
+      return GLME_E_TYPE;
+    }
+    op->op = f->kind == GLME_K_ARRAY ? GLME_OP_ARRAY : GLME_OP_VECTOR;
+    op->wtype = GLME_ARRAY << 1;
+    op->etype = f->type <= GLME_BASE_MAX ? f->type << 1 : 0;
+    return 0;
+  }
+  return GLME_E_INVAL;
+}
+
+int glme_desc_init(glme_desc_t *desc)
+{
+  int k, n;
+  struct glme_fieldop_s *ops;
+
+  if (!desc || desc->typeid <= GLME_BASE_MAX || (desc->nfields > 0 && !desc->fields))
+    return GLME_E_INVAL;
+  if (desc->ops)
+    return 0;
+
+  ops = (struct glme_fieldop_s *)calloc(desc->nfields + 1, sizeof(struct glme_fieldop_s));
+  if (!ops)
+    return GLME_E_NOMEM;
+  // set before compiling fields; recursive structures refer to themselves
+  desc->ops = ops;
+  for (k = 0; k < desc->nfields; k++) {
+    if ((n = __field_compile(&ops[k], &desc->fields[k])) < 0) {
+      desc->ops = (struct glme_fieldop_s *)0;
+      free(ops);
+      return n;
+    }
+  }
+  // runs of scalar fields are encoded with single space check
+  for (k = desc->nfields; k > 0; k--) {
+    if (__GLME_OP_SCALAR(ops[k-1].op))
+      ops[k-1].nrun = ops[k].nrun + 1;
+  }
+  return 0;
+}
+
+void glme_desc_release(glme_desc_t *desc)
+{
+  if (desc && desc->ops) {
+    free(desc->ops);
+    desc->ops = (struct glme_fieldop_s *)0;
+  }
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+
+#include "gobber.h"
+#include "glme.h"
+#include "dict.h"
+
+/*
+ * String dictionaries. Strings are numbered in order of first occurrence, as
+ * structures are in object identity tables: the first occurrence is sent as a
+ * plain string and both sides enter it, so numbers are never sent. A string
+ * seen again is written as -(id+1) in place of the type id.
+ *
+ * Both sides keep an open addressing hash table from string content to number
+ * with interned copies; decoder also keeps strings in an array indexed by
+ * number. Entering stops at maxcount strings, which bounds the memory with
+ * maxlen.
+ *
+ * Active dictionaries are linked to a thread local list; buffer selects the
+ * dictionary.
+ */
+
+__thread glme_dict_t *__glme_dicts;
+
+int glme_dict_begin(glme_buf_t *gbuf, glme_dict_t *dict, size_t maxcount, size_t maxlen)
+{
+  *dict = (glme_dict_t){gbuf, __glme_dicts, maxcount, maxlen, 0, 0,
+                        (struct glme_dictent_s *)0, (char **)0};
+  __glme_dicts = dict;
+  return 0;
+}
+
+void glme_dict_reset(glme_buf_t *gbuf, glme_dict_t *dict)
+{
+  size_t k;
+
+  for (k = 0; k < dict->size; k++)
+    if (dict->table[k].str)
+      glme_free(gbuf, dict->table[k].str);
+  if (dict->table)
+    glme_free(gbuf, dict->table);
+  if (dict->strs)
+    glme_free(gbuf, dict->strs);
+  dict->count = dict->size = 0;
+  dict->table = (struct glme_dictent_s *)0;
+  dict->strs = (char **)0;
+}
+
+void glme_dict_end(glme_buf_t *gbuf, glme_dict_t *dict)
+{
+  glme_dict_t **dp;
+
+  for (dp = &__glme_dicts; *dp; dp = &(*dp)->outer) {
+    if (*dp == dict) {
+      *dp = dict->outer;
+      break;
+    }
+  }
+  glme_dict_reset(gbuf, dict);
+  dict->gbuf = (glme_buf_t *)0;
+  dict->outer = (glme_dict_t *)0;
+}
+
+static inline
+size_t __hash(const char *s, size_t len)
+{
+  uint64_t h = 0xcbf29ce484222325ull;
+  while (len-- > 0) {
+    h ^= (unsigned char)*s++;
+    h *= 0x100000001b3ull;
+  }
+  return (size_t)(h ^ (h >> 32));
+}
+
+// find slot of string or empty slot where it goes
+static inline
+struct glme_dictent_s *__slot(glme_dict_t *d, const char *s, size_t len)
+{
+  size_t k, mask = d->size - 1;
+  struct glme_dictent_s *e;
+
+  for (k = __hash(s, len) & mask; ; k = (k + 1) & mask) {
+    e = &d->table[k];
+    if (!e->str || (e->len == len && memcmp(e->str, s, len) == 0))
+      return e;
+  }
+}
+
+// string of len bytes is entered
+static inline
+int __enters(const glme_dict_t *d, size_t len)
+{
+  return len > 0 && (d->maxlen == 0 || len <= d->maxlen) &&
+    (d->maxcount == 0 || d->count < d->maxcount) && d->count < INT_MAX;
+}
+
+// grow hash table and number index of decoder
+static
+int __grow(glme_buf_t *gb, glme_dict_t *d, int index)
+{
+  struct glme_dictent_s *old = d->table, *e;
+  size_t k, osize = d->size, size = osize ? 2*osize : 64;
+  char **strs;
+
+  if (index) {
+    strs = (char **)glme_realloc(gb, d->strs, size * sizeof(char *));
+    if (!strs) {
+      gb->last_error = GLME_E_NOMEM;
+      return GLME_E_NOMEM;
+    }
+    d->strs = strs;
+  }
+  d->table = (struct glme_dictent_s *)glme_calloc(gb, size, sizeof(struct glme_dictent_s));
+  if (!d->table) {
+    d->table = old;
+    gb->last_error = GLME_E_NOMEM;
+    return GLME_E_NOMEM;
+  }
+  d->size = size;
+  for (k = 0; k < osize; k++) {
+    if (old[k].str) {
+      e = __slot(d, old[k].str, old[k].len);
+      *e = old[k];
+    }
+  }
+  if (old)
+    glme_free(gb, old);
+  return 0;
+}
+
+// new entry to empty slot
+static
+int __enter(glme_buf_t *gb, glme_dict_t *d, struct glme_dictent_s *e, const char *s, size_t len)
+{
+  char *str;
+
+  if (!(str = (char *)glme_malloc(gb, len + 1))) {
+    gb->last_error = GLME_E_NOMEM;
+    return GLME_E_NOMEM;
+  }
+  memcpy(str, s, len);
+  str[len] = '\0';
+  *e = (struct glme_dictent_s){str, len, d->count};
+  if (d->strs)
+    d->strs[d->count] = str;
+  d->count++;
+  return 0;
+}
+
+int __glme_dict_put(glme_buf_t *enc, glme_dict_t *d, const char *s, size_t len)
+{
+  struct glme_dictent_s *e;
+  int64_t ref;
+
+  if (d->size && (e = __slot(d, s, len))->str) {
+    // seen before; reference in place of type id
+    ref = -(int64_t)e->id - 1;
+    return glme_encode_value_int64(enc, &ref);
+  }
+  if (!__enters(d, len))
+    return 0;
+  if (2*(d->count + 1) > d->size && __grow(enc, d, 0) < 0)
+    return GLME_E_NOMEM;
+  if (__enter(enc, d, __slot(d, s, len), s, len) < 0)
+    return GLME_E_NOMEM;
+  return 0;
+}
+
+// remove entry; following entries of the probe run are shifted back
+static
+void __remove(glme_dict_t *d, size_t i)
+{
+  size_t j = i, h, mask = d->size - 1;
+
+  for (;;) {
+    d->table[i].str = (char *)0;
+    for (;;) {
+      j = (j + 1) & mask;
+      if (!d->table[j].str)
+        return;
+      // entry at j may fill i if its home slot is not within (i, j]
+      h = __hash(d->table[j].str, d->table[j].len) & mask;
+      if (i <= j ? (h <= i || h > j) : (h <= i && h > j))
+        break;
+    }
+    d->table[i] = d->table[j];
+    i = j;
+  }
+}
+
+void __glme_dict_drop(glme_buf_t *enc, glme_dict_t *d, size_t count)
+{
+  size_t k;
+
+  if (count >= d->count)
+    return;
+  for (k = 0; k < d->size; ) {
+    if (d->table[k].str && d->table[k].id >= count) {
+      // slot is refilled by shift; look again
+      glme_free(enc, d->table[k].str);
+      __remove(d, k);
+      continue;
+    }
+    k++;
+  }
+  d->count = count;
+}
+
+int __glme_dict_add(glme_buf_t *dec, glme_dict_t *d, const char *s, size_t len, char **out)
+{
+  struct glme_dictent_s *e;
+
+  // string already entered is shared; plain encoders repeat strings
+  if (d->size && (e = __slot(d, s, len))->str) {
+    *out = e->str;
+    return 0;
+  }
+  if (!__enters(d, len)) {
+    if (!(*out = (char *)glme_malloc(dec, len + 1))) {
+      dec->last_error = GLME_E_NOMEM;
+      return GLME_E_NOMEM;
+    }
+    memcpy(*out, s, len);
+    (*out)[len] = '\0';
+    return 0;
+  }
+  if (2*(d->count + 1) > d->size && __grow(dec, d, 1) < 0)
+    return GLME_E_NOMEM;
+  e = __slot(d, s, len);
+  if (__enter(dec, d, e, s, len) < 0)
+    return GLME_E_NOMEM;
+  *out = e->str;
+  return 0;
+}
+
+int __glme_dict_get(glme_buf_t *dec, glme_dict_t *d, int ref, char **out)
+{
+  uint64_t id = (uint64_t)(-(int64_t)ref - 1);
+
+  if (!d || ref >= 0 || id >= d->count || !d->strs) {
+    dec->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+  *out = d->strs[id];
+  return 0;
+}
+
+void glme_dict_free(glme_buf_t *gbuf, char *s)
+{
+  glme_dict_t *d;
+
+  if (!s)
+    return;
+  if ((d = __glme_dict_of(gbuf)) && d->size && __slot(d, s, strlen(s))->str == s)
+    return;
+  glme_free(gbuf, s);
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "gobber.h"
+#include "glme.h"
+
+/*
+ * Routes are kept in open addressing hash table with linear probing. Table size
+ * is power of two and load factor is kept below 1/2 so lookups stay short.
+ */
+
+static inline
+unsigned int __route_hash(int typeid, unsigned int nslots)
+{
+  // Fibonacci hashing
+  return (unsigned int)(((uint32_t)typeid * 2654435769u) >> 7) & (nslots - 1);
+}
+
+static inline
+unsigned int __route_slots(unsigned int nelem)
+{
+  unsigned int n = 8;
+  while (n < 2*nelem)
+    n <<= 1;
+  return n;
+}
+
+static
+glme_route_t *__route_slot(glme_route_t *routes, unsigned int nslots, int typeid)
+{
+  unsigned int k = __route_hash(typeid, nslots);
+  while (routes[k].typeid != 0 && routes[k].typeid != typeid)
+    k = (k + 1) & (nslots - 1);
+  return &routes[k];
+}
+
+static
+int __route_rehash(glme_dispatch_t *disp, unsigned int nslots)
+{
+  glme_route_t *routes;
+  unsigned int k;
+
+  routes = (glme_route_t *)calloc(nslots, sizeof(glme_route_t));
+  if (!routes)
+    return GLME_E_NOMEM;
+  for (k = 0; k < disp->nslots; k++) {
+    if (disp->routes[k].typeid != 0)
+      *__route_slot(routes, nslots, disp->routes[k].typeid) = disp->routes[k];
+  }
+  free(disp->routes);
+  disp->routes = routes;
+  disp->nslots = nslots;
+  return 0;
+}
+
+// -------------------------------------------------------------------------
+// Route table
+
+int glme_dispatch_init(glme_dispatch_t *disp, unsigned int nelem, int flags)
+{
+  disp->nelem = 0;
+  disp->flags = flags;
+  disp->ndispatched = disp->nskipped = 0;
+  disp->nslots = __route_slots(nelem);
+  disp->routes = (glme_route_t *)calloc(disp->nslots, sizeof(glme_route_t));
+  if (!disp->routes) {
+    disp->nslots = 0;
+    return GLME_E_NOMEM;
+  }
+  return 0;
+}
+
+void glme_dispatch_release(glme_dispatch_t *disp)
+{
+  if (disp) {
+    free(disp->routes);
+    disp->routes = (glme_route_t *)0;
+    disp->nslots = disp->nelem = 0;
+  }
+}
+
+int glme_dispatch_subscribe(glme_dispatch_t *disp, int typeid, size_t size,
+                            glme_decoder_f decoder, glme_handler_f handler,
+                            glme_destalloc_f alloc, void *user)
+{
+  glme_route_t *r;
+
+  if (typeid <= GLME_BASE_MAX || !handler)
+    return GLME_E_INVAL;
+
+  if (2*(disp->nelem + 1) > disp->nslots) {
+    if (__route_rehash(disp, __route_slots(disp->nelem + 1)) < 0)
+      return GLME_E_NOMEM;
+  }
+  r = __route_slot(disp->routes, disp->nslots, typeid);
+  if (r->typeid == 0)
+    disp->nelem++;
+  *r = (glme_route_t){typeid, size, decoder, handler, alloc, user, (glme_destfree_f)0};
+  return 0;
+}
+
+int glme_dispatch_set_release(glme_dispatch_t *disp, int typeid, glme_destfree_f release)
+{
+  glme_route_t *r;
+
+  if (!(r = glme_dispatch_find(disp, typeid)))
+    return GLME_E_INVAL;
+  r->release = release;
+  return 0;
+}
+
+void glme_dispatch_unsubscribe(glme_dispatch_t *disp, int typeid)
+{
+  glme_route_t *r;
+  unsigned int k, j;
+
+  if (!disp->routes || !(r = glme_dispatch_find(disp, typeid)))
+    return;
+
+  // backward shift deletion keeps probe sequences intact
+  k = r - disp->routes;
+  disp->routes[k].typeid = 0;
+  disp->nelem--;
+  for (j = (k + 1) & (disp->nslots - 1); disp->routes[j].typeid != 0;
+       j = (j + 1) & (disp->nslots - 1)) {
+    glme_route_t tmp = disp->routes[j];
+    disp->routes[j].typeid = 0;
+    *__route_slot(disp->routes, disp->nslots, tmp.typeid) = tmp;
+  }
+}
+
+glme_route_t *glme_dispatch_find(glme_dispatch_t *disp, int typeid)
+{
+  glme_route_t *r;
+  if (!disp->routes || typeid == 0)
+    return (glme_route_t *)0;
+  r = __route_slot(disp->routes, disp->nslots, typeid);
+  return r->typeid == typeid ? r : (glme_route_t *)0;
+}
+
+// -------------------------------------------------------------------------
+// Dispatch loops
+
+int glme_dispatch_one(glme_dispatch_t *disp, glme_buf_t *dec)
+{
+  int n, typeid;
+  size_t size;
+  void *msg;
+  glme_route_t *r;
+  glme_decoder_f dfunc;
+  uint64_t __at_start = dec->current;
+
+  if (glme_decode_peek_type(dec, &typeid) < 0)
+    return GLME_E_UFLOW;
+
+  if (!(r = glme_dispatch_find(disp, typeid))) {
+    if (!(disp->flags & GLME_DISPATCH_SKIP)) {
+      dec->last_error = GLME_E_NODEC;
+      return GLME_E_NODEC;
+    }
+    if ((n = glme_skip(dec)) < 0)
+      return n;
+    disp->nskipped++;
+    return n;
+  }
+
+  // without route decoder registered decoder or descriptor table is used
+  if (!(dfunc = r->decoder) && !glme_get_spec(dec, typeid)) {
+    dec->last_error = GLME_E_NODEC;
+    return GLME_E_NODEC;
+  }
+  if ((size = r->size) == 0 && (size = glme_get_typesize(dec, typeid)) == 0) {
+    dec->last_error = GLME_E_NOSIZE;
+    return GLME_E_NOSIZE;
+  }
+  msg = r->alloc ? (*r->alloc)(disp, typeid, size, r->user) : (void *)0;
+  if (r->alloc && !msg) {
+    dec->last_error = GLME_E_NOMEM;
+    return GLME_E_NOMEM;
+  }
+  if ((n = glme_decode_struct(dec, typeid, &msg, size, dfunc)) < 0) {
+    // destination goes back to its owner
+    if (r->alloc && r->release)
+      (*r->release)(disp, typeid, msg, r->user);
+    return n;
+  }
+
+  disp->ndispatched++;
+  if ((n = (*r->handler)(disp, typeid, msg, r->user)) < 0)
+    return n;
+  return dec->current - __at_start;
+}
+
+int glme_dispatch_buf(glme_dispatch_t *disp, glme_buf_t *dec)
+{
+  int n;
+  size_t ndone = disp->ndispatched;
+
+  while (dec->current < dec->count) {
+    if ((n = glme_dispatch_one(disp, dec)) < 0)
+      return n;
+  }
+  return disp->ndispatched - ndone;
+}
+
+int glme_dispatch_fd(glme_dispatch_t *disp, glme_buf_t *dec, int fd, size_t maxlen)
+{
+  int n;
+  size_t ndone = disp->ndispatched;
+
+  while ((n = glme_buf_readm(dec, fd, maxlen)) > 0) {
+    if ((n = glme_dispatch_buf(disp, dec)) < 0)
+      return n;
+  }
+  return n < 0 ? n : disp->ndispatched - ndone;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -38,6 +38,9 @@
 
 #include "gobber.h"
 #include "glme.h"
+#include "descriptor.h"
+#include "refs.h"
+#include "dict.h"
 
 /*
  * Encode basic type id (0 < id < 32) directly to buffer. 
@@ -47,7 +50,7 @@ int __encode_base_type(glme_buf_t *enc, int id)
 {
   unsigned int u = (id << 1);
   if (enc->buflen <= enc->count) {
-    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen : 1024) == 0)
+    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen + 32 : 1024) == 0)
       return -1;
   }
   enc->buf[enc->count] = (unsigned char)u;
@@ -65,9 +68,10 @@ int glme_encode_value_uint64(glme_buf_t *enc, const uint64_t *v)
     return 0;
   n = gob_encode_uint64(&enc->buf[enc->count], enc->buflen-enc->count, *v);
   if (n < 0) {
-    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen : 1024) == 0) {
+    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen + 32 : 1024) == 0) {
       return -1;
     }
+    n = gob_encode_uint64(&enc->buf[enc->count], enc->buflen-enc->count, *v);
   }
   enc->count += n;
   return n;
@@ -80,9 +84,10 @@ int glme_encode_value_int64(glme_buf_t *enc, const int64_t *v)
     return 0;
   n = gob_encode_int64(&enc->buf[enc->count], enc->buflen-enc->count, *v);
   if (n < 0) {
-    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen : 1024) == 0) {
+    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen + 32 : 1024) == 0) {
       return -1;
     }
+    n = gob_encode_int64(&enc->buf[enc->count], enc->buflen-enc->count, *v);
   }
   enc->count += n;
   return n;
@@ -95,9 +100,10 @@ int glme_encode_value_double(glme_buf_t *enc, const double *v)
     return 0;
   n = gob_encode_double(&enc->buf[enc->count], enc->buflen-enc->count, *v);
   if (n < 0) {
-    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen : 1024) == 0) {
+    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen + 32 : 1024) == 0) {
       return -1;
     }
+    n = gob_encode_double(&enc->buf[enc->count], enc->buflen-enc->count, *v);
   }
   enc->count += n;
   return n;
@@ -110,9 +116,10 @@ int glme_encode_value_complex128(glme_buf_t *enc, const double complex *v)
     return 0;
   n = gob_encode_complex128(&enc->buf[enc->count], enc->buflen-enc->count, *v);
   if (n < 0) {
-    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen : 1024) == 0) {
+    if (glme_buf_resize(enc, enc->buflen < 1024 ? enc->buflen + 32 : 1024) == 0) {
       return -1;
     }
+    n = gob_encode_complex128(&enc->buf[enc->count], enc->buflen-enc->count, *v);
   }
   enc->count += n;
   return n;
@@ -149,6 +156,13 @@ int glme_encode_value_float(glme_buf_t *gbuf, const float *v)
   return glme_encode_value_double(gbuf, &d); //(double)v);
 }
 
+// single precision bits byte reversed; low exponent bits and sign in low byte
+int glme_encode_value_float32(glme_buf_t *gbuf, const float *v)
+{
+  uint64_t u64 = glme_flip_float(*v);
+  return glme_encode_value_uint64(gbuf, &u64);
+}
+
 int glme_encode_value_complex64(glme_buf_t *gbuf, const float complex *v)
 {
   double complex d = (double complex)(*v);
@@ -238,6 +252,16 @@ int glme_encode_float(glme_buf_t *enc, const float *v)
   return nc < 0 ? nc : nc + n;
 }
 
+int glme_encode_float32(glme_buf_t *enc, const float *v)
+{
+  int n, nc;
+  n = __encode_base_type(enc, GLME_FLOAT32);
+  if (n < 0)
+    return n;
+  nc = glme_encode_value_float32(enc, v);
+  return nc < 0 ? nc : nc + n;
+}
+
 int glme_encode_complex128(glme_buf_t *enc, const double complex *v)
 {
   int n, nc;
@@ -283,13 +307,19 @@ int glme_encode_bytes(glme_buf_t *enc, const void *v, size_t vlen)
 
 int glme_encode_string(glme_buf_t *gbuf, const char *s)
 {
+  glme_dict_t *dict = __glme_dicts ? __glme_dict_of(gbuf) : (glme_dict_t *)0;
+  size_t len = strlen(s), dcount = dict ? dict->count : 0;
   int nc, n;
-  n = __encode_base_type(gbuf, GLME_STRING);
-  if (n < 0)
+
+  // reference to string in dictionary
+  if (dict && (n = __glme_dict_put(gbuf, dict, s, len)) != 0)
     return n;
-  nc = glme_encode_bytes(gbuf, s, strlen(s));
-  if (nc < 0) {
-    return nc;
+  n = __encode_base_type(gbuf, GLME_STRING);
+  if (n < 0 || (nc = glme_encode_bytes(gbuf, s, len)) < 0) {
+    // string entered but not written
+    if (dict)
+      __glme_dict_drop(gbuf, dict, dcount);
+    return n < 0 ? n : nc;
   }
   return n + nc;
 }
@@ -306,6 +336,136 @@ int glme_encode_vector(glme_buf_t *gbuf, const char *s, size_t len)
   return n + nc;
 }
 
+// -------------------------------------------------------------------------
+// Tail structure pointer fields
+
+/*
+ * Encoder functions are called through __encode_value which installs a tail
+ * context for the encoder. Structure pointer encoded with glme_encode_field_tail
+ * writes only the field header and is left pending in the context; the encoder
+ * function finishes and __encode_value calls the encoder of the pending
+ * structure next. End markers of structures with deferred tail are counted and
+ * written after the whole chain, the output is same as with recursive encoding.
+ *
+ * When a structure links to another structure of the same kind the offset of
+ * the tail field is known and the chain is followed a few nodes ahead of the
+ * encoder with prefetches, so the nodes are in cache when their turn comes.
+ *
+ * Encoder functions called outside __encode_value see no context and encode
+ * tail fields recursively.
+ */
+
+// number of nodes prefetched ahead of the encoder
+#define __PREFETCH_AHEAD 4
+
+struct __etail_ctx {
+  glme_buf_t *enc;
+  glme_encoder_f efunc;         // encoder of pending structure
+  glme_spec_t *spec;            // or its spec
+  const void *ptr;              // pending structure; null if none
+  const void *field;            // tail field pointing to it
+  size_t esize;                 // size of pending structure
+  size_t nends;                 // deferred end markers
+};
+
+static __thread struct __etail_ctx *__etail;
+
+// encode structure value with encoder function or spec; deferred tails in a loop
+static
+int __encode_value(glme_buf_t *enc, glme_encoder_f efunc, glme_spec_t *spec, const void *ptr)
+{
+  struct __etail_ctx t, *outer = __etail;
+  const char *pf = (const char *)0;
+  ptrdiff_t link = -1, off;
+  int n, ahead = 0;
+
+  t = (struct __etail_ctx){enc, (glme_encoder_f)0, (glme_spec_t *)0,
+                           (const void *)0, (const void *)0, 0, 0};
+  __etail = &t;
+  for (;;) {
+    n = efunc ? (*efunc)(enc, ptr) :
+      spec->encoder ? (*spec->encoder)(enc, ptr) : glme_encode_desc(enc, spec->desc, ptr);
+    if (n < 0 || !t.ptr)
+      break;
+
+    off = (const char *)t.field - (const char *)ptr;
+    if (link < 0 && off >= 0 && off < t.esize &&
+        (efunc ? t.efunc == efunc : t.spec == spec)) {
+      // self linked structure; start following the chain
+      link = off;
+      pf = (const char *)t.ptr;
+      ahead = 0;
+    } else if (link >= 0 && off != link) {
+      link = -1;
+    }
+    if (link >= 0) {
+      // pf is ahead nodes in front of the next structure
+      if (ahead > 0)
+        ahead--;
+      for (; pf && ahead < __PREFETCH_AHEAD; ahead++) {
+        pf = *(const char * const *)(pf + link);
+        if (pf)
+          __builtin_prefetch(pf);
+      }
+    }
+    ptr = t.ptr;
+    efunc = t.efunc;
+    spec = t.spec;
+    t.ptr = (const void *)0;
+  }
+  __etail = outer;
+
+  if (n >= 0 && t.nends > 0) {
+    if (glme_buf_reserve(enc, t.nends) < 0)
+      return -1;
+    memset(&enc->buf[enc->count], 0, t.nends);
+    enc->count += t.nends;
+  }
+  return n;
+}
+
+int glme_encode_field_tail(glme_buf_t *enc, int *delta, int typeid,
+                           const void *vptr, size_t esize, glme_encoder_f efunc)
+{
+  struct __etail_ctx *t = __etail;
+  const void *ptr = *(const void * const *)vptr;
+  glme_spec_t *spec = (glme_spec_t *)0;
+  glme_refs_t *refs;
+  uint64_t __at_start = enc->count;
+  int n;
+
+  if (!t || t->enc != enc || t->ptr || !ptr)
+    return glme_encode_field(enc, delta, typeid, 0, ptr, 0, esize, efunc);
+
+  if (!efunc && !(efunc = glme_get_encoder(enc, typeid))) {
+    // registered descriptor table
+    if (!(spec = glme_get_spec(enc, typeid)) || !spec->desc) {
+      enc->last_error = GLME_E_NOENC;
+      return -1;
+    }
+  }
+  __builtin_prefetch(ptr);
+  if (glme_encode_value_uint(enc, (unsigned int *)delta) < 0)
+    return -1;
+  if ((refs = __glme_refs_of(enc))) {
+    if ((n = __glme_refs_put(enc, refs, ptr, typeid, 0)) < 0)
+      return -1;
+    if (n > 0) {
+      *delta = 1;
+      return enc->count - __at_start;
+    }
+  }
+  if (glme_encode_type(enc, typeid) < 0)
+    return -1;
+  t->ptr = ptr;
+  t->efunc = efunc;
+  t->spec = spec;
+  t->field = vptr;
+  t->esize = esize;
+  *delta = 1;
+  return enc->count - __at_start;
+}
+
 // -------------------------------------------------------------------------
 // Array functions
 
@@ -338,16 +498,22 @@ int glme_encode_array_data(glme_buf_t *enc, const void *vptr,
                            size_t len, size_t esize, glme_encoder_f efunc)
 {
   const char *ptr = (const char *)vptr;
+  struct __etail_ctx *outer = __etail;
   int k, n;
   size_t i, __at_start = enc->count;
 
   if (! efunc)
     return -1;
 
+  // element encoders encode tail fields recursively
+  __etail = (struct __etail_ctx *)0;
   for (k = 0, i = 0; k < len; k++, i += esize) {
-    if ((n = (*efunc)(enc, (const void *)&ptr[i])) < 0)
+    if ((n = (*efunc)(enc, (const void *)&ptr[i])) < 0) {
+      __etail = outer;
       return n;
+    }
   }
+  __etail = outer;
   return enc->count - __at_start;
 }
 
@@ -394,6 +560,95 @@ int glme_encode_type(glme_buf_t *gbuf, int typeid)
   return glme_encode_value_int64(gbuf, &__t);
 }
 
+// -------------------------------------------------------------------------
+// Map functions
+
+int glme_encode_map_start(glme_buf_t *enc, int ktype, int etype, size_t count)
+{
+  size_t __at_start = enc->count;
+  uint64_t u = count;
+
+  if (__encode_base_type(enc, GLME_MAP) < 0 ||
+      glme_encode_type(enc, ktype) < 0 ||
+      glme_encode_type(enc, etype) < 0 ||
+      glme_encode_value_uint64(enc, &u) < 0)
+    return -1;
+  return enc->count - __at_start;
+}
+
+// value of type; encoded bytes of other than scalars, strings and vectors
+static
+int __encode_map_value(glme_buf_t *enc, int type, const glme_mapent_t *e)
+{
+  float f;
+
+  switch (type) {
+  case GLME_INT:
+    return glme_encode_value_int64(enc, &e->v.i);
+  case GLME_BOOLEAN:
+  case GLME_UINT:
+    return glme_encode_value_uint64(enc, &e->v.u);
+  case GLME_FLOAT:
+    return glme_encode_value_double(enc, &e->v.f);
+  case GLME_FLOAT32:
+    f = (float)e->v.f;
+    return glme_encode_value_float32(enc, &f);
+  case GLME_COMPLEX:
+    return glme_encode_value_complex128(enc, &e->v.c);
+  case GLME_STRING:
+  case GLME_VECTOR:
+    return glme_encode_bytes(enc, e->v.s.ptr, e->v.s.len);
+  }
+  if (e->v.s.len > enc->buflen - enc->count &&
+      glme_buf_resize(enc, e->v.s.len - (enc->buflen - enc->count)) == 0)
+    return -1;
+  memcpy(&enc->buf[enc->count], e->v.s.ptr, e->v.s.len);
+  enc->count += e->v.s.len;
+  return e->v.s.len;
+}
+
+int glme_encode_map_entry(glme_buf_t *enc, int ktype, int etype, const glme_mapent_t *e)
+{
+  size_t __at_start = enc->count;
+  int n;
+
+  switch (ktype) {
+  case GLME_INT:
+    n = glme_encode_value_int64(enc, &e->key.i);
+    break;
+  case GLME_UINT:
+    n = glme_encode_value_uint64(enc, &e->key.u);
+    break;
+  case GLME_STRING:
+    n = glme_encode_bytes(enc, e->key.s.ptr, e->key.s.len);
+    break;
+  default:
+    enc->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  if (n < 0)
+    return n;
+  if (etype == GLME_ANY && glme_encode_type(enc, e->type) < 0)
+    return -1;
+  if (__encode_map_value(enc, etype == GLME_ANY ? e->type : etype, e) < 0)
+    return -1;
+  return enc->count - __at_start;
+}
+
+int glme_encode_map(glme_buf_t *enc, const glme_map_t *map)
+{
+  size_t k, __at_start = enc->count;
+
+  if (glme_encode_map_start(enc, map->ktype, map->etype, map->count) < 0)
+    return -1;
+  for (k = 0; k < map->size; k++) {
+    if (map->slots[k].hash &&
+        glme_encode_map_entry(enc, map->ktype, map->etype, &map->slots[k]) < 0)
+      return -1;
+  }
+  return enc->count - __at_start;
+}
+
 // -------------------------------------------------------------------------
 // Structure functions
 
@@ -409,6 +664,11 @@ int glme_encode_start_struct(glme_buf_t *gbuf, int *delta)
 int glme_encode_end_struct(glme_buf_t *gbuf)
 {
   uint64_t u64 = 0;
+  if (__etail && __etail->ptr && __etail->enc == gbuf) {
+    // written after deferred tail structure
+    __etail->nends++;
+    return 1;
+  }
   return glme_encode_value_uint64(gbuf, &u64);
 }
 
@@ -416,7 +676,10 @@ int glme_encode_field(glme_buf_t *enc, int *delta, int typeid, int flags,
                       const void *vptr, size_t nlen, size_t esize, glme_encoder_f efunc)
 {
   int n;
+  size_t k;
   uint64_t __at_start = enc->count;
+  glme_spec_t *spec;
+  glme_refs_t *refs;
 
   if (! vptr || (vptr && esize == 0)) {
     // empty field; omit from stream and increment delta;
@@ -430,6 +693,12 @@ int glme_encode_field(glme_buf_t *enc, int *delta, int typeid, int flags,
     return 0;
   }
   
+  // empty map is omitted
+  if (typeid == GLME_MAP && ((const glme_map_t *)vptr)->count == 0) {
+    *delta += 1;
+    return 0;
+  }
+
   // zero length string is not encoded (is this good as other side is gets null pointer??)
   if (typeid == GLME_STRING && vptr && (*((char *)vptr) == 0)) {
     *delta += 1;
@@ -445,12 +714,17 @@ int glme_encode_field(glme_buf_t *enc, int *delta, int typeid, int flags,
   case GLME_INT:
   case GLME_UINT:
   case GLME_FLOAT:
+  case GLME_FLOAT32:
+    if ((flags & GLME_F_ARRAY) && (flags & (GLME_F_DELTA|GLME_F_DELTA2))) {
+      n = glme_encode_delta(enc, typeid, vptr, nlen, esize, flags & GLME_F_DELTA2 ? 2 : 1);
+      break;
+    }
     if (!efunc) {
       enc->last_error = GLME_E_NOENC;
       return -1;
     }
     if (flags & GLME_F_ARRAY) {
-      // array of (int, uint, float)
+      // array of (int, uint, float, float32)
       n = glme_encode_array(enc, typeid, vptr, nlen, esize, efunc);
     } else {
       n = (*efunc)(enc, vptr);
@@ -465,11 +739,35 @@ int glme_encode_field(glme_buf_t *enc, int *delta, int typeid, int flags,
     n = glme_encode_string(enc, (char *)vptr);
     break;
 
+  case GLME_MAP:
+    n = glme_encode_map(enc, (const glme_map_t *)vptr);
+    break;
+
   default:
+    if (!(flags & GLME_F_ARRAY) && (refs = __glme_refs_of(enc))) {
+      // structure seen before is encoded as back-reference unless embedded
+      if ((n = __glme_refs_put(enc, refs, vptr, typeid, flags & GLME_F_EMBED)) < 0)
+        return -1;
+      if (n > 0)
+        break;
+    }
     if (!efunc) {
       if (!(efunc = glme_get_encoder(enc, typeid))) {
-        enc->last_error = GLME_E_NOENC;
-        return -1;
+        // registered descriptor table
+        if (!(spec = glme_get_spec(enc, typeid)) || !spec->desc) {
+          enc->last_error = GLME_E_NOENC;
+          return -1;
+        }
+        if (flags & GLME_F_ARRAY) {
+          n = glme_encode_array_start(enc, typeid, nlen);
+          for (k = 0; k < nlen && n >= 0; k++)
+            n = glme_encode_desc(enc, spec->desc, (const char *)vptr + k*esize);
+        } else {
+          n = glme_encode_type(enc, typeid);
+          if (n >= 0)
+            n = __encode_value(enc, (glme_encoder_f)0, spec, vptr);
+        }
+        break;
       }
     }
     if (flags & GLME_F_ARRAY) {
@@ -477,7 +775,7 @@ int glme_encode_field(glme_buf_t *enc, int *delta, int typeid, int flags,
     } else {
       if (glme_encode_type(enc, typeid) < 0)
         return -1;
-      n = (*efunc)(enc, vptr);
+      n = __encode_value(enc, efunc, (glme_spec_t *)0, vptr);
     }
   }
   if (n < 0)
@@ -491,14 +789,19 @@ int glme_encode_struct(glme_buf_t *enc, int typeid, const void *ptr, glme_encode
 {
   int n;
   uint64_t __at_start = enc->count;
+  glme_spec_t *spec = (glme_spec_t *)0;
+  glme_refs_t *refs;
+  glme_dict_t *dict;
+  size_t dcount;
 
   // if null pointer then no data; only things pointed to are encoded
   if (!ptr)
     return 0;
 
   if (!efunc) {
-    // try to find encoder function
-    if (!(efunc = glme_get_encoder(enc, typeid))) {
+    // try to find encoder function or descriptor table
+    spec = glme_get_spec(enc, typeid);
+    if (!spec || (!spec->encoder && !spec->desc)) {
       enc->last_error = GLME_E_NOENC;
       return -1;
     }
@@ -506,11 +809,242 @@ int glme_encode_struct(glme_buf_t *enc, int typeid, const void *ptr, glme_encode
 
   if (glme_encode_type(enc, typeid) < 0)
     return -1;
+  if ((refs = __glme_refs_of(enc)) && __glme_refs_put(enc, refs, ptr, typeid, 1) < 0)
+    return -1;
 
-  if ((n = (*efunc)(enc, ptr)) < 0)
+  dict = __glme_dicts ? __glme_dict_of(enc) : (glme_dict_t *)0;
+  dcount = dict ? dict->count : 0;
+  n = __encode_value(enc, efunc, spec, ptr);
+  if (n < 0) {
+    // strings of failed message are not sent
+    if (dict)
+      __glme_dict_drop(enc, dict, dcount);
     return n;
+  }
+
+  return enc->count - __at_start;
+}
+
+
+// -------------------------------------------------------------------------
+// Descriptor table encoding
+
+// load scalar as encoded unsigned value; return 0 if equal to default
+static inline
+int __desc_load(int op, const void *p, const glme_value_t *dv, uint64_t *u)
+{
+  union { uint64_t u; double d; } v;
+  int64_t i;
+
+  switch (op) {
+  case GLME_OP_I8:  i = *(const int8_t *)p;  goto sint;
+  case GLME_OP_I16: i = *(const int16_t *)p; goto sint;
+  case GLME_OP_I32: i = *(const int32_t *)p; goto sint;
+  case GLME_OP_I64: i = *(const int64_t *)p;
+  sint:
+    *u = glme_zigzag(i);
+    return !dv || i != dv->i;
+  case GLME_OP_U8:  *u = *(const uint8_t *)p;  break;
+  case GLME_OP_U16: *u = *(const uint16_t *)p; break;
+  case GLME_OP_U32: *u = *(const uint32_t *)p; break;
+  case GLME_OP_U64: *u = *(const uint64_t *)p; break;
+  default:          *u = 0; break;
+  case GLME_OP_F32:
+  case GLME_OP_F64:
+    v.d = op == GLME_OP_F32 ? (double)*(const float *)p : *(const double *)p;
+    *u = glme_bswap64(v.u);
+    return !dv || v.d != dv->f;
+  }
+  return !dv || *u != dv->u;
+}
+
+static
+int __desc_struct_value_enc(glme_buf_t *enc, const glme_field_t *f, const void *p)
+{
+  glme_spec_t *spec;
+
+  if (f->nested)
+    return glme_encode_desc(enc, f->nested, p);
+  if ((spec = glme_get_spec(enc, f->type))) {
+    if (spec->encoder)
+      return __encode_value(enc, spec->encoder, spec, p);
+    if (spec->desc)
+      return glme_encode_desc(enc, spec->desc, p);
+  }
+  enc->last_error = GLME_E_NOENC;
+  return GLME_E_NOENC;
+}
+
+static
+int __desc_encode_array(glme_buf_t *enc, const glme_field_t *f,
+                        const struct glme_fieldop_s *op, const char *ptr, size_t len)
+{
+  size_t k;
+  uint64_t u;
+  char *p;
+  int n;
+
+  // ARRAY, element type, count
+  p = &enc->buf[enc->count];
+  *p++ = (char)op->wtype;
+  p = glme_put_uint64(p, glme_zigzag(f->type));
+  p = glme_put_uint64(p, len);
+
+  if (op->eop != GLME_OP_STRUCT) {
+    enc->count = p - enc->buf;
+    if (glme_buf_reserve(enc, len * 9) < 0)
+      return GLME_E_NOMEM;
+    p = &enc->buf[enc->count];
+    for (k = 0; k < len; k++) {
+      __desc_load(op->eop, &ptr[k*f->esize], (const glme_value_t *)0, &u);
+      p = glme_put_uint64(p, u);
+    }
+    enc->count = p - enc->buf;
+    return 0;
+  }
+  enc->count = p - enc->buf;
+  for (k = 0; k < len; k++) {
+    if ((n = __desc_struct_value_enc(enc, f, &ptr[k*f->esize])) < 0)
+      return n;
+  }
+  return 0;
+}
+
+// encode non-scalar field; returns 0 if field was omitted
+int __glme_desc_encode_field(glme_buf_t *enc, const glme_field_t *f,
+                             const struct glme_fieldop_s *op, const char *p, uint64_t delta)
+{
+  const char *s;
+  char *w;
+  size_t len;
+  glme_refs_t *refs;
+  int n;
+
+  switch (op->op) {
+  case GLME_OP_STRING:
+    if (!(s = *(const char **)p) || *s == '\0')
+      return 0;
+    if (__glme_dicts && __glme_dict_of(enc)) {
+      if (glme_encode_value_uint64(enc, &delta) < 0 || glme_encode_string(enc, s) < 0)
+        return -1;
+      return 1;
+    }
+    len = strlen(s);
+    if (glme_buf_reserve(enc, len + 19) < 0)
+      return GLME_E_NOMEM;
+    w = glme_put_uint64(&enc->buf[enc->count], delta);
+    *w++ = (char)op->wtype;
+    w = glme_put_uint64(w, len);
+    memcpy(w, s, len);
+    enc->count = w + len - enc->buf;
+    return 1;
+
+  case GLME_OP_BYTES:
+    if (glme_buf_reserve(enc, f->nelem + 19) < 0)
+      return GLME_E_NOMEM;
+    w = glme_put_uint64(&enc->buf[enc->count], delta);
+    *w++ = (char)op->wtype;
+    w = glme_put_uint64(w, f->nelem);
+    memcpy(w, p, f->nelem);
+    enc->count = w + f->nelem - enc->buf;
+    return 1;
+
+  case GLME_OP_STRUCT_PTR:
+    if (!(p = *(const char **)p))
+      return 0;
+    // fall through
+  case GLME_OP_STRUCT:
+    if (glme_buf_reserve(enc, 18) < 0)
+      return GLME_E_NOMEM;
+    w = glme_put_uint64(&enc->buf[enc->count], delta);
+    enc->count = w - enc->buf;
+    // embedded structure is numbered but never a back-reference
+    if ((refs = __glme_refs_of(enc)) &&
+        (n = __glme_refs_put(enc, refs, p, f->type, op->op == GLME_OP_STRUCT)) != 0)
+      return n < 0 ? n : 1;
+    w = glme_put_uint64(w, glme_zigzag(f->type));
+    enc->count = w - enc->buf;
+    if ((n = __desc_struct_value_enc(enc, f, p)) < 0)
+      return n;
+    return 1;
+
+  case GLME_OP_ARRAY:
+  case GLME_OP_VECTOR:
+    if (op->op == GLME_OP_ARRAY) {
+      switch (f->lensize) {
+      case 1: len = *(const uint8_t *)(p - f->offset + f->lenoff); break;
+      case 2: len = *(const uint16_t *)(p - f->offset + f->lenoff); break;
+      case 4: len = *(const uint32_t *)(p - f->offset + f->lenoff); break;
+      default: len = *(const uint64_t *)(p - f->offset + f->lenoff); break;
+      }
+      if (len == 0 || !(p = *(const char **)p))
+        return 0;
+    } else {
+      len = f->nelem;
+    }
+    if (glme_buf_reserve(enc, 37) < 0)
+      return GLME_E_NOMEM;
+    enc->count = glme_put_uint64(&enc->buf[enc->count], delta) - enc->buf;
+    if ((n = __desc_encode_array(enc, f, op, p, len)) < 0)
+      return n;
+    return 1;
+  }
+  enc->last_error = GLME_E_INVAL;
+  return GLME_E_INVAL;
+}
 
+int glme_encode_desc(glme_buf_t *enc, const glme_desc_t *desc, const void *ptr)
+{
+  const struct glme_fieldop_s *ops = desc->ops;
+  const glme_field_t *fields = desc->fields;
+  const char *base = (const char *)ptr;
+  uint64_t u, delta = 1, __at_start = enc->count;
+  glme_dict_t *dict = __glme_dicts ? __glme_dict_of(enc) : (glme_dict_t *)0;
+  size_t dcount = dict ? dict->count : 0;
+  unsigned int k, end;
+  char *p;
+  int n;
+
+  if (!ops) {
+    enc->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+
+  for (k = 0; k < desc->nfields; ) {
+    if ((end = ops[k].nrun) > 0) {
+      // run of scalars; one space check and no calls
+      if ((n = glme_buf_reserve(enc, end * __GLME_SCALAR_MAX)) < 0)
+        goto error;
+      p = &enc->buf[enc->count];
+      for (end += k; k < end; k++) {
+        if (!__desc_load(ops[k].op, base + fields[k].offset, &fields[k].defval, &u)) {
+          delta++;
+          continue;
+        }
+        p = glme_put_uint64(p, delta);
+        *p++ = (char)ops[k].wtype;
+        p = glme_put_uint64(p, u);
+        delta = 1;
+      }
+      enc->count = p - enc->buf;
+      continue;
+    }
+    if ((n = __glme_desc_encode_field(enc, &fields[k], &ops[k], base + fields[k].offset, delta)) < 0)
+      goto error;
+    delta = n > 0 ? 1 : delta + 1;
+    k++;
+  }
+  // end of struct
+  if ((n = glme_buf_reserve(enc, 1)) < 0)
+    goto error;
+  enc->buf[enc->count++] = 0;
   return enc->count - __at_start;
+
+ error:
+  // strings of failed message are not sent
+  if (dict)
+    __glme_dict_drop(enc, dict, dcount);
+  return n;
 }
 
 // Local Variables:
@@ -47,13 +47,115 @@
  * We assume that number of encoder/decoder specs is relatively small and therefore
  * use simple linear search. Alternatively could sort them in increasing order and
  * use binary search.
+ *
+ * Shared handler base keeps its specs in an immutable snapshot sorted by typeid.
+ * Readers load the snapshot pointer once and use binary search; writers take the
+ * writer lock, build a modified copy and publish it with release store. Replaced
+ * snapshots are linked to retired list and released in glme_base_reclaim().
  */
 
+static inline
+void __base_lock(glme_base_t *base)
+{
+  while (__atomic_exchange_n(&base->wlock, 1, __ATOMIC_ACQUIRE))
+    while (__atomic_load_n(&base->wlock, __ATOMIC_RELAXED))
+      ;
+}
+
+static inline
+void __base_unlock(glme_base_t *base)
+{
+  __atomic_store_n(&base->wlock, 0, __ATOMIC_RELEASE);
+}
+
+static inline
+glme_snapshot_t *__snapshot_new(unsigned int nelem)
+{
+  glme_snapshot_t *s;
+  s = (glme_snapshot_t *)malloc(sizeof(glme_snapshot_t) + nelem*sizeof(glme_spec_t));
+  if (s) {
+    s->next = (glme_snapshot_t *)0;
+    s->nelem = nelem;
+  }
+  return s;
+}
+
+// index of first spec with typeid greater or equal to typeid
+static inline
+unsigned int __snapshot_search(const glme_snapshot_t *s, int typeid)
+{
+  unsigned int lo = 0, hi = s->nelem, mid;
+  while (lo < hi) {
+    mid = (lo + hi) >> 1;
+    if (s->specs[mid].typeid < typeid)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// publish new snapshot and retire the current one; called with writer lock held
+static inline
+void __snapshot_publish(glme_base_t *base, glme_snapshot_t *s)
+{
+  glme_snapshot_t *old = base->snapshot;
+  __atomic_store_n(&base->snapshot, s, __ATOMIC_RELEASE);
+  old->next = base->retired;
+  base->retired = old;
+}
+
+static
+int __shared_register(glme_base_t *base, glme_spec_t *spec)
+{
+  glme_snapshot_t *s, *cur;
+  unsigned int k, n;
+
+  __base_lock(base);
+  cur = base->snapshot;
+  k = __snapshot_search(cur, spec->typeid);
+  n = (k < cur->nelem && cur->specs[k].typeid == spec->typeid) ? cur->nelem : cur->nelem + 1;
+  if (!(s = __snapshot_new(n))) {
+    __base_unlock(base);
+    return GLME_E_NOMEM;
+  }
+  memcpy(s->specs, cur->specs, k*sizeof(glme_spec_t));
+  s->specs[k] = *spec;
+  if (n == cur->nelem)
+    memcpy(&s->specs[k+1], &cur->specs[k+1], (n-k-1)*sizeof(glme_spec_t));
+  else
+    memcpy(&s->specs[k+1], &cur->specs[k], (n-k-1)*sizeof(glme_spec_t));
+  __snapshot_publish(base, s);
+  __base_unlock(base);
+  return k;
+}
+
+static
+void __shared_unregister(glme_base_t *base, int typeid)
+{
+  glme_snapshot_t *s, *cur;
+  unsigned int k;
+
+  __base_lock(base);
+  cur = base->snapshot;
+  k = __snapshot_search(cur, typeid);
+  if (k < cur->nelem && cur->specs[k].typeid == typeid) {
+    if ((s = __snapshot_new(cur->nelem-1))) {
+      memcpy(s->specs, cur->specs, k*sizeof(glme_spec_t));
+      memcpy(&s->specs[k], &cur->specs[k+1], (cur->nelem-k-1)*sizeof(glme_spec_t));
+      __snapshot_publish(base, s);
+    }
+  }
+  __base_unlock(base);
+}
 
 void glme_base_init(glme_base_t *base, glme_spec_t *specs, unsigned int nelem,
                     glme_allocator_t *alloc)
 {
   base->nelem = base->owner = 0;
+  base->handlers = (glme_spec_t *)0;
+  base->snapshot = base->retired = (glme_snapshot_t *)0;
+  base->wlock = 0;
   if (specs) {
     base->handlers = specs;
     base->nelem = nelem;
@@ -70,11 +172,38 @@ void glme_base_init(glme_base_t *base, glme_spec_t *specs, unsigned int nelem,
   base->calloc  = alloc && alloc->calloc  ? alloc->calloc  : calloc;
 }
 
+int glme_base_init_shared(glme_base_t *base, glme_spec_t *specs, unsigned int nelem,
+                          glme_allocator_t *alloc)
+{
+  int i;
+  glme_snapshot_t *s;
+
+  glme_base_init(base, (glme_spec_t *)0, 0, alloc);
+  if (!(s = __snapshot_new(0)))
+    return GLME_E_NOMEM;
+  base->snapshot = s;
+  for (i = 0; specs && i < nelem; i++) {
+    if (specs[i].typeid != 0 && __shared_register(base, &specs[i]) < 0) {
+      // release snapshots made so far
+      glme_base_release(base);
+      return GLME_E_NOMEM;
+    }
+  }
+  // nobody has seen the intermediate snapshots
+  glme_base_reclaim(base);
+  return 0;
+}
+
 glme_spec_t *glme_base_find(glme_base_t *base, int typeid)
 {
   int i;
+  glme_snapshot_t *s;
   if (!base)
     return (glme_spec_t *)0;
+  if ((s = __atomic_load_n(&base->snapshot, __ATOMIC_ACQUIRE))) {
+    i = __snapshot_search(s, typeid);
+    return i < s->nelem && s->specs[i].typeid == typeid ? &s->specs[i] : (glme_spec_t *)0;
+  }
   for (i = 0; i < base->nelem; i++) {
     if (typeid == base->handlers[i].typeid)
       return &base->handlers[i];
@@ -87,6 +216,14 @@ int glme_base_register(glme_base_t *base, glme_spec_t *spec)
   int i;
   if (!base)
     return -1;
+  // field descriptors are checked once at registration
+  if (spec->desc && !spec->desc->ops) {
+    if ((i = glme_desc_init((glme_desc_t *)spec->desc)) < 0)
+      return i;
+  }
+
+  if (base->snapshot)
+    return __shared_register(base, spec);
 
   for (i = 0; i < base->nelem; i++) {
     if (base->handlers[i].typeid == 0) {
@@ -99,11 +236,48 @@ int glme_base_register(glme_base_t *base, glme_spec_t *spec)
 
 void glme_base_unregister(glme_base_t *base, int typeid)
 {
-  glme_spec_t *spec = glme_base_find(base, typeid);
+  glme_spec_t *spec;
+  if (base && base->snapshot) {
+    __shared_unregister(base, typeid);
+    return;
+  }
+  spec = glme_base_find(base, typeid);
   if (spec)
     spec->typeid = 0;
 }
 
+int glme_base_reclaim(glme_base_t *base)
+{
+  int n = 0;
+  glme_snapshot_t *s, *next;
+
+  if (!base)
+    return 0;
+  __base_lock(base);
+  s = base->retired;
+  base->retired = (glme_snapshot_t *)0;
+  __base_unlock(base);
+
+  for (; s; s = next, n++) {
+    next = s->next;
+    free(s);
+  }
+  return n;
+}
+
+void glme_base_release(glme_base_t *base)
+{
+  if (!base)
+    return;
+  if (base->owner) 
+    free(base->handlers);
+  if (base->snapshot) {
+    glme_base_reclaim(base);
+    free(base->snapshot);
+    base->snapshot = (glme_snapshot_t *)0;
+  }
+}
+
 
 size_t glme_buf_resize(glme_buf_t *gbuf, size_t increase)
 {
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * This file is part of https://github.com/hrautila/glme repository.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _DESCRIPTOR_H
+#define _DESCRIPTOR_H
+
+// Compiled field operations of structure descriptors (internal).
+
+enum glme_field_ops {
+  GLME_OP_NONE = 0,
+  GLME_OP_I8,
+  GLME_OP_I16,
+  GLME_OP_I32,
+  GLME_OP_I64,
+  GLME_OP_U8,
+  GLME_OP_U16,
+  GLME_OP_U32,
+  GLME_OP_U64,
+  GLME_OP_F32,
+  GLME_OP_F64,
+  GLME_OP_BYTES,
+  GLME_OP_STRING,
+  GLME_OP_STRUCT,
+  GLME_OP_STRUCT_PTR,
+  GLME_OP_ARRAY,
+  GLME_OP_VECTOR
+};
+
+struct glme_fieldop_s {
+  unsigned char op;     // field operation
+  unsigned char eop;    // array element operation
+  unsigned char wtype;  // encoded type byte of field (base types only)
+  unsigned char etype;  // encoded type byte of array element (base types only)
+  unsigned int nrun;    // number of consecutive scalar fields starting here
+};
+
+#define __GLME_OP_SCALAR(op) ((op) >= GLME_OP_I8 && (op) <= GLME_OP_F64)
+
+// maximum encoded size of scalar field; delta, type byte and value
+#define __GLME_SCALAR_MAX 19
+
+// field operations of the descriptor interpreter shared with compiled code
+extern int __glme_desc_encode_field(glme_buf_t *enc, const glme_field_t *f,
+                                    const struct glme_fieldop_s *op, const char *p,
+                                    uint64_t delta);
+extern int __glme_desc_field(glme_buf_t *dec, const glme_field_t *f,
+                             const struct glme_fieldop_s *op, char *p);
+extern void __glme_desc_default(const glme_field_t *f, int op, char *p);
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * This file is part of https://github.com/hrautila/glme repository.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _DICT_H
+#define _DICT_H
+
+// String dictionaries (internal).
+
+struct glme_dictent_s {
+  char *str;            // interned copy; null if empty hash slot
+  size_t len;
+  size_t id;            // sequence number
+};
+
+// active dictionary of buffer; null if none
+static inline
+glme_dict_t *__glme_dict_of(glme_buf_t *gb)
+{
+  glme_dict_t *d;
+  for (d = __glme_dicts; d; d = d->outer)
+    if (d->gbuf == gb)
+      return d;
+  return (glme_dict_t *)0;
+}
+
+// write reference to string seen before or enter new string; returns number of
+// bytes written, zero if string must be written as is, negative on error
+extern int __glme_dict_put(glme_buf_t *enc, glme_dict_t *d, const char *s, size_t len);
+
+// drop strings entered at or after count; encode that entered them failed and
+// the peer never sees them
+extern void __glme_dict_drop(glme_buf_t *enc, glme_dict_t *d, size_t count);
+
+// enter decoded string; *out is interned or allocated copy
+extern int __glme_dict_add(glme_buf_t *dec, glme_dict_t *d, const char *s, size_t len, char **out);
+
+// resolve reference decoded in place of type id
+extern int __glme_dict_get(glme_buf_t *dec, glme_dict_t *d, int ref, char **out);
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * This file is part of https://github.com/hrautila/glme repository.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _GLIMITS_H
+#define _GLIMITS_H
+
+// Decode limits (internal).
+
+// active limits of buffer; null if none
+static inline
+glme_limits_t *__glme_limits_of(glme_buf_t *gb)
+{
+  glme_limits_t *l;
+  for (l = __glme_limits; l; l = l->outer)
+    if (l->gbuf == gb)
+      return l;
+  return (glme_limits_t *)0;
+}
+
+// enter nested structure; returns limits to leave or null, GLME_E_LIMIT in *err
+// if nesting is too deep
+static inline
+glme_limits_t *__glme_depth_enter(glme_buf_t *dec, int *err)
+{
+  glme_limits_t *l;
+
+  *err = 0;
+  if (!__glme_limits || !(l = __glme_limits_of(dec)))
+    return (glme_limits_t *)0;
+  if (l->maxdepth && l->depth >= l->maxdepth) {
+    l->exceeded = 1;
+    dec->last_error = GLME_E_LIMIT;
+    *err = GLME_E_LIMIT;
+    return (glme_limits_t *)0;
+  }
+  l->depth++;
+  return l;
+}
+
+static inline
+void __glme_depth_leave(glme_limits_t *l)
+{
+  if (l)
+    l->depth--;
+}
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
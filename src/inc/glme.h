@@ -36,6 +36,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <complex.h>
+#include <sys/uio.h>
 
 // for inline base functions (see glme.c)
 #ifndef __GLME_INLINE__
@@ -56,10 +57,14 @@ extern "C" {
     GLME_VECTOR         = 5,
     GLME_STRING         = 6,
     GLME_COMPLEX        = 7,
+    GLME_PACKED         = 8,
+    GLME_DELTA          = 9,
     GLME_ARRAY          = 10,
-    GLME_MAP            = 11, /* Reserved */
+    GLME_MAP            = 11,
     GLME_NAMED_STRUCT   = 12, /* Reserved */
     GLME_NAMED_MAP      = 13, /* Reserved */
+    GLME_FLOAT32        = 14,
+    GLME_COLUMNS        = 15,
     GLME_BASE_MAX       = 15, /* */
     GLME_USER_MIN       = 16  /* first user available type id */
   };
@@ -67,7 +72,12 @@ extern "C" {
   enum glme_flags {
     GLME_F_NONE   = 0x0,
     GLME_F_ARRAY  = 0x1,
-    GLME_F_PTR    = 0x2
+    GLME_F_PTR    = 0x2,
+    GLME_F_ALIGN  = 0x4,
+    GLME_F_VIEW   = 0x8,
+    GLME_F_DELTA  = 0x10,
+    GLME_F_DELTA2 = 0x20,
+    GLME_F_EMBED  = 0x40
   };
 
   /* Not yet used, needs some thought. */
@@ -80,11 +90,13 @@ extern "C" {
     GLME_E_NOSIZE = -6,
     GLME_E_NOMEM  = -7,
     GLME_E_UFLOW  = -8,
-    GLME_E_OFLOW  = -9
+    GLME_E_OFLOW  = -9,
+    GLME_E_LIMIT  = -10
   };
 
 // forward spec
 typedef struct glme_base_s glme_base_t;
+typedef struct glme_desc_s glme_desc_t;
 
 /**
  * Gob Like Message Encoding buffer
@@ -110,6 +122,7 @@ typedef struct glme_spec_s
   size_t size;         // sizeof(<struct message>)
   glme_encoder_f encoder;
   glme_decoder_f decoder;
+  const glme_desc_t *desc;  // field descriptor table, used if no encoder/decoder
 } glme_spec_t;
 
 /**
@@ -123,6 +136,17 @@ typedef struct glme_allocator_s
   void *(*calloc)(size_t, size_t);      ///< Allocation in blocks
 } glme_allocator_t;
 
+/**
+ * Immutable handler table snapshot of a shared handler base. Specs are sorted
+ * in increasing typeid order.
+ */
+typedef struct glme_snapshot_s
+{
+  struct glme_snapshot_s *next;         ///< Link in retired snapshot list
+  unsigned int nelem;                   ///< Number of specs
+  glme_spec_t specs[];
+} glme_snapshot_t;
+
 /**
  * Handler base
  */
@@ -135,6 +159,9 @@ struct glme_base_s
   unsigned int nelem;
   glme_spec_t *handlers;
   int owner;
+  glme_snapshot_t *snapshot;            ///< Current snapshot, non-null for shared base
+  glme_snapshot_t *retired;             ///< Replaced snapshots waiting for reclaim
+  int wlock;                            ///< Writer lock for shared base
 };
 
 
@@ -148,7 +175,7 @@ __GLME_INLINE__
 glme_spec_t *glme_spec_init(glme_spec_t *spec, int typeid,
                             glme_encoder_f encoder, glme_decoder_f decoder, size_t size)
 {
-  *spec = (glme_spec_t){typeid, size, encoder, decoder};
+  *spec = (glme_spec_t){typeid, size, encoder, decoder, (const glme_desc_t *)0};
   return spec;
 }
 
@@ -173,10 +200,35 @@ glme_spec_t *glme_spec_init(glme_spec_t *spec, int typeid,
 extern void glme_base_init(glme_base_t *base, glme_spec_t *specs, unsigned int nelem,
                            glme_allocator_t *alloc);
 
+/**
+ * Initialize handler base that can be shared between decoding threads.
+ *
+ * Readers find handlers from an immutable snapshot of the handler table with
+ * single atomic pointer load and never block. Writers (register, unregister) are
+ * serialized and publish a new copy of the table. Replaced snapshots are kept
+ * until glme_base_reclaim() is called.
+ *
+ * @param base
+ *   Handler base.
+ * @param specs
+ *   Array of initial encoder/decoder specs. May be null. Specs are copied.
+ * @param nelem
+ *   Number of elements in spec array.
+ * @param alloc
+ *   Optional memory allocator functions.
+ *
+ * @return
+ *   Zero on success or negative error code. On error the base holds no
+ *   memory.
+ */
+extern int glme_base_init_shared(glme_base_t *base, glme_spec_t *specs, unsigned int nelem,
+                                 glme_allocator_t *alloc);
+
 extern glme_spec_t *glme_base_find(glme_base_t *base, int typeid);
 
 /**
- * Register typeid handlers.
+ * Register typeid handlers. On shared base existing handlers for the typeid
+ * are replaced. Field descriptor table of the spec is compiled if not already done.
  */
   extern int glme_base_register(glme_base_t *base, glme_spec_t *spec);
 /**
@@ -184,15 +236,21 @@ extern glme_spec_t *glme_base_find(glme_base_t *base, int typeid);
  */
 extern void glme_base_unregister(glme_base_t *base, int typeid);
 
+/**
+ * Release snapshots replaced by register and unregister operations on shared
+ * handler base. Caller must ensure that no thread is still using spec pointers
+ * found before the last modification, e.g. all decoding threads have passed
+ * a quiescent point after it.
+ *
+ * @return
+ *   Number of snapshots released.
+ */
+extern int glme_base_reclaim(glme_base_t *base);
+
 /**
  * Release handler table if allocated at initialization.
  */
-__GLME_INLINE__
-void glme_base_release(glme_base_t *base)
-{
-  if (base && base->owner) 
-    free(base->handlers);
-}
+extern void glme_base_release(glme_base_t *base);
 
 
 /**
@@ -234,12 +292,23 @@ glme_decoder_f glme_get_decoder(glme_buf_t *gb, int typeid)
   return s ? s->decoder : (glme_decoder_f)0;
 }
 
+// decode limits; active limits of this thread and charging allocations
+typedef struct glme_limits_s glme_limits_t;
+extern __thread glme_limits_t *__glme_limits;
+extern int __glme_limits_charge(glme_buf_t *gb, size_t nelem, size_t nbyt);
+
+// string dictionaries; active dictionaries of this thread
+typedef struct glme_dict_s glme_dict_t;
+extern __thread glme_dict_t *__glme_dicts;
+
 /**
  * Allocate memory nbyt bytes of memory.
  */
 __GLME_INLINE__
 void *glme_malloc(glme_buf_t *gb, size_t nbyt)
 {
+  if (__glme_limits && __glme_limits_charge(gb, 1, nbyt) < 0)
+    return (void *)0;
   return gb->base && gb->base->malloc
     ? (*gb->base->malloc)(nbyt)
     : malloc(nbyt);
@@ -251,6 +320,8 @@ void *glme_malloc(glme_buf_t *gb, size_t nbyt)
 __GLME_INLINE__
 void *glme_realloc(glme_buf_t *gb, void *ptr, size_t nbyt)
 {
+  if (__glme_limits && __glme_limits_charge(gb, 1, nbyt) < 0)
+    return (void *)0;
   return gb->base && gb->base->realloc
     ? (*gb->base->realloc)(ptr, nbyt)
     : realloc(ptr, nbyt);
@@ -262,6 +333,8 @@ void *glme_realloc(glme_buf_t *gb, void *ptr, size_t nbyt)
 __GLME_INLINE__
 void *glme_calloc(glme_buf_t *gb, size_t nelem, size_t nbyt)
 {
+  if (__glme_limits && __glme_limits_charge(gb, nelem, nbyt) < 0)
+    return (void *)0;
   return gb->base && gb->base->calloc
     ? (*gb->base->calloc)(nelem, nbyt)
     : calloc(nelem, nbyt);
@@ -578,6 +651,15 @@ extern int glme_encode_value_int(glme_buf_t *gbuf, const int *v);
 extern int glme_encode_float(glme_buf_t *gbuf, const float *v);
 extern int glme_encode_value_float(glme_buf_t *gbuf, const float *v);
 
+/**
+ * Encode single precision float without widening to double; sent as type
+ * GLME_FLOAT32. Floating point decoders accept both types.
+ *
+ * @see glme_encode_uint64
+ */
+extern int glme_encode_float32(glme_buf_t *gbuf, const float *v);
+extern int glme_encode_value_float32(glme_buf_t *gbuf, const float *v);
+
 /**
  * Encode single precision complex into the specified buffer.
  *
@@ -653,7 +735,7 @@ extern int glme_encode_start_struct(glme_buf_t *gbuf, int *delta);
  * @param   gbuf    Encode buffer
  * @param   delta   Pointer to field counter delta
  * @param   typeid  Element type, if array then array element typeid
- * @param   flags   Flag bits 
+ * @param   flags   Flag bits; GLME_F_EMBED for embedded structure, never a back-reference
  * @param   vptr    Pointer to field value
  * @param   nlen    Number of elements in array
  * @param   esize   Element size, used also not-empty value indicator for simple types.
@@ -663,13 +745,35 @@ extern int glme_encode_start_struct(glme_buf_t *gbuf, int *delta);
 extern int glme_encode_field(glme_buf_t *gbuf, int *delta, int typeid, int flags,
                              const void *vptr, size_t nlen, size_t esize, glme_encoder_f efunc);
 
+/**
+ * Encode structure pointer that is the last field of the structure being encoded.
+ *
+ * When the encoder function was called by the library (glme_encode_struct,
+ * glme_encode_field) only field delta and type id are written and the
+ * structure is encoded after the current encoder function has returned.
+ * Chains of structures linked by tail fields are encoded in a loop in constant
+ * stack space and the following structures are prefetched ahead. Output is
+ * identical to glme_encode_field.
+ *
+ * @param   gbuf    Encode buffer
+ * @param   delta   Pointer to field counter delta
+ * @param   typeid  Structure type id
+ * @param   vptr    Pointer to structure pointer field
+ * @param   esize   Structure size
+ * @param   efunc   Structure encoder function; registered encoder if null
+ */
+extern int glme_encode_field_tail(glme_buf_t *gbuf, int *delta, int typeid,
+                                  const void *vptr, size_t esize, glme_encoder_f efunc);
+
 /**
  * Encode structure end mark into the specified buffer.
  */
 extern int glme_encode_end_struct(glme_buf_t *gbuf);
 
 /**
- * Encode structure into the specified buffer.
+ * Encode structure into the specified buffer. If encoder function is null it is
+ * looked up from the registery; registered type without encoder function is encoded
+ * with its field descriptor table.
  */
 extern int glme_encode_struct(glme_buf_t *enc, int typeid, const void *ptr, glme_encoder_f efunc);
 
@@ -722,7 +826,7 @@ extern int glme_decode_peek_int64(glme_buf_t *dec, int64_t *v);
 
 /**
  * Decode double precision IEEE floating point type or valuer from the
- * specified decoder.
+ * specified decoder. Typed decoders accept GLME_FLOAT32 values too.
  *
  * @param dec
  *   Decoder
@@ -735,6 +839,13 @@ extern int glme_decode_value_double(glme_buf_t *dec, double *v);
 extern int glme_decode_float(glme_buf_t *dec, float *v);
 extern int glme_decode_value_float(glme_buf_t *dec, float *v);
 
+/**
+ * Decode single precision float sent as GLME_FLOAT32; typed decoder accepts
+ * GLME_FLOAT values too.
+ */
+extern int glme_decode_float32(glme_buf_t *dec, float *v);
+extern int glme_decode_value_float32(glme_buf_t *dec, float *v);
+
 /**
  * Decode double precision IEEE complex type or valuer from the
  * specified decoder.
@@ -856,6 +967,29 @@ extern int glme_decode_field_id(glme_buf_t *dec, int *next, int cur);
 extern int glme_decode_field(glme_buf_t *dec, unsigned int *delta, int typeid, int flags,
                              void *vptr, size_t *nlen, size_t esize, glme_decoder_f dfunc);
 
+/**
+ * Read structure pointer that is the last field of the structure being decoded.
+ *
+ * When the decoder function was called by the library (glme_decode_struct,
+ * glme_decode_field) the structure is allocated and linked to the field but
+ * decoded only after the current decoder function has returned. Chains of
+ * structures linked by tail fields, e.g. linked lists, are decoded in a loop
+ * in constant stack space. Otherwise structure is decoded recursively as with
+ * glme_decode_field.
+ *
+ * @param dec    Decoder
+ * @param delta  Current delta value
+ * @param typeid Expected type id
+ * @param vptr   Pointer to structure pointer field
+ * @param esize  Structure size
+ * @param dfunc  Structure decoder function; registered decoder if null
+ *
+ * @return
+ *    Number of bytes consumed or negative error number.
+ */
+extern int glme_decode_field_tail(glme_buf_t *dec, unsigned int *delta, int typeid,
+                                  void *vptr, size_t esize, glme_decoder_f dfunc);
+
 /**
  * Initialize structure decoder
  */
@@ -865,6 +999,46 @@ extern int glme_decode_start_struct(glme_buf_t *dec, int *delta);
  */
 extern int glme_decode_end_struct(glme_buf_t *dec);
 
+/**
+ * Skip unknown trailing fields and read end of struct marker.
+ *
+ * @return
+ *    Number of bytes consumed or negative error number.
+ */
+extern int glme_decode_end_struct_skip(glme_buf_t *dec);
+
+/**
+ * Skip one element at read pointer; type id and value of a scalar, vector,
+ * string, array, map or structure. Only the wire format is used, no handlers or
+ * descriptors. Arrays of scalars are skipped without decoding the values.
+ * Skipping does not recurse; arrays and maps may nest GLME_READER_DEPTH deep,
+ * deeper nesting fails with GLME_E_LIMIT.
+ *
+ * @return
+ *    Number of bytes skipped or negative error number. Read pointer is
+ *    not moved on error.
+ */
+extern int glme_skip(glme_buf_t *dec);
+
+/**
+ * Skip remaining fields of a structure up to and including its end marker.
+ *
+ * @return
+ *    Number of bytes skipped or negative error number.
+ */
+extern int glme_skip_fields(glme_buf_t *dec);
+
+/**
+ * Skip field at read pointer if its number matches field counter. Used in
+ * place of decoding a field that is not needed; value is stepped over with
+ * the wire format only.
+ *
+ * @return
+ *    Number of bytes skipped, zero if field is not present or negative
+ *    error number.
+ */
+extern int glme_decode_field_skip(glme_buf_t *dec, unsigned int *delta);
+
 /**
  * Read structure type from the specified buffer.
  *
@@ -884,6 +1058,7 @@ extern int glme_decode_end_struct(glme_buf_t *dec);
  * decoded structure.  If esize is zero then type size for the decoded type id is looked up from
  * internal type registery. If lookup fails then error is returned. Likewise if decoder function
  * is null it is looked up from the registery and error is returned if decoder function not found.
+ * Registered type without decoder function is decoded with its field descriptor table.
  *
  * @return
  *   Number of bytes consumed or negative error code.
@@ -938,7 +1113,8 @@ extern int glme_decode_array_data(glme_buf_t *dec, void **dst,
                                   size_t len, size_t esize, glme_decoder_f func);
 
 /**
- * Read array from the specified buffer.
+ * Read array from the specified buffer. Delta encoded integer array is
+ * decoded with glme_decode_delta; element decoder function is not used.
  */
 extern int glme_decode_array(glme_buf_t *dec, int *typeid, void **dst,
                              size_t *len, size_t esize, glme_decoder_f func);
@@ -964,191 +1140,1865 @@ extern int glme_decode_type(glme_buf_t *dec, int *t);
 extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
 
 // ----------------------------------------------------------------------------
-// encode helper macros
+// Field descriptor tables
 
 /**
- * Encoder standard definitions.
+ * Default value of scalar field.
  */
-#define GLME_ENCODE_STDDEF(enc)                 \
-  int __e, __ne, __delta;                       \
-  size_t __nl, __start_at = (enc)->count
+typedef union glme_value_u
+{
+  int64_t i;
+  uint64_t u;
+  double f;
+} glme_value_t;
+
+/**
+ * Storage kind of structure field.
+ */
+enum glme_kinds {
+  GLME_K_NONE       = 0,
+  GLME_K_INT        = 1,  ///< Signed integer of 1, 2, 4 or 8 bytes
+  GLME_K_UINT       = 2,  ///< Unsigned integer of 1, 2, 4 or 8 bytes
+  GLME_K_FLOAT      = 3,  ///< Float or double
+  GLME_K_BYTES      = 4,  ///< Fixed size byte vector (char[])
+  GLME_K_STRING     = 5,  ///< Null terminated string (char *)
+  GLME_K_STRUCT     = 6,  ///< Embedded structure
+  GLME_K_STRUCT_PTR = 7,  ///< Pointer to structure
+  GLME_K_ARRAY      = 8,  ///< Pointer to array and separate length field
+  GLME_K_VECTOR     = 9   ///< Fixed size array
+};
 
+struct glme_fieldop_s;
 
 /**
- * Encode structure header
- *
- * @param enc    Encode buffer
- * @param typeid Type id for structure type.
+ * Structure field descriptor.
  */
-#define GLME_ENCODE_STRUCT_START(enc) \
-  do { \
-    if (glme_encode_start_struct(enc, &__delta) < 0)	\
-      return -1;					\
-  } while (0)
+typedef struct glme_field_s
+{
+  size_t offset;                ///< Field offset in structure
+  size_t esize;                 ///< Field size or array element size in bytes
+  size_t nelem;                 ///< Number of elements in fixed size array
+  size_t lenoff;                ///< Offset of array length field
+  int lensize;                  ///< Size of array length field
+  int kind;                     ///< Field storage kind
+  int type;                     ///< Element type or structure typeid
+  const glme_desc_t *nested;    ///< Optional descriptor for structure typed elements
+  glme_value_t defval;          ///< Default value of scalar field
+} glme_field_t;
 
 /**
- * Encode structure end marker. Make return with number of bytes encoded.
- *
- * @param enc    Encode buffer
+ * Structure descriptor.
  */
-#define GLME_ENCODE_STRUCT_END(enc)              \
-  do {                                           \
-    if (glme_encode_end_struct(enc) < 0)         \
-      return -4;                                 \
-  } while (0)
+struct glme_desc_s
+{
+  int typeid;                   ///< Structure typeid
+  size_t size;                  ///< Structure size
+  unsigned int nfields;         ///< Number of fields
+  const glme_field_t *fields;   ///< Fields in encoding order
+  struct glme_fieldop_s *ops;   ///< Compiled field operations
+};
 
-#define GLME_ENCODE_RETURN(enc) \
-  return (enc)->count - __start_at
+#define __GLME_FSIZE(stype, member) sizeof(((stype *)0)->member)
+#define __GLME_ESIZE(stype, member) sizeof(((stype *)0)->member[0])
+
+#define GLME_FIELD_INT(stype, member, dv)                               \
+  { offsetof(stype, member), __GLME_FSIZE(stype, member), 1, 0, 0,      \
+      GLME_K_INT, GLME_INT, (const glme_desc_t *)0, { .i = (dv) } }
+
+#define GLME_FIELD_UINT(stype, member, dv)                              \
+  { offsetof(stype, member), __GLME_FSIZE(stype, member), 1, 0, 0,      \
+      GLME_K_UINT, GLME_UINT, (const glme_desc_t *)0, { .u = (dv) } }
+
+#define GLME_FIELD_DOUBLE(stype, member, dv)                            \
+  { offsetof(stype, member), __GLME_FSIZE(stype, member), 1, 0, 0,      \
+      GLME_K_FLOAT, GLME_FLOAT, (const glme_desc_t *)0, { .f = (dv) } }
+
+#define GLME_FIELD_VECTOR(stype, member)                                \
+  { offsetof(stype, member), 1, __GLME_FSIZE(stype, member), 0, 0,      \
+      GLME_K_BYTES, GLME_VECTOR, (const glme_desc_t *)0, { 0 } }
+
+#define GLME_FIELD_STRING(stype, member)                                \
+  { offsetof(stype, member), __GLME_FSIZE(stype, member), 1, 0, 0,      \
+      GLME_K_STRING, GLME_STRING, (const glme_desc_t *)0, { 0 } }
+
+#define GLME_FIELD_STRUCT(stype, member, typeid, desc)                  \
+  { offsetof(stype, member), __GLME_FSIZE(stype, member), 1, 0, 0,      \
+      GLME_K_STRUCT, typeid, desc, { 0 } }
+
+#define GLME_FIELD_STRUCT_PTR(stype, member, typeid, desc)              \
+  { offsetof(stype, member), sizeof(*((stype *)0)->member), 1, 0, 0,    \
+      GLME_K_STRUCT_PTR, typeid, desc, { 0 } }
+
+#define GLME_FIELD_ARRAY(stype, member, lenmember, typeid, desc)        \
+  { offsetof(stype, member), __GLME_ESIZE(stype, member), 0,            \
+      offsetof(stype, lenmember), __GLME_FSIZE(stype, lenmember),       \
+      GLME_K_ARRAY, typeid, desc, { 0 } }
+
+#define GLME_FIELD_VECTOR_OF(stype, member, typeid)                     \
+  { offsetof(stype, member), __GLME_ESIZE(stype, member),               \
+      __GLME_FSIZE(stype, member)/__GLME_ESIZE(stype, member), 0, 0,    \
+      GLME_K_VECTOR, typeid, (const glme_desc_t *)0, { 0 } }
+
+#define GLME_FIELD_INT_ARRAY(stype, member, lenmember)                  \
+  GLME_FIELD_ARRAY(stype, member, lenmember, GLME_INT, (const glme_desc_t *)0)
+#define GLME_FIELD_UINT_ARRAY(stype, member, lenmember)                 \
+  GLME_FIELD_ARRAY(stype, member, lenmember, GLME_UINT, (const glme_desc_t *)0)
+#define GLME_FIELD_FLOAT_ARRAY(stype, member, lenmember)                \
+  GLME_FIELD_ARRAY(stype, member, lenmember, GLME_FLOAT, (const glme_desc_t *)0)
+#define GLME_FIELD_STRUCT_ARRAY(stype, member, lenmember, typeid, desc) \
+  GLME_FIELD_ARRAY(stype, member, lenmember, typeid, desc)
+
+#define GLME_FIELD_INT_VECTOR(stype, member)    \
+  GLME_FIELD_VECTOR_OF(stype, member, GLME_INT)
+#define GLME_FIELD_UINT_VECTOR(stype, member)   \
+  GLME_FIELD_VECTOR_OF(stype, member, GLME_UINT)
+#define GLME_FIELD_FLOAT_VECTOR(stype, member)  \
+  GLME_FIELD_VECTOR_OF(stype, member, GLME_FLOAT)
 
 /**
- * Encode signed integer
- *
- * @param enc    Encode buffer
- * @param elem   Signed integer element
- * @param defval Default value, field omitted if it's value is equal to defval
+ * Initializer for structure descriptor.
  */
-#define GLME_ENCODE_FLD_INT(enc, elem, defval)                        \
-  do {                                                                \
-    int64_t __i64 = (int64_t)(elem);                                  \
-    __ne = (elem) != defval;                                          \
-    __e = glme_encode_field(enc, &__delta, GLME_INT, 0, &__i64, 0,    \
-                            __ne, (glme_encoder_f)glme_encode_int64); \
-    if (__e < 0) return __e;                                          \
-  } while (0)
+#define GLME_DESC(typeid, stype, fields)                                \
+  { typeid, sizeof(stype), sizeof(fields)/sizeof((fields)[0]), fields,  \
+      (struct glme_fieldop_s *)0 }
 
 /**
- * Encode unsigned integer
+ * Check and compile field descriptors of the structure descriptor. Nested
+ * descriptors not yet compiled are compiled too.
  *
- * @param enc    Encode buffer
- * @param elem   Unsigned integer element
- * @param defval Default value, field omitted if it's value is equal to defval
+ * @return
+ *   Zero or negative error code. On error fields are not usable.
  */
-#define GLME_ENCODE_FLD_UINT(enc, elem, defval)                     \
-  do {                                                              \
-    uint64_t __u64 = (uint64_t)(elem);                              \
-    __ne = (elem) != defval;                                        \
-    __e = glme_encode_field(enc, &__delta, GLME_UINT, 0, &__u64, 0, \
-                            __ne, (glme_encoder_f)glme_encode_uint64);     \
-    if (__e < 0) return __e;                                        \
-  } while (0)
+extern int glme_desc_init(glme_desc_t *desc);
 
 /**
- * Encode floating point number
- *
- * @param enc    Encode buffer
- * @param fno    Field number (for error codes)
- * @param elem   Floating point element
- * @param defval Default value, field omitted if it's value is equal to defval
+ * Release compiled field operations.
  */
-#define GLME_ENCODE_FLD_DOUBLE(enc, elem, defval)                    \
-  do {                                                               \
-    double __f64 = (double)(elem);                                   \
-    __ne = (elem) != defval;                                         \
-    __e = glme_encode_field(enc, &__delta, GLME_FLOAT, 0, &__f64, 0, \
-                            __ne, (glme_encoder_f)glme_encode_double);      \
-    if (__e < 0) return __e;                                         \
-  } while (0)
+extern void glme_desc_release(glme_desc_t *desc);
 
+/**
+ * Initialize type specification with field descriptor table. Typeid and size
+ * are taken from the descriptor.
+ */
+__GLME_INLINE__
+glme_spec_t *glme_spec_init_desc(glme_spec_t *spec, const glme_desc_t *desc)
+{
+  *spec = (glme_spec_t){desc->typeid, desc->size, (glme_encoder_f)0, (glme_decoder_f)0, desc};
+  return spec;
+}
 
 /**
- * Encode null terminated string.
+ * Encode structure value with field descriptor table. Scalar fields equal to
+ * their default values, null pointers, empty strings and zero length arrays are
+ * omitted.
  *
- * @param enc   Encode buffer
- * @param elem  Pointer to string element
+ * @param enc   Encoder
+ * @param desc  Compiled structure descriptor
+ * @param ptr   Structure
+ *
+ * @return
+ *   Number of bytes written or negative error code.
  */
-#define GLME_ENCODE_FLD_STRING(enc, elem)                  \
-  do {                                                     \
-    __e = glme_encode_field(enc, &__delta, GLME_STRING, 0, \
-                            (elem), 0, 1, (glme_encoder_f)0);     \
-    if (__e < 0) return __e;                               \
-  } while (0)
+extern int glme_encode_desc(glme_buf_t *enc, const glme_desc_t *desc, const void *ptr);
 
 /**
- * Encode byte vector of specified length.
+ * Decode structure value with field descriptor table. Fields beyond the
+ * descriptor, written by a newer encoder, are skipped.
  *
- * @param enc   Encode buffer
- * @param elem  Vector or pointer to vector
- * @param len   Number of bytes in vector
+ * @param dec   Decoder
+ * @param desc  Compiled structure descriptor
+ * @param ptr   Structure
+ *
+ * @return
+ *   Number of bytes consumed or negative error code.
  */
-#define GLME_ENCODE_FLD_VECTOR(enc, elem, len)                \
-  do {                                                        \
-    __ne = (len) > 0 ? 1 : 0;                                 \
-    __e = glme_encode_field(enc, &__delta, GLME_VECTOR, 0,    \
-                            (elem), (len), __ne, (glme_encoder_f)0); \
-    if (__e < 0) return __e;                                  \
-  } while (0)
+extern int glme_decode_desc(glme_buf_t *dec, const glme_desc_t *desc, void *ptr);
 
 /**
- * Encode structure that element points to.
- *
- * @param enc    Encode buffer
- * @param typeid Structure type id
- * @param elem   Structure pointer
- * @param func   Encoding function for structure
+ * Native code compiled from structure descriptor.
  */
-#define GLME_ENCODE_FLD_STRUCT(enc, typeid, elem, func)           \
-  do {                                                            \
-    __e = glme_encode_field(enc, &__delta, typeid, 0, (elem),     \
-                            0, sizeof((elem)[0]), func);          \
-    if (__e < 0) return __e;                                      \
-  } while (0)
+typedef struct glme_jit_s
+{
+  void *code;                   ///< Executable pages, null if interpreter is used
+  size_t size;                  ///< Size of executable pages
+} glme_jit_t;
 
+enum glme_jit_flags {
+  GLME_JIT_PERFMAP = 0x1,       ///< Write symbols to /tmp/perf-<pid>.map for perf
+  GLME_JIT_INTERP  = 0x2        ///< Do not compile, use the interpreter
+};
 
-#if 0
 /**
- * Encode embedded structure.
+ * Compile structure descriptor to native encoder and decoder functions and
+ * initialize type specification with them. Encoded bytes and decoded values
+ * are same as with glme_encode_desc and glme_decode_desc.
  *
- * @param enc   Encode buffer
- * @param fno   Field number (for error codes)
- * @param elem  Embedded structure element
- * @param func  Encoding function for structure
+ * Native code is generated on x86-64 Linux. Elsewhere, or if executable pages
+ * are not available, the spec is initialized with the descriptor only and
+ * the interpreter is used. Nested structures are encoded and decoded as
+ * with the interpreter.
+ *
+ * Compiled code refers to the descriptor and its fields; they must not be
+ * released or modified before glme_jit_release.
+ *
+ * @param jit    Compiled code
+ * @param spec   Type specification to initialize
+ * @param desc   Structure descriptor, compiled with glme_desc_init if not yet done
+ * @param flags  GLME_JIT_* flags
+ *
+ * @return
+ *   One if native code was generated, zero if interpreter is used or negative
+ *   error code.
  */
-#define GLME_ENCODE_FLD_STRUCT(enc, fno, elem, func)	 \
-  do {							 \
-    if (glme_encode_value_uint64(enc, &__delta) < 0)	 \
-      return -(10+fno);					 \
-    if ((*func)(enc, &(elem)) < 0)			 \
-      return -(10+fno);					 \
-    __delta = 1;					 \
-  } while (0)
-#endif
+extern int glme_jit_compile(glme_jit_t *jit, glme_spec_t *spec, glme_desc_t *desc, int flags);
 
 /**
- * Encode array of signed integers.
- *
- * @param enc    Encode buffer
- * @param fno    Field number
- * @param elem   Source array
- * @param len    Number of element in source
+ * Release compiled code. Specs initialized with it are no longer usable.
  */
-#define GLME_ENCODE_FLD_INT_ARRAY(enc, elem, len, vfunc)        \
-  do {								\
-      __e = glme_encode_field(enc, &__delta,                    \
-                              GLME_INT, GLME_F_ARRAY,           \
-                              (elem), (len), sizeof((elem)[0]), \
-                              (glme_encoder_f)vfunc);                  \
-      if (__e < 0) return __e;                                  \
-  } while (0)
+extern void glme_jit_release(glme_jit_t *jit);
 
-#define GLME_ENCODE_FLD_INT_VECTOR(enc, elem, vfunc)            \
-  do {								\
-    __nl = sizeof(elem)/sizeof((elem)[0]);                      \
-    __e = glme_encode_field(enc, &__delta,                      \
-                            GLME_INT, GLME_F_ARRAY,             \
-                            (elem), __nl, sizeof((elem)[0]),    \
-                            (glme_encoder_f)vfunc);                    \
-    if (__e < 0) return __e;                                    \
-  } while (0)
+// ----------------------------------------------------------------------------
+// Object identity
 
+/**
+ * Object identity table. While active, structures reached through structure
+ * fields are numbered and a structure reached again is encoded as a
+ * back-reference to its first occurrence. Shared structures are encoded once
+ * and cyclic structures are encoded in linear time. Decoded pointers refer to
+ * the same structure wherever the encoded ones did.
+ */
+typedef struct glme_refs_s
+{
+  glme_buf_t *gbuf;                     ///< Buffer the table is active for
+  struct glme_refs_s *outer;            ///< Other active tables of the thread
+  size_t count;                         ///< Number of structures seen
+  size_t size;                          ///< Allocated table entries
+  struct glme_ref_s *table;             ///< Identity table
+} glme_refs_t;
 
 /**
- * Encode array of unsigned integers.
+ * Start object identity mode for encoding or decoding with the buffer on the
+ * calling thread. Messages encoded until glme_refs_end share numbering and
+ * must be decoded in one identity mode session in the same order.
  *
- * @param enc    Encode buffer
- * @param elem   Source array
- * @param len    Number of element in source
+ * Back-reference decoded to an embedded structure field is an error; pointer
+ * fields only can share structures. Decoded shared structures are allocated
+ * once and must be released once.
+ *
+ * @param gbuf  Encode or decode buffer
+ * @param refs  Identity table, initialized here
+ *
+ * @return
+ *   Zero.
  */
-#define GLME_ENCODE_FLD_UINT_ARRAY(enc, elem, len, vfunc)	\
+extern int glme_refs_begin(glme_buf_t *gbuf, glme_refs_t *refs);
+
+/**
+ * End object identity mode and release table.
+ */
+extern void glme_refs_end(glme_buf_t *gbuf, glme_refs_t *refs);
+
+// ----------------------------------------------------------------------------
+// String dictionary
+
+/**
+ * String dictionary. While active, strings are numbered in order of first
+ * occurrence and a string encoded again is sent as a reference to its number.
+ * Decoded strings in the dictionary are shared copies owned by it.
+ */
+struct glme_dict_s
+{
+  glme_buf_t *gbuf;                     ///< Buffer the dictionary is active for
+  struct glme_dict_s *outer;            ///< Other active dictionaries of the thread
+  size_t maxcount;                      ///< Maximum number of strings, zero for none
+  size_t maxlen;                        ///< Longest string entered, zero for none
+  size_t count;                         ///< Number of strings entered
+  size_t size;                          ///< Allocated hash table entries
+  struct glme_dictent_s *table;         ///< Hash table by string content
+  char **strs;                          ///< Decoded strings by number
+};
+
+/**
+ * Start string dictionary for encoding or decoding with the buffer on the
+ * calling thread. Messages encoded until glme_dict_end or glme_dict_reset share
+ * the dictionary and must be decoded with a dictionary of the same limits, in
+ * the same order and resetting at the same points.
+ *
+ * Strings encoded with glme_encode_string, string field macros and descriptor
+ * tables are entered until the dictionary holds maxcount strings; strings
+ * longer than maxlen are always sent as is. A reference replaces the type id
+ * with -(number+1) like an object identity back-reference.
+ *
+ * Strings entered by glme_encode_string, glme_encode_struct or glme_encode_desc
+ * that fails are dropped again, so a failed message can be encoded again, e.g.
+ * to a larger buffer. Bytes of a failed encode must not be sent.
+ *
+ * Decoded strings in the dictionary are valid until the dictionary is reset
+ * or ended and must not be released; use glme_dict_free for decoded strings.
+ *
+ * @param gbuf     Encode or decode buffer
+ * @param dict     Dictionary, initialized here
+ * @param maxcount Maximum number of strings or zero
+ * @param maxlen   Length of longest string entered or zero
+ *
+ * @return
+ *   Zero.
+ */
+extern int glme_dict_begin(glme_buf_t *gbuf, glme_dict_t *dict,
+                           size_t maxcount, size_t maxlen);
+
+/**
+ * Release dictionary strings and start numbering again. Strings decoded
+ * before the reset are no longer valid.
+ */
+extern void glme_dict_reset(glme_buf_t *gbuf, glme_dict_t *dict);
+
+/**
+ * End string dictionary and release its strings.
+ */
+extern void glme_dict_end(glme_buf_t *gbuf, glme_dict_t *dict);
+
+/**
+ * Release string decoded with the buffer unless it is owned by the buffer's
+ * active dictionary.
+ */
+extern void glme_dict_free(glme_buf_t *gbuf, char *s);
+
+// ----------------------------------------------------------------------------
+// Decode limits
+
+/**
+ * Resource limits of decoding. While active, memory allocated with the
+ * buffer's allocator functions is charged against a budget and nesting of
+ * structures is bounded. Hostile input then fails with an error instead of
+ * exhausting memory or the stack.
+ */
+struct glme_limits_s
+{
+  glme_buf_t *gbuf;                     ///< Buffer the limits are active for
+  struct glme_limits_s *outer;          ///< Other active limits of the thread
+  size_t maxmem;                        ///< Memory budget in bytes, zero for none
+  size_t allocated;                     ///< Bytes charged so far
+  unsigned int maxdepth;                ///< Maximum nesting depth, zero for none
+  unsigned int depth;                   ///< Current nesting depth
+  int exceeded;                         ///< Nonzero after a limit was hit
+};
+
+/**
+ * Start decode limits for the buffer on the calling thread.
+ *
+ * Requested sizes of glme_malloc, glme_calloc and glme_realloc are charged;
+ * released memory is not credited back. An allocation over the budget fails
+ * and the decoder reports GLME_E_NOMEM. Structure nesting deeper than maxdepth
+ * fails with GLME_E_LIMIT. Both set the exceeded flag. Nesting is counted by
+ * decoders called through the library and by glme_skip; tail structure pointer
+ * fields do not nest in decoders.
+ *
+ * @param gbuf     Decode buffer
+ * @param limits   Limits, initialized here
+ * @param maxmem   Memory budget in bytes or zero
+ * @param maxdepth Maximum nesting depth or zero
+ *
+ * @return
+ *   Zero.
+ */
+extern int glme_limits_begin(glme_buf_t *gbuf, glme_limits_t *limits,
+                             size_t maxmem, unsigned int maxdepth);
+
+/**
+ * End decode limits. Counters are left for inspection.
+ */
+extern void glme_limits_end(glme_buf_t *gbuf, glme_limits_t *limits);
+
+// ----------------------------------------------------------------------------
+// Maps
+
+/**
+ * Map entry. Keys are GLME_INT, GLME_UINT or GLME_STRING values. Values of
+ * scalar types are decoded; strings and vectors are given as data and length;
+ * values of other types, arrays, maps and structures, as their encoded bytes
+ * without type id.
+ */
+typedef struct glme_mapent_s
+{
+  uint64_t hash;                        ///< Key hash in table; zero in empty slot
+  int type;                             ///< Value type id
+  union {
+    int64_t i;                          ///< GLME_INT key
+    uint64_t u;                         ///< GLME_UINT key
+    struct {
+      const char *ptr;                  ///< GLME_STRING key
+      size_t len;                       ///< Key length
+    } s;
+  } key;
+  union {
+    int64_t i;                          ///< GLME_INT value
+    uint64_t u;                         ///< GLME_UINT and GLME_BOOLEAN value
+    double f;                           ///< GLME_FLOAT and GLME_FLOAT32 value
+    double complex c;                   ///< GLME_COMPLEX value
+    struct {
+      const char *ptr;                  ///< Data or encoded value
+      size_t len;                       ///< Data length
+    } s;
+  } v;
+} glme_mapent_t;
+
+/**
+ * Open addressing hash table of map entries. Entries are the slots with
+ * nonzero hash.
+ */
+typedef struct glme_map_s
+{
+  int ktype;                            ///< Key type
+  int etype;                            ///< Value type or GLME_ANY
+  size_t count;                         ///< Number of entries
+  size_t size;                          ///< Number of slots, power of two
+  glme_mapent_t *slots;                 ///< Slots
+  struct glme_mapblk_s *blocks;         ///< Decoded strings and values
+} glme_map_t;
+
+/**
+ * Insert function of user map table. Called first with null entry, key and
+ * value type and entry count of the map for presizing, then for every entry.
+ * Strings and encoded values of the entry refer to the decode buffer.
+ *
+ * @return
+ *    Zero or negative error number to stop decoding.
+ */
+typedef int (*glme_map_insert_f)(void *table, int ktype, int etype, uint64_t count,
+                                 const glme_mapent_t *e);
+
+/**
+ * Initialize empty map. Nothing is allocated.
+ */
+__GLME_INLINE__
+void glme_map_init(glme_map_t *map, int ktype, int etype)
+{
+  *map = (glme_map_t){ktype, etype, 0, 0, (glme_mapent_t *)0, (struct glme_mapblk_s *)0};
+}
+
+/**
+ * Insert entry or replace value of existing key. Strings and encoded values
+ * are not copied.
+ *
+ * @return
+ *    Zero or negative error number.
+ */
+extern int glme_map_put(glme_buf_t *gb, glme_map_t *map, const glme_mapent_t *e);
+
+/**
+ * Find entry of GLME_INT or GLME_UINT key.
+ *
+ * @return
+ *    Entry or null if key is not in map.
+ */
+extern glme_mapent_t *glme_map_find(const glme_map_t *map, uint64_t key);
+
+/**
+ * Find entry of GLME_STRING key.
+ *
+ * @return
+ *    Entry or null if key is not in map.
+ */
+extern glme_mapent_t *glme_map_find_str(const glme_map_t *map, const char *key, size_t len);
+
+/**
+ * Release table and decoded data.
+ */
+extern void glme_map_release(glme_buf_t *gb, glme_map_t *map);
+
+/**
+ * Encode map with type id.
+ *
+ * @return
+ *    Number of bytes written or negative error number.
+ */
+extern int glme_encode_map(glme_buf_t *enc, const glme_map_t *map);
+
+/**
+ * Encode map type id and header for count entries that follow. Used to
+ * encode maps kept in other tables.
+ */
+extern int glme_encode_map_start(glme_buf_t *enc, int ktype, int etype, size_t count);
+
+/**
+ * Encode map entry key and value. Value type id is written if etype is
+ * GLME_ANY.
+ */
+extern int glme_encode_map_entry(glme_buf_t *enc, int ktype, int etype,
+                                 const glme_mapent_t *e);
+
+/**
+ * Decode map with type id to map table. Table is presized from the entry
+ * count; strings and values of other than scalar types are copied to one
+ * block owned by the map. Key and value types are set from the encoded map.
+ * Map with entries must have the same key type.
+ *
+ * @return
+ *    Number of bytes decoded or negative error number.
+ */
+extern int glme_decode_map(glme_buf_t *dec, glme_map_t *map);
+
+/**
+ * Decode map with type id to user table.
+ *
+ * @return
+ *    Number of bytes decoded or negative error number.
+ */
+extern int glme_decode_map_to(glme_buf_t *dec, glme_map_insert_f insert, void *table);
+
+// ----------------------------------------------------------------------------
+// Packed arrays
+
+/**
+ * Packed array element kind from element type, GLME_INT, GLME_UINT or
+ * GLME_FLOAT, and element size in bytes: 1, 2, 4 or 8 for integers, 4 or 8
+ * for floating point values.
+ */
+#define GLME_PACKED_KIND(type, size) (((type) << 4) | (int)(size))
+
+/**
+ * Packed array kind of booleans; elements are bits, eight per byte, first
+ * element in the lowest bit.
+ */
+#define GLME_PACKED_BITS GLME_PACKED_KIND(GLME_BOOLEAN, 0)
+
+/**
+ * Element type of packed array kind.
+ */
+#define GLME_PACKED_TYPE(kind) ((kind) >> 4)
+
+/**
+ * Element size of packed array kind; zero for bits.
+ */
+#define GLME_PACKED_SIZE(kind) ((kind) & 0xf)
+
+/**
+ * Encode packed array with type id. Elements are written as fixed width
+ * little-endian values; on little-endian hosts with a single copy. With
+ * GLME_F_ALIGN in flags padding is added so that elements are aligned to
+ * their size from start of buffer data.
+ *
+ * @param enc    Encode buffer
+ * @param kind   Element kind, see GLME_PACKED_KIND
+ * @param ptr    Elements
+ * @param count  Number of elements
+ * @param flags  GLME_F_ALIGN or zero
+ *
+ * @return
+ *    Number of bytes written or negative error number.
+ */
+extern int glme_encode_packed(glme_buf_t *enc, int kind, const void *ptr, size_t count, int flags);
+
+/**
+ * Decode packed array with type id without copying. Elements are left in the
+ * decode buffer as little-endian values and are valid as long as buffer data
+ * is. Element pointer is aligned to element size only if encoder aligned the
+ * array and decode buffer data is at the same alignment.
+ *
+ * @param dec    Decode buffer
+ * @param kind   Element kind
+ * @param ptr    Pointer to first element in decode buffer
+ * @param count  Number of elements
+ *
+ * @return
+ *    Number of bytes decoded or negative error number.
+ */
+extern int glme_decode_packed(glme_buf_t *dec, int *kind, const void **ptr, size_t *count);
+
+/**
+ * Decode packed array of kind with type id to allocated array.
+ *
+ * @return
+ *    Number of bytes decoded or negative error number; GLME_E_TYPE if array
+ *    elements are not of kind.
+ */
+extern int glme_decode_packed_copy(glme_buf_t *dec, int kind, void **ptr, size_t *count);
+
+/**
+ * Encode packed array structure field. Zero length array is omitted.
+ *
+ * @param   enc     Encode buffer
+ * @param   delta   Pointer to field counter delta
+ * @param   kind    Element kind
+ * @param   flags   GLME_F_ALIGN or zero
+ * @param   vptr    Elements
+ * @param   nlen    Number of elements
+ */
+extern int glme_encode_field_packed(glme_buf_t *enc, int *delta, int kind, int flags,
+                                    const void *vptr, size_t nlen);
+
+/**
+ * Decode packed array structure field. Elements are copied to allocated array
+ * unless GLME_F_VIEW is in flags; then pointer to elements in decode buffer is
+ * returned if they are native and aligned for the element type, otherwise
+ * decoding fails with GLME_E_INVAL.
+ *
+ * @param   dec     Decode buffer
+ * @param   delta   Pointer to field counter delta
+ * @param   kind    Element kind
+ * @param   flags   GLME_F_VIEW or zero
+ * @param   vptr    Pointer to element pointer
+ * @param   nlen    Number of elements decoded
+ */
+extern int glme_decode_field_packed(glme_buf_t *dec, unsigned int *delta, int kind, int flags,
+                                    void *vptr, size_t *nlen);
+
+/**
+ * Pack array of len booleans, bool or uint8_t, to bitmap of (len+7)/8 bytes.
+ * Nonzero elements are set bits; unused bits of the last byte are cleared.
+ */
+extern void glme_pack_bits(void *bits, const void *vptr, size_t len);
+
+/**
+ * Unpack bitmap to array of len booleans, bool or uint8_t, of value 0 or 1.
+ */
+extern void glme_unpack_bits(void *vptr, const void *bits, size_t len);
+
+/**
+ * Encode array of booleans, bool or uint8_t, as packed array of bits with
+ * type id. Encoded array is decoded as bitmap with glme_decode_packed.
+ *
+ * @param enc    Encode buffer
+ * @param vptr   Elements
+ * @param len    Number of elements
+ *
+ * @return
+ *    Number of bytes written or negative error number.
+ */
+extern int glme_encode_bits(glme_buf_t *enc, const void *vptr, size_t len);
+
+/**
+ * Decode packed array of bits or plain array of booleans with type id to
+ * array of booleans, bool or uint8_t.
+ *
+ * @param dec    Decode buffer
+ * @param dst    Target array; if null space is allocated
+ * @param len    Number of elements decoded; on entry target array length if
+ *               target array is given
+ *
+ * @return
+ *    Number of bytes decoded or negative error number; GLME_E_OFLOW if target
+ *    array is too short.
+ */
+extern int glme_decode_bits(glme_buf_t *dec, void **dst, size_t *len);
+
+/**
+ * Encode boolean array structure field as bits. Zero length array is omitted.
+ *
+ * @param   enc     Encode buffer
+ * @param   delta   Pointer to field counter delta
+ * @param   vptr    Elements
+ * @param   nlen    Number of elements
+ */
+extern int glme_encode_field_bits(glme_buf_t *enc, int *delta, const void *vptr, size_t nlen);
+
+/**
+ * Decode boolean array structure field. If nlen is non-zero on entry elements
+ * are decoded to the pointed array of that length, otherwise to allocated array.
+ *
+ * @param   dec     Decode buffer
+ * @param   delta   Pointer to field counter delta
+ * @param   vptr    Pointer to element pointer
+ * @param   nlen    Number of elements decoded
+ */
+extern int glme_decode_field_bits(glme_buf_t *dec, unsigned int *delta, void *vptr, size_t *nlen);
+
+// ----------------------------------------------------------------------------
+// Delta arrays
+
+/**
+ * Encode integer or floating point array with delta encoding. Integers are
+ * sent as zigzag encoded differences to the previous element (order 1) or as
+ * differences of differences (order 2); sorted and regularly spaced sequences
+ * take one or two bytes per element. Floating point values are sent as bit
+ * packed XOR with the previous value (order 1); slowly varying series take a
+ * few bits per element.
+ *
+ * @param enc    Encode buffer
+ * @param typeid Element type, GLME_INT, GLME_UINT or GLME_FLOAT
+ * @param vptr   Elements
+ * @param len    Number of elements
+ * @param esize  Element size, 1, 2, 4 or 8 bytes; 4 or 8 for GLME_FLOAT
+ * @param order  Delta order, 1 or 2; 1 for GLME_FLOAT
+ *
+ * @return
+ *    Number of bytes written or negative error number.
+ */
+extern int glme_encode_delta(glme_buf_t *enc, int typeid, const void *vptr, size_t len,
+                             size_t esize, int order);
+
+/**
+ * Decode delta encoded array with type id. Array and field decoders of
+ * integer and floating point arrays accept delta arrays as well.
+ *
+ * @param dec    Decode buffer
+ * @param typeid Element type; if non-zero on entry elements must be of this type
+ * @param dst    Target array; if null space is allocated
+ * @param len    Number of elements decoded; on entry target array length if non-zero
+ * @param esize  Element size, 1, 2, 4 or 8 bytes; 4 or 8 for GLME_FLOAT
+ *
+ * @return
+ *    Number of bytes decoded or negative error number.
+ */
+extern int glme_decode_delta(glme_buf_t *dec, int *typeid, void **dst, size_t *len, size_t esize);
+
+// ----------------------------------------------------------------------------
+// Columnar arrays
+
+/**
+ * Encode array of structures as columns with type id. Structure is described
+ * by a compiled descriptor of scalar fields only. Each field is sent as one
+ * array of its values in all rows; integer columns as packed, delta or plain
+ * array whichever is smallest, floating point columns as XOR delta array
+ * unless packed array is smaller. Columns of default values are omitted.
+ *
+ * @param enc    Encode buffer
+ * @param desc   Compiled structure descriptor
+ * @param vec    Array of structures
+ * @param len    Number of structures
+ *
+ * @return
+ *    Number of bytes written or negative error number; GLME_E_TYPE if
+ *    descriptor has other than scalar fields.
+ */
+extern int glme_encode_columns(glme_buf_t *enc, const glme_desc_t *desc, const void *vec, size_t len);
+
+/**
+ * Decode columnar array of structures with type id.
+ *
+ * @param dec    Decode buffer
+ * @param desc   Compiled structure descriptor
+ * @param vec    Target array; if null space is allocated
+ * @param len    Number of structures decoded; on entry target array length if
+ *               target array is given
+ *
+ * Without target array the row count may not exceed the remaining input, as
+ * omitted columns would let a short message claim any number of rows; a
+ * target array of enough length accepts any row count.
+ *
+ * @return
+ *    Number of bytes decoded or negative error number; GLME_E_OFLOW if target
+ *    array is too short, GLME_E_UFLOW if row count exceeds remaining input.
+ */
+extern int glme_decode_columns(glme_buf_t *dec, const glme_desc_t *desc, void **vec, size_t *len);
+
+/**
+ * Decode columnar array of structures with type id to column arrays, one
+ * per descriptor field. Elements of column k are of the size of field k.
+ * Columns with null array are skipped; columns not in input are filled with
+ * field default value.
+ *
+ * @param dec    Decode buffer
+ * @param desc   Compiled structure descriptor
+ * @param cols   Column arrays
+ * @param len    Number of rows decoded; on entry length of column arrays
+ *
+ * @return
+ *    Number of bytes decoded or negative error number; GLME_E_OFLOW if column
+ *    arrays are too short.
+ */
+extern int glme_decode_column_arrays(glme_buf_t *dec, const glme_desc_t *desc, void **cols, size_t *len);
+
+/**
+ * Encode columnar array structure field. Zero length array is omitted.
+ *
+ * @param   enc     Encode buffer
+ * @param   delta   Pointer to field counter delta
+ * @param   desc    Compiled structure descriptor
+ * @param   vptr    Array of structures
+ * @param   nlen    Number of structures
+ */
+extern int glme_encode_field_columns(glme_buf_t *enc, int *delta, const glme_desc_t *desc,
+                                     const void *vptr, size_t nlen);
+
+/**
+ * Decode columnar array structure field. Structures are decoded to allocated
+ * array unless pointed array is not null; then nlen is its length on entry.
+ *
+ * @param   dec     Decode buffer
+ * @param   delta   Pointer to field counter delta
+ * @param   desc    Compiled structure descriptor
+ * @param   vptr    Pointer to array pointer
+ * @param   nlen    Number of structures decoded
+ */
+extern int glme_decode_field_columns(glme_buf_t *dec, unsigned int *delta, const glme_desc_t *desc,
+                                     void *vptr, size_t *nlen);
+
+// ----------------------------------------------------------------------------
+// Field index
+
+/**
+ * Indexed field.
+ */
+typedef struct glme_index_entry_s
+{
+  unsigned int fno;                     ///< Field number, zero for first field
+  int typeid;                           ///< Field type id on the wire
+  size_t offset;                        ///< Buffer offset of field delta
+} glme_index_entry_t;
+
+/**
+ * Structure field index.
+ */
+typedef struct glme_index_s
+{
+  int typeid;                           ///< Structure type id
+  size_t start;                         ///< Buffer offset of structure
+  size_t end;                           ///< Buffer offset after structure
+  size_t count;                         ///< Number of fields present
+  size_t size;                          ///< Allocated entries
+  glme_index_entry_t *fields;           ///< Fields in ascending field number
+} glme_index_t;
+
+/**
+ * Initialize empty field index.
+ */
+__GLME_INLINE__
+void glme_index_init(glme_index_t *index)
+{
+  *index = (glme_index_t){0, 0, 0, 0, 0, (glme_index_entry_t *)0};
+}
+
+/**
+ * Index top level fields of the structure at read pointer. Type and buffer
+ * offset of every field present are recorded in one pass; field values are
+ * skipped, not decoded. Read pointer is moved past the structure. Index can
+ * be reused for next structure; entries are reallocated only when needed.
+ *
+ * Field number is position of the field in the encoder, i.e. the number of
+ * field macros or descriptor fields before it.
+ *
+ * @return
+ *    Number of bytes in structure or negative error number. On error read
+ *    pointer is not moved and index is empty.
+ */
+extern int glme_index_struct(glme_buf_t *dec, glme_index_t *index);
+
+/**
+ * Find field by field number.
+ *
+ * @return
+ *    Index entry or null if field is not present in structure.
+ */
+extern const glme_index_entry_t *glme_index_find(const glme_index_t *index, unsigned int fno);
+
+/**
+ * Decode field by field number directly from indexed position. Parameters
+ * are as for glme_decode_field. Read pointer is not moved; fields can be
+ * decoded in any order and more than once.
+ *
+ * @return
+ *    Number of bytes decoded, zero if field is not present (target is not
+ *    changed) or negative error number.
+ */
+extern int glme_decode_indexed(glme_buf_t *dec, const glme_index_t *index, unsigned int fno,
+                               int etype, int flags, void *vptr, size_t *nlen, size_t esize,
+                               glme_decoder_f dfunc);
+
+/**
+ * Release index entries.
+ */
+extern void glme_index_release(glme_buf_t *dec, glme_index_t *index);
+
+// ----------------------------------------------------------------------------
+// Pull parser
+
+/**
+ * Token kinds returned by reader.
+ */
+enum glme_token_e {
+  GLME_T_EOF = 0,               ///< End of input
+  GLME_T_SCALAR,                ///< Boolean, integer, float or complex value
+  GLME_T_BYTES,                 ///< String, byte vector, packed or XOR array; view to buffer
+  GLME_T_ARRAY,                 ///< Array start; element type and count
+  GLME_T_ARRAY_END,             ///< Array end
+  GLME_T_MAP,                   ///< Map start; key type, element type and count
+  GLME_T_MAP_END,               ///< Map end
+  GLME_T_STRUCT,                ///< Structure start; structure type id, rows of columnar array
+  GLME_T_FIELD,                 ///< Structure field; field delta and number
+  GLME_T_STRUCT_END,            ///< Structure end
+  GLME_T_REF                    ///< Back-reference to structure or dictionary string number
+};
+
+/**
+ * Reader token. Only members relevant to the token kind are set.
+ */
+typedef struct glme_token_s
+{
+  int kind;                     ///< Token kind
+  int typeid;                   ///< Value type, structure type id or element type
+  int ktype;                    ///< Map key type, packed array kind, XOR array type or GLME_COLUMNS
+  unsigned int fno;             ///< Field number, zero for first field
+  uint64_t delta;               ///< Field delta
+  uint64_t count;               ///< Array, packed array or map element count, columnar array rows
+  union {
+    int64_t i;                  ///< GLME_INT value
+    uint64_t u;                 ///< GLME_UINT and GLME_BOOLEAN value, structure number
+    double f;                   ///< GLME_FLOAT and GLME_FLOAT32 value
+    double complex c;           ///< GLME_COMPLEX value
+    struct {
+      const char *ptr;          ///< String or vector data, not zero terminated
+      size_t len;               ///< Data length
+    } s;
+  } v;
+} glme_token_t;
+
+#ifndef GLME_READER_DEPTH
+#define GLME_READER_DEPTH 64
+#endif
+
+/**
+ * Pull parser over decode buffer.
+ */
+typedef struct glme_reader_s
+{
+  glme_buf_t *dec;                      ///< Decode buffer
+  int depth;                            ///< Open structures, arrays and maps
+  struct glme_rframe_s {
+    int kind;                           ///< GLME_T_STRUCT, GLME_T_ARRAY or GLME_T_MAP
+    int typeid;                         ///< Structure type id or element type
+    int ktype;                          ///< Map key type
+    int value;                          ///< Field value or map element is next
+    unsigned int fno;                   ///< Field number of last field
+    uint64_t count;                     ///< Elements left
+    int order;                          ///< Delta array order, zero for other arrays
+    uint64_t last;                      ///< Delta array previous element
+    uint64_t step;                      ///< Delta array previous difference
+  } stack[GLME_READER_DEPTH];
+} glme_reader_t;
+
+/**
+ * Initialize reader at the read pointer of decode buffer.
+ */
+__GLME_INLINE__
+void glme_reader_init(glme_reader_t *rd, glme_buf_t *dec)
+{
+  rd->dec = dec;
+  rd->depth = 0;
+}
+
+/**
+ * Read next token. Elements of the stream are returned as tokens: scalars
+ * with their value, strings and vectors as views to buffer, start and end of
+ * arrays, maps and structures, and structure fields. Field token is followed
+ * by tokens of the field value. Array elements and map keys and elements
+ * follow array and map start tokens. Every value is decoded once and nothing
+ * is allocated.
+ *
+ * @return
+ *    Token kind, GLME_T_EOF at end of input at top level or negative error
+ *    number. On error read pointer is at start of the token and reader state
+ *    is not changed; GLME_E_UFLOW can be retried after more input is added.
+ *    GLME_E_OFLOW is returned if nesting is deeper than GLME_READER_DEPTH.
+ */
+extern int glme_reader_next(glme_reader_t *rd, glme_token_t *tok);
+
+/**
+ * Skip rest of the innermost open structure, array or map, including its
+ * end token.
+ *
+ * @return
+ *    Zero or negative error number.
+ */
+extern int glme_reader_skip(glme_reader_t *rd);
+
+// ----------------------------------------------------------------------------
+// Dynamic values
+
+/**
+ * Memory arena. Allocations are bump allocated from chunks and released all
+ * at once.
+ */
+typedef struct glme_arena_s
+{
+  struct glme_chunk_s *chunks;          ///< Allocated chunks, current first
+  char *ptr;                            ///< Next free byte in current chunk
+  char *end;                            ///< End of current chunk
+  size_t chunksize;                     ///< Size of next chunk
+} glme_arena_t;
+
+/**
+ * Initialize empty arena. Nothing is allocated until first allocation.
+ */
+extern void glme_arena_init(glme_arena_t *arena, size_t chunksize);
+
+/**
+ * Allocate nbytes from arena, aligned for any value.
+ *
+ * @return
+ *    Pointer to allocated space or null if out of memory.
+ */
+extern void *glme_arena_alloc(glme_arena_t *arena, size_t nbytes);
+
+/**
+ * Release all allocations. If more than one chunk was used the space is
+ * released and next chunk is made large enough for all of them; repeated
+ * use for similar messages settles to single chunk.
+ */
+extern void glme_arena_reset(glme_arena_t *arena);
+
+/**
+ * Release arena memory.
+ */
+extern void glme_arena_release(glme_arena_t *arena);
+
+/**
+ * Dynamic value tree node. Kind is one of the reader token kinds GLME_T_SCALAR,
+ * GLME_T_BYTES, GLME_T_ARRAY, GLME_T_MAP, GLME_T_STRUCT or GLME_T_REF.
+ *
+ * Children of arrays, maps and structures are in items list linked with
+ * next pointer. Array and map items are also contiguous and can be indexed;
+ * map items are keys and elements in turn. Structure fields are in ascending
+ * field number order. Columnar structure array is a structure node of column
+ * fields with GLME_COLUMNS key type and number of rows in count.
+ */
+typedef struct glme_node_s
+{
+  int kind;                     ///< Value kind
+  int typeid;                   ///< Value type, structure type id or element type
+  int ktype;                    ///< Map key type, packed array kind, XOR array type or GLME_COLUMNS
+  unsigned int fno;             ///< Field number if structure field
+  uint64_t count;               ///< Number of array elements, map entries or fields; columnar array rows
+  struct glme_node_s *next;    ///< Next item of containing value
+  union {
+    int64_t i;                  ///< GLME_INT value
+    uint64_t u;                 ///< GLME_UINT and GLME_BOOLEAN value, structure number
+    double f;                   ///< GLME_FLOAT and GLME_FLOAT32 value
+    double complex c;           ///< GLME_COMPLEX value
+    struct {
+      const char *ptr;          ///< String or vector data, not zero terminated
+      size_t len;               ///< Data length
+    } s;
+    struct glme_node_s *items; ///< First item of array, map or structure
+  } v;
+} glme_node_t;
+
+/**
+ * Decode element at read pointer to value tree. Tree nodes are allocated
+ * from arena; strings and vectors refer to decode buffer which must be kept
+ * as long as the tree is used. Nesting depth is limited to GLME_READER_DEPTH.
+ *
+ * @param dec    Decode buffer
+ * @param arena  Arena for tree nodes
+ * @param vp     Decoded tree root
+ *
+ * @return
+ *    Number of bytes decoded or negative error number. On error read pointer
+ *    is not moved; nodes allocated so far are released with the arena.
+ */
+extern int glme_node_decode(glme_buf_t *dec, glme_arena_t *arena, glme_node_t **vp);
+
+/**
+ * Encode value tree.
+ *
+ * @return
+ *    Number of bytes written or negative error number.
+ */
+extern int glme_node_encode(glme_buf_t *enc, const glme_node_t *v);
+
+/**
+ * Find structure field by field number.
+ *
+ * @return
+ *    Field value or null if field is not present.
+ */
+extern glme_node_t *glme_node_field(const glme_node_t *v, unsigned int fno);
+
+// ----------------------------------------------------------------------------
+// Segmented input
+
+/**
+ * Cursor over input in non-contiguous segments, e.g. a wrapped ring buffer or
+ * a chain of received chunks. Elements are handed out one at a time in a
+ * decode buffer. An element inside one segment is decoded in place; only an
+ * element straddling segment boundaries is copied to scratch space.
+ */
+typedef struct glme_segbuf_s
+{
+  const struct iovec *iov;              ///< Input segments
+  int iovcnt;                           ///< Number of segments
+  int seg;                              ///< Segment of read position
+  size_t off;                           ///< Offset of read position in segment
+  size_t offset;                        ///< Read position from start of input
+  size_t pending;                       ///< Length of element handed out last
+  int copied;                           ///< Last element was copied to scratch
+  char *scratch;                        ///< Space for straddling elements
+  size_t size;                          ///< Scratch size
+} glme_segbuf_t;
+
+/**
+ * Initialize cursor at start of segments. Nothing is allocated.
+ */
+__GLME_INLINE__
+void glme_segbuf_init(glme_segbuf_t *sb, const struct iovec *iov, int iovcnt)
+{
+  *sb = (glme_segbuf_t){iov, iovcnt, 0, 0, 0, 0, 0, (char *)0, 0};
+}
+
+/**
+ * Move past element handed out last and set decode buffer to the next one.
+ * Decode buffer refers to the element in its segment or in scratch space and
+ * holds the element only; its base, user context and error are kept and it
+ * must not own memory. Any decoder function or macro can then be used. Decode
+ * buffer is valid until next call.
+ *
+ * @param sb   Segment cursor
+ * @param dec  Decode buffer, data set here
+ *
+ * @return
+ *    Length of element, zero at end of input or negative error number.
+ *    GLME_E_UFLOW if input ends within an element; read position is left at
+ *    start of the incomplete element.
+ */
+extern int glme_segbuf_next(glme_segbuf_t *sb, glme_buf_t *dec);
+
+/**
+ * Release scratch space allocated with decode buffer's allocator.
+ */
+extern void glme_segbuf_release(glme_buf_t *dec, glme_segbuf_t *sb);
+
+// ----------------------------------------------------------------------------
+// Message dispatching
+
+typedef struct glme_dispatch_s glme_dispatch_t;
+
+/**
+ * Message handler. Called with decoded message. Negative return value stops
+ * the dispatch loop and is returned to the caller.
+ */
+typedef int (*glme_handler_f)(glme_dispatch_t *disp, int typeid, void *msg, void *user);
+
+/**
+ * Destination allocator for decoded message. If route has no allocator message
+ * is allocated with glme_malloc() and handler takes ownership of it.
+ */
+typedef void *(*glme_destalloc_f)(glme_dispatch_t *disp, int typeid, size_t size, void *user);
+
+/**
+ * Destination release. Called with message from route allocator when decoding
+ * into it fails; fields decoded before the failure may be set.
+ */
+typedef void (*glme_destfree_f)(glme_dispatch_t *disp, int typeid, void *msg, void *user);
+
+enum glme_dispatch_flags {
+  GLME_DISPATCH_NONE = 0x0,
+  GLME_DISPATCH_SKIP = 0x1      ///< Skip messages with no route instead of failing
+};
+
+/**
+ * Typeid route.
+ */
+typedef struct glme_route_s
+{
+  int typeid;                   ///< Message typeid, zero for empty slot
+  size_t size;                  ///< Message size, if zero looked up from handler base
+  glme_decoder_f decoder;       ///< Decoder, if null looked up from handler base
+  glme_handler_f handler;       ///< Message handler
+  glme_destalloc_f alloc;       ///< Optional destination allocator
+  void *user;                   ///< User context for handler and allocator
+  glme_destfree_f release;      ///< Optional release of destination on decode failure
+} glme_route_t;
+
+/**
+ * Typeid dispatcher. Routes are kept in open addressing hash table.
+ */
+struct glme_dispatch_s
+{
+  glme_route_t *routes;         ///< Route table
+  unsigned int nslots;          ///< Table size (power of two)
+  unsigned int nelem;           ///< Number of routes
+  int flags;                    ///< Dispatch flags
+  size_t ndispatched;           ///< Number of delivered messages
+  size_t nskipped;              ///< Number of skipped messages
+};
+
+/**
+ * Initialize dispatcher with space for nelem routes.
+ *
+ * @return
+ *   Zero or negative error code.
+ */
+extern int glme_dispatch_init(glme_dispatch_t *disp, unsigned int nelem, int flags);
+
+/**
+ * Release dispatcher route table.
+ */
+extern void glme_dispatch_release(glme_dispatch_t *disp);
+
+/**
+ * Add or replace route for typeid. Table grows as needed.
+ *
+ * @return
+ *   Zero or negative error code.
+ */
+extern int glme_dispatch_subscribe(glme_dispatch_t *disp, int typeid, size_t size,
+                                   glme_decoder_f decoder, glme_handler_f handler,
+                                   glme_destalloc_f alloc, void *user);
+
+/**
+ * Set release function for destinations of route allocator. Without it
+ * destination of failed decode is not returned to the allocator.
+ *
+ * @return
+ *   Zero or GLME_E_INVAL if typeid has no route.
+ */
+extern int glme_dispatch_set_release(glme_dispatch_t *disp, int typeid, glme_destfree_f release);
+
+/**
+ * Remove route for typeid.
+ */
+extern void glme_dispatch_unsubscribe(glme_dispatch_t *disp, int typeid);
+
+/**
+ * Find route for typeid.
+ */
+extern glme_route_t *glme_dispatch_find(glme_dispatch_t *disp, int typeid);
+
+/**
+ * Decode next message from the decoder and deliver it to its handler.
+ *
+ * @return
+ *   Number of bytes consumed or negative error code. Negative handler return
+ *   value is returned as is.
+ */
+extern int glme_dispatch_one(glme_dispatch_t *disp, glme_buf_t *dec);
+
+/**
+ * Decode and deliver all messages in the decoder.
+ *
+ * @return
+ *   Number of messages delivered or negative error code.
+ */
+extern int glme_dispatch_buf(glme_dispatch_t *disp, glme_buf_t *dec);
+
+/**
+ * Read length prefixed messages from the file descriptor into the decoder
+ * and deliver them until end of file.
+ *
+ * @see glme_dispatch_buf
+ */
+extern int glme_dispatch_fd(glme_dispatch_t *disp, glme_buf_t *dec, int fd, size_t maxlen);
+
+// ----------------------------------------------------------------------------
+// inline field primitives
+
+/**
+ * Make sure there is space for at least n more bytes in encoder.
+ *
+ * @return
+ *   Zero or GLME_E_NOMEM.
+ */
+__GLME_INLINE__
+int glme_buf_reserve(glme_buf_t *enc, size_t n)
+{
+  size_t avail = enc->buflen - enc->count;
+  if (avail >= n)
+    return 0;
+  n -= avail;
+  if (glme_buf_resize(enc, n < 1024 ? 1024 : n) == 0) {
+    enc->last_error = GLME_E_NOMEM;
+    return GLME_E_NOMEM;
+  }
+  return 0;
+}
+
+/**
+ * Write unsigned value to p without space checks.
+ *
+ * @return
+ *   Pointer to next free byte.
+ */
+__GLME_INLINE__
+char *glme_put_uint64(char *p, uint64_t u)
+{
+  int nb;
+  if (u < 128) {
+    *p++ = (char)u;
+    return p;
+  }
+#if defined(__GNUC__)
+  nb = (71 - __builtin_clzll(u)) >> 3;
+#else
+  for (nb = 1; nb < 8 && (u >> (nb << 3)) != 0; nb++);
+#endif
+  *p++ = (char)(-nb);
+  while (nb-- > 0)
+    *p++ = (char)(u >> (nb << 3));
+  return p;
+}
+
+/**
+ * Signed value as unsigned wire value.
+ */
+__GLME_INLINE__
+uint64_t glme_zigzag(int64_t v)
+{
+  return v < 0 ? ((uint64_t)~v << 1) | 1 : (uint64_t)v << 1;
+}
+
+/**
+ * Unsigned wire value as signed value.
+ */
+__GLME_INLINE__
+int64_t glme_unzigzag(uint64_t u)
+{
+  return u & 1 ? (int64_t)~(u >> 1) : (int64_t)(u >> 1);
+}
+
+/**
+ * Reverse byte order.
+ */
+__GLME_INLINE__
+uint64_t glme_bswap64(uint64_t u)
+{
+#if defined(__GNUC__)
+  return __builtin_bswap64(u);
+#else
+  u = ((u >> 8) & 0x00FF00FF00FF00FFull) | ((u & 0x00FF00FF00FF00FFull) << 8);
+  u = ((u >> 16) & 0x0000FFFF0000FFFFull) | ((u & 0x0000FFFF0000FFFFull) << 16);
+  return (u >> 32) | (u << 32);
+#endif
+}
+
+/**
+ * Floating point value as unsigned wire value.
+ */
+__GLME_INLINE__
+uint64_t glme_flip_double(double d)
+{
+  union { double d; uint64_t u; } v = { .d = d };
+  return glme_bswap64(v.u);
+}
+
+/**
+ * Unsigned wire value as floating point value.
+ */
+__GLME_INLINE__
+double glme_unflip_double(uint64_t u)
+{
+  union { double d; uint64_t u; } v = { .u = glme_bswap64(u) };
+  return v.d;
+}
+
+/**
+ * Single precision value as unsigned wire value.
+ */
+__GLME_INLINE__
+uint64_t glme_flip_float(float f)
+{
+  union { float f; uint32_t u; } v = { .f = f };
+  return glme_bswap64(v.u) >> 32;
+}
+
+/**
+ * Unsigned wire value as single precision value.
+ */
+__GLME_INLINE__
+float glme_unflip_float(uint64_t u)
+{
+  union { float f; uint32_t u; } v = { .u = (uint32_t)(glme_bswap64(u) >> 32) };
+  return v.f;
+}
+
+/**
+ * Encode scalar field header and value with single space check.
+ *
+ * @param enc    Encoder
+ * @param delta  Field delta; reset to one
+ * @param wtype  Wire type byte (base type << 1)
+ * @param u      Unsigned wire value
+ *
+ * @return
+ *   Number of bytes written or negative error code.
+ */
+__GLME_INLINE__
+int glme_encode_fld_uint64(glme_buf_t *enc, int *delta, int wtype, uint64_t u)
+{
+  char *p;
+  if (glme_buf_reserve(enc, 19) < 0)
+    return GLME_E_NOMEM;
+  p = glme_put_uint64(&enc->buf[enc->count], *delta);
+  *p++ = (char)wtype;
+  p = glme_put_uint64(p, u);
+  *delta = 1;
+  u = p - &enc->buf[enc->count];
+  enc->count += u;
+  return (int)u;
+}
+
+/**
+ * Encode string or byte vector field with single space check.
+ *
+ * @see glme_encode_fld_uint64
+ */
+__GLME_INLINE__
+int glme_encode_fld_bytes(glme_buf_t *enc, int *delta, int wtype, const void *s, size_t len)
+{
+  char *p;
+  size_t n;
+  if (glme_buf_reserve(enc, len + 19) < 0)
+    return GLME_E_NOMEM;
+  p = glme_put_uint64(&enc->buf[enc->count], *delta);
+  *p++ = (char)wtype;
+  p = glme_put_uint64(p, len);
+  memcpy(p, s, len);
+  *delta = 1;
+  n = p + len - &enc->buf[enc->count];
+  enc->count += n;
+  return (int)n;
+}
+
+/**
+ * Read unsigned value at read position.
+ *
+ * @return
+ *   Number of bytes read or GLME_E_UFLOW.
+ */
+__GLME_INLINE__
+int glme_get_uint64(glme_buf_t *dec, uint64_t *u)
+{
+  const unsigned char *b = (const unsigned char *)&dec->buf[dec->current];
+  size_t avail = dec->count - dec->current;
+  uint64_t v;
+  int k, nb;
+
+  if (avail > 0 && b[0] < 128) {
+    *u = b[0];
+    dec->current++;
+    return 1;
+  }
+  nb = avail > 0 ? 256 - b[0] : 0;
+  if (nb == 0 || (size_t)nb >= avail || nb > 8) {
+    dec->last_error = GLME_E_UFLOW;
+    return GLME_E_UFLOW;
+  }
+  for (v = 0, k = 1; k <= nb; k++)
+    v = (v << 8) | b[k];
+  *u = v;
+  dec->current += nb + 1;
+  return nb + 1;
+}
+
+/**
+ * Find field with wire type at read position. Field delta is handled as in
+ * glme_decode_field.
+ *
+ * @return
+ *   One if field present and read position at its value, zero if field
+ *   omitted or negative error code.
+ */
+__GLME_INLINE__
+int glme_decode_fld_header(glme_buf_t *dec, unsigned int *delta, int wtype)
+{
+  size_t at = dec->current;
+  uint64_t offset;
+  int n;
+
+  if ((n = glme_get_uint64(dec, &offset)) < 0)
+    return n;
+  if (offset == 0 || *delta == 0) {
+    // end of struct seen
+    dec->current = at;
+    *delta = 0;
+    return 0;
+  }
+  if (*delta < offset) {
+    dec->current = at;
+    *delta += 1;
+    return 0;
+  }
+  if (dec->current >= dec->count || dec->buf[dec->current] != (char)wtype) {
+    dec->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  dec->current++;
+  *delta = 1;
+  return 1;
+}
+
+/**
+ * Decode scalar field.
+ *
+ * @param dec    Decoder
+ * @param delta  Field delta
+ * @param wtype  Expected wire type byte
+ * @param u      Unsigned wire value, not changed if field omitted
+ *
+ * @return
+ *   One if field decoded, zero if omitted, negative error code on error.
+ */
+__GLME_INLINE__
+int glme_decode_fld_uint64(glme_buf_t *dec, unsigned int *delta, int wtype, uint64_t *u)
+{
+  int n;
+  if ((n = glme_decode_fld_header(dec, delta, wtype)) <= 0)
+    return n;
+  return (n = glme_get_uint64(dec, u)) < 0 ? n : 1;
+}
+
+/**
+ * Decode floating point field sent as GLME_FLOAT or GLME_FLOAT32.
+ *
+ * @see glme_decode_fld_uint64
+ */
+__GLME_INLINE__
+int glme_decode_fld_double(glme_buf_t *dec, unsigned int *delta, double *d)
+{
+  uint64_t u;
+  int n, err = dec->last_error;
+
+  if ((n = glme_decode_fld_header(dec, delta, GLME_FLOAT << 1)) > 0) {
+    if ((n = glme_get_uint64(dec, &u)) < 0)
+      return n;
+    *d = glme_unflip_double(u);
+    return 1;
+  }
+  // header consumed on type mismatch
+  if (n != GLME_E_TYPE || dec->current >= dec->count ||
+      dec->buf[dec->current] != (char)(GLME_FLOAT32 << 1))
+    return n;
+  dec->last_error = err;
+  dec->current++;
+  *delta = 1;
+  if ((n = glme_get_uint64(dec, &u)) < 0)
+    return n;
+  *d = glme_unflip_float(u);
+  return 1;
+}
+
+/**
+ * Decode string or byte vector field. Data points to bytes in decoder buffer.
+ *
+ * @see glme_decode_fld_uint64
+ */
+__GLME_INLINE__
+int glme_decode_fld_bytes(glme_buf_t *dec, unsigned int *delta, int wtype,
+                          const char **data, size_t *len)
+{
+  uint64_t u;
+  int n;
+  if ((n = glme_decode_fld_header(dec, delta, wtype)) <= 0)
+    return n;
+  if ((n = glme_get_uint64(dec, &u)) < 0)
+    return n;
+  if (u > dec->count - dec->current) {
+    dec->last_error = GLME_E_UFLOW;
+    return GLME_E_UFLOW;
+  }
+  *data = &dec->buf[dec->current];
+  *len = (size_t)u;
+  dec->current += u;
+  return 1;
+}
+
+// ----------------------------------------------------------------------------
+// encode helper macros
+
+/**
+ * Encoder standard definitions.
+ */
+#define GLME_ENCODE_STDDEF(enc)                 \
+  int __e, __ne, __delta;                       \
+  size_t __nl, __start_at = (enc)->count
+
+
+/**
+ * Encode structure header
+ *
+ * @param enc    Encode buffer
+ * @param typeid Type id for structure type.
+ */
+#define GLME_ENCODE_STRUCT_START(enc) \
+  do { \
+    if (glme_encode_start_struct(enc, &__delta) < 0)	\
+      return -1;					\
+  } while (0)
+
+/**
+ * Encode structure end marker. Make return with number of bytes encoded.
+ *
+ * @param enc    Encode buffer
+ */
+#define GLME_ENCODE_STRUCT_END(enc)              \
+  do {                                           \
+    if (glme_encode_end_struct(enc) < 0)         \
+      return -4;                                 \
+  } while (0)
+
+#define GLME_ENCODE_RETURN(enc) \
+  return (enc)->count - __start_at
+
+/**
+ * Encode signed integer
+ *
+ * @param enc    Encode buffer
+ * @param elem   Signed integer element
+ * @param defval Default value, field omitted if it's value is equal to defval
+ */
+#define GLME_ENCODE_FLD_INT(enc, elem, defval)                        \
+  do {                                                                \
+    int64_t __i64 = (int64_t)(elem);                                  \
+    __ne = (elem) != defval;                                          \
+    __e = glme_encode_field(enc, &__delta, GLME_INT, 0, &__i64, 0,    \
+                            __ne, (glme_encoder_f)glme_encode_int64); \
+    if (__e < 0) return __e;                                          \
+  } while (0)
+
+/**
+ * Encode unsigned integer
+ *
+ * @param enc    Encode buffer
+ * @param elem   Unsigned integer element
+ * @param defval Default value, field omitted if it's value is equal to defval
+ */
+#define GLME_ENCODE_FLD_UINT(enc, elem, defval)                     \
+  do {                                                              \
+    uint64_t __u64 = (uint64_t)(elem);                              \
+    __ne = (elem) != defval;                                        \
+    __e = glme_encode_field(enc, &__delta, GLME_UINT, 0, &__u64, 0, \
+                            __ne, (glme_encoder_f)glme_encode_uint64);     \
+    if (__e < 0) return __e;                                        \
+  } while (0)
+
+/**
+ * Encode floating point number
+ *
+ * @param enc    Encode buffer
+ * @param fno    Field number (for error codes)
+ * @param elem   Floating point element
+ * @param defval Default value, field omitted if it's value is equal to defval
+ */
+#define GLME_ENCODE_FLD_DOUBLE(enc, elem, defval)                    \
+  do {                                                               \
+    double __f64 = (double)(elem);                                   \
+    __ne = (elem) != defval;                                         \
+    __e = glme_encode_field(enc, &__delta, GLME_FLOAT, 0, &__f64, 0, \
+                            __ne, (glme_encoder_f)glme_encode_double);      \
+    if (__e < 0) return __e;                                         \
+  } while (0)
+
+
+/**
+ * Encode single precision floating point number as GLME_FLOAT32.
+ *
+ * @param enc    Encode buffer
+ * @param elem   Floating point element
+ * @param defval Default value, field omitted if it's value is equal to defval
+ */
+#define GLME_ENCODE_FLD_FLOAT32(enc, elem, defval)                      \
+  do {                                                                  \
+    float __f32 = (float)(elem);                                        \
+    __ne = (elem) != defval;                                            \
+    __e = glme_encode_field(enc, &__delta, GLME_FLOAT32, 0, &__f32, 0,  \
+                            __ne, (glme_encoder_f)glme_encode_float32); \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
+/**
+ * Encode null terminated string.
+ *
+ * @param enc   Encode buffer
+ * @param elem  Pointer to string element
+ */
+#define GLME_ENCODE_FLD_STRING(enc, elem)                  \
+  do {                                                     \
+    __e = glme_encode_field(enc, &__delta, GLME_STRING, 0, \
+                            (elem), 0, 1, (glme_encoder_f)0);     \
+    if (__e < 0) return __e;                               \
+  } while (0)
+
+/**
+ * Encode map table; empty map is omitted.
+ *
+ * @param enc   Encode buffer
+ * @param elem  Map table, glme_map_t
+ */
+#define GLME_ENCODE_FLD_MAP(enc, elem)                     \
+  do {                                                     \
+    __e = glme_encode_field(enc, &__delta, GLME_MAP, 0,    \
+                            &(elem), 0, 1, (glme_encoder_f)0);    \
+    if (__e < 0) return __e;                               \
+  } while (0)
+
+/**
+ * Encode packed array of fixed width elements; zero length array is omitted.
+ *
+ * @param enc   Encode buffer
+ * @param type  Element type, GLME_INT, GLME_UINT or GLME_FLOAT
+ * @param elem  Pointer to elements
+ * @param len   Number of elements
+ * @param flags GLME_F_ALIGN to align elements in buffer, or zero
+ */
+#define GLME_ENCODE_FLD_PACKED(enc, type, elem, len, flags)           \
+  do {                                                                \
+    __e = glme_encode_field_packed(enc, &__delta,                     \
+                                   GLME_PACKED_KIND(type, sizeof((elem)[0])), \
+                                   flags, (elem), (len));             \
+    if (__e < 0) return __e;                                          \
+  } while (0)
+
+/**
+ * Encode array of booleans as bits; zero length array is omitted.
+ *
+ * @param enc   Encode buffer
+ * @param elem  Pointer to elements, bool or uint8_t
+ * @param len   Number of elements
+ */
+#define GLME_ENCODE_FLD_BOOL_ARRAY(enc, elem, len)                    \
+  do {                                                                \
+    __e = glme_encode_field_bits(enc, &__delta, (elem), (len));       \
+    if (__e < 0) return __e;                                          \
+  } while (0)
+
+/**
+ * Encode fixed size array of booleans as bits.
+ *
+ * @param enc   Encode buffer
+ * @param elem  Fixed size array, bool or uint8_t
+ */
+#define GLME_ENCODE_FLD_BOOL_VECTOR(enc, elem)                        \
+  do {                                                                \
+    __e = glme_encode_field_bits(enc, &__delta, (elem),               \
+                                 sizeof(elem)/sizeof((elem)[0]));     \
+    if (__e < 0) return __e;                                          \
+  } while (0)
+
+/**
+ * Encode array of structures as columns; zero length array is omitted.
+ *
+ * @param enc   Encode buffer
+ * @param desc  Compiled structure descriptor, glme_desc_t pointer
+ * @param elem  Pointer to structures
+ * @param len   Number of structures
+ */
+#define GLME_ENCODE_FLD_COLUMNS(enc, desc, elem, len)                 \
+  do {                                                                \
+    __e = glme_encode_field_columns(enc, &__delta, desc, (elem), (len)); \
+    if (__e < 0) return __e;                                          \
+  } while (0)
+
+/**
+ * Encode byte vector of specified length.
+ *
+ * @param enc   Encode buffer
+ * @param elem  Vector or pointer to vector
+ * @param len   Number of bytes in vector
+ */
+#define GLME_ENCODE_FLD_VECTOR(enc, elem, len)                \
+  do {                                                        \
+    __ne = (len) > 0 ? 1 : 0;                                 \
+    __e = glme_encode_field(enc, &__delta, GLME_VECTOR, 0,    \
+                            (elem), (len), __ne, (glme_encoder_f)0); \
+    if (__e < 0) return __e;                                  \
+  } while (0)
+
+/**
+ * Encode structure that element points to.
+ *
+ * @param enc    Encode buffer
+ * @param typeid Structure type id
+ * @param elem   Structure pointer
+ * @param func   Encoding function for structure
+ */
+#define GLME_ENCODE_FLD_STRUCT(enc, typeid, elem, func)           \
+  do {                                                            \
+    __e = glme_encode_field(enc, &__delta, typeid, 0, (elem),     \
+                            0, sizeof((elem)[0]), func);          \
+    if (__e < 0) return __e;                                      \
+  } while (0)
+
+/**
+ * Encode embedded structure. Embedded structure is numbered in identity mode
+ * but never sent as back-reference, decoders can not point into it.
+ *
+ * @param enc    Encode buffer
+ * @param typeid Structure type id
+ * @param elem   Embedded structure element
+ * @param func   Encoding function for structure
+ */
+#define GLME_ENCODE_FLD_STRUCT_EMBED(enc, typeid, elem, func)             \
+  do {                                                                    \
+    __e = glme_encode_field(enc, &__delta, typeid, GLME_F_EMBED, &(elem), \
+                            0, sizeof(elem), func);                       \
+    if (__e < 0) return __e;                                              \
+  } while (0)
+
+/**
+ * Encode structure that element points to as the last field of the structure.
+ * Encoder function must not write anything after this but the end of structure.
+ * Linked structures are encoded iteratively without recursion.
+ *
+ * @param enc    Encode buffer
+ * @param typeid Structure type id
+ * @param elem   Structure pointer field
+ * @param func   Encoding function for structure
+ *
+ * @see glme_encode_field_tail
+ */
+#define GLME_ENCODE_FLD_STRUCT_TAIL(enc, typeid, elem, func)            \
+  do {                                                                  \
+    __e = glme_encode_field_tail(enc, &__delta, typeid, &(elem),        \
+                                 sizeof((elem)[0]), func);              \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
+
+#if 0
+/**
+ * Encode embedded structure.
+ *
+ * @param enc   Encode buffer
+ * @param fno   Field number (for error codes)
+ * @param elem  Embedded structure element
+ * @param func  Encoding function for structure
+ */
+#define GLME_ENCODE_FLD_STRUCT(enc, fno, elem, func)	 \
+  do {							 \
+    if (glme_encode_value_uint64(enc, &__delta) < 0)	 \
+      return -(10+fno);					 \
+    if ((*func)(enc, &(elem)) < 0)			 \
+      return -(10+fno);					 \
+    __delta = 1;					 \
+  } while (0)
+#endif
+
+/**
+ * Encode array of signed integers.
+ *
+ * @param enc    Encode buffer
+ * @param fno    Field number
+ * @param elem   Source array
+ * @param len    Number of element in source
+ */
+#define GLME_ENCODE_FLD_INT_ARRAY(enc, elem, len, vfunc)        \
+  do {								\
+      __e = glme_encode_field(enc, &__delta,                    \
+                              GLME_INT, GLME_F_ARRAY,           \
+                              (elem), (len), sizeof((elem)[0]), \
+                              (glme_encoder_f)vfunc);                  \
+      if (__e < 0) return __e;                                  \
+  } while (0)
+
+#define GLME_ENCODE_FLD_INT_VECTOR(enc, elem, vfunc)            \
+  do {								\
+    __nl = sizeof(elem)/sizeof((elem)[0]);                      \
+    __e = glme_encode_field(enc, &__delta,                      \
+                            GLME_INT, GLME_F_ARRAY,             \
+                            (elem), __nl, sizeof((elem)[0]),    \
+                            (glme_encoder_f)vfunc);                    \
+    if (__e < 0) return __e;                                    \
+  } while (0)
+
+
+/**
+ * Encode array of unsigned integers.
+ *
+ * @param enc    Encode buffer
+ * @param elem   Source array
+ * @param len    Number of element in source
+ */
+#define GLME_ENCODE_FLD_UINT_ARRAY(enc, elem, len, vfunc)	\
   do {								\
       __e = glme_encode_field(enc, &__delta,                    \
                               GLME_UINT, GLME_F_ARRAY,          \
@@ -1167,6 +3017,38 @@ extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
     if (__e < 0) return __e;                                    \
   } while (0)
 
+/**
+ * Encode array of signed integers with delta encoding. Decoded with the
+ * integer array macros.
+ *
+ * @param enc    Encode buffer
+ * @param elem   Source array
+ * @param len    Number of element in source
+ * @param order  Delta order, 1 for sorted, 2 for regularly spaced values
+ */
+#define GLME_ENCODE_FLD_INT_DELTA(enc, elem, len, order)                \
+  do {                                                                  \
+    __e = glme_encode_field(enc, &__delta, GLME_INT,                    \
+                            GLME_F_ARRAY|((order) == 2 ? GLME_F_DELTA2 : GLME_F_DELTA), \
+                            (elem), (len), sizeof((elem)[0]),           \
+                            (glme_encoder_f)0);                         \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
+/**
+ * Encode array of unsigned integers with delta encoding.
+ *
+ * @see GLME_ENCODE_FLD_INT_DELTA
+ */
+#define GLME_ENCODE_FLD_UINT_DELTA(enc, elem, len, order)               \
+  do {                                                                  \
+    __e = glme_encode_field(enc, &__delta, GLME_UINT,                   \
+                            GLME_F_ARRAY|((order) == 2 ? GLME_F_DELTA2 : GLME_F_DELTA), \
+                            (elem), (len), sizeof((elem)[0]),           \
+                            (glme_encoder_f)0);                         \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
 /**
  * Encode array of unsigned integers.
  *
@@ -1183,6 +3065,23 @@ extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
       if (__e < 0) return __e;                                  \
   } while (0)
 
+/**
+ * Encode array of floating point numbers as XOR with previous value. Decoded
+ * with the floating point array macros.
+ *
+ * @param enc    Encode buffer
+ * @param elem   Source array, double or float elements
+ * @param len    Number of element in source
+ */
+#define GLME_ENCODE_FLD_FLOAT_XOR(enc, elem, len)                       \
+  do {                                                                  \
+    __e = glme_encode_field(enc, &__delta, GLME_FLOAT,                  \
+                            GLME_F_ARRAY|GLME_F_DELTA,                  \
+                            (elem), (len), sizeof((elem)[0]),           \
+                            (glme_encoder_f)0);                         \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
 #define GLME_ENCODE_FLD_FLOAT_VECTOR(enc, elem, vfunc)          \
   do {								\
     __nl = sizeof(elem)/sizeof((elem)[0]);                      \
@@ -1193,6 +3092,37 @@ extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
     if (__e < 0) return __e;                                    \
   } while (0)
 
+/**
+ * Encode array of single precision floats as GLME_FLOAT32 elements. Decoded
+ * with the floating point array macros.
+ *
+ * @param enc    Encode buffer
+ * @param elem   Source array of float
+ * @param len    Number of element in source
+ */
+#define GLME_ENCODE_FLD_FLOAT32_ARRAY(enc, elem, len)                   \
+  do {                                                                  \
+    __e = glme_encode_field(enc, &__delta, GLME_FLOAT32, GLME_F_ARRAY,  \
+                            (elem), (len), sizeof(float),               \
+                            (glme_encoder_f)glme_encode_value_float32); \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
+/**
+ * Encode fixed size array of single precision floats as GLME_FLOAT32 elements.
+ *
+ * @param enc    Encode buffer
+ * @param elem   Fixed size source array of float
+ */
+#define GLME_ENCODE_FLD_FLOAT32_VECTOR(enc, elem)                       \
+  do {                                                                  \
+    __nl = sizeof(elem)/sizeof((elem)[0]);                              \
+    __e = glme_encode_field(enc, &__delta, GLME_FLOAT32, GLME_F_ARRAY,  \
+                            (elem), __nl, sizeof(float),                \
+                            (glme_encoder_f)glme_encode_value_float32); \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
 
 /**
  * Insert code for starting encoding header of an array field.
@@ -1251,6 +3181,26 @@ extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
       return -4;			  \
   } while (0)
 
+/**
+ * Skip field that is not needed. Projecting decoder skips unwanted fields
+ * by wire format only, without decoding them.
+ */
+#define GLME_DECODE_FLD_SKIP(dec)                                       \
+  do {                                                                  \
+    __e = glme_decode_field_skip(dec, (unsigned int *)&__delta);        \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
+/**
+ * Decode end of structure marker skipping any unknown trailing fields, e.g.
+ * fields added to the structure by a newer encoder.
+ */
+#define GLME_DECODE_STRUCT_END_SKIP(dec)       \
+  do {                                         \
+    if (glme_decode_end_struct_skip(dec) < 0)  \
+      return -4;                               \
+  } while (0)
+
 #define GLME_DECODE_RETURN(dec) \
     return (dec)->current - __at_start
 
@@ -1332,6 +3282,98 @@ extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
     if (__e < 0) return __e;                                        \
   } while(0)
 
+/**
+ * Decode map to map table. Table is initialized by caller and released with
+ * glme_map_release.
+ *
+ * @param dec     Decode buffer
+ * @param elem    Element, glme_map_t
+ */
+#define GLME_DECODE_FLD_MAP(dec, elem)                              \
+  do {                                                              \
+    __e = glme_decode_field(dec, &__delta, GLME_MAP, 0,             \
+                            &(elem), &__nl, 1, (glme_decoder_f)0);  \
+    if (__e < 0) return __e;                                        \
+  } while(0)
+
+/**
+ * Decode packed array to allocated array.
+ *
+ * @param dec     Decode buffer
+ * @param type    Element type, GLME_INT, GLME_UINT or GLME_FLOAT
+ * @param elem    Element, array pointer
+ * @param len     Number of elements decoded, size_t
+ */
+#define GLME_DECODE_FLD_PACKED(dec, type, elem, len)                    \
+  do {                                                                  \
+    (elem) = (void *)0; (len) = 0;                                      \
+    __e = glme_decode_field_packed(dec, &__delta,                       \
+                                   GLME_PACKED_KIND(type, sizeof((elem)[0])), \
+                                   0, &(elem), &(len));                 \
+    if (__e < 0) return __e;                                            \
+  } while(0)
+
+/**
+ * Decode packed array without copying; element pointer refers to decode
+ * buffer. Fails with GLME_E_INVAL if elements are not aligned in the buffer.
+ *
+ * @param dec     Decode buffer
+ * @param type    Element type, GLME_INT, GLME_UINT or GLME_FLOAT
+ * @param elem    Element, const array pointer
+ * @param len     Number of elements decoded, size_t
+ */
+#define GLME_DECODE_FLD_PACKED_VIEW(dec, type, elem, len)               \
+  do {                                                                  \
+    (elem) = (void *)0; (len) = 0;                                      \
+    __e = glme_decode_field_packed(dec, &__delta,                       \
+                                   GLME_PACKED_KIND(type, sizeof((elem)[0])), \
+                                   GLME_F_VIEW, (void *)&(elem), &(len)); \
+    if (__e < 0) return __e;                                            \
+  } while(0)
+
+/**
+ * Decode array of booleans to allocated array.
+ *
+ * @param dec     Decode buffer
+ * @param elem    Element, bool or uint8_t array pointer
+ * @param len     Number of elements decoded, size_t
+ */
+#define GLME_DECODE_FLD_BOOL_ARRAY(dec, elem, len)                      \
+  do {                                                                  \
+    (elem) = (void *)0; (len) = 0;                                      \
+    __e = glme_decode_field_bits(dec, &__delta, (void *)&(elem), &(len)); \
+    if (__e < 0) return __e;                                            \
+  } while(0)
+
+/**
+ * Decode fixed size array of booleans; elements not in input are cleared.
+ *
+ * @param dec     Decode buffer
+ * @param elem    Fixed size target array, bool or uint8_t
+ */
+#define GLME_DECODE_FLD_BOOL_VECTOR(dec, elem)                          \
+  do {                                                                  \
+    void *__ptr = &(elem)[0]; __nl = sizeof(elem)/sizeof((elem)[0]);    \
+    memset((elem), 0, sizeof(elem));                                    \
+    __e = glme_decode_field_bits(dec, &__delta, &__ptr, &__nl);         \
+    if (__e < 0) return __e;                                            \
+  } while(0)
+
+/**
+ * Decode columnar array of structures to allocated array.
+ *
+ * @param dec     Decode buffer
+ * @param desc    Compiled structure descriptor, glme_desc_t pointer
+ * @param elem    Element, array pointer
+ * @param len     Number of structures decoded, size_t
+ */
+#define GLME_DECODE_FLD_COLUMNS(dec, desc, elem, len)                   \
+  do {                                                                  \
+    (elem) = (void *)0; (len) = 0;                                      \
+    __e = glme_decode_field_columns(dec, &__delta, desc, (void *)&(elem), &(len)); \
+    if (__e < 0) return __e;                                            \
+  } while(0)
+
 
 /**
  * Decode structure to a pointer field.
@@ -1349,6 +3391,27 @@ extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
     if (__e < 0) return __e;                                            \
   } while (0)
 
+/**
+ * Decode structure to a pointer field that is the last field of the structure.
+ * Decoder function must not read anything after this but the end of structure.
+ * Linked structures are decoded iteratively without recursion.
+ *
+ * @param dec     Decode buffer
+ * @param typeid  Structure type id
+ * @param elem    Element, structure pointer
+ * @param func    Decode function
+ *
+ * @see glme_decode_field_tail
+ */
+#define GLME_DECODE_FLD_STRUCT_PTR_TAIL(dec, typeid, elem, func)        \
+  do {                                                                  \
+    (elem) = (void *)0;                                                 \
+    __e = glme_decode_field_tail(dec, (unsigned int *)&__delta, typeid, \
+                                 &(elem), sizeof((elem)[0]),            \
+                                 (glme_decoder_f)func);                 \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
 /**
  * Decode structure to an embedded structure field.
  *
@@ -1393,10 +3456,10 @@ extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
  */
 #define GLME_DECODE_FLD_INT_VECTOR(dec, elem, func)                 \
   do {                                                              \
-    void *__ptr = &(elem); __nl = sizeof(elem)/sizeof((elem)[0]);   \
+    void *__ptr = &(elem)[0]; __nl = sizeof(elem)/sizeof((elem)[0]); \
     memset((elem), 0, sizeof(elem));                                \
     __e = glme_decode_field(dec, &__delta, GLME_INT, GLME_F_ARRAY,  \
-                            &(elem), &__nl, sizeof((elem)[0]),      \
+                            &__ptr, &__nl, sizeof((elem)[0]),   \
                             (glme_decoder_f)func);                         \
     if (__e < 0) return __e;                                        \
   } while (0)
@@ -1428,10 +3491,10 @@ extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
  */
 #define GLME_DECODE_FLD_UINT_VECTOR(dec, elem, func)                \
   do {                                                              \
-    void *__ptr = &(elem); __nl = sizeof(elem)/sizeof((elem)[0]);   \
+    void *__ptr = &(elem)[0]; __nl = sizeof(elem)/sizeof((elem)[0]); \
     memset((elem), 0, sizeof(elem));                                \
     __e = glme_decode_field(dec, &__delta, GLME_UINT, GLME_F_ARRAY, \
-                            &(elem), &__nl, sizeof((elem)[0]),      \
+                            &__ptr, &__nl, sizeof((elem)[0]),   \
                             (glme_decoder_f)func);                         \
     if (__e < 0) return __e;                                        \
   } while (0)
@@ -1497,6 +3560,454 @@ extern int glme_decode_peek_type(glme_buf_t *dec, int *typeid);
 #define GLME_DECODE_FLD_END_ARRAY(dec, id)          \
     __skip_array_ ## fno:			     \
     do {} while (0)
+
+// ----------------------------------------------------------------------------
+// fast field macros
+
+/*
+ * Fast field macros are used like GLME_ENCODE_FLD_* and GLME_DECODE_FLD_*
+ * macros and can be mixed with them. Field delta, type and value are written
+ * and read inline with one buffer space check per field instead of calls
+ * through glme_encode_field and glme_decode_field.
+ */
+
+/**
+ * Encode signed integer
+ *
+ * @see GLME_ENCODE_FLD_INT
+ */
+#define GLME_FAST_ENCODE_FLD_INT(enc, elem, defval)                     \
+  do {                                                                  \
+    if ((elem) != defval) {                                             \
+      __e = glme_encode_fld_uint64(enc, &__delta, GLME_INT << 1,        \
+                                   glme_zigzag((int64_t)(elem)));       \
+      if (__e < 0) return __e;                                          \
+    } else {                                                            \
+      __delta++;                                                        \
+    }                                                                   \
+  } while (0)
+
+/**
+ * Encode unsigned integer
+ *
+ * @see GLME_ENCODE_FLD_UINT
+ */
+#define GLME_FAST_ENCODE_FLD_UINT(enc, elem, defval)                    \
+  do {                                                                  \
+    if ((elem) != defval) {                                             \
+      __e = glme_encode_fld_uint64(enc, &__delta, GLME_UINT << 1,       \
+                                   (uint64_t)(elem));                   \
+      if (__e < 0) return __e;                                          \
+    } else {                                                            \
+      __delta++;                                                        \
+    }                                                                   \
+  } while (0)
+
+/**
+ * Encode floating point number
+ *
+ * @see GLME_ENCODE_FLD_DOUBLE
+ */
+#define GLME_FAST_ENCODE_FLD_DOUBLE(enc, elem, defval)                  \
+  do {                                                                  \
+    if ((elem) != defval) {                                             \
+      __e = glme_encode_fld_uint64(enc, &__delta, GLME_FLOAT << 1,      \
+                                   glme_flip_double((double)(elem)));   \
+      if (__e < 0) return __e;                                          \
+    } else {                                                            \
+      __delta++;                                                        \
+    }                                                                   \
+  } while (0)
+
+/**
+ * Encode single precision floating point number as GLME_FLOAT32.
+ *
+ * @see GLME_ENCODE_FLD_FLOAT32
+ */
+#define GLME_FAST_ENCODE_FLD_FLOAT32(enc, elem, defval)                 \
+  do {                                                                  \
+    if ((elem) != defval) {                                             \
+      __e = glme_encode_fld_uint64(enc, &__delta, GLME_FLOAT32 << 1,    \
+                                   glme_flip_float((float)(elem)));     \
+      if (__e < 0) return __e;                                          \
+    } else {                                                            \
+      __delta++;                                                        \
+    }                                                                   \
+  } while (0)
+
+/**
+ * Encode null terminated string; null and empty strings are omitted. Active
+ * string dictionary is used through glme_encode_field.
+ *
+ * @see GLME_ENCODE_FLD_STRING
+ */
+#define GLME_FAST_ENCODE_FLD_STRING(enc, elem)                          \
+  do {                                                                  \
+    const char *__s = (elem);                                           \
+    if (__s && *__s) {                                                  \
+      if (__glme_dicts)                                                 \
+        __e = glme_encode_field(enc, &__delta, GLME_STRING, 0,          \
+                                __s, 0, 1, (glme_encoder_f)0);          \
+      else                                                              \
+        __e = glme_encode_fld_bytes(enc, &__delta, GLME_STRING << 1,    \
+                                    __s, strlen(__s));                  \
+      if (__e < 0) return __e;                                          \
+    } else {                                                            \
+      __delta++;                                                        \
+    }                                                                   \
+  } while (0)
+
+/**
+ * Encode byte vector of specified length.
+ *
+ * @see GLME_ENCODE_FLD_VECTOR
+ */
+#define GLME_FAST_ENCODE_FLD_VECTOR(enc, elem, len)                     \
+  do {                                                                  \
+    if ((len) > 0) {                                                    \
+      __e = glme_encode_fld_bytes(enc, &__delta, GLME_VECTOR << 1,      \
+                                  (elem), (len));                       \
+      if (__e < 0) return __e;                                          \
+    } else {                                                            \
+      __delta++;                                                        \
+    }                                                                   \
+  } while (0)
+
+/**
+ * Decode signed integer value.
+ *
+ * @see GLME_DECODE_FLD_INT
+ */
+#define GLME_FAST_DECODE_FLD_INT(dec, elem, defval)                     \
+  do {                                                                  \
+    uint64_t __u;                                                       \
+    __e = glme_decode_fld_uint64(dec, (unsigned int *)&__delta,         \
+                                 GLME_INT << 1, &__u);                  \
+    if (__e < 0) return __e;                                            \
+    (elem) = __e ? glme_unzigzag(__u) : (defval);                       \
+  } while (0)
+
+/**
+ * Decode unsigned integer value.
+ *
+ * @see GLME_DECODE_FLD_UINT
+ */
+#define GLME_FAST_DECODE_FLD_UINT(dec, elem, defval)                    \
+  do {                                                                  \
+    uint64_t __u;                                                       \
+    __e = glme_decode_fld_uint64(dec, (unsigned int *)&__delta,         \
+                                 GLME_UINT << 1, &__u);                 \
+    if (__e < 0) return __e;                                            \
+    (elem) = __e ? __u : (defval);                                      \
+  } while (0)
+
+/**
+ * Decode floating point number value.
+ *
+ * @see GLME_DECODE_FLD_DOUBLE
+ */
+#define GLME_FAST_DECODE_FLD_DOUBLE(dec, elem, defval)                  \
+  do {                                                                  \
+    double __d;                                                         \
+    __e = glme_decode_fld_double(dec, (unsigned int *)&__delta, &__d);  \
+    if (__e < 0) return __e;                                            \
+    (elem) = __e ? __d : (defval);                                      \
+  } while (0)
+
+/**
+ * Decode variable string; omitted string is null pointer. Active string
+ * dictionary is used through glme_decode_field.
+ *
+ * @see GLME_DECODE_FLD_STRING
+ */
+#define GLME_FAST_DECODE_FLD_STRING(dec, elem)                          \
+  do {                                                                  \
+    const char *__s;                                                    \
+    (elem) = (char *)0;                                                 \
+    if (__glme_dicts) {                                                 \
+      __nl = 0;                                                         \
+      __e = glme_decode_field(dec, (unsigned int *)&__delta,            \
+                              GLME_STRING, 0, &(elem), &__nl, 1,        \
+                              (glme_decoder_f)0);                       \
+      if (__e < 0) return __e;                                          \
+      break;                                                            \
+    }                                                                   \
+    __e = glme_decode_fld_bytes(dec, (unsigned int *)&__delta,          \
+                                GLME_STRING << 1, &__s, &__nl);         \
+    if (__e < 0) return __e;                                            \
+    if (__e > 0) {                                                      \
+      if (!((elem) = (char *)glme_malloc(dec, __nl + 1))) {             \
+        (dec)->last_error = GLME_E_NOMEM;                               \
+        return GLME_E_NOMEM;                                            \
+      }                                                                 \
+      memcpy((elem), __s, __nl);                                        \
+      (elem)[__nl] = '\0';                                              \
+    }                                                                   \
+  } while (0)
+
+/**
+ * Decode fixed size byte array; omitted and missing bytes are zeroed.
+ *
+ * @see GLME_DECODE_FLD_VECTOR
+ */
+#define GLME_FAST_DECODE_FLD_VECTOR(dec, elem)                          \
+  do {                                                                  \
+    const char *__s;                                                    \
+    memset((elem), 0, sizeof(elem));                                    \
+    __e = glme_decode_fld_bytes(dec, (unsigned int *)&__delta,          \
+                                GLME_VECTOR << 1, &__s, &__nl);         \
+    if (__e < 0) return __e;                                            \
+    if (__e > 0)                                                        \
+      memcpy((elem), __s, __nl < sizeof(elem) ? __nl : sizeof(elem));   \
+  } while (0)
+
+// ----------------------------------------------------------------------------
+// schema field lists
+
+/*
+ * Message is described once with a field list macro that takes a field
+ * macro F as argument and calls it for each field in encoding order:
+ *
+ *   #define POINT_FIELDS(F)          \
+ *     F(INT, int, x, 0)              \
+ *     F(INT, int, y, -1)
+ *
+ *   GLME_SCHEMA_DECLARE(point, 40, POINT_FIELDS);
+ *   GLME_SCHEMA_DEFINE(point, POINT_FIELDS)
+ *
+ * Field is F(kind, type, name, arg) where arg is default value for scalars,
+ * element count for vectors and 0 otherwise.
+ *
+ *   kind          type                member             arg
+ *   INT           int8 .. int64, int  type name;         default
+ *   UINT          uint8 .. ulong      type name;         default
+ *   DOUBLE        float, double       type name;         default
+ *   STRING        char                char *name;        0
+ *   VECTOR        char                char name[N];      N
+ *   INT_VECTOR    int64, int, long    type name[N];      N
+ *   UINT_VECTOR   uint64, uint, ulong type name[N];      N
+ *   FLOAT_VECTOR  float, double       type name[N];      N
+ *   INT_ARRAY     int64, int, long    size_t name_len; type *name;  0
+ *   UINT_ARRAY    uint64, uint, ulong size_t name_len; type *name;  0
+ *   FLOAT_ARRAY   float, double       size_t name_len; type *name;  0
+ *   STRUCT        message             struct type name;  0
+ *   STRUCT_PTR    message             struct type *name; 0
+ *   STRUCT_ARRAY  message             size_t name_len; struct type *name; 0
+ *
+ * Nested message types must be declared before use.
+ */
+
+// type names to C types
+#define __GLME_SX_CTYPE_int8    int8_t
+#define __GLME_SX_CTYPE_int16   int16_t
+#define __GLME_SX_CTYPE_int32   int32_t
+#define __GLME_SX_CTYPE_int64   int64_t
+#define __GLME_SX_CTYPE_int     int
+#define __GLME_SX_CTYPE_long    long
+#define __GLME_SX_CTYPE_uint8   uint8_t
+#define __GLME_SX_CTYPE_uint16  uint16_t
+#define __GLME_SX_CTYPE_uint32  uint32_t
+#define __GLME_SX_CTYPE_uint64  uint64_t
+#define __GLME_SX_CTYPE_uint    unsigned int
+#define __GLME_SX_CTYPE_ulong   unsigned long
+#define __GLME_SX_CTYPE_float   float
+#define __GLME_SX_CTYPE_double  double
+#define __GLME_SX_CTYPE_char    char
+
+#define __GLME_SX_CTYPE(type) __GLME_SX_CTYPE_ ## type
+
+// structure members
+#define __GLME_SX_MEMBER(kind, type, name, arg) __GLME_SX_MEMBER_ ## kind(type, name, arg)
+
+#define __GLME_SX_MEMBER_INT(type, name, arg)          __GLME_SX_CTYPE(type) name;
+#define __GLME_SX_MEMBER_UINT(type, name, arg)         __GLME_SX_CTYPE(type) name;
+#define __GLME_SX_MEMBER_DOUBLE(type, name, arg)       __GLME_SX_CTYPE(type) name;
+#define __GLME_SX_MEMBER_STRING(type, name, arg)       char *name;
+#define __GLME_SX_MEMBER_VECTOR(type, name, arg)       char name[arg];
+#define __GLME_SX_MEMBER_INT_VECTOR(type, name, arg)   __GLME_SX_CTYPE(type) name[arg];
+#define __GLME_SX_MEMBER_UINT_VECTOR(type, name, arg)  __GLME_SX_CTYPE(type) name[arg];
+#define __GLME_SX_MEMBER_FLOAT_VECTOR(type, name, arg) __GLME_SX_CTYPE(type) name[arg];
+#define __GLME_SX_MEMBER_INT_ARRAY(type, name, arg)    size_t name ## _len; __GLME_SX_CTYPE(type) *name;
+#define __GLME_SX_MEMBER_UINT_ARRAY(type, name, arg)   size_t name ## _len; __GLME_SX_CTYPE(type) *name;
+#define __GLME_SX_MEMBER_FLOAT_ARRAY(type, name, arg)  size_t name ## _len; __GLME_SX_CTYPE(type) *name;
+#define __GLME_SX_MEMBER_STRUCT(type, name, arg)       struct type name;
+#define __GLME_SX_MEMBER_STRUCT_PTR(type, name, arg)   struct type *name;
+#define __GLME_SX_MEMBER_STRUCT_ARRAY(type, name, arg) size_t name ## _len; struct type *name;
+
+// upper bound of fixed size part of encoded field; field delta and type
+// take one byte each in structures with less than 128 fields
+#define __GLME_SX_MAX(kind, type, name, arg) + __GLME_SX_MAX_ ## kind(type, arg)
+
+#define __GLME_SX_MAX_INT(type, arg)          (2 + 9)
+#define __GLME_SX_MAX_UINT(type, arg)         (2 + 9)
+#define __GLME_SX_MAX_DOUBLE(type, arg)       (2 + 9)
+#define __GLME_SX_MAX_STRING(type, arg)       (2 + 9)
+#define __GLME_SX_MAX_VECTOR(type, arg)       (2 + 9 + (arg))
+#define __GLME_SX_MAX_INT_VECTOR(type, arg)   (3 + 9 + 9*(arg))
+#define __GLME_SX_MAX_UINT_VECTOR(type, arg)  (3 + 9 + 9*(arg))
+#define __GLME_SX_MAX_FLOAT_VECTOR(type, arg) (3 + 9 + 9*(arg))
+#define __GLME_SX_MAX_INT_ARRAY(type, arg)    (3 + 9)
+#define __GLME_SX_MAX_UINT_ARRAY(type, arg)   (3 + 9)
+#define __GLME_SX_MAX_FLOAT_ARRAY(type, arg)  (3 + 9)
+#define __GLME_SX_MAX_STRUCT(type, arg)       (1 + 9 + type ## _MAXSIZE)
+#define __GLME_SX_MAX_STRUCT_PTR(type, arg)   (1 + 9)
+#define __GLME_SX_MAX_STRUCT_ARRAY(type, arg) (2 + 9 + 9)
+
+// variable size part of encoded field
+#define __GLME_SX_SIZE(kind, type, name, arg) __GLME_SX_SIZE_ ## kind(type, name)
+
+#define __GLME_SX_SIZE_INT(type, name)
+#define __GLME_SX_SIZE_UINT(type, name)
+#define __GLME_SX_SIZE_DOUBLE(type, name)
+#define __GLME_SX_SIZE_STRING(type, name)       if (p->name) __n += strlen(p->name);
+#define __GLME_SX_SIZE_VECTOR(type, name)
+#define __GLME_SX_SIZE_INT_VECTOR(type, name)
+#define __GLME_SX_SIZE_UINT_VECTOR(type, name)
+#define __GLME_SX_SIZE_FLOAT_VECTOR(type, name)
+#define __GLME_SX_SIZE_INT_ARRAY(type, name)    __n += 9*p->name ## _len;
+#define __GLME_SX_SIZE_UINT_ARRAY(type, name)   __n += 9*p->name ## _len;
+#define __GLME_SX_SIZE_FLOAT_ARRAY(type, name)  __n += 9*p->name ## _len;
+#define __GLME_SX_SIZE_STRUCT(type, name)       __n += type ## _size(&p->name) - type ## _MAXSIZE;
+#define __GLME_SX_SIZE_STRUCT_PTR(type, name)   if (p->name) __n += type ## _size(p->name);
+#define __GLME_SX_SIZE_STRUCT_ARRAY(type, name)                         \
+  if (p->name) {                                                        \
+    size_t __k;                                                         \
+    for (__k = 0; __k < p->name ## _len; __k++)                         \
+      __n += type ## _size(&p->name[__k]);                              \
+  }
+
+// field encoders
+#define __GLME_SX_ENC(kind, type, name, arg) __GLME_SX_ENC_ ## kind(type, name, arg);
+
+#define __GLME_SX_ENC_INT(type, name, arg)    GLME_FAST_ENCODE_FLD_INT(enc, p->name, arg)
+#define __GLME_SX_ENC_UINT(type, name, arg)   GLME_FAST_ENCODE_FLD_UINT(enc, p->name, arg)
+#define __GLME_SX_ENC_DOUBLE(type, name, arg) GLME_FAST_ENCODE_FLD_DOUBLE(enc, p->name, arg)
+#define __GLME_SX_ENC_STRING(type, name, arg) GLME_FAST_ENCODE_FLD_STRING(enc, p->name)
+#define __GLME_SX_ENC_VECTOR(type, name, arg) GLME_FAST_ENCODE_FLD_VECTOR(enc, p->name, arg)
+#define __GLME_SX_ENC_INT_VECTOR(type, name, arg)                       \
+  GLME_ENCODE_FLD_INT_VECTOR(enc, p->name, glme_encode_value_ ## type)
+#define __GLME_SX_ENC_UINT_VECTOR(type, name, arg)                      \
+  GLME_ENCODE_FLD_UINT_VECTOR(enc, p->name, glme_encode_value_ ## type)
+#define __GLME_SX_ENC_FLOAT_VECTOR(type, name, arg)                     \
+  GLME_ENCODE_FLD_FLOAT_VECTOR(enc, p->name, glme_encode_value_ ## type)
+#define __GLME_SX_ENC_INT_ARRAY(type, name, arg)                        \
+  GLME_ENCODE_FLD_INT_ARRAY(enc, p->name, p->name ## _len, glme_encode_value_ ## type)
+#define __GLME_SX_ENC_UINT_ARRAY(type, name, arg)                       \
+  GLME_ENCODE_FLD_UINT_ARRAY(enc, p->name, p->name ## _len, glme_encode_value_ ## type)
+#define __GLME_SX_ENC_FLOAT_ARRAY(type, name, arg)                      \
+  GLME_ENCODE_FLD_FLOAT_ARRAY(enc, p->name, p->name ## _len, glme_encode_value_ ## type)
+#define __GLME_SX_ENC_STRUCT(type, name, arg)                           \
+  GLME_ENCODE_FLD_STRUCT_EMBED(enc, type ## _TYPEID, p->name, type ## _encode)
+#define __GLME_SX_ENC_STRUCT_PTR(type, name, arg)                       \
+  GLME_ENCODE_FLD_STRUCT(enc, type ## _TYPEID, p->name, type ## _encode)
+#define __GLME_SX_ENC_STRUCT_ARRAY(type, name, arg)                     \
+  do {                                                                  \
+    __e = glme_encode_field(enc, &__delta, type ## _TYPEID, GLME_F_ARRAY, \
+                            p->name, p->name ## _len, sizeof(struct type), \
+                            type ## _encode);                           \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
+// field decoders
+#define __GLME_SX_DEC(kind, type, name, arg) __GLME_SX_DEC_ ## kind(type, name, arg);
+
+#define __GLME_SX_DEC_INT(type, name, arg)    GLME_FAST_DECODE_FLD_INT(dec, p->name, arg)
+#define __GLME_SX_DEC_UINT(type, name, arg)   GLME_FAST_DECODE_FLD_UINT(dec, p->name, arg)
+#define __GLME_SX_DEC_DOUBLE(type, name, arg) GLME_FAST_DECODE_FLD_DOUBLE(dec, p->name, arg)
+#define __GLME_SX_DEC_STRING(type, name, arg) GLME_FAST_DECODE_FLD_STRING(dec, p->name)
+#define __GLME_SX_DEC_VECTOR(type, name, arg) GLME_FAST_DECODE_FLD_VECTOR(dec, p->name)
+#define __GLME_SX_DEC_INT_VECTOR(type, name, arg)                       \
+  GLME_DECODE_FLD_INT_VECTOR(dec, p->name, glme_decode_value_ ## type)
+#define __GLME_SX_DEC_UINT_VECTOR(type, name, arg)                      \
+  GLME_DECODE_FLD_UINT_VECTOR(dec, p->name, glme_decode_value_ ## type)
+#define __GLME_SX_DEC_FLOAT_VECTOR(type, name, arg)                     \
+  GLME_DECODE_FLD_FLOAT_VECTOR(dec, p->name, glme_decode_value_ ## type)
+#define __GLME_SX_DEC_INT_ARRAY(type, name, arg)                        \
+  p->name = 0;                                                          \
+  GLME_DECODE_FLD_INT_ARRAY(dec, p->name, p->name ## _len, glme_decode_value_ ## type)
+#define __GLME_SX_DEC_UINT_ARRAY(type, name, arg)                       \
+  p->name = 0;                                                          \
+  GLME_DECODE_FLD_UINT_ARRAY(dec, p->name, p->name ## _len, glme_decode_value_ ## type)
+#define __GLME_SX_DEC_FLOAT_ARRAY(type, name, arg)                      \
+  p->name = 0;                                                          \
+  GLME_DECODE_FLD_FLOAT_ARRAY(dec, p->name, p->name ## _len, glme_decode_value_ ## type)
+#define __GLME_SX_DEC_STRUCT(type, name, arg)                           \
+  GLME_DECODE_FLD_STRUCT(dec, type ## _TYPEID, p->name, type ## _decode)
+#define __GLME_SX_DEC_STRUCT_PTR(type, name, arg)                       \
+  GLME_DECODE_FLD_STRUCT_PTR(dec, type ## _TYPEID, p->name, type ## _decode)
+#define __GLME_SX_DEC_STRUCT_ARRAY(type, name, arg)                     \
+  do {                                                                  \
+    p->name = 0; p->name ## _len = 0;                                   \
+    __e = glme_decode_field(dec, &__delta, type ## _TYPEID,             \
+                            GLME_F_ARRAY|GLME_F_PTR, &p->name,          \
+                            &p->name ## _len, sizeof(struct type),      \
+                            type ## _decode);                           \
+    if (__e < 0) return __e;                                            \
+  } while (0)
+
+/**
+ * Declare message structure, its typeid and maximum size constants and
+ * encoder, decoder and size functions. Constant NAME_TYPEID is the typeid and
+ * NAME_MAXSIZE upper bound of encoded structure value without strings,
+ * dynamic arrays and structure pointers.
+ *
+ * @param name    Structure name
+ * @param typeid  Structure typeid
+ * @param fields  Field list macro
+ */
+#define GLME_SCHEMA_DECLARE(name, typeid, fields)                       \
+  struct name {                                                         \
+    fields(__GLME_SX_MEMBER)                                            \
+  };                                                                    \
+  enum {                                                                \
+    name ## _TYPEID = (typeid),                                         \
+    name ## _MAXSIZE = 1 fields(__GLME_SX_MAX)                          \
+  };                                                                    \
+  extern int name ## _encode(glme_buf_t *enc, const void *ptr);         \
+  extern int name ## _decode(glme_buf_t *dec, void *ptr);               \
+  extern size_t name ## _size(const struct name *p)
+
+/**
+ * Define encoder, decoder and size functions for structure declared with
+ * GLME_SCHEMA_DECLARE. Scalar, string and byte vector fields are expanded
+ * with fast field macros and constant default values.
+ *
+ * @param name    Structure name
+ * @param fields  Field list macro
+ */
+#define GLME_SCHEMA_DEFINE(name, fields)                                \
+  int name ## _encode(glme_buf_t *enc, const void *ptr)                 \
+  {                                                                     \
+    const struct name *p = (const struct name *)ptr;                    \
+    GLME_ENCODE_STDDEF(enc);                                            \
+    GLME_ENCODE_STRUCT_START(enc);                                      \
+    fields(__GLME_SX_ENC)                                               \
+    GLME_ENCODE_STRUCT_END(enc);                                        \
+    GLME_ENCODE_RETURN(enc);                                            \
+  }                                                                     \
+  int name ## _decode(glme_buf_t *dec, void *ptr)                       \
+  {                                                                     \
+    struct name *p = (struct name *)ptr;                                \
+    GLME_DECODE_STDDEF(dec);                                            \
+    GLME_DECODE_STRUCT_START(dec);                                      \
+    fields(__GLME_SX_DEC)                                               \
+    GLME_DECODE_STRUCT_END(dec);                                        \
+    GLME_DECODE_RETURN(dec);                                            \
+  }                                                                     \
+  size_t name ## _size(const struct name *p)                            \
+  {                                                                     \
+    size_t __n = name ## _MAXSIZE;                                      \
+    fields(__GLME_SX_SIZE)                                              \
+    return __n;                                                         \
+  }
+
+/**
+ * Type specification initializer for structure declared with
+ * GLME_SCHEMA_DECLARE.
+ */
+#define GLME_SCHEMA_SPEC(name)                                          \
+  { name ## _TYPEID, sizeof(struct name), name ## _encode,              \
+      name ## _decode, (const glme_desc_t *)0 }
     
 
 
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * This file is part of https://github.com/hrautila/glme repository.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _REFS_H
+#define _REFS_H
+
+// Object identity tables (internal).
+
+struct glme_ref_s {
+  const void *ptr;      // structure; null if empty hash slot
+  int typeid;
+  size_t id;            // sequence number
+};
+
+// active tables of this thread
+extern __thread glme_refs_t *__glme_refs;
+
+// active identity table of buffer; null if not in identity mode
+static inline
+glme_refs_t *__glme_refs_of(glme_buf_t *gb)
+{
+  glme_refs_t *r;
+  for (r = __glme_refs; r; r = r->outer)
+    if (r->gbuf == gb)
+      return r;
+  return (glme_refs_t *)0;
+}
+
+// number structure or write back-reference if seen before; with noref (top level
+// and embedded structures) always number; returns 1 if back-reference was
+// written, 0 if numbered, negative on error
+extern int __glme_refs_put(glme_buf_t *enc, glme_refs_t *r, const void *ptr, int typeid, int noref);
+
+// number decoded structure
+extern int __glme_refs_add(glme_buf_t *dec, glme_refs_t *r, void *ptr, int typeid);
+
+// resolve back-reference decoded in place of type id
+extern int __glme_refs_get(glme_buf_t *dec, int ref, int typeid, void **pp);
+
+#endif
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,864 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gobber.h"
+#include "glme.h"
+#include "descriptor.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define __GLME_JIT_NATIVE 1
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#if defined(__GLME_JIT_NATIVE)
+
+/*
+ * Compiled descriptor is a straight line of native code for the System V
+ * x86-64 ABI. Scalar fields are loaded, compared to default, converted and
+ * written or read and stored inline. Other fields call the field operations
+ * of the descriptor interpreter with field and operation pointers as
+ * immediate values.
+ *
+ * Register use in compiled functions:
+ *   rbx  encoder/decoder buffer
+ *   rbp  structure pointer
+ *   r12  count/current at start
+ *   r13  field delta
+ *   r14  write pointer within run of scalar fields; decoder read pointer,
+ *        stored to current before calls
+ *   r15  value saved over calls; decoder end of input
+ * and 8 bytes on stack at [rsp] for varints returned from calls.
+ *
+ * Error exits are emitted before the function entry point so that all
+ * jumps to them are backward jumps with known targets.
+ */
+
+enum {
+  RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// condition codes
+enum {
+  CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6,
+  CC_A = 0x7, CC_S = 0x8, CC_P = 0xa, CC_L = 0xc
+};
+
+#define __OFF(member) ((int32_t)offsetof(glme_buf_t, member))
+
+struct __jit_code {
+  unsigned char *buf;
+  size_t len;
+  size_t cap;
+  int err;
+};
+
+// error exits
+struct __jit_exits {
+  size_t uflow;
+  size_t type;
+  size_t err;
+  size_t exit;
+};
+
+static
+void __b(struct __jit_code *j, unsigned int v)
+{
+  unsigned char *p;
+  if (j->len == j->cap) {
+    if (!(p = (unsigned char *)realloc(j->buf, j->cap + 4096))) {
+      // result is discarded
+      j->err = GLME_E_NOMEM;
+      return;
+    }
+    j->buf = p;
+    j->cap += 4096;
+  }
+  j->buf[j->len++] = (unsigned char)v;
+}
+
+static
+void __u32(struct __jit_code *j, uint32_t v)
+{
+  int k;
+  for (k = 0; k < 4; k++)
+    __b(j, v >> (k*8));
+}
+
+static
+void __u64(struct __jit_code *j, uint64_t v)
+{
+  int k;
+  for (k = 0; k < 8; k++)
+    __b(j, v >> (k*8));
+}
+
+// prefix, REX and one or two byte (0x0fXX) opcode
+static
+void __opc(struct __jit_code *j, int pfx, int w, unsigned int opc, int reg, int rm)
+{
+  int rex = (w ? 8 : 0) | (reg & 8 ? 4 : 0) | (rm & 8 ? 1 : 0);
+  if (pfx)
+    __b(j, pfx);
+  if (rex)
+    __b(j, 0x40 | rex);
+  if (opc > 0xff)
+    __b(j, opc >> 8);
+  __b(j, opc & 0xff);
+}
+
+// instruction with register operands; reg is register or opcode extension
+static
+void __op_rr(struct __jit_code *j, int pfx, int w, unsigned int opc, int reg, int rm)
+{
+  __opc(j, pfx, w, opc, reg, rm);
+  __b(j, 0xc0 | (reg & 7) << 3 | (rm & 7));
+}
+
+// instruction with register and memory operand [base+disp]
+static
+void __op_rm(struct __jit_code *j, int pfx, int w, unsigned int opc, int reg, int base, int32_t disp)
+{
+  int mod = disp >= -128 && disp < 128 ? 1 : 2;
+
+  __opc(j, pfx, w, opc, reg, base);
+  __b(j, mod << 6 | (reg & 7) << 3 | (base & 7));
+  if ((base & 7) == RSP)
+    __b(j, 0x24);
+  if (mod == 1)
+    __b(j, disp & 0xff);
+  else
+    __u32(j, (uint32_t)disp);
+}
+
+static
+void __mov_imm(struct __jit_code *j, int reg, uint64_t v)
+{
+  if (v >> 32) {
+    __b(j, 0x48 | (reg & 8 ? 1 : 0));
+    __b(j, 0xb8 | (reg & 7));
+    __u64(j, v);
+  } else {
+    if (reg & 8)
+      __b(j, 0x41);
+    __b(j, 0xb8 | (reg & 7));
+    __u32(j, (uint32_t)v);
+  }
+}
+
+static
+void __push(struct __jit_code *j, int reg)
+{
+  if (reg & 8)
+    __b(j, 0x41);
+  __b(j, 0x50 | (reg & 7));
+}
+
+static
+void __pop(struct __jit_code *j, int reg)
+{
+  if (reg & 8)
+    __b(j, 0x41);
+  __b(j, 0x58 | (reg & 7));
+}
+
+static
+void __bswap(struct __jit_code *j)
+{
+  __b(j, 0x48);                         // bswap rax
+  __b(j, 0x0f);
+  __b(j, 0xc8);
+}
+
+static
+void __call(struct __jit_code *j, const void *fn)
+{
+  __mov_imm(j, RAX, (uint64_t)(uintptr_t)fn);
+  __b(j, 0xff);
+  __b(j, 0xd0);
+}
+
+// jump to known target; cc < 0 for unconditional jump
+static
+void __jmp(struct __jit_code *j, int cc, size_t target)
+{
+  size_t next = j->len + (cc < 0 ? 5 : 6);
+  if (cc < 0) {
+    __b(j, 0xe9);
+  } else {
+    __b(j, 0x0f);
+    __b(j, 0x80 | cc);
+  }
+  __u32(j, (uint32_t)(int32_t)((ptrdiff_t)target - (ptrdiff_t)next));
+}
+
+// forward jump; returns position for __bind
+static
+size_t __fwd(struct __jit_code *j, int cc)
+{
+  __jmp(j, cc, j->len);
+  return j->len;
+}
+
+// bind forward jump to current position
+static
+void __bind(struct __jit_code *j, size_t at)
+{
+  uint32_t rel = (uint32_t)(j->len - at);
+  int k;
+  if (j->err)
+    return;
+  for (k = 0; k < 4; k++)
+    j->buf[at - 4 + k] = (unsigned char)(rel >> (k*8));
+}
+
+// error exits and epilogue; eax has the error code
+static
+void __exits(struct __jit_code *j, struct __jit_exits *x)
+{
+  x->uflow = j->len;
+  __mov_imm(j, RAX, (uint32_t)GLME_E_UFLOW);
+  __jmp(j, -1, j->len + 5 + 10);
+  x->type = j->len;
+  __mov_imm(j, RAX, (uint32_t)GLME_E_TYPE);
+  __jmp(j, -1, j->len + 5);
+  x->err = j->len;
+  __op_rm(j, 0, 0, 0x89, RAX, RBX, __OFF(last_error));
+  x->exit = j->len;
+  __op_rr(j, 0, 1, 0x83, 0, RSP);       // add rsp, 8
+  __b(j, 8);
+  __pop(j, R15);
+  __pop(j, R14);
+  __pop(j, R13);
+  __pop(j, R12);
+  __pop(j, RBP);
+  __pop(j, RBX);
+  __b(j, 0xc3);
+}
+
+static
+void __prologue(struct __jit_code *j)
+{
+  __push(j, RBX);
+  __push(j, RBP);
+  __push(j, R12);
+  __push(j, R13);
+  __push(j, R14);
+  __push(j, R15);
+  __op_rr(j, 0, 1, 0x83, 5, RSP);       // sub rsp, 8
+  __b(j, 8);
+  __op_rr(j, 0, 1, 0x89, RDI, RBX);
+  __op_rr(j, 0, 1, 0x89, RSI, RBP);
+}
+
+// ---------------------------------------------------------------------
+// encoder
+
+// reserve n bytes of buffer space
+static
+void __enc_reserve(struct __jit_code *j, struct __jit_exits *x, uint32_t n)
+{
+  size_t ok;
+
+  __op_rm(j, 0, 1, 0x8b, RAX, RBX, __OFF(buflen));
+  __op_rm(j, 0, 1, 0x2b, RAX, RBX, __OFF(count));
+  __op_rr(j, 0, 1, 0x81, 7, RAX);       // cmp rax, n
+  __u32(j, n);
+  ok = __fwd(j, CC_AE);
+  __op_rr(j, 0, 1, 0x89, RBX, RDI);
+  __mov_imm(j, RSI, n);
+  __call(j, (const void *)glme_buf_reserve);
+  __op_rr(j, 0, 0, 0x85, RAX, RAX);
+  __jmp(j, CC_S, x->err);
+  __bind(j, ok);
+}
+
+// write unsigned value in rax at r14; space for 9 bytes is reserved
+static
+void __enc_put(struct __jit_code *j)
+{
+  size_t big, done;
+
+  __op_rr(j, 0, 1, 0x81, 7, RAX);       // cmp rax, 128
+  __u32(j, 128);
+  big = __fwd(j, CC_AE);
+  __op_rm(j, 0, 0, 0x88, RAX, R14, 0);
+  __op_rr(j, 0, 1, 0xff, 0, R14);       // inc r14
+  done = __fwd(j, -1);
+  __bind(j, big);
+  // byte count k+1 from highest bit; -(k+1) and bytes in big endian order
+  __op_rr(j, 0, 1, 0x0fbd, RCX, RAX);   // bsr rcx, rax
+  __op_rr(j, 0, 0, 0xc1, 5, RCX);       // shr ecx, 3
+  __b(j, 3);
+  __op_rr(j, 0, 0, 0x89, RCX, RDX);
+  __op_rr(j, 0, 0, 0xf7, 2, RDX);       // not edx
+  __op_rm(j, 0, 0, 0x88, RDX, R14, 0);
+  __bswap(j);
+  __op_rr(j, 0, 0, 0x83, 6, RCX);       // xor ecx, 7
+  __b(j, 7);
+  __op_rr(j, 0, 0, 0xc1, 4, RCX);       // shl ecx, 3
+  __b(j, 3);
+  __op_rr(j, 0, 1, 0xd3, 5, RAX);       // shr rax, cl
+  __op_rm(j, 0, 1, 0x89, RAX, R14, 1);
+  __op_rr(j, 0, 0, 0xf7, 3, RDX);       // neg edx
+  __op_rr(j, 0, 1, 0x01, RDX, R14);
+  __op_rr(j, 0, 1, 0xff, 0, R14);
+  __bind(j, done);
+}
+
+// compare rax to 64 bit value
+static
+void __cmp_imm(struct __jit_code *j, uint64_t v)
+{
+  if ((int64_t)v >= INT32_MIN && (int64_t)v <= INT32_MAX) {
+    __op_rr(j, 0, 1, 0x81, 7, RAX);
+    __u32(j, (uint32_t)v);
+  } else {
+    __mov_imm(j, RCX, v);
+    __op_rr(j, 0, 1, 0x39, RCX, RAX);
+  }
+}
+
+// encode scalar field; delta fits in one byte if small
+static
+void __enc_scalar(struct __jit_code *j, const glme_field_t *f,
+                  const struct glme_fieldop_s *op, int small)
+{
+  union { double d; uint64_t u; } dv;
+  int32_t off = (int32_t)f->offset;
+  size_t skip, put, next;
+
+  dv.d = f->defval.f;
+  switch (op->op) {
+  case GLME_OP_I8:  __op_rm(j, 0, 1, 0x0fbe, RAX, RBP, off); break;
+  case GLME_OP_I16: __op_rm(j, 0, 1, 0x0fbf, RAX, RBP, off); break;
+  case GLME_OP_I32: __op_rm(j, 0, 1, 0x63, RAX, RBP, off); break;
+  case GLME_OP_U8:  __op_rm(j, 0, 0, 0x0fb6, RAX, RBP, off); break;
+  case GLME_OP_U16: __op_rm(j, 0, 0, 0x0fb7, RAX, RBP, off); break;
+  case GLME_OP_U32: __op_rm(j, 0, 0, 0x8b, RAX, RBP, off); break;
+  case GLME_OP_I64:
+  case GLME_OP_U64: __op_rm(j, 0, 1, 0x8b, RAX, RBP, off); break;
+  case GLME_OP_F32: __op_rm(j, 0xf3, 0, 0x0f5a, 0, RBP, off); break;   // cvtss2sd xmm0
+  case GLME_OP_F64: __op_rm(j, 0xf2, 0, 0x0f10, 0, RBP, off); break;   // movsd xmm0
+  }
+
+  if (op->op == GLME_OP_F32 || op->op == GLME_OP_F64) {
+    // unordered compare; NaN is never default
+    __mov_imm(j, RCX, dv.u);
+    __op_rr(j, 0x66, 1, 0x0f6e, 1, RCX);        // movq xmm1, rcx
+    __op_rr(j, 0x66, 0, 0x0f2e, 0, 1);          // ucomisd xmm0, xmm1
+    put = __fwd(j, CC_P);
+    skip = __fwd(j, CC_E);
+    __bind(j, put);
+    __op_rr(j, 0x66, 1, 0x0f7e, 0, RAX);        // movq rax, xmm0
+    __bswap(j);
+  } else {
+    __cmp_imm(j, f->defval.u);
+    skip = __fwd(j, CC_E);
+    if (op->op <= GLME_OP_I64) {
+      // zigzag
+      __op_rr(j, 0, 1, 0x89, RAX, RCX);
+      __op_rr(j, 0, 1, 0xc1, 7, RCX);           // sar rcx, 63
+      __b(j, 63);
+      __op_rr(j, 0, 1, 0x01, RAX, RAX);         // add rax, rax
+      __op_rr(j, 0, 1, 0x31, RCX, RAX);
+    }
+  }
+
+  if (small) {
+    __op_rm(j, 0, 0, 0x88, R13, R14, 0);
+    __op_rm(j, 0, 0, 0xc6, 0, R14, 1);          // mov byte [r14+1], wtype
+    __b(j, op->wtype);
+    __op_rr(j, 0, 1, 0x83, 0, R14);             // add r14, 2
+    __b(j, 2);
+  } else {
+    __op_rr(j, 0, 1, 0x89, RAX, R15);
+    __op_rr(j, 0, 1, 0x89, R14, RDI);
+    __op_rr(j, 0, 1, 0x89, R13, RSI);
+    __call(j, (const void *)glme_put_uint64);
+    __op_rm(j, 0, 0, 0xc6, 0, RAX, 0);
+    __b(j, op->wtype);
+    __op_rm(j, 0, 1, 0x8d, R14, RAX, 1);        // lea r14, [rax+1]
+    __op_rr(j, 0, 1, 0x89, R15, RAX);
+  }
+  __enc_put(j);
+  __mov_imm(j, R13, 1);
+  next = __fwd(j, -1);
+  __bind(j, skip);
+  __op_rr(j, 0, 1, 0xff, 0, R13);               // inc r13
+  __bind(j, next);
+}
+
+static
+void __enc_field(struct __jit_code *j, struct __jit_exits *x,
+                 const glme_field_t *f, const struct glme_fieldop_s *op)
+{
+  __op_rr(j, 0, 1, 0x89, RBX, RDI);
+  __mov_imm(j, RSI, (uint64_t)(uintptr_t)f);
+  __mov_imm(j, RDX, (uint64_t)(uintptr_t)op);
+  __op_rm(j, 0, 1, 0x8d, RCX, RBP, (int32_t)f->offset);
+  __op_rr(j, 0, 1, 0x89, R13, R8);
+  __call(j, (const void *)__glme_desc_encode_field);
+  __op_rr(j, 0, 0, 0x85, RAX, RAX);
+  __jmp(j, CC_S, x->err);
+  // delta is 1 after written field, one more after omitted
+  __op_rm(j, 0, 1, 0x8d, RCX, R13, 1);
+  __mov_imm(j, R13, 1);
+  __op_rr(j, 0, 1, 0x0f44, R13, RCX);           // cmovz r13, rcx
+}
+
+// returns offset of entry point
+static
+size_t __jit_encoder(struct __jit_code *j, const glme_desc_t *desc)
+{
+  const struct glme_fieldop_s *ops = desc->ops;
+  struct __jit_exits x;
+  unsigned int k, end;
+  int small = desc->nfields < 127;
+  size_t entry;
+
+  __exits(j, &x);
+  entry = j->len;
+  __prologue(j);
+  __op_rm(j, 0, 1, 0x8b, R12, RBX, __OFF(count));
+  __mov_imm(j, R13, 1);
+
+  for (k = 0; k < desc->nfields; ) {
+    if ((end = ops[k].nrun) > 0) {
+      __enc_reserve(j, &x, end * __GLME_SCALAR_MAX);
+      __op_rm(j, 0, 1, 0x8b, R14, RBX, __OFF(buf));
+      __op_rm(j, 0, 1, 0x03, R14, RBX, __OFF(count));
+      for (end += k; k < end; k++)
+        __enc_scalar(j, &desc->fields[k], &ops[k], small);
+      __op_rr(j, 0, 1, 0x89, R14, RAX);
+      __op_rm(j, 0, 1, 0x2b, RAX, RBX, __OFF(buf));
+      __op_rm(j, 0, 1, 0x89, RAX, RBX, __OFF(count));
+      continue;
+    }
+    __enc_field(j, &x, &desc->fields[k], &ops[k]);
+    k++;
+  }
+  // end of struct
+  __enc_reserve(j, &x, 1);
+  __op_rm(j, 0, 1, 0x8b, RAX, RBX, __OFF(buf));
+  __op_rm(j, 0, 1, 0x8b, RCX, RBX, __OFF(count));
+  __op_rr(j, 0, 1, 0x01, RCX, RAX);
+  __op_rm(j, 0, 0, 0xc6, 0, RAX, 0);            // mov byte [rax], 0
+  __b(j, 0);
+  __op_rr(j, 0, 1, 0xff, 0, RCX);
+  __op_rm(j, 0, 1, 0x89, RCX, RBX, __OFF(count));
+  __op_rr(j, 0, 1, 0x89, RCX, RAX);
+  __op_rr(j, 0, 1, 0x29, R12, RAX);             // sub rax, r12
+  __jmp(j, -1, x.exit);
+  return entry;
+}
+
+// ---------------------------------------------------------------------
+// decoder
+
+static
+int __jit_uint64(glme_buf_t *dec, uint64_t *v)
+{
+  int n = gob_decode_uint64(v, &dec->buf[dec->current], dec->count - dec->current);
+  if (n < 0)
+    return GLME_E_UFLOW;
+  dec->current += n;
+  return n;
+}
+
+// skip value of unknown field and remaining fields of structure
+static
+int __jit_skip(glme_buf_t *dec)
+{
+  if (glme_skip(dec) < 0 || glme_skip_fields(dec) < 0)
+    return dec->last_error;
+  return 0;
+}
+
+// load read pointer r14 and end of input r15 from decoder
+static
+void __dec_load(struct __jit_code *j)
+{
+  __op_rm(j, 0, 1, 0x8b, R14, RBX, __OFF(buf));
+  __op_rr(j, 0, 1, 0x89, R14, R15);
+  __op_rm(j, 0, 1, 0x03, R14, RBX, __OFF(current));
+  __op_rm(j, 0, 1, 0x03, R15, RBX, __OFF(count));
+}
+
+// store read pointer to decoder
+static
+void __dec_sync(struct __jit_code *j)
+{
+  __op_rr(j, 0, 1, 0x89, R14, RAX);
+  __op_rm(j, 0, 1, 0x2b, RAX, RBX, __OFF(buf));
+  __op_rm(j, 0, 1, 0x89, RAX, RBX, __OFF(current));
+}
+
+// read unsigned value to register dst
+static
+void __dec_get(struct __jit_code *j, struct __jit_exits *x, int dst)
+{
+  size_t big, slow, done1, done2, loop;
+
+  __op_rr(j, 0, 1, 0x39, R15, R14);             // cmp r14, r15
+  __jmp(j, CC_AE, x->uflow);
+  __op_rm(j, 0, 0, 0x0fbe, RDX, R14, 0);        // movsx edx, byte [r14]
+  __op_rr(j, 0, 1, 0xff, 0, R14);
+  __op_rr(j, 0, 0, 0x85, RDX, RDX);
+  big = __fwd(j, CC_S);
+  __op_rr(j, 0, 0, 0x89, RDX, dst);
+  done1 = __fwd(j, -1);
+
+  // byte count and big endian bytes; over 8 bytes as in gob_decode_uint64
+  __bind(j, big);
+  __op_rr(j, 0, 0, 0x83, 7, RDX);               // cmp edx, -8
+  __b(j, 0xf8);
+  slow = __fwd(j, CC_L);
+  __op_rr(j, 0, 0, 0xf7, 3, RDX);               // neg edx
+  __op_rr(j, 0, 1, 0x89, R15, RAX);
+  __op_rr(j, 0, 1, 0x29, R14, RAX);             // sub rax, r14
+  __op_rr(j, 0, 1, 0x39, RDX, RAX);             // cmp rax, rdx
+  __jmp(j, CC_B, x->uflow);
+  __op_rr(j, 0, 0, 0x31, RCX, RCX);
+  loop = j->len;
+  __op_rr(j, 0, 1, 0xc1, 4, RCX);               // shl rcx, 8
+  __b(j, 8);
+  __op_rm(j, 0, 0, 0x0fb6, RAX, R14, 0);        // movzx eax, byte [r14]
+  __op_rr(j, 0, 1, 0x09, RAX, RCX);             // or rcx, rax
+  __op_rr(j, 0, 1, 0xff, 0, R14);
+  __op_rr(j, 0, 0, 0xff, 1, RDX);               // dec edx
+  __jmp(j, CC_NE, loop);
+  __op_rr(j, 0, 1, 0x89, RCX, dst);
+  done2 = __fwd(j, -1);
+
+  __bind(j, slow);
+  __op_rr(j, 0, 1, 0xff, 1, R14);               // back to count byte
+  __dec_sync(j);
+  __op_rr(j, 0, 1, 0x89, RBX, RDI);
+  __op_rr(j, 0, 1, 0x89, RSP, RSI);
+  __call(j, (const void *)__jit_uint64);
+  __op_rr(j, 0, 0, 0x85, RAX, RAX);
+  __jmp(j, CC_S, x->uflow);
+  __dec_load(j);
+  __op_rm(j, 0, 1, 0x8b, dst, RSP, 0);
+  __bind(j, done1);
+  __bind(j, done2);
+}
+
+// read field delta; more than max fields ahead is not in this descriptor
+// and is skipped with the rest, leaving zero delta for defaults
+static
+void __dec_delta(struct __jit_code *j, struct __jit_exits *x, uint32_t max)
+{
+  size_t known;
+
+  __dec_get(j, x, R13);
+  __op_rr(j, 0, 1, 0x81, 7, R13);
+  __u32(j, max);
+  known = __fwd(j, CC_BE);
+  __dec_sync(j);
+  __op_rr(j, 0, 1, 0x89, RBX, RDI);
+  __call(j, (const void *)__jit_skip);
+  __op_rr(j, 0, 0, 0x85, RAX, RAX);
+  __jmp(j, CC_S, x->err);
+  __dec_load(j);
+  __op_rr(j, 0, 1, 0x31, R13, R13);             // xor r13, r13
+  __bind(j, known);
+}
+
+// store rax to scalar field
+static
+void __dec_store(struct __jit_code *j, int op, int32_t off)
+{
+  switch (op) {
+  case GLME_OP_I8:
+  case GLME_OP_U8:
+    __op_rm(j, 0, 0, 0x88, RAX, RBP, off);
+    break;
+  case GLME_OP_I16:
+  case GLME_OP_U16:
+    __op_rm(j, 0x66, 0, 0x89, RAX, RBP, off);
+    break;
+  case GLME_OP_I32:
+  case GLME_OP_U32:
+  case GLME_OP_F32:
+    __op_rm(j, 0, 0, 0x89, RAX, RBP, off);
+    break;
+  default:
+    __op_rm(j, 0, 1, 0x89, RAX, RBP, off);
+    break;
+  }
+}
+
+// decode field with interpreter
+static
+void __dec_call(struct __jit_code *j, struct __jit_exits *x,
+                const glme_field_t *f, const struct glme_fieldop_s *op)
+{
+  __dec_sync(j);
+  __op_rr(j, 0, 1, 0x89, RBX, RDI);
+  __mov_imm(j, RSI, (uint64_t)(uintptr_t)f);
+  __mov_imm(j, RDX, (uint64_t)(uintptr_t)op);
+  __op_rm(j, 0, 1, 0x8d, RCX, RBP, (int32_t)f->offset);
+  __call(j, (const void *)__glme_desc_field);
+  __op_rr(j, 0, 0, 0x85, RAX, RAX);
+  __jmp(j, CC_S, x->err);
+  __dec_load(j);
+}
+
+// floating point fields of other wire type go to interpreter
+static
+void __dec_scalar(struct __jit_code *j, struct __jit_exits *x,
+                  const glme_field_t *f, const struct glme_fieldop_s *op)
+{
+  int32_t off = (int32_t)f->offset;
+  size_t other = 0, done;
+
+  // type byte
+  __op_rr(j, 0, 1, 0x39, R15, R14);
+  __jmp(j, CC_AE, x->uflow);
+  __op_rm(j, 0, 0, 0x80, 7, R14, 0);            // cmp byte [r14], wtype
+  __b(j, op->wtype);
+  if (op->op == GLME_OP_F32 || op->op == GLME_OP_F64)
+    other = __fwd(j, CC_NE);
+  else
+    __jmp(j, CC_NE, x->type);
+  __op_rr(j, 0, 1, 0xff, 0, R14);
+
+  __dec_get(j, x, RAX);
+  switch (op->op) {
+  case GLME_OP_I8:
+  case GLME_OP_I16:
+  case GLME_OP_I32:
+  case GLME_OP_I64:
+    // unzigzag
+    __op_rr(j, 0, 1, 0x89, RAX, RCX);
+    __op_rr(j, 0, 1, 0xd1, 5, RAX);             // shr rax, 1
+    __op_rr(j, 0, 0, 0x83, 4, RCX);             // and ecx, 1
+    __b(j, 1);
+    __op_rr(j, 0, 1, 0xf7, 3, RCX);             // neg rcx
+    __op_rr(j, 0, 1, 0x31, RCX, RAX);
+    break;
+  case GLME_OP_F32:
+    __bswap(j);
+    __op_rr(j, 0x66, 1, 0x0f6e, 0, RAX);        // movq xmm0, rax
+    __op_rr(j, 0xf2, 0, 0x0f5a, 0, 0);          // cvtsd2ss xmm0, xmm0
+    __op_rm(j, 0xf3, 0, 0x0f11, 0, RBP, off);   // movss [rbp+off], xmm0
+    break;
+  case GLME_OP_F64:
+    __bswap(j);
+    break;
+  }
+  if (op->op != GLME_OP_F32)
+    __dec_store(j, op->op, off);
+  if (other) {
+    done = __fwd(j, -1);
+    __bind(j, other);
+    __dec_call(j, x, f, op);
+    __bind(j, done);
+  }
+}
+
+static
+void __dec_default(struct __jit_code *j, const glme_field_t *f, const struct glme_fieldop_s *op)
+{
+  union { double d; uint64_t u; } dv;
+  union { float f; uint32_t u; } fv;
+
+  switch (op->op) {
+  case GLME_OP_F32:
+    fv.f = (float)f->defval.f;
+    __mov_imm(j, RAX, fv.u);
+    break;
+  case GLME_OP_F64:
+    dv.d = f->defval.f;
+    __mov_imm(j, RAX, dv.u);
+    break;
+  default:
+    if (!__GLME_OP_SCALAR(op->op)) {
+      __mov_imm(j, RDI, (uint64_t)(uintptr_t)f);
+      __mov_imm(j, RSI, op->op);
+      __op_rm(j, 0, 1, 0x8d, RDX, RBP, (int32_t)f->offset);
+      __call(j, (const void *)__glme_desc_default);
+      return;
+    }
+    __mov_imm(j, RAX, f->defval.u);
+    break;
+  }
+  __dec_store(j, op->op, (int32_t)f->offset);
+}
+
+// returns offset of entry point
+static
+size_t __jit_decoder(struct __jit_code *j, const glme_desc_t *desc)
+{
+  const struct glme_fieldop_s *ops = desc->ops;
+  const glme_field_t *f;
+  struct __jit_exits x;
+  size_t absent, end, next, entry;
+  unsigned int k;
+
+  __exits(j, &x);
+  entry = j->len;
+  __prologue(j);
+  __op_rm(j, 0, 1, 0x8b, R12, RBX, __OFF(current));
+  __dec_load(j);
+  __dec_delta(j, &x, desc->nfields);
+
+  for (k = 0; k < desc->nfields; k++) {
+    f = &desc->fields[k];
+    __op_rr(j, 0, 1, 0x83, 7, R13);             // cmp r13, 1
+    __b(j, 1);
+    absent = __fwd(j, CC_NE);
+    if (__GLME_OP_SCALAR(ops[k].op))
+      __dec_scalar(j, &x, f, &ops[k]);
+    else
+      __dec_call(j, &x, f, &ops[k]);
+    __dec_delta(j, &x, desc->nfields - k - 1);
+    next = __fwd(j, -1);
+    // omitted field; zero delta after end of struct stays zero
+    __bind(j, absent);
+    __dec_default(j, f, &ops[k]);
+    __op_rr(j, 0, 1, 0x85, R13, R13);
+    end = __fwd(j, CC_E);
+    __op_rr(j, 0, 1, 0xff, 1, R13);             // dec r13
+    __bind(j, end);
+    __bind(j, next);
+  }
+  __dec_sync(j);
+  __op_rr(j, 0, 1, 0x29, R12, RAX);
+  __jmp(j, -1, x.exit);
+  return entry;
+}
+
+static
+void __perfmap(const void *code, size_t len, const char *what, int typeid)
+{
+  char path[64];
+  FILE *fp;
+
+  snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+  if (!(fp = fopen(path, "a")))
+    return;
+  fprintf(fp, "%lx %lx glme_jit_%s_%d\n", (unsigned long)(uintptr_t)code,
+          (unsigned long)len, what, typeid);
+  fclose(fp);
+}
+
+static
+int __jit_native(glme_jit_t *jit, glme_spec_t *spec, const glme_desc_t *desc, int flags)
+{
+  struct __jit_code j = { (unsigned char *)0, 0, 0, 0 };
+  size_t k, encsz, decat, encentry, decentry, pagesz;
+  unsigned char *code;
+
+  // field offsets are 32 bit displacements
+  for (k = 0; k < desc->nfields; k++) {
+    if (desc->fields[k].offset > INT32_MAX)
+      return 0;
+  }
+
+  encentry = __jit_encoder(&j, desc);
+  encsz = j.len;
+  while (j.len & 15)
+    __b(&j, 0xcc);
+  decat = j.len;
+  decentry = __jit_decoder(&j, desc);
+  if (j.err) {
+    free(j.buf);
+    return j.err;
+  }
+
+  pagesz = (size_t)sysconf(_SC_PAGESIZE);
+  jit->size = (j.len + pagesz - 1) & ~(pagesz - 1);
+  code = (unsigned char *)mmap((void *)0, jit->size, PROT_READ|PROT_WRITE,
+                               MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (code == (unsigned char *)MAP_FAILED) {
+    // executable mappings may be denied; interpreter still works
+    free(j.buf);
+    jit->size = 0;
+    return 0;
+  }
+  memcpy(code, j.buf, j.len);
+  free(j.buf);
+  if (mprotect(code, jit->size, PROT_READ|PROT_EXEC) != 0) {
+    munmap(code, jit->size);
+    jit->size = 0;
+    return 0;
+  }
+  jit->code = code;
+
+  spec->encoder = (glme_encoder_f)(code + encentry);
+  spec->decoder = (glme_decoder_f)(code + decentry);
+  if (flags & GLME_JIT_PERFMAP) {
+    __perfmap(code, encsz, "encode", desc->typeid);
+    __perfmap(code + decat, j.len - decat, "decode", desc->typeid);
+  }
+  return 1;
+}
+
+#endif  // __GLME_JIT_NATIVE
+
+int glme_jit_compile(glme_jit_t *jit, glme_spec_t *spec, glme_desc_t *desc, int flags)
+{
+  int n;
+
+  jit->code = (void *)0;
+  jit->size = 0;
+  if ((n = glme_desc_init(desc)) < 0)
+    return n;
+  glme_spec_init_desc(spec, desc);
+#if defined(__GLME_JIT_NATIVE)
+  if (!(flags & GLME_JIT_INTERP))
+    return __jit_native(jit, spec, desc, flags);
+#endif
+  return 0;
+}
+
+void glme_jit_release(glme_jit_t *jit)
+{
+#if defined(__GLME_JIT_NATIVE)
+  if (jit->code)
+    munmap(jit->code, jit->size);
+#endif
+  jit->code = (void *)0;
+  jit->size = 0;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
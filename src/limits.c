@@ -0,0 +1,89 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "glme.h"
+#include "glimits.h"
+
+/*
+ * Decode limits. Active limits are linked to a thread local list like object
+ * identity tables; buffer selects the limits. Allocator functions in glme.h
+ * test the list head only, so decoding without limits pays one thread local
+ * load per allocation.
+ */
+
+__thread glme_limits_t *__glme_limits;
+
+int glme_limits_begin(glme_buf_t *gbuf, glme_limits_t *limits,
+                      size_t maxmem, unsigned int maxdepth)
+{
+  *limits = (glme_limits_t){gbuf, __glme_limits, maxmem, 0, maxdepth, 0, 0};
+  __glme_limits = limits;
+  return 0;
+}
+
+void glme_limits_end(glme_buf_t *gbuf, glme_limits_t *limits)
+{
+  glme_limits_t **lp;
+
+  for (lp = &__glme_limits; *lp; lp = &(*lp)->outer) {
+    if (*lp == limits) {
+      *lp = limits->outer;
+      break;
+    }
+  }
+  limits->gbuf = (glme_buf_t *)0;
+  limits->outer = (glme_limits_t *)0;
+}
+
+int __glme_limits_charge(glme_buf_t *gb, size_t nelem, size_t nbyt)
+{
+  glme_limits_t *l = __glme_limits_of(gb);
+
+  if (!l)
+    return 0;
+  if (nbyt && nelem > SIZE_MAX / nbyt) {
+    l->exceeded = 1;
+    return GLME_E_LIMIT;
+  }
+  // allocated never exceeds nonzero budget
+  if (l->maxmem && nelem * nbyt > l->maxmem - l->allocated) {
+    l->exceeded = 1;
+    return GLME_E_LIMIT;
+  }
+  l->allocated += nelem * nbyt;
+  return 0;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "glme.h"
+#include "map.h"
+
+/*
+ * Map tables. Open addressing with linear probing, load factor at most one
+ * half. Slot hash has top bit set so that zero marks an empty slot. Integer
+ * keys are compared as 64 bit values whatever the key type.
+ */
+
+#define __HASHBIT 0x8000000000000000ull
+
+static inline
+uint64_t __mix(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h | __HASHBIT;
+}
+
+static inline
+uint64_t __hash_str(const char *p, size_t len)
+{
+  uint64_t h = len * 0x9E3779B97F4A7C15ull, w;
+
+  for (; len >= 8; p += 8, len -= 8) {
+    memcpy(&w, p, sizeof(w));
+    h = (h ^ w) * 0x100000001b3ull;
+    h ^= h >> 29;
+  }
+  if (len > 0) {
+    w = 0;
+    memcpy(&w, p, len);
+    h = (h ^ w) * 0x100000001b3ull;
+  }
+  return __mix(h);
+}
+
+static inline
+uint64_t __hash(int ktype, const glme_mapent_t *e)
+{
+  return ktype == GLME_STRING ? __hash_str(e->key.s.ptr, e->key.s.len) : __mix(e->key.u);
+}
+
+// slot of key or empty slot where it goes
+static inline
+glme_mapent_t *__slot(const glme_map_t *map, uint64_t h, const glme_mapent_t *e)
+{
+  size_t k, mask = map->size - 1;
+  glme_mapent_t *s;
+
+  for (k = h & mask; ; k = (k + 1) & mask) {
+    s = &map->slots[k];
+    if (!s->hash)
+      return s;
+    if (s->hash != h)
+      continue;
+    if (map->ktype == GLME_STRING
+        ? s->key.s.len == e->key.s.len && memcmp(s->key.s.ptr, e->key.s.ptr, e->key.s.len) == 0
+        : s->key.u == e->key.u)
+      return s;
+  }
+}
+
+int __glme_map_reserve(glme_buf_t *gb, glme_map_t *map, size_t n)
+{
+  glme_mapent_t *old = map->slots, *s;
+  size_t k, osize = map->size, size;
+
+  if (2*n <= osize)
+    return 0;
+  for (size = osize ? osize : 8; size < 2*n; size *= 2)
+    ;
+  if (!(map->slots = (glme_mapent_t *)glme_calloc(gb, size, sizeof(glme_mapent_t)))) {
+    map->slots = old;
+    gb->last_error = GLME_E_NOMEM;
+    return GLME_E_NOMEM;
+  }
+  map->size = size;
+  for (k = 0; k < osize; k++) {
+    if (old[k].hash) {
+      s = __slot(map, old[k].hash, &old[k]);
+      *s = old[k];
+    }
+  }
+  if (old)
+    glme_free(gb, old);
+  return 0;
+}
+
+char *__glme_map_block(glme_buf_t *gb, glme_map_t *map, size_t size)
+{
+  struct glme_mapblk_s *b;
+
+  if (!(b = (struct glme_mapblk_s *)glme_malloc(gb, sizeof(*b) + size))) {
+    gb->last_error = GLME_E_NOMEM;
+    return (char *)0;
+  }
+  b->next = map->blocks;
+  map->blocks = b;
+  return (char *)(b + 1);
+}
+
+int glme_map_put(glme_buf_t *gb, glme_map_t *map, const glme_mapent_t *e)
+{
+  glme_mapent_t *s;
+  uint64_t h;
+  int n;
+
+  if ((n = __glme_map_reserve(gb, map, map->count + 1)) < 0)
+    return n;
+  h = __hash(map->ktype, e);
+  s = __slot(map, h, e);
+  if (!s->hash)
+    map->count++;
+  *s = *e;
+  s->hash = h;
+  return 0;
+}
+
+glme_mapent_t *glme_map_find(const glme_map_t *map, uint64_t key)
+{
+  glme_mapent_t e, *s;
+
+  if (map->count == 0 || map->ktype == GLME_STRING)
+    return (glme_mapent_t *)0;
+  e.key.u = key;
+  s = __slot(map, __mix(key), &e);
+  return s->hash ? s : (glme_mapent_t *)0;
+}
+
+glme_mapent_t *glme_map_find_str(const glme_map_t *map, const char *key, size_t len)
+{
+  glme_mapent_t e, *s;
+
+  if (map->count == 0 || map->ktype != GLME_STRING)
+    return (glme_mapent_t *)0;
+  e.key.s.ptr = key;
+  e.key.s.len = len;
+  s = __slot(map, __hash_str(key, len), &e);
+  return s->hash ? s : (glme_mapent_t *)0;
+}
+
+void glme_map_release(glme_buf_t *gb, glme_map_t *map)
+{
+  struct glme_mapblk_s *b, *next;
+
+  for (b = map->blocks; b; b = next) {
+    next = b->next;
+    glme_free(gb, b);
+  }
+  if (map->slots)
+    glme_free(gb, map->slots);
+  glme_map_init(map, map->ktype, map->etype);
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,437 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gobber.h"
+#include "glme.h"
+
+// ---------------------------------------------------------------------
+// Arena
+
+struct glme_chunk_s
+{
+  struct glme_chunk_s *next;
+  size_t size;
+};
+
+#define __ALIGN 16
+#define __ROUND(n) (((n) + __ALIGN - 1) & ~(size_t)(__ALIGN - 1))
+#define __HDRSIZE __ROUND(sizeof(struct glme_chunk_s))
+
+void glme_arena_init(glme_arena_t *arena, size_t chunksize)
+{
+  *arena = (glme_arena_t){(struct glme_chunk_s *)0, (char *)0, (char *)0,
+                          chunksize < 1024 ? 1024 : chunksize};
+}
+
+// allocate new chunk for nbytes
+static
+int __arena_grow(glme_arena_t *arena, size_t nbytes)
+{
+  struct glme_chunk_s *c;
+  size_t size = arena->chunksize;
+
+  if (size < nbytes + __HDRSIZE)
+    size = nbytes + __HDRSIZE;
+  if (!(c = (struct glme_chunk_s *)malloc(size)))
+    return GLME_E_NOMEM;
+  c->next = arena->chunks;
+  c->size = size;
+  arena->chunks = c;
+  arena->ptr = (char *)c + __HDRSIZE;
+  arena->end = (char *)c + size;
+  return 0;
+}
+
+static inline
+void *__arena_alloc(glme_arena_t *arena, size_t nbytes)
+{
+  char *p;
+
+  nbytes = __ROUND(nbytes);
+  if ((size_t)(arena->end - arena->ptr) < nbytes && __arena_grow(arena, nbytes) < 0)
+    return (void *)0;
+  p = arena->ptr;
+  arena->ptr += nbytes;
+  return p;
+}
+
+void *glme_arena_alloc(glme_arena_t *arena, size_t nbytes)
+{
+  return __arena_alloc(arena, nbytes);
+}
+
+void glme_arena_reset(glme_arena_t *arena)
+{
+  struct glme_chunk_s *c = arena->chunks, *next;
+  size_t total = 0;
+
+  if (c && !c->next) {
+    // single chunk is reused
+    arena->ptr = (char *)c + __HDRSIZE;
+    return;
+  }
+  for (; c; c = next) {
+    next = c->next;
+    total += c->size;
+    free(c);
+  }
+  if (total > arena->chunksize)
+    arena->chunksize = total;
+  arena->chunks = (struct glme_chunk_s *)0;
+  arena->ptr = arena->end = (char *)0;
+}
+
+void glme_arena_release(glme_arena_t *arena)
+{
+  glme_arena_reset(arena);
+  if (arena->chunks)
+    free(arena->chunks);
+  arena->chunks = (struct glme_chunk_s *)0;
+  arena->ptr = arena->end = (char *)0;
+}
+
+// ---------------------------------------------------------------------
+// Node tree decoding
+
+/*
+ * Tree is built from reader tokens without recursion. Containers open while
+ * reading are kept on a stack parallel to reader stack. Array and map items
+ * are allocated as one block when the count is read; structure fields are
+ * allocated one at a time and appended to the field list.
+ */
+
+struct __vframe
+{
+  glme_node_t *node;            // open container
+  glme_node_t *slot;           // next array or map item
+  glme_node_t **tail;          // end of structure field list
+  unsigned int fno;             // number of next structure field
+};
+
+static inline
+glme_node_t *__items(glme_arena_t *arena, uint64_t n)
+{
+  glme_node_t *v;
+  uint64_t k;
+
+  if (n == 0)
+    return (glme_node_t *)0;
+  if (!(v = (glme_node_t *)__arena_alloc(arena, n * sizeof(glme_node_t))))
+    return (glme_node_t *)0;
+  for (k = 0; k < n - 1; k++)
+    v[k].next = &v[k+1];
+  v[n-1].next = (glme_node_t *)0;
+  return v;
+}
+
+int glme_node_decode(glme_buf_t *dec, glme_arena_t *arena, glme_node_t **vp)
+{
+  glme_reader_t rd;
+  glme_token_t tok;
+  struct __vframe st[GLME_READER_DEPTH], *f;
+  glme_node_t *v, *root = (glme_node_t *)0;
+  uint64_t n, __at_start = dec->current;
+  int t, depth = 0;
+
+  glme_reader_init(&rd, dec);
+  for (;;) {
+    if ((t = glme_reader_next(&rd, &tok)) < 0)
+      goto error;
+    f = depth > 0 ? &st[depth-1] : (struct __vframe *)0;
+
+    switch (t) {
+    case GLME_T_EOF:
+      dec->last_error = t = GLME_E_UFLOW;
+      goto error;
+    case GLME_T_FIELD:
+      f->fno = tok.fno;
+      continue;
+    case GLME_T_ARRAY_END:
+    case GLME_T_MAP_END:
+    case GLME_T_STRUCT_END:
+      if (--depth == 0)
+        goto done;
+      continue;
+    }
+
+    if (f && !f->tail) {
+      v = f->slot++;
+    } else {
+      if (!(v = (glme_node_t *)__arena_alloc(arena, sizeof(glme_node_t))))
+        goto nomem;
+      v->next = (glme_node_t *)0;
+      if (f) {
+        *f->tail = v;
+        f->tail = &v->next;
+        if (f->node->ktype != GLME_COLUMNS)
+          f->node->count++;
+      } else {
+        root = v;
+      }
+    }
+    v->kind = t;
+    v->typeid = tok.typeid;
+    v->ktype = 0;
+    v->fno = f ? f->fno : 0;
+    v->count = 0;
+
+    switch (t) {
+    case GLME_T_SCALAR:
+      if (tok.typeid == GLME_COMPLEX)
+        v->v.c = tok.v.c;
+      else
+        v->v.u = tok.v.u;
+      break;
+    case GLME_T_REF:
+      v->v.u = tok.v.u;
+      break;
+    case GLME_T_BYTES:
+      v->v.s.ptr = tok.v.s.ptr;
+      v->v.s.len = tok.v.s.len;
+      if (tok.typeid == GLME_PACKED || tok.typeid == GLME_DELTA) {
+        v->ktype = tok.ktype;
+        v->count = tok.count;
+      }
+      break;
+    case GLME_T_ARRAY:
+    case GLME_T_MAP:
+      // every item takes at least one byte
+      n = t == GLME_T_MAP ? 2*tok.count : tok.count;
+      if (n > dec->count - dec->current || (t == GLME_T_MAP && n < tok.count)) {
+        dec->last_error = t = GLME_E_UFLOW;
+        goto error;
+      }
+      v->ktype = tok.ktype;
+      v->count = tok.count;
+      if (n > 0 && !(v->v.items = __items(arena, n)))
+        goto nomem;
+      if (n == 0)
+        v->v.items = (glme_node_t *)0;
+      st[depth++] = (struct __vframe){v, v->v.items, (glme_node_t **)0, 0};
+      break;
+    case GLME_T_STRUCT:
+      // columnar array keeps number of rows
+      v->ktype = tok.ktype;
+      v->count = tok.count;
+      v->v.items = (glme_node_t *)0;
+      st[depth++] = (struct __vframe){v, (glme_node_t *)0, &v->v.items, 0};
+      break;
+    }
+    if (depth == 0)
+      goto done;
+  }
+
+ done:
+  *vp = root;
+  return dec->current - __at_start;
+
+ nomem:
+  dec->last_error = t = GLME_E_NOMEM;
+ error:
+  dec->current = __at_start;
+  return t;
+}
+
+glme_node_t *glme_node_field(const glme_node_t *v, unsigned int fno)
+{
+  glme_node_t *c;
+
+  if (v->kind != GLME_T_STRUCT)
+    return (glme_node_t *)0;
+  for (c = v->v.items; c && c->fno <= fno; c = c->next) {
+    if (c->fno == fno)
+      return c;
+  }
+  return (glme_node_t *)0;
+}
+
+// ---------------------------------------------------------------------
+// Node tree encoding
+
+/*
+ * Space for scalar values and container headers is reserved once per node and
+ * written with the unchecked writers of the fast field functions.
+ */
+
+#define __NODE_MAX 40
+
+static
+int __encode_tree(glme_buf_t *enc, const glme_node_t *v, int typed)
+{
+  const glme_node_t *c;
+  int64_t prev;
+  size_t len = v->kind == GLME_T_BYTES ? v->v.s.len : 0;
+  int n;
+  char *p;
+
+  if (glme_buf_reserve(enc, __NODE_MAX + len) < 0)
+    return GLME_E_NOMEM;
+  p = &enc->buf[enc->count];
+
+  if (typed) {
+    switch (v->kind) {
+    case GLME_T_ARRAY:
+      p = glme_put_uint64(p, glme_zigzag(GLME_ARRAY));
+      break;
+    case GLME_T_MAP:
+      p = glme_put_uint64(p, glme_zigzag(GLME_MAP));
+      break;
+    case GLME_T_REF:
+      p = glme_put_uint64(p, glme_zigzag(-(int64_t)v->v.u - 1));
+      break;
+    case GLME_T_STRUCT:
+      if (v->ktype == GLME_COLUMNS) {
+        p = glme_put_uint64(p, glme_zigzag(GLME_COLUMNS));
+        p = glme_put_uint64(p, glme_zigzag(v->typeid));
+        p = glme_put_uint64(p, v->count);
+        break;
+      }
+      p = glme_put_uint64(p, glme_zigzag(v->typeid));
+      break;
+    default:
+      p = glme_put_uint64(p, glme_zigzag(v->typeid));
+      break;
+    }
+  }
+
+  switch (v->kind) {
+  case GLME_T_SCALAR:
+    switch (v->typeid) {
+    case GLME_INT:
+      p = glme_put_uint64(p, glme_zigzag(v->v.i));
+      break;
+    case GLME_FLOAT:
+      p = glme_put_uint64(p, glme_flip_double(v->v.f));
+      break;
+    case GLME_FLOAT32:
+      p = glme_put_uint64(p, glme_flip_float((float)v->v.f));
+      break;
+    case GLME_COMPLEX:
+      p = glme_put_uint64(p, glme_flip_double(creal(v->v.c)));
+      p = glme_put_uint64(p, glme_flip_double(cimag(v->v.c)));
+      break;
+    default:
+      p = glme_put_uint64(p, v->v.u);
+      break;
+    }
+    enc->count = p - enc->buf;
+    return 0;
+
+  case GLME_T_REF:
+    enc->count = p - enc->buf;
+    return 0;
+
+  case GLME_T_BYTES:
+    if (v->typeid == GLME_PACKED) {
+      // elements unaligned
+      p = glme_put_uint64(p, v->ktype);
+      p = glme_put_uint64(p, v->count);
+      *p++ = 0;
+    } else if (v->typeid == GLME_DELTA) {
+      // float array bit stream
+      p = glme_put_uint64(p, glme_zigzag(v->ktype));
+      p = glme_put_uint64(p, 1);
+      p = glme_put_uint64(p, v->count);
+      p = glme_put_uint64(p, len);
+    } else {
+      p = glme_put_uint64(p, len);
+    }
+    memcpy(p, v->v.s.ptr, len);
+    enc->count = p + len - enc->buf;
+    return 0;
+
+  case GLME_T_ARRAY:
+    p = glme_put_uint64(p, glme_zigzag(v->typeid));
+    p = glme_put_uint64(p, v->count);
+    enc->count = p - enc->buf;
+    for (c = v->v.items; c; c = c->next) {
+      if ((n = __encode_tree(enc, c, v->typeid == GLME_ANY)) < 0)
+        return n;
+    }
+    return 0;
+
+  case GLME_T_MAP:
+    p = glme_put_uint64(p, glme_zigzag(v->ktype));
+    p = glme_put_uint64(p, glme_zigzag(v->typeid));
+    p = glme_put_uint64(p, v->count);
+    enc->count = p - enc->buf;
+    for (c = v->v.items; c && c->next; c = c->next->next) {
+      if ((n = __encode_tree(enc, c, v->ktype == GLME_ANY)) < 0)
+        return n;
+      if ((n = __encode_tree(enc, c->next, v->typeid == GLME_ANY)) < 0)
+        return n;
+    }
+    return 0;
+
+  case GLME_T_STRUCT:
+    enc->count = p - enc->buf;
+    prev = -1;
+    for (c = v->v.items; c; c = c->next) {
+      if ((int64_t)c->fno <= prev) {
+        enc->last_error = GLME_E_INVAL;
+        return GLME_E_INVAL;
+      }
+      if (glme_buf_reserve(enc, 10) < 0)
+        return GLME_E_NOMEM;
+      p = glme_put_uint64(&enc->buf[enc->count], (uint64_t)(c->fno - prev));
+      enc->count = p - enc->buf;
+      if ((n = __encode_tree(enc, c, 1)) < 0)
+        return n;
+      prev = c->fno;
+    }
+    if (glme_buf_reserve(enc, 1) < 0)
+      return GLME_E_NOMEM;
+    enc->buf[enc->count++] = 0;
+    return 0;
+  }
+  enc->last_error = GLME_E_INVAL;
+  return GLME_E_INVAL;
+}
+
+int glme_node_encode(glme_buf_t *enc, const glme_node_t *v)
+{
+  uint64_t __at_start = enc->count;
+  int n;
+
+  if ((n = __encode_tree(enc, v, 1)) < 0) {
+    enc->count = __at_start;
+    return n;
+  }
+  return enc->count - __at_start;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,476 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "glme.h"
+#include "packed.h"
+
+/*
+ * Packed arrays of fixed width numbers. Header is element kind, count and
+ * padding length followed by padding bytes; elements follow as little-endian
+ * values. Padding aligns elements to their size from start of buffer data
+ * when encoder asks for it; otherwise padding length is zero. On little-endian
+ * hosts elements are written and read with one copy and can be used in place.
+ *
+ * Boolean arrays are packed as bits, eight per byte with the first element in
+ * the lowest bit. Bits are packed from and unpacked to byte arrays eight at a
+ * time within a 64 bit word.
+ */
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define __NATIVE 0
+#else
+#define __NATIVE 1
+#endif
+
+// type id, kind, count and padding
+#define __HEADER_MAX 20
+
+static inline
+int __kind_valid(int kind)
+{
+  switch (GLME_PACKED_TYPE(kind)) {
+  case GLME_INT:
+  case GLME_UINT:
+    switch (GLME_PACKED_SIZE(kind)) {
+    case 1: case 2: case 4: case 8:
+      return 1;
+    }
+    return 0;
+  case GLME_FLOAT:
+    return GLME_PACKED_SIZE(kind) == 4 || GLME_PACKED_SIZE(kind) == 8;
+  case GLME_BOOLEAN:
+    return GLME_PACKED_SIZE(kind) == 0;
+  }
+  return 0;
+}
+
+void __glme_packed_copy(char *dst, const char *src, size_t count, int size)
+{
+  size_t k;
+  int j;
+
+  if (count == 0)
+    return;
+  if (size == 0) {
+    // bits; unused bits of last byte cleared
+    memcpy(dst, src, (count + 7) / 8);
+    if (count % 8)
+      dst[(count - 1) / 8] &= (1 << count % 8) - 1;
+    return;
+  }
+  if (__NATIVE || size == 1) {
+    memcpy(dst, src, count * size);
+    return;
+  }
+  for (k = 0; k < count; k++, dst += size, src += size)
+    for (j = 0; j < size; j++)
+      dst[j] = src[size - 1 - j];
+}
+
+int __glme_packed_start(glme_buf_t *dec, int *kind, uint64_t *count)
+{
+  uint64_t u, len;
+  int n;
+
+  if ((n = glme_get_uint64(dec, &u)) < 0 || (n = glme_get_uint64(dec, &len)) < 0)
+    return n;
+  if (u > 0xff || !__kind_valid((int)u)) {
+    dec->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  if (dec->current >= dec->count) {
+    dec->last_error = GLME_E_UFLOW;
+    return GLME_E_UFLOW;
+  }
+  // padding length and padding
+  n = (unsigned char)dec->buf[dec->current];
+  if (n > 7) {
+    dec->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+  if (dec->count - dec->current < (size_t)n + 1 ||
+      (GLME_PACKED_SIZE(u) > 0 && len > (dec->count - dec->current - 1 - n) / GLME_PACKED_SIZE(u)) ||
+      __glme_packed_len((int)u, len) > dec->count - dec->current - 1 - n) {
+    dec->last_error = GLME_E_UFLOW;
+    return GLME_E_UFLOW;
+  }
+  dec->current += n + 1;
+  *kind = (int)u;
+  *count = len;
+  return 0;
+}
+
+int glme_encode_packed(glme_buf_t *enc, int kind, const void *ptr, size_t count, int flags)
+{
+  size_t n, pad, size = GLME_PACKED_SIZE(kind);
+  char *p;
+
+  if (!__kind_valid(kind)) {
+    enc->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  if (size > 0 && count > (SIZE_MAX - __HEADER_MAX) / size) {
+    enc->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+  n = __glme_packed_len(kind, count);
+  if (glme_buf_reserve(enc, n + __HEADER_MAX) < 0)
+    return GLME_E_NOMEM;
+  p = &enc->buf[enc->count];
+  *p++ = (char)(GLME_PACKED << 1);
+  *p++ = (char)kind;
+  p = glme_put_uint64(p, count);
+  // elements start after padding length byte and padding
+  pad = (flags & GLME_F_ALIGN) && size > 1 ? (size - (p + 1 - enc->buf) % size) % size : 0;
+  *p++ = (char)pad;
+  memset(p, 0, pad);
+  p += pad;
+  __glme_packed_copy(p, (const char *)ptr, count, size);
+  p += n;
+  n = p - &enc->buf[enc->count];
+  enc->count += n;
+  return (int)n;
+}
+
+int glme_decode_packed(glme_buf_t *dec, int *kind, const void **ptr, size_t *count)
+{
+  uint64_t len, __at_start = dec->current;
+  int n;
+
+  if (dec->current >= dec->count || dec->buf[dec->current] != (char)(GLME_PACKED << 1)) {
+    dec->last_error = dec->current < dec->count ? GLME_E_TYPE : GLME_E_UFLOW;
+    return dec->last_error;
+  }
+  dec->current++;
+  if ((n = __glme_packed_start(dec, kind, &len)) < 0) {
+    dec->current = __at_start;
+    return n;
+  }
+  *ptr = &dec->buf[dec->current];
+  *count = len;
+  dec->current += __glme_packed_len(*kind, len);
+  return dec->current - __at_start;
+}
+
+int glme_decode_packed_copy(glme_buf_t *dec, int kind, void **ptr, size_t *count)
+{
+  uint64_t __at_start = dec->current;
+  const void *data;
+  void *nptr = (void *)0;
+  size_t len;
+  int n, k;
+
+  if ((n = glme_decode_packed(dec, &k, &data, &len)) < 0)
+    return n;
+  if (k != kind) {
+    dec->current = __at_start;
+    dec->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  if (len > 0 && !(nptr = glme_malloc(dec, __glme_packed_len(k, len)))) {
+    dec->current = __at_start;
+    dec->last_error = GLME_E_NOMEM;
+    return GLME_E_NOMEM;
+  }
+  __glme_packed_copy((char *)nptr, (const char *)data, len, GLME_PACKED_SIZE(k));
+  *ptr = nptr;
+  *count = len;
+  return n;
+}
+
+int glme_encode_field_packed(glme_buf_t *enc, int *delta, int kind, int flags,
+                             const void *vptr, size_t nlen)
+{
+  uint64_t __at_start = enc->count;
+
+  if (!vptr || nlen == 0) {
+    // empty array is omitted
+    *delta += 1;
+    return 0;
+  }
+  if (glme_encode_value_uint(enc, (unsigned int *)delta) < 0)
+    return -1;
+  if (glme_encode_packed(enc, kind, vptr, nlen, flags) < 0) {
+    enc->count = __at_start;
+    return -1;
+  }
+  *delta = 1;
+  return enc->count - __at_start;
+}
+
+int glme_decode_field_packed(glme_buf_t *dec, unsigned int *delta, int kind, int flags,
+                             void *vptr, size_t *nlen)
+{
+  uint64_t offset, __at_start = dec->current;
+  const void *data;
+  int n, k;
+
+  if ((n = glme_decode_peek_uint64(dec, &offset)) < 0)
+    return n;
+  if (offset == 0 || *delta == 0) {
+    // end of struct or we have already seen end of struct
+    *delta = 0;
+    return 0;
+  }
+  if (*delta < offset) {
+    *delta += 1;
+    return 0;
+  }
+  dec->current += n;
+  if (!(flags & GLME_F_VIEW)) {
+    if ((n = glme_decode_packed_copy(dec, kind, (void **)vptr, nlen)) < 0) {
+      dec->current = __at_start;
+      return n;
+    }
+    *delta = 1;
+    return dec->current - __at_start;
+  }
+  if ((n = glme_decode_packed(dec, &k, &data, nlen)) < 0) {
+    dec->current = __at_start;
+    return n;
+  }
+  if (k != kind) {
+    dec->current = __at_start;
+    dec->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  if (GLME_PACKED_SIZE(k) > 1 &&
+      (!__NATIVE || ((uintptr_t)data & (GLME_PACKED_SIZE(k) - 1)) != 0)) {
+    // elements not usable in place
+    dec->current = __at_start;
+    dec->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+  *(const void **)vptr = data;
+  *delta = 1;
+  return dec->current - __at_start;
+}
+
+// ---------------------------------------------------------------------
+// Bit arrays
+
+#define __ONES 0x0101010101010101ull
+#define __LOW7 0x7f7f7f7f7f7f7f7full
+
+static inline
+uint64_t __load64(const unsigned char *p)
+{
+  uint64_t x;
+  memcpy(&x, p, sizeof(x));
+  return __NATIVE ? x : __builtin_bswap64(x);
+}
+
+static inline
+void __store64(unsigned char *p, uint64_t x)
+{
+  x = __NATIVE ? x : __builtin_bswap64(x);
+  memcpy(p, &x, sizeof(x));
+}
+
+void glme_pack_bits(void *bits, const void *vptr, size_t len)
+{
+  const unsigned char *v = (const unsigned char *)vptr;
+  unsigned char *b = (unsigned char *)bits;
+  uint64_t x;
+  size_t k;
+  int j;
+
+  for (k = 0; k + 8 <= len; k += 8) {
+    // one in low bit of each nonzero byte, gathered to top byte
+    x = __load64(&v[k]);
+    x = ((((x & __LOW7) + __LOW7) | x) >> 7) & __ONES;
+    b[k/8] = (unsigned char)((x * 0x0102040810204080ull) >> 56);
+  }
+  if (k < len) {
+    b[k/8] = 0;
+    for (j = 0; k + j < len; j++)
+      b[k/8] |= (v[k+j] != 0) << j;
+  }
+}
+
+void glme_unpack_bits(void *vptr, const void *bits, size_t len)
+{
+  const unsigned char *b = (const unsigned char *)bits;
+  unsigned char *v = (unsigned char *)vptr;
+  uint64_t x;
+  size_t k;
+  int j;
+
+  for (k = 0; k + 8 <= len; k += 8) {
+    // bit j of byte to low bit of byte j
+    x = (b[k/8] * __ONES) & 0x8040201008040201ull;
+    __store64(&v[k], (((x + __LOW7) >> 7) & __ONES));
+  }
+  for (j = 0; k + j < len; j++)
+    v[k+j] = (b[k/8] >> j) & 1;
+}
+
+int glme_encode_bits(glme_buf_t *enc, const void *vptr, size_t len)
+{
+  size_t n = len / 8 + (len % 8 != 0);
+  char *p;
+
+  if (n > SIZE_MAX - __HEADER_MAX) {
+    enc->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+  if (glme_buf_reserve(enc, n + __HEADER_MAX) < 0)
+    return GLME_E_NOMEM;
+  p = &enc->buf[enc->count];
+  *p++ = (char)(GLME_PACKED << 1);
+  *p++ = (char)GLME_PACKED_BITS;
+  p = glme_put_uint64(p, len);
+  *p++ = 0;
+  glme_pack_bits(p, vptr, len);
+  p += n;
+  n = p - &enc->buf[enc->count];
+  enc->count += n;
+  return (int)n;
+}
+
+int glme_decode_bits(glme_buf_t *dec, void **dst, size_t *len)
+{
+  uint64_t k, u, alen, __at_start = dec->current;
+  unsigned char *ptr = (unsigned char *)*dst;
+  const void *data = (const void *)0;
+  size_t count;
+  int n, kind, typeid;
+
+  if (dec->current >= dec->count) {
+    dec->last_error = GLME_E_UFLOW;
+    return GLME_E_UFLOW;
+  }
+  if (dec->buf[dec->current] == (char)(GLME_PACKED << 1)) {
+    if ((n = glme_decode_packed(dec, &kind, &data, &count)) < 0)
+      return n;
+    alen = count;
+    n = GLME_E_TYPE;
+    if (kind != GLME_PACKED_BITS)
+      goto error;
+  } else {
+    // plain array of booleans
+    n = GLME_E_TYPE;
+    if (dec->buf[dec->current] != (char)(GLME_ARRAY << 1))
+      goto error;
+    dec->current++;
+    n = GLME_E_UFLOW;
+    if (glme_decode_type(dec, &typeid) < 0 || glme_get_uint64(dec, &alen) < 0)
+      goto error;
+    if (alen > dec->count - dec->current)
+      goto error;
+    n = GLME_E_TYPE;
+    if (typeid != GLME_BOOLEAN)
+      goto error;
+  }
+  n = GLME_E_OFLOW;
+  if (ptr && *len < alen)
+    goto error;
+  n = GLME_E_NOMEM;
+  if (!ptr && alen > 0 && !(ptr = (unsigned char *)glme_malloc(dec, alen)))
+    goto error;
+
+  if (data) {
+    glme_unpack_bits(ptr, data, alen);
+  } else {
+    for (k = 0; k < alen; k++) {
+      if ((n = glme_get_uint64(dec, &u)) < 0) {
+        if (!*dst)
+          glme_free(dec, ptr);
+        goto error;
+      }
+      ptr[k] = u != 0;
+    }
+  }
+  *dst = ptr;
+  *len = alen;
+  return dec->current - __at_start;
+
+ error:
+  dec->current = __at_start;
+  dec->last_error = n;
+  return n;
+}
+
+int glme_encode_field_bits(glme_buf_t *enc, int *delta, const void *vptr, size_t nlen)
+{
+  uint64_t __at_start = enc->count;
+
+  if (!vptr || nlen == 0) {
+    // empty array is omitted
+    *delta += 1;
+    return 0;
+  }
+  if (glme_encode_value_uint(enc, (unsigned int *)delta) < 0)
+    return -1;
+  if (glme_encode_bits(enc, vptr, nlen) < 0) {
+    enc->count = __at_start;
+    return -1;
+  }
+  *delta = 1;
+  return enc->count - __at_start;
+}
+
+int glme_decode_field_bits(glme_buf_t *dec, unsigned int *delta, void *vptr, size_t *nlen)
+{
+  uint64_t offset, __at_start = dec->current;
+  size_t len = *nlen;
+  int n;
+
+  if ((n = glme_decode_peek_uint64(dec, &offset)) < 0)
+    return n;
+  if (offset == 0 || *delta == 0) {
+    // end of struct or we have already seen end of struct
+    *delta = 0;
+    return 0;
+  }
+  if (*delta < offset) {
+    *delta += 1;
+    return 0;
+  }
+  dec->current += n;
+  if (len == 0)
+    // allocated array
+    *(void **)vptr = (void *)0;
+  if ((n = glme_decode_bits(dec, (void **)vptr, &len)) < 0) {
+    dec->current = __at_start;
+    return n;
+  }
+  *nlen = len;
+  *delta = 1;
+  return dec->current - __at_start;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
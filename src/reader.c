@@ -0,0 +1,356 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "gobber.h"
+#include "glme.h"
+#include "packed.h"
+#include "delta.h"
+
+/*
+ * Pull parser. Reader keeps a stack of open structures, arrays and maps and
+ * returns one token per call. Every varint is decoded once, values of strings
+ * and vectors are returned as views to the buffer and nothing is allocated.
+ *
+ * A token is read completely before reader state is changed; on error the read
+ * pointer is left at the start of the token and reading can be retried, e.g.
+ * after more input has been appended to the buffer.
+ */
+
+static inline
+int __error(glme_buf_t *dec, uint64_t at, int err)
+{
+  dec->current = at;
+  dec->last_error = err;
+  return err;
+}
+
+static inline
+int __push(glme_reader_t *rd, int kind, int typeid, int ktype, uint64_t count)
+{
+  if (rd->depth == GLME_READER_DEPTH)
+    return GLME_E_OFLOW;
+  rd->stack[rd->depth++] = (struct glme_rframe_s){kind, typeid, ktype, 0, 0, count};
+  return 0;
+}
+
+// read unsigned value; zero if truncated, negative if malformed
+static inline
+int __get_uint(glme_buf_t *dec, uint64_t *v)
+{
+  const unsigned char *p = (const unsigned char *)&dec->buf[dec->current];
+  size_t avail = dec->count - dec->current;
+  uint64_t u = 0;
+  int k, nb;
+
+  if (avail == 0)
+    return 0;
+  if (p[0] < 0x80) {
+    *v = p[0];
+    dec->current++;
+    return 1;
+  }
+  if ((nb = 256 - p[0]) > 8)
+    return GLME_E_INVAL;
+  if (avail <= (size_t)nb)
+    return 0;
+  for (k = 1; k <= nb; k++)
+    u = (u << 8) | p[k];
+  *v = u;
+  dec->current += nb + 1;
+  return nb + 1;
+}
+
+static inline
+int __get_type(glme_buf_t *dec, int *typeid)
+{
+  uint64_t u = 0;
+  int n = __get_uint(dec, &u);
+  *typeid = (int)glme_unzigzag(u);
+  return n;
+}
+
+// error of failed read
+#define __EREAD(n) ((n) < 0 ? (n) : GLME_E_UFLOW)
+
+// read value of typeid; type id itself is already read
+static
+int __read_value(glme_reader_t *rd, glme_token_t *tok, int typeid, uint64_t at)
+{
+  glme_buf_t *dec = rd->dec;
+  uint64_t u, len;
+  int n, ktype;
+
+  tok->typeid = typeid;
+  if (typeid < 0) {
+    tok->v.u = (uint64_t)(-(int64_t)typeid - 1);
+    return tok->kind = GLME_T_REF;
+  }
+
+  switch (typeid) {
+  case GLME_BOOLEAN:
+  case GLME_UINT:
+    if ((n = __get_uint(dec, &tok->v.u)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    return tok->kind = GLME_T_SCALAR;
+
+  case GLME_INT:
+    if ((n = __get_uint(dec, &u)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    tok->v.i = glme_unzigzag(u);
+    return tok->kind = GLME_T_SCALAR;
+
+  case GLME_FLOAT:
+    if ((n = __get_uint(dec, &u)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    tok->v.f = glme_unflip_double(u);
+    return tok->kind = GLME_T_SCALAR;
+
+  case GLME_FLOAT32:
+    if ((n = __get_uint(dec, &u)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    tok->v.f = glme_unflip_float(u);
+    return tok->kind = GLME_T_SCALAR;
+
+  case GLME_COMPLEX:
+    if ((n = __get_uint(dec, &u)) <= 0 || (n = __get_uint(dec, &len)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    tok->v.c = glme_unflip_double(u) + glme_unflip_double(len) * I;
+    return tok->kind = GLME_T_SCALAR;
+
+  case GLME_VECTOR:
+  case GLME_STRING:
+    if ((n = __get_uint(dec, &len)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    if (len > dec->count - dec->current)
+      return __error(dec, at, GLME_E_UFLOW);
+    tok->v.s.ptr = &dec->buf[dec->current];
+    tok->v.s.len = len;
+    dec->current += len;
+    return tok->kind = GLME_T_BYTES;
+
+  case GLME_PACKED:
+    if ((n = __glme_packed_start(dec, &tok->ktype, &tok->count)) < 0)
+      return __error(dec, at, n);
+    tok->v.s.ptr = &dec->buf[dec->current];
+    tok->v.s.len = __glme_packed_len(tok->ktype, tok->count);
+    dec->current += tok->v.s.len;
+    return tok->kind = GLME_T_BYTES;
+
+  case GLME_ARRAY:
+    if ((n = __get_type(dec, &tok->typeid)) <= 0 || (n = __get_uint(dec, &tok->count)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    // elements have no references; every element takes at least one byte
+    if (tok->typeid < 0)
+      return __error(dec, at, GLME_E_TYPE);
+    if (tok->count > dec->count - dec->current)
+      return __error(dec, at, GLME_E_UFLOW);
+    if ((n = __push(rd, GLME_T_ARRAY, tok->typeid, 0, tok->count)) < 0)
+      return __error(dec, at, n);
+    return tok->kind = GLME_T_ARRAY;
+
+  case GLME_DELTA:
+    if ((n = __glme_delta_header(dec, &tok->typeid, &ktype, &tok->count, &len)) < 0)
+      return __error(dec, at, n);
+    if (tok->typeid == GLME_FLOAT) {
+      // XOR bit stream as is
+      tok->ktype = tok->typeid;
+      tok->typeid = GLME_DELTA;
+      tok->v.s.ptr = &dec->buf[dec->current];
+      tok->v.s.len = len;
+      dec->current += len;
+      return tok->kind = GLME_T_BYTES;
+    }
+    if ((n = __push(rd, GLME_T_ARRAY, tok->typeid, 0, tok->count)) < 0)
+      return __error(dec, at, n);
+    rd->stack[rd->depth-1].order = ktype;
+    return tok->kind = GLME_T_ARRAY;
+
+  case GLME_MAP:
+    if ((n = __get_type(dec, &ktype)) <= 0 || (n = __get_type(dec, &tok->typeid)) <= 0 ||
+        (n = __get_uint(dec, &tok->count)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    if (ktype < 0 || tok->typeid < 0)
+      return __error(dec, at, GLME_E_TYPE);
+    if (tok->count > (dec->count - dec->current) / 2)
+      return __error(dec, at, GLME_E_UFLOW);
+    tok->ktype = ktype;
+    if ((n = __push(rd, GLME_T_MAP, tok->typeid, ktype, tok->count)) < 0)
+      return __error(dec, at, n);
+    return tok->kind = GLME_T_MAP;
+
+  case GLME_COLUMNS:
+    // structure of column fields
+    if ((n = __get_type(dec, &tok->typeid)) <= 0 || (n = __get_uint(dec, &tok->count)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    if (tok->typeid <= GLME_BASE_MAX)
+      return __error(dec, at, GLME_E_TYPE);
+    if ((n = __push(rd, GLME_T_STRUCT, tok->typeid, GLME_COLUMNS, tok->count)) < 0)
+      return __error(dec, at, n);
+    tok->ktype = GLME_COLUMNS;
+    return tok->kind = GLME_T_STRUCT;
+  }
+
+  if (typeid <= GLME_BASE_MAX)
+    return __error(dec, at, GLME_E_TYPE);
+  if ((n = __push(rd, GLME_T_STRUCT, typeid, 0, 0)) < 0)
+    return __error(dec, at, n);
+  tok->ktype = 0;
+  tok->count = 0;
+  return tok->kind = GLME_T_STRUCT;
+}
+
+// read delta array element; value from previous element and difference
+static
+int __read_delta(glme_reader_t *rd, struct glme_rframe_s *f, glme_token_t *tok, uint64_t at)
+{
+  uint64_t u, d;
+  int n;
+
+  if ((n = __get_uint(rd->dec, &u)) <= 0)
+    return __error(rd->dec, at, __EREAD(n));
+  d = (uint64_t)glme_unzigzag(u);
+  if (f->order == 2 && f->fno > 0) {
+    f->step += d;
+    f->last += f->step;
+  } else {
+    // first value; difference to it for order one
+    f->last += d;
+  }
+  // element index in fno
+  f->fno++;
+  f->count--;
+  tok->typeid = f->typeid;
+  tok->v.u = f->last;
+  return tok->kind = GLME_T_SCALAR;
+}
+
+// read element with its own type id
+static inline
+int __read_element(glme_reader_t *rd, glme_token_t *tok, uint64_t at)
+{
+  int n, typeid;
+
+  if ((n = __get_type(rd->dec, &typeid)) <= 0)
+    return __error(rd->dec, at, __EREAD(n));
+  return __read_value(rd, tok, typeid, at);
+}
+
+int glme_reader_next(glme_reader_t *rd, glme_token_t *tok)
+{
+  glme_buf_t *dec = rd->dec;
+  struct glme_rframe_s *f;
+  uint64_t delta, at = dec->current;
+  int n;
+
+  if (rd->depth == 0) {
+    if (dec->current >= dec->count)
+      return tok->kind = GLME_T_EOF;
+    return __read_element(rd, tok, at);
+  }
+
+  f = &rd->stack[rd->depth-1];
+  switch (f->kind) {
+  case GLME_T_STRUCT:
+    if (f->value) {
+      if ((n = __read_element(rd, tok, at)) < 0)
+        return n;
+      f->value = 0;
+      return n;
+    }
+    if ((n = __get_uint(dec, &delta)) <= 0)
+      return __error(dec, at, __EREAD(n));
+    if (delta == 0) {
+      tok->typeid = f->typeid;
+      rd->depth--;
+      return tok->kind = GLME_T_STRUCT_END;
+    }
+    f->fno += delta;
+    f->value = 1;
+    tok->delta = delta;
+    tok->fno = f->fno - 1;
+    return tok->kind = GLME_T_FIELD;
+
+  case GLME_T_ARRAY:
+    if (f->count == 0) {
+      tok->typeid = f->typeid;
+      rd->depth--;
+      return tok->kind = GLME_T_ARRAY_END;
+    }
+    if (f->order)
+      return __read_delta(rd, f, tok, at);
+    n = f->typeid == GLME_ANY
+      ? __read_element(rd, tok, at) : __read_value(rd, tok, f->typeid, at);
+    if (n < 0)
+      return n;
+    f->count--;
+    return n;
+
+  case GLME_T_MAP:
+    if (!f->value) {
+      if (f->count == 0) {
+        tok->typeid = f->typeid;
+        rd->depth--;
+        return tok->kind = GLME_T_MAP_END;
+      }
+      if ((n = __read_value(rd, tok, f->ktype, at)) < 0)
+        return n;
+      f->value = 1;
+      return n;
+    }
+    n = f->typeid == GLME_ANY
+      ? __read_element(rd, tok, at) : __read_value(rd, tok, f->typeid, at);
+    if (n < 0)
+      return n;
+    f->value = 0;
+    f->count--;
+    return n;
+  }
+  return __error(dec, at, GLME_E_INVAL);
+}
+
+int glme_reader_skip(glme_reader_t *rd)
+{
+  glme_token_t tok;
+  int n, depth = rd->depth;
+
+  while (rd->depth >= depth && depth > 0) {
+    if ((n = glme_reader_next(rd, &tok)) < 0)
+      return n;
+  }
+  return 0;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
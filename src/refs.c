@@ -0,0 +1,184 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "gobber.h"
+#include "glme.h"
+#include "refs.h"
+
+/*
+ * Object identity tables. Every structure encoded through a structure field
+ * or as top level structure gets the next sequence number, in encoding order
+ * before its fields. Decoder numbers structures at the same points, so both
+ * sides agree on the numbers without sending them. A structure reached again
+ * is written as a back-reference: type id is replaced by -(id+1), which never
+ * equals a valid type id.
+ *
+ * Encoder keeps an open addressing hash table from (pointer, typeid) to number;
+ * typeid is part of the key as a structure and its first member share address.
+ * Decoder keeps structures in an array indexed by number.
+ *
+ * Active tables are linked to a thread local list; buffer selects the table.
+ */
+
+__thread glme_refs_t *__glme_refs;
+
+int glme_refs_begin(glme_buf_t *gbuf, glme_refs_t *refs)
+{
+  *refs = (glme_refs_t){gbuf, __glme_refs, 0, 0, (struct glme_ref_s *)0};
+  __glme_refs = refs;
+  return 0;
+}
+
+void glme_refs_end(glme_buf_t *gbuf, glme_refs_t *refs)
+{
+  glme_refs_t **rp;
+
+  for (rp = &__glme_refs; *rp; rp = &(*rp)->outer) {
+    if (*rp == refs) {
+      *rp = refs->outer;
+      break;
+    }
+  }
+  if (refs->table)
+    glme_free(gbuf, refs->table);
+  *refs = (glme_refs_t){(glme_buf_t *)0, (glme_refs_t *)0, 0, 0, (struct glme_ref_s *)0};
+}
+
+static inline
+size_t __hash(const void *ptr, int typeid)
+{
+  uint64_t h = ((uintptr_t)ptr >> 3) ^ ((uint64_t)(unsigned int)typeid << 32);
+  h *= 0x9E3779B97F4A7C15ull;
+  return (size_t)(h >> 20);
+}
+
+// find slot of key or empty slot where it goes
+static inline
+struct glme_ref_s *__slot(glme_refs_t *r, const void *ptr, int typeid)
+{
+  size_t k, mask = r->size - 1;
+  struct glme_ref_s *e;
+
+  for (k = __hash(ptr, typeid) & mask; ; k = (k + 1) & mask) {
+    e = &r->table[k];
+    if (!e->ptr || (e->ptr == ptr && e->typeid == typeid))
+      return e;
+  }
+}
+
+static
+int __grow_hash(glme_buf_t *gb, glme_refs_t *r)
+{
+  struct glme_ref_s *old = r->table, *e;
+  size_t k, osize = r->size;
+
+  r->size = osize ? 2*osize : 64;
+  r->table = (struct glme_ref_s *)glme_calloc(gb, r->size, sizeof(struct glme_ref_s));
+  if (!r->table) {
+    r->table = old;
+    r->size = osize;
+    gb->last_error = GLME_E_NOMEM;
+    return GLME_E_NOMEM;
+  }
+  for (k = 0; k < osize; k++) {
+    if (old[k].ptr) {
+      e = __slot(r, old[k].ptr, old[k].typeid);
+      *e = old[k];
+    }
+  }
+  if (old)
+    glme_free(gb, old);
+  return 0;
+}
+
+int __glme_refs_put(glme_buf_t *enc, glme_refs_t *r, const void *ptr, int typeid, int noref)
+{
+  struct glme_ref_s *e;
+  int64_t ref;
+
+  if (2*(r->count + 1) > r->size && __grow_hash(enc, r) < 0)
+    return GLME_E_NOMEM;
+
+  e = __slot(r, ptr, typeid);
+  if (e->ptr && !noref) {
+    // seen before; back-reference in place of type id
+    ref = -(int64_t)e->id - 1;
+    if (glme_encode_value_int64(enc, &ref) < 0)
+      return -1;
+    return 1;
+  }
+  *e = (struct glme_ref_s){ptr, typeid, r->count++};
+  return 0;
+}
+
+int __glme_refs_add(glme_buf_t *dec, glme_refs_t *r, void *ptr, int typeid)
+{
+  struct glme_ref_s *t;
+  size_t size;
+
+  if (r->count == r->size) {
+    size = r->size ? 2*r->size : 64;
+    t = (struct glme_ref_s *)glme_realloc(dec, r->table, size * sizeof(struct glme_ref_s));
+    if (!t) {
+      dec->last_error = GLME_E_NOMEM;
+      return GLME_E_NOMEM;
+    }
+    r->table = t;
+    r->size = size;
+  }
+  r->table[r->count] = (struct glme_ref_s){ptr, typeid, r->count};
+  r->count++;
+  return 0;
+}
+
+int __glme_refs_get(glme_buf_t *dec, int ref, int typeid, void **pp)
+{
+  glme_refs_t *r = __glme_refs_of(dec);
+  uint64_t id = (uint64_t)(-(int64_t)ref - 1);
+
+  if (!r || ref >= 0 || id >= r->count) {
+    dec->last_error = GLME_E_INVAL;
+    return GLME_E_INVAL;
+  }
+  if (typeid != 0 && r->table[id].typeid != typeid) {
+    dec->last_error = GLME_E_TYPE;
+    return GLME_E_TYPE;
+  }
+  *pp = (void *)r->table[id].ptr;
+  return 0;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "glme.h"
+
+/*
+ * Segmented input. Element at read position is located with glme_skip over
+ * the rest of the current segment; when it is complete there the decode
+ * buffer is pointed to it and decoders run at full speed on contiguous
+ * memory. Otherwise bytes from read position onwards are gathered to
+ * scratch space in doubling steps until glme_skip finds the element
+ * complete, so an element straddling boundaries is copied about once no
+ * matter how small the segments are.
+ */
+
+// step read position n bytes forward; empty segments are passed
+static
+void __advance(glme_segbuf_t *sb, size_t n)
+{
+  size_t left;
+
+  sb->offset += n;
+  while (sb->seg < sb->iovcnt) {
+    left = sb->iov[sb->seg].iov_len - sb->off;
+    if (n < left) {
+      sb->off += n;
+      return;
+    }
+    n -= left;
+    sb->seg++;
+    sb->off = 0;
+  }
+}
+
+// copy at most len bytes from skip bytes past read position; returns count
+static
+size_t __gather(const glme_segbuf_t *sb, size_t skip, char *dst, size_t len)
+{
+  size_t off = sb->off, left, n = 0, k;
+  int seg;
+
+  for (seg = sb->seg; seg < sb->iovcnt && n < len; seg++, off = 0) {
+    left = sb->iov[seg].iov_len - off;
+    if (skip >= left) {
+      skip -= left;
+      continue;
+    }
+    off += skip;
+    left -= skip;
+    skip = 0;
+    k = left < len - n ? left : len - n;
+    memcpy(&dst[n], (const char *)sb->iov[seg].iov_base + off, k);
+    n += k;
+  }
+  return n;
+}
+
+int glme_segbuf_next(glme_segbuf_t *sb, glme_buf_t *dec)
+{
+  const struct iovec *v;
+  size_t have, want, left;
+  char *p;
+  int n;
+
+  __advance(sb, sb->pending);
+  sb->pending = 0;
+  sb->copied = 0;
+  if (sb->seg >= sb->iovcnt) {
+    glme_buf_make(dec, (char *)0, 0, 0);
+    return 0;
+  }
+
+  // element within current segment
+  v = &sb->iov[sb->seg];
+  left = v->iov_len - sb->off;
+  glme_buf_make(dec, (char *)v->iov_base + sb->off, left, left);
+  if ((n = glme_skip(dec)) >= 0)
+    goto found;
+  if (dec->last_error != GLME_E_UFLOW)
+    return n;
+
+  // straddles boundary; gather until complete
+  have = 0;
+  want = left < 32 ? 64 : 2*left;
+  for (;;) {
+    if (want > sb->size) {
+      if (!(p = (char *)glme_realloc(dec, sb->scratch, want))) {
+        dec->last_error = GLME_E_NOMEM;
+        return GLME_E_NOMEM;
+      }
+      sb->scratch = p;
+      sb->size = want;
+    }
+    if ((left = __gather(sb, have, &sb->scratch[have], want - have)) == 0) {
+      dec->last_error = GLME_E_UFLOW;
+      return GLME_E_UFLOW;
+    }
+    have += left;
+    glme_buf_make(dec, sb->scratch, sb->size, have);
+    if ((n = glme_skip(dec)) >= 0) {
+      sb->copied = 1;
+      goto found;
+    }
+    if (dec->last_error != GLME_E_UFLOW)
+      return n;
+    want *= 2;
+  }
+
+found:
+  dec->count = n;
+  dec->current = 0;
+  sb->pending = n;
+  return n;
+}
+
+void glme_segbuf_release(glme_buf_t *dec, glme_segbuf_t *sb)
+{
+  if (sb->scratch)
+    glme_free(dec, sb->scratch);
+  sb->scratch = (char *)0;
+  sb->size = 0;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
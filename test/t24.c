@@ -0,0 +1,118 @@
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "glme.h"
+
+// Shared handler base with concurrent decoders and registering writer.
+
+#define NTHREADS 4
+#define NROUNDS  2000
+
+struct point
+{
+  int x;
+  int y;
+};
+
+int encode_point(glme_buf_t *enc, const void *ptr)
+{
+  const struct point *p = (const struct point *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_INT(enc, p->x, 0);
+  GLME_ENCODE_FLD_INT(enc, p->y, 0);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int decode_point(glme_buf_t *dec, void *ptr)
+{
+  struct point *p = (struct point *)ptr;
+  GLME_DECODE_STDDEF(dec);
+  GLME_DECODE_STRUCT_START(dec);
+  GLME_DECODE_FLD_INT(dec, p->x, 0);
+  GLME_DECODE_FLD_INT(dec, p->y, 0);
+  GLME_DECODE_STRUCT_END(dec);
+  GLME_DECODE_RETURN(dec);
+}
+
+glme_base_t base;
+glme_buf_t encoded;
+int done = 0;
+
+void *reader(void *arg)
+{
+  glme_buf_t dec;
+  struct point pt, *pp;
+  glme_decoder_f dfunc;
+  int n, count = 0;
+
+  while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE) || count < NROUNDS) {
+    glme_buf_make(&dec, glme_buf_data(&encoded), glme_buf_size(&encoded), glme_buf_len(&encoded));
+    dec.base = &base;
+    dec.user = (void *)0;
+    dec.last_error = 0;
+    dfunc = glme_get_decoder(&dec, 32);
+    assert(dfunc == decode_point);
+    pp = &pt;
+    n = glme_decode_struct(&dec, 32, (void **)&pp, 0, dfunc);
+    assert(n == glme_buf_len(&encoded));
+    assert(pt.x == 3 && pt.y == -4);
+    count++;
+  }
+  return (void *)0;
+}
+
+main(int argc, char *argv)
+{
+  pthread_t threads[NTHREADS];
+  glme_spec_t spec, specs[] = {
+    (glme_spec_t){ 32, sizeof(struct point), encode_point, decode_point }
+  };
+  struct point pt = (struct point){3, -4};
+  int i, k;
+
+  assert(glme_base_init_shared(&base, specs, 1, (glme_allocator_t *)0) == 0);
+  assert(glme_base_find(&base, 32) != 0);
+  assert(glme_base_find(&base, 33) == 0);
+
+  glme_buf_init(&encoded, 64);
+  encoded.base = &base;
+  glme_encode_struct(&encoded, 32, &pt, (glme_encoder_f)0);
+
+  for (i = 0; i < NTHREADS; i++)
+    pthread_create(&threads[i], NULL, reader, (void *)0);
+
+  // writer registers and unregisters other types while readers decode
+  for (k = 0; k < NROUNDS; k++) {
+    glme_spec_init(&spec, 33 + (k % 16), encode_point, decode_point, sizeof(struct point));
+    assert(glme_base_register(&base, &spec) >= 0);
+    if (k % 3 == 0)
+      glme_base_unregister(&base, 33 + ((k/3) % 16));
+  }
+  __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+  for (i = 0; i < NTHREADS; i++)
+    pthread_join(threads[i], NULL);
+
+  // readers finished; safe to release replaced tables
+  assert(glme_base_reclaim(&base) > 0);
+  assert(glme_base_reclaim(&base) == 0);
+
+  // replace existing handler
+  glme_spec_init(&spec, 32, encode_point, (glme_decoder_f)0, sizeof(struct point));
+  glme_base_register(&base, &spec);
+  assert(glme_base_find(&base, 32)->decoder == (glme_decoder_f)0);
+  glme_base_unregister(&base, 32);
+  assert(glme_base_find(&base, 32) == 0);
+
+  glme_base_release(&base);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,198 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Typeid dispatching of message stream
+
+struct point
+{
+  int x;
+  int y;
+};
+
+struct value
+{
+  double v;
+  unsigned int vec[3];
+};
+
+int encode_point(glme_buf_t *enc, const void *ptr)
+{
+  const struct point *p = (const struct point *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_INT(enc, p->x, 0);
+  GLME_ENCODE_FLD_INT(enc, p->y, 0);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int decode_point(glme_buf_t *dec, void *ptr)
+{
+  struct point *p = (struct point *)ptr;
+  GLME_DECODE_STDDEF(dec);
+  GLME_DECODE_STRUCT_START(dec);
+  GLME_DECODE_FLD_INT(dec, p->x, 0);
+  GLME_DECODE_FLD_INT(dec, p->y, 0);
+  GLME_DECODE_STRUCT_END(dec);
+  GLME_DECODE_RETURN(dec);
+}
+
+int encode_value(glme_buf_t *enc, const void *ptr)
+{
+  const struct value *p = (const struct value *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->v, 0.0);
+  GLME_ENCODE_FLD_UINT_VECTOR(enc, p->vec, glme_encode_value_uint);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int decode_value(glme_buf_t *dec, void *ptr)
+{
+  struct value *p = (struct value *)ptr;
+  GLME_DECODE_STDDEF(dec);
+  GLME_DECODE_STRUCT_START(dec);
+  GLME_DECODE_FLD_DOUBLE(dec, p->v, 0.0);
+  GLME_DECODE_FLD_UINT_VECTOR(dec, p->vec, glme_decode_value_uint);
+  GLME_DECODE_STRUCT_END(dec);
+  GLME_DECODE_RETURN(dec);
+}
+
+int npoints = 0, nvalues = 0;
+struct point slot;
+
+int on_point(glme_dispatch_t *d, int typeid, void *msg, void *user)
+{
+  struct point *p = (struct point *)msg;
+  assert(typeid == 32 && p == &slot);
+  assert(p->x == npoints % 10 && p->y == -(npoints % 10));
+  npoints++;
+  return 0;
+}
+
+void *point_alloc(glme_dispatch_t *d, int typeid, size_t size, void *user)
+{
+  assert(size == sizeof(struct point));
+  return &slot;
+}
+
+int on_value(glme_dispatch_t *d, int typeid, void *msg, void *user)
+{
+  struct value *p = (struct value *)msg;
+  assert(typeid == 33);
+  assert(p->v == 1.5 && p->vec[2] == 7);
+  nvalues++;
+  free(msg);
+  return *(int *)user;
+}
+
+int nalloc = 0, nfree = 0;
+
+void *pool_alloc(glme_dispatch_t *d, int typeid, size_t size, void *user)
+{
+  nalloc++;
+  return calloc(1, size);
+}
+
+void pool_release(glme_dispatch_t *d, int typeid, void *msg, void *user)
+{
+  nfree++;
+  free(msg);
+}
+
+int on_pooled(glme_dispatch_t *d, int typeid, void *msg, void *user)
+{
+  pool_release(d, typeid, msg, user);
+  return 0;
+}
+
+main(int argc, char *argv)
+{
+  glme_buf_t gbuf;
+  glme_dispatch_t disp;
+  struct point pt;
+  struct value val = (struct value){1.5, {0, 6, 7}};
+  int k, n, stop = 0, pipefd[2];
+
+  glme_buf_init(&gbuf, 1024);
+  for (k = 0; k < 10; k++) {
+    pt = (struct point){k, -k};
+    glme_encode_struct(&gbuf, 32, &pt, encode_point);
+    glme_encode_struct(&gbuf, 33, &val, encode_value);
+    // nobody listens to this
+    glme_encode_struct(&gbuf, 34, &val, encode_value);
+  }
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  glme_dispatch_init(&disp, 1, GLME_DISPATCH_NONE);
+  glme_dispatch_subscribe(&disp, 32, sizeof(struct point), decode_point, on_point,
+                          point_alloc, (void *)0);
+  glme_dispatch_subscribe(&disp, 33, sizeof(struct value), decode_value, on_value,
+                          (glme_destalloc_f)0, &stop);
+  // more routes than initial table size
+  for (k = 100; k < 140; k++)
+    glme_dispatch_subscribe(&disp, k, 8, decode_point, on_point, point_alloc, (void *)0);
+  for (k = 100; k < 140; k++)
+    glme_dispatch_unsubscribe(&disp, k);
+  assert(disp.nelem == 2);
+  assert(glme_dispatch_find(&disp, 32) && glme_dispatch_find(&disp, 33));
+  assert(glme_dispatch_find(&disp, 34) == 0);
+
+  // unsubscribed typeid fails without skip flag
+  n = glme_dispatch_buf(&disp, &gbuf);
+  assert(n == GLME_E_NODEC && npoints == 1 && nvalues == 1);
+
+  disp.flags |= GLME_DISPATCH_SKIP;
+  glme_buf_reset(&gbuf);
+  npoints = nvalues = 0;
+  disp.ndispatched = 0;
+  n = glme_dispatch_buf(&disp, &gbuf);
+  assert(n == 20 && npoints == 10 && nvalues == 10 && disp.nskipped == 10);
+
+  // handler can stop the loop
+  glme_buf_reset(&gbuf);
+  npoints = nvalues = 0;
+  stop = -100;
+  assert(glme_dispatch_buf(&disp, &gbuf) == -100 && npoints == 1);
+  stop = 0;
+
+  // messages from file descriptor
+  glme_buf_reset(&gbuf);
+  pipe(pipefd);
+  for (k = 0; k < 3; k++)
+    glme_buf_writem(&gbuf, pipefd[1]);
+  close(pipefd[1]);
+  npoints = nvalues = 0;
+  glme_buf_t dec;
+  glme_buf_init(&dec, 16);
+  n = glme_dispatch_fd(&disp, &dec, pipefd[0], 1 << 20);
+  assert(n == 60 && npoints == 30);
+
+  // destination of failed decode goes back to route allocator
+  glme_buf_clear(&gbuf);
+  pt = (struct point){1, 2};
+  glme_encode_struct(&gbuf, 32, &pt, encode_point);
+  glme_encode_struct(&gbuf, 32, &val, encode_value);
+  glme_dispatch_subscribe(&disp, 32, sizeof(struct point), decode_point, on_pooled,
+                          pool_alloc, (void *)0);
+  assert(glme_dispatch_set_release(&disp, 32, pool_release) == 0);
+  assert(glme_dispatch_set_release(&disp, 35, pool_release) == GLME_E_INVAL);
+  assert(glme_dispatch_buf(&disp, &gbuf) < 0);
+  assert(nalloc == 2 && nfree == 2);
+
+  glme_dispatch_release(&disp);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,195 @@
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include "glme.h"
+
+// Structures decoded with field descriptor tables
+
+struct other
+{
+  unsigned int u;
+  int i;
+};
+
+int encode_struct_other(glme_buf_t *enc, const void *ptr)
+{
+  const struct other *p = (const struct other *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_UINT(enc, p->u, 0);
+  GLME_ENCODE_FLD_INT(enc, p->i, 0);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+struct test
+{
+  int a;
+  double b;
+  char vec[4];
+  char *s;
+  unsigned int uvec[3];
+  size_t ilen;
+  int *iv;
+  struct other other;
+  struct other *optr;
+  short h;
+  float f;
+  unsigned int olen;
+  struct other *ov;
+};
+
+int encode_struct_test(glme_buf_t *enc, const void *ptr)
+{
+  const struct test *p = (const struct test *)ptr;
+  int k;
+
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+
+  GLME_ENCODE_FLD_INT(enc, p->a, 0);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->b, 0.0);
+  GLME_ENCODE_FLD_VECTOR(enc, p->vec, sizeof(p->vec));
+  GLME_ENCODE_FLD_STRING(enc, p->s);
+  GLME_ENCODE_FLD_UINT_VECTOR(enc, p->uvec, glme_encode_value_uint);
+  GLME_ENCODE_FLD_INT_ARRAY(enc, p->iv, p->ilen, glme_encode_value_int);
+  GLME_ENCODE_FLD_STRUCT(enc, 33, &p->other, encode_struct_other);
+  GLME_ENCODE_FLD_STRUCT(enc, 33, p->optr, encode_struct_other);
+  GLME_ENCODE_FLD_INT(enc, p->h, 0);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->f, 0.0);
+
+  GLME_ENCODE_FLD_START_ARRAY(enc, ov, 33, p->olen);
+  for (k = 0; k < p->olen; k++) {
+    if ((__e = encode_struct_other(enc, &p->ov[k])) < 0)
+      return __e;
+  }
+  GLME_ENCODE_FLD_END_ARRAY(enc, ov);
+
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+glme_field_t other_fields[] = {
+  GLME_FIELD_UINT(struct other, u, 0),
+  GLME_FIELD_INT(struct other, i, -1)
+};
+glme_desc_t other_desc = GLME_DESC(33, struct other, other_fields);
+
+glme_field_t test_fields[] = {
+  GLME_FIELD_INT(struct test, a, 0),
+  GLME_FIELD_DOUBLE(struct test, b, 0.0),
+  GLME_FIELD_VECTOR(struct test, vec),
+  GLME_FIELD_STRING(struct test, s),
+  GLME_FIELD_UINT_VECTOR(struct test, uvec),
+  GLME_FIELD_INT_ARRAY(struct test, iv, ilen),
+  GLME_FIELD_STRUCT(struct test, other, 33, &other_desc),
+  // nested type from registry
+  GLME_FIELD_STRUCT_PTR(struct test, optr, 33, (const glme_desc_t *)0),
+  GLME_FIELD_INT(struct test, h, 0),
+  GLME_FIELD_DOUBLE(struct test, f, 0.0),
+  GLME_FIELD_STRUCT_ARRAY(struct test, ov, olen, 33, &other_desc)
+};
+glme_desc_t test_desc = GLME_DESC(32, struct test, test_fields);
+
+struct bad
+{
+  char c3[3];
+};
+
+glme_field_t bad_fields[] = {
+  GLME_FIELD_INT(struct bad, c3, 0)
+};
+glme_desc_t bad_desc = GLME_DESC(34, struct bad, bad_fields);
+
+main(int argc, char *argv)
+{
+  glme_buf_t gbuf;
+  glme_base_t base;
+  glme_spec_t spec;
+  struct test t0, t1, *tp;
+  int n, iv[2] = {-1, -2};
+  struct other oval = (struct other){129, -62};
+  struct other ovec[3] = {{1, -1}, {0, 0}, {300, -300}};
+
+  // field checks happen once at compile time
+  assert(glme_desc_init(&bad_desc) == GLME_E_INVAL && bad_desc.ops == 0);
+  assert(glme_desc_init(&test_desc) == 0);
+  assert(test_desc.ops != 0 && other_desc.ops != 0);
+
+  glme_base_init(&base, (glme_spec_t *)0, 4, (glme_allocator_t *)0);
+  glme_base_register(&base, glme_spec_init_desc(&spec, &other_desc));
+  glme_base_register(&base, glme_spec_init_desc(&spec, &test_desc));
+  assert(glme_base_register(&base, glme_spec_init_desc(&spec, &bad_desc)) == GLME_E_INVAL);
+
+  t0 = (struct test){.a = 10,
+                     .b = -17.0,
+                     .vec = {'w', 'o', 'r', 'l'},
+                     .s = "hello",
+                     .uvec = {5, 6, 7},
+                     .ilen = 2,
+                     .iv = iv,
+                     .other = (struct other){67, -2},
+                     .optr = &oval,
+                     .h = -300,
+                     .f = 2.5,
+                     .olen = 3,
+                     .ov = ovec
+  };
+
+  glme_buf_init(&gbuf, 1024);
+  gbuf.base = &base;
+  glme_encode_struct(&gbuf, 32, (void *)&t0, (glme_encoder_f)encode_struct_test);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  // decode with registered descriptor table
+  memset(&t1, 0xff, sizeof(t1));
+  tp = &t1;
+  n = glme_decode_struct(&gbuf, 32, (void **)&tp, 0, (glme_decoder_f)0);
+  assert(n == glme_buf_len(&gbuf) && gbuf.current == gbuf.count);
+
+  assert(t1.a == 10 && t1.b == -17.0);
+  assert(memcmp(t1.vec, "worl", 4) == 0);
+  assert(strcmp(t1.s, "hello") == 0);
+  assert(t1.uvec[0] == 5 && t1.uvec[2] == 7);
+  assert(t1.ilen == 2 && t1.iv[0] == -1 && t1.iv[1] == -2);
+  assert(t1.other.u == 67 && t1.other.i == -2);
+  assert(t1.optr && t1.optr->u == 129 && t1.optr->i == -62);
+  assert(t1.h == -300 && t1.f == 2.5);
+  // zero valued fields of array elements are not encoded; defaults used
+  assert(t1.olen == 3 && t1.ov[1].u == 0 && t1.ov[1].i == -1);
+  assert(t1.ov[2].u == 300 && t1.ov[2].i == -300);
+  free(t1.s); free(t1.iv); free(t1.optr); free(t1.ov);
+
+  // omitted fields get default values
+  t0 = (struct test){.a = 0, .b = 1.0, .s = (char *)0};
+  glme_buf_clear(&gbuf);
+  glme_encode_struct(&gbuf, 32, (void *)&t0, (glme_encoder_f)encode_struct_test);
+  memset(&t1, 0xff, sizeof(t1));
+  assert(glme_decode_struct(&gbuf, 32, (void **)&tp, 0, (glme_decoder_f)0) > 0);
+  assert(t1.a == 0 && t1.b == 1.0 && t1.s == 0 && t1.optr == 0);
+  assert(t1.vec[0] == 0 && t1.uvec[1] == 0 && t1.ilen == 0 && t1.iv == 0);
+  assert(t1.other.u == 0 && t1.olen == 0 && t1.ov == 0);
+
+  // wrong structure type for descriptor
+  glme_buf_clear(&gbuf);
+  glme_encode_struct(&gbuf, 33, (void *)&oval, encode_struct_other);
+  glme_decode_type(&gbuf, &n);
+  assert(glme_decode_desc(&gbuf, &other_desc, &oval) > 0);
+  glme_buf_reset(&gbuf);
+  glme_decode_type(&gbuf, &n);
+  // other fields at positions of test fields a and b
+  assert(glme_decode_desc(&gbuf, &test_desc, &t1) == GLME_E_TYPE);
+
+  glme_desc_release(&test_desc);
+  glme_desc_release(&other_desc);
+  glme_base_release(&base);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
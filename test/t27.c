@@ -0,0 +1,168 @@
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include "glme.h"
+
+// Structures encoded with field descriptor tables
+
+struct other
+{
+  unsigned int u;
+  int i;
+};
+
+int encode_struct_other(glme_buf_t *enc, const void *ptr)
+{
+  const struct other *p = (const struct other *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_UINT(enc, p->u, 0);
+  GLME_ENCODE_FLD_INT(enc, p->i, -1);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+struct test
+{
+  int a;
+  double b;
+  char vec[4];
+  char *s;
+  unsigned int uvec[3];
+  size_t ilen;
+  int *iv;
+  struct other other;
+  struct other *optr;
+  short h;
+  float f;
+  uint64_t big;
+  unsigned int olen;
+  struct other *ov;
+};
+
+int encode_struct_test(glme_buf_t *enc, const void *ptr)
+{
+  const struct test *p = (const struct test *)ptr;
+  int k;
+
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+
+  GLME_ENCODE_FLD_INT(enc, p->a, 0);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->b, 0.0);
+  GLME_ENCODE_FLD_VECTOR(enc, p->vec, sizeof(p->vec));
+  GLME_ENCODE_FLD_STRING(enc, p->s);
+  GLME_ENCODE_FLD_UINT_VECTOR(enc, p->uvec, glme_encode_value_uint);
+  GLME_ENCODE_FLD_INT_ARRAY(enc, p->iv, p->ilen, glme_encode_value_int);
+  GLME_ENCODE_FLD_STRUCT(enc, 33, &p->other, encode_struct_other);
+  // registered descriptor table
+  GLME_ENCODE_FLD_STRUCT(enc, 33, p->optr, (glme_encoder_f)0);
+  GLME_ENCODE_FLD_INT(enc, p->h, 0);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->f, 1.0);
+  GLME_ENCODE_FLD_UINT(enc, p->big, 0);
+
+  GLME_ENCODE_FLD_START_ARRAY(enc, ov, 33, p->olen);
+  for (k = 0; k < p->olen; k++) {
+    if ((__e = encode_struct_other(enc, &p->ov[k])) < 0)
+      return __e;
+  }
+  GLME_ENCODE_FLD_END_ARRAY(enc, ov);
+
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+glme_field_t other_fields[] = {
+  GLME_FIELD_UINT(struct other, u, 0),
+  GLME_FIELD_INT(struct other, i, -1)
+};
+glme_desc_t other_desc = GLME_DESC(33, struct other, other_fields);
+
+glme_field_t test_fields[] = {
+  GLME_FIELD_INT(struct test, a, 0),
+  GLME_FIELD_DOUBLE(struct test, b, 0.0),
+  GLME_FIELD_VECTOR(struct test, vec),
+  GLME_FIELD_STRING(struct test, s),
+  GLME_FIELD_UINT_VECTOR(struct test, uvec),
+  GLME_FIELD_INT_ARRAY(struct test, iv, ilen),
+  GLME_FIELD_STRUCT(struct test, other, 33, &other_desc),
+  GLME_FIELD_STRUCT_PTR(struct test, optr, 33, (const glme_desc_t *)0),
+  GLME_FIELD_INT(struct test, h, 0),
+  GLME_FIELD_DOUBLE(struct test, f, 1.0),
+  GLME_FIELD_UINT(struct test, big, 0),
+  GLME_FIELD_STRUCT_ARRAY(struct test, ov, olen, 33, &other_desc)
+};
+glme_desc_t test_desc = GLME_DESC(32, struct test, test_fields);
+
+main(int argc, char *argv)
+{
+  glme_buf_t ref, gbuf;
+  glme_base_t base;
+  glme_spec_t spec;
+  struct test t0, t1, *tp;
+  int k, n, iv[2] = {-1, -200000};
+  struct other oval = (struct other){129, -62};
+  struct other ovec[3] = {{1, -1}, {0, 0}, {300, -300}};
+
+  glme_base_init(&base, (glme_spec_t *)0, 4, (glme_allocator_t *)0);
+  glme_base_register(&base, glme_spec_init_desc(&spec, &other_desc));
+  glme_base_register(&base, glme_spec_init_desc(&spec, &test_desc));
+  assert(test_desc.ops != 0 && other_desc.ops != 0);
+
+  glme_buf_init(&ref, 4096);
+  // small buffer; descriptor encoder grows it
+  glme_buf_init(&gbuf, 8);
+  ref.base = gbuf.base = &base;
+
+  t0 = (struct test){.a = -10,
+                     .b = -17.0,
+                     .vec = {'w', 'o', 'r', 'l'},
+                     .s = "hello",
+                     .uvec = {5, 0, 700},
+                     .ilen = 2,
+                     .iv = iv,
+                     .other = (struct other){67, -2},
+                     .optr = &oval,
+                     .h = -300,
+                     .f = 2.5,
+                     .big = 0xFFFFFFFFFFFFFFFFull,
+                     .olen = 3,
+                     .ov = ovec
+  };
+
+  for (k = 0; k < 2; k++) {
+    glme_buf_clear(&ref);
+    glme_buf_clear(&gbuf);
+    n = glme_encode_struct(&ref, 32, &t0, encode_struct_test);
+    assert(n > 0);
+    // no encoder function; registered descriptor table used
+    assert(glme_encode_struct(&gbuf, 32, &t0, (glme_encoder_f)0) == n);
+    assert(memcmp(glme_buf_data(&ref), glme_buf_data(&gbuf), n) == 0);
+
+    tp = &t1;
+    memset(&t1, 0, sizeof(t1));
+    assert(glme_decode_struct(&gbuf, 32, (void **)&tp, 0, (glme_decoder_f)0) == n);
+    assert(t1.a == t0.a && t1.b == t0.b && t1.h == t0.h && t1.f == t0.f);
+    assert(t1.big == t0.big && t1.uvec[2] == t0.uvec[2]);
+    assert(t1.olen == t0.olen && (t0.olen == 0 || t1.ov[2].i == -300));
+    assert(t1.s ? strcmp(t1.s, t0.s) == 0 : *t0.s == 0);
+    assert((t0.optr == 0 && t1.optr == 0) || t1.optr->i == -62);
+    if (argc > 1)
+      write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+    // defaults, null pointers and empty arrays are omitted
+    t0 = (struct test){.a = 0, .f = 1.0, .s = "", .ilen = 1};
+  }
+
+  glme_desc_release(&test_desc);
+  glme_desc_release(&other_desc);
+  glme_base_release(&base);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
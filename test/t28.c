@@ -0,0 +1,181 @@
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+#include "t28_msg.h"
+
+// Encoders and decoders generated by schema compiler
+
+extern glme_desc_t shape_desc;
+
+glme_field_t point_fields[] = {
+  GLME_FIELD_INT(struct point, x, 0),
+  GLME_FIELD_INT(struct point, y, -1)
+};
+glme_desc_t point_desc = GLME_DESC(POINT_ID, struct point, point_fields);
+
+glme_field_t shape_fields[] = {
+  GLME_FIELD_STRING(struct shape, name),
+  GLME_FIELD_VECTOR(struct shape, tag),
+  GLME_FIELD_INT(struct shape, h, 0),
+  GLME_FIELD_UINT(struct shape, big, 0),
+  GLME_FIELD_DOUBLE(struct shape, f, 1.5),
+  GLME_FIELD_FLOAT_ARRAY(struct shape, vals, vals_len),
+  GLME_FIELD_UINT_VECTOR(struct shape, flags),
+  GLME_FIELD_STRUCT(struct shape, origin, POINT_ID, &point_desc),
+  GLME_FIELD_STRUCT_PTR(struct shape, next, POINT_ID, &point_desc),
+  GLME_FIELD_STRUCT_ARRAY(struct shape, pts, pts_len, POINT_ID, &point_desc),
+  GLME_FIELD_STRUCT_PTR(struct shape, child, SHAPE_ID, &shape_desc),
+  GLME_FIELD_INT(struct shape, last, 0)
+};
+glme_desc_t shape_desc = GLME_DESC(SHAPE_ID, struct shape, shape_fields);
+
+// leading fields of shape with single precision floats
+int encode_shape32(glme_buf_t *enc, const void *ptr)
+{
+  const struct shape *p = (const struct shape *)ptr;
+  float vals[4];
+  size_t k;
+  GLME_ENCODE_STDDEF(enc);
+  for (k = 0; k < p->vals_len && k < 4; k++)
+    vals[k] = (float)p->vals[k];
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_STRING(enc, p->name);
+  GLME_ENCODE_FLD_VECTOR(enc, p->tag, 0);
+  GLME_ENCODE_FLD_INT(enc, p->h, 0);
+  GLME_ENCODE_FLD_UINT(enc, p->big, 0);
+  GLME_ENCODE_FLD_FLOAT32(enc, p->f, 1.5);
+  GLME_ENCODE_FLD_FLOAT32_ARRAY(enc, vals, k);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, ref;
+  glme_base_t base;
+  glme_spec_t specs[] = {
+    POINT_SPEC,
+    SHAPE_SPEC
+  };
+  struct shape s0, s1, child, *sp;
+  struct point pt = (struct point){7, 8}, p1, *pp;
+  struct point pts[2] = {{1, -1}, {-100000, 100000}};
+  double vals[3] = {1.0, -2.5, 1e100};
+  size_t len;
+  int n;
+
+  assert(glme_desc_init(&shape_desc) == 0);
+
+  child = (struct shape){.name = "child", .f = 1.5, .last = -1};
+  s0 = (struct shape){.name = "shape",
+                      .tag = {'a', 'b', 'c', 'd'},
+                      .h = -300,
+                      .big = 0xFEDCBA9876543210ull,
+                      .f = 0.25,
+                      .vals_len = 3,
+                      .vals = vals,
+                      .flags = {1, 200, 0},
+                      .origin = (struct point){-5, -1},
+                      .next = &pt,
+                      .pts_len = 2,
+                      .pts = pts,
+                      .child = &child,
+                      .last = 12345};
+
+  glme_base_init(&base, specs, 2, (glme_allocator_t *)0);
+  // small buffer; generated encoder reserves space once
+  glme_buf_init(&gbuf, 8);
+  glme_buf_init(&ref, 1024);
+  gbuf.base = ref.base = &base;
+
+  n = glme_encode_struct(&gbuf, SHAPE_ID, &s0, (glme_encoder_f)0);
+  assert(n > 0 && n == glme_buf_len(&gbuf));
+  assert(glme_buf_len(&gbuf) <= shape_size(&s0) + 1);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  // same bytes as descriptor table encoder
+  glme_encode_type(&ref, SHAPE_ID);
+  glme_encode_desc(&ref, &shape_desc, &s0);
+  assert(glme_buf_len(&ref) == n);
+  assert(memcmp(glme_buf_data(&ref), glme_buf_data(&gbuf), n) == 0);
+
+  sp = &s1;
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&gbuf, SHAPE_ID, (void **)&sp, 0, (glme_decoder_f)0) == n);
+  assert(strcmp(s1.name, "shape") == 0 && memcmp(s1.tag, "abcd", 4) == 0);
+  assert(s1.h == -300 && s1.big == s0.big && s1.f == 0.25);
+  assert(s1.vals_len == 3 && s1.vals[1] == -2.5 && s1.vals[2] == 1e100);
+  assert(s1.flags[1] == 200 && s1.flags[2] == 0);
+  assert(s1.origin.x == -5 && s1.origin.y == -1);
+  assert(s1.next && s1.next->x == 7 && s1.next->y == 8);
+  assert(s1.pts_len == 2 && s1.pts[1].x == -100000 && s1.pts[1].y == 100000);
+  assert(s1.child && strcmp(s1.child->name, "child") == 0);
+  assert(s1.child->f == 1.5 && s1.child->last == -1 && s1.child->next == 0);
+  assert(s1.child->vals == 0 && s1.child->pts_len == 0 && s1.child->child == 0);
+  assert(s1.last == 12345);
+  shape_free(&gbuf, &s1);
+  assert(s1.name == 0 && s1.child == 0 && s1.pts == 0);
+
+  // single precision values for float and double fields
+  s0.vals_len = 2;
+  glme_buf_clear(&ref);
+  n = glme_encode_struct(&ref, SHAPE_ID, &s0, encode_shape32);
+  assert(n > 0);
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&ref, SHAPE_ID, (void **)&sp, 0, (glme_decoder_f)0) == n);
+  assert(s1.h == -300 && s1.big == s0.big && s1.f == 0.25);
+  assert(s1.vals_len == 2 && s1.vals[0] == 1.0 && s1.vals[1] == -2.5);
+  assert(!s1.child && s1.last == 0);
+  shape_free(&ref, &s1);
+  s0.vals_len = 3;
+
+  // truncated input fails cleanly; partial result is released
+  for (len = 1; len < n; len++) {
+    glme_buf_reset(&gbuf);
+    gbuf.count = len;
+    memset(&s1, 0, sizeof(s1));
+    assert(glme_decode_struct(&gbuf, SHAPE_ID, (void **)&sp, 0, (glme_decoder_f)0) < 0);
+  }
+
+  // unknown trailing fields of newer encoder are skipped
+  glme_buf_clear(&ref);
+  glme_encode_struct(&ref, POINT_ID, &pt, (glme_encoder_f)0);
+  ref.count--;
+  memcpy(&ref.buf[ref.count], "\x03\x04\x02\x01\x0c\x01x\x00", 8);
+  ref.count += 8;
+  pp = &p1;
+  p1 = (struct point){0, 0};
+  assert(glme_decode_struct(&ref, POINT_ID, (void **)&pp, 0, (glme_decoder_f)0) == ref.count);
+  assert(p1.x == 7 && p1.y == 8);
+  // delta beyond any field
+  glme_buf_clear(&ref);
+  glme_encode_struct(&ref, POINT_ID, &pt, (glme_encoder_f)0);
+  ref.count--;
+  memcpy(&ref.buf[ref.count], "\xfe\x01\x00\x04\x02\x00", 6);
+  ref.count += 6;
+  assert(glme_decode_struct(&ref, POINT_ID, (void **)&pp, 0, (glme_decoder_f)0) == ref.count);
+  // truncated trailing field
+  glme_buf_clear(&ref);
+  glme_encode_struct(&ref, POINT_ID, &pt, (glme_encoder_f)0);
+  ref.count--;
+  memcpy(&ref.buf[ref.count], "\x03\x0c\x05" "ab", 5);
+  ref.count += 5;
+  assert(glme_decode_struct(&ref, POINT_ID, (void **)&pp, 0, (glme_decoder_f)0) == GLME_E_UFLOW);
+
+  glme_desc_release(&shape_desc);
+  glme_desc_release(&point_desc);
+  glme_base_release(&base);
+  glme_buf_close(&ref);
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,158 @@
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Structures defined with schema field lists
+
+#define POINT_FIELDS(F)                         \
+  F(INT, int, x, 0)                             \
+  F(INT, int, y, -1)
+
+GLME_SCHEMA_DECLARE(point, 40, POINT_FIELDS);
+GLME_SCHEMA_DEFINE(point, POINT_FIELDS)
+
+#define SHAPE_FIELDS(F)                         \
+  F(STRING, char, name, 0)                      \
+  F(VECTOR, char, tag, 4)                       \
+  F(INT, int16, h, 0)                           \
+  F(UINT, uint64, big, 0)                       \
+  F(DOUBLE, float, f, 1.5)                      \
+  F(FLOAT_ARRAY, double, vals, 0)               \
+  F(UINT_VECTOR, uint, flags, 3)                \
+  F(INT_ARRAY, int, iv, 0)                      \
+  F(STRUCT, point, origin, 0)                   \
+  F(STRUCT_PTR, point, next, 0)                 \
+  F(STRUCT_ARRAY, point, pts, 0)                \
+  F(STRUCT_PTR, shape, child, 0)                \
+  F(INT, long, last, 0)
+
+GLME_SCHEMA_DECLARE(shape, 41, SHAPE_FIELDS);
+GLME_SCHEMA_DEFINE(shape, SHAPE_FIELDS)
+
+// same structures as descriptor tables
+extern glme_desc_t shape_desc;
+
+glme_field_t point_fields[] = {
+  GLME_FIELD_INT(struct point, x, 0),
+  GLME_FIELD_INT(struct point, y, -1)
+};
+glme_desc_t point_desc = GLME_DESC(point_TYPEID, struct point, point_fields);
+
+glme_field_t shape_fields[] = {
+  GLME_FIELD_STRING(struct shape, name),
+  GLME_FIELD_VECTOR(struct shape, tag),
+  GLME_FIELD_INT(struct shape, h, 0),
+  GLME_FIELD_UINT(struct shape, big, 0),
+  GLME_FIELD_DOUBLE(struct shape, f, 1.5),
+  GLME_FIELD_FLOAT_ARRAY(struct shape, vals, vals_len),
+  GLME_FIELD_UINT_VECTOR(struct shape, flags),
+  GLME_FIELD_INT_ARRAY(struct shape, iv, iv_len),
+  GLME_FIELD_STRUCT(struct shape, origin, point_TYPEID, &point_desc),
+  GLME_FIELD_STRUCT_PTR(struct shape, next, point_TYPEID, &point_desc),
+  GLME_FIELD_STRUCT_ARRAY(struct shape, pts, pts_len, point_TYPEID, &point_desc),
+  GLME_FIELD_STRUCT_PTR(struct shape, child, shape_TYPEID, &shape_desc),
+  GLME_FIELD_INT(struct shape, last, 0)
+};
+glme_desc_t shape_desc = GLME_DESC(shape_TYPEID, struct shape, shape_fields);
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, ref;
+  glme_base_t base;
+  glme_spec_t specs[] = {
+    GLME_SCHEMA_SPEC(point),
+    GLME_SCHEMA_SPEC(shape)
+  };
+  struct shape s0, s1, child, *sp;
+  struct point p0, p1, *pp;
+  struct point pt = (struct point){7, 8};
+  struct point pts[2] = {{1, -1}, {-100000, 100000}};
+  double vals[3] = {1.0, -2.5, 1e100};
+  int iv[2] = {-1, 1 << 30};
+  int k, n;
+
+  assert(glme_desc_init(&shape_desc) == 0);
+  glme_base_init(&base, specs, 2, (glme_allocator_t *)0);
+  glme_buf_init(&gbuf, 1024);
+  glme_buf_init(&ref, 1024);
+  gbuf.base = ref.base = &base;
+
+  // fixed size structure within its maximum size
+  assert(point_TYPEID == 40 && point_size(&pt) == point_MAXSIZE);
+  p0 = (struct point){-1 << 30, 1 << 30};
+  n = glme_encode_struct(&gbuf, point_TYPEID, &p0, (glme_encoder_f)0);
+  assert(n > 0 && n - 1 <= point_MAXSIZE);
+  pp = &p1;
+  assert(glme_decode_struct(&gbuf, point_TYPEID, (void **)&pp, 0, (glme_decoder_f)0) == n);
+  assert(p1.x == p0.x && p1.y == p0.y);
+
+  child = (struct shape){.name = "child", .f = 1.5, .last = -1};
+  s0 = (struct shape){.name = "shape",
+                      .tag = {'a', 'b', 'c', 'd'},
+                      .h = -300,
+                      .big = 0xFEDCBA9876543210ull,
+                      .f = 0.25,
+                      .vals_len = 3,
+                      .vals = vals,
+                      .flags = {1, 200, 0},
+                      .iv_len = 2,
+                      .iv = iv,
+                      .origin = (struct point){-5, -1},
+                      .next = &pt,
+                      .pts_len = 2,
+                      .pts = pts,
+                      .child = &child,
+                      .last = 12345};
+
+  for (k = 0; k < 2; k++) {
+    glme_buf_clear(&gbuf);
+    glme_buf_clear(&ref);
+    n = glme_encode_struct(&gbuf, shape_TYPEID, &s0, (glme_encoder_f)0);
+    assert(n > 0 && n - 1 <= shape_size(&s0));
+    if (argc > 1)
+      write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+    // same bytes as descriptor table encoder
+    glme_encode_type(&ref, shape_TYPEID);
+    glme_encode_desc(&ref, &shape_desc, &s0);
+    assert(glme_buf_len(&ref) == n);
+    assert(memcmp(glme_buf_data(&ref), glme_buf_data(&gbuf), n) == 0);
+
+    sp = &s1;
+    memset(&s1, 0xff, sizeof(s1));
+    assert(glme_decode_struct(&gbuf, shape_TYPEID, (void **)&sp, 0, (glme_decoder_f)0) == n);
+    assert(s1.h == s0.h && s1.big == s0.big && s1.f == s0.f && s1.last == s0.last);
+    assert(s1.vals_len == s0.vals_len && s1.iv_len == s0.iv_len && s1.pts_len == s0.pts_len);
+    assert(s1.flags[1] == s0.flags[1] && memcmp(s1.tag, s0.tag, 4) == 0);
+    assert(s1.origin.x == s0.origin.x && s1.origin.y == s0.origin.y);
+    if (k == 0) {
+      assert(strcmp(s1.name, "shape") == 0);
+      assert(s1.vals[2] == 1e100 && s1.iv[1] == 1 << 30);
+      assert(s1.next && s1.next->x == 7 && s1.next->y == 8);
+      assert(s1.pts[1].x == -100000 && s1.pts[1].y == 100000);
+      assert(s1.child && strcmp(s1.child->name, "child") == 0 && s1.child->last == -1);
+      assert(s1.child->vals == 0 && s1.child->pts == 0 && s1.child->next == 0);
+      free(s1.name); free(s1.vals); free(s1.iv); free(s1.next); free(s1.pts);
+      free(s1.child->name); free(s1.child);
+    } else {
+      assert(s1.name == 0 && s1.vals == 0 && s1.iv == 0);
+      assert(s1.next == 0 && s1.pts == 0 && s1.child == 0);
+    }
+    // defaults, null pointers and empty arrays are omitted
+    s0 = (struct shape){.name = "", .f = 1.5, .origin = (struct point){0, -1}};
+  }
+
+  glme_desc_release(&shape_desc);
+  glme_desc_release(&point_desc);
+  glme_base_release(&base);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,211 @@
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Structures with fast field macros
+
+struct other
+{
+  unsigned int u;
+  int i;
+};
+
+int encode_struct_other(glme_buf_t *enc, const void *ptr)
+{
+  const struct other *p = (const struct other *)ptr;
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_FAST_ENCODE_FLD_UINT(enc, p->u, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->i, 0);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int decode_struct_other(glme_buf_t *dec, void *ptr)
+{
+  struct other *p = (struct other *)ptr;
+  GLME_DECODE_STDDEF(dec);
+  GLME_DECODE_STRUCT_START(dec);
+  GLME_FAST_DECODE_FLD_UINT(dec, p->u, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->i, 0);
+  GLME_DECODE_STRUCT_END(dec);
+  GLME_DECODE_RETURN(dec);
+}
+
+struct test
+{
+  int a;
+  double b;
+  char vec[4];
+  char *s;
+  struct other other;
+  short h;
+  float f;
+  uint64_t big;
+  int64_t neg;
+};
+
+int encode_struct_test(glme_buf_t *enc, const void *ptr)
+{
+  const struct test *p = (const struct test *)ptr;
+
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_ENCODE_FLD_INT(enc, p->a, 0);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->b, 0.0);
+  GLME_ENCODE_FLD_VECTOR(enc, p->vec, sizeof(p->vec));
+  GLME_ENCODE_FLD_STRING(enc, p->s);
+  GLME_ENCODE_FLD_STRUCT(enc, 33, &p->other, encode_struct_other);
+  GLME_ENCODE_FLD_INT(enc, p->h, -1);
+  GLME_ENCODE_FLD_DOUBLE(enc, p->f, 1.0);
+  GLME_ENCODE_FLD_UINT(enc, p->big, 0);
+  GLME_ENCODE_FLD_INT(enc, p->neg, 0);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int decode_struct_test(glme_buf_t *dec, void *ptr)
+{
+  struct test *p = (struct test *)ptr;
+
+  GLME_DECODE_STDDEF(dec);
+  GLME_DECODE_STRUCT_START(dec);
+  GLME_DECODE_FLD_INT(dec, p->a, 0);
+  GLME_DECODE_FLD_DOUBLE(dec, p->b, 0.0);
+  GLME_DECODE_FLD_VECTOR(dec, p->vec);
+  GLME_DECODE_FLD_STRING(dec, p->s);
+  GLME_DECODE_FLD_STRUCT(dec, 33, p->other, decode_struct_other);
+  GLME_DECODE_FLD_INT(dec, p->h, -1);
+  GLME_DECODE_FLD_DOUBLE(dec, p->f, 1.0);
+  GLME_DECODE_FLD_UINT(dec, p->big, 0);
+  GLME_DECODE_FLD_INT(dec, p->neg, 0);
+  GLME_DECODE_STRUCT_END(dec);
+  GLME_DECODE_RETURN(dec);
+}
+
+int fast_encode_struct_test(glme_buf_t *enc, const void *ptr)
+{
+  const struct test *p = (const struct test *)ptr;
+
+  GLME_ENCODE_STDDEF(enc);
+  GLME_ENCODE_STRUCT_START(enc);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->a, 0);
+  GLME_FAST_ENCODE_FLD_DOUBLE(enc, p->b, 0.0);
+  GLME_FAST_ENCODE_FLD_VECTOR(enc, p->vec, sizeof(p->vec));
+  GLME_FAST_ENCODE_FLD_STRING(enc, p->s);
+  // nested structures with generic field macros
+  GLME_ENCODE_FLD_STRUCT(enc, 33, &p->other, encode_struct_other);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->h, -1);
+  GLME_FAST_ENCODE_FLD_DOUBLE(enc, p->f, 1.0);
+  GLME_FAST_ENCODE_FLD_UINT(enc, p->big, 0);
+  GLME_FAST_ENCODE_FLD_INT(enc, p->neg, 0);
+  GLME_ENCODE_STRUCT_END(enc);
+  GLME_ENCODE_RETURN(enc);
+}
+
+int fast_decode_struct_test(glme_buf_t *dec, void *ptr)
+{
+  struct test *p = (struct test *)ptr;
+
+  GLME_DECODE_STDDEF(dec);
+  GLME_DECODE_STRUCT_START(dec);
+  GLME_FAST_DECODE_FLD_INT(dec, p->a, 0);
+  GLME_FAST_DECODE_FLD_DOUBLE(dec, p->b, 0.0);
+  GLME_FAST_DECODE_FLD_VECTOR(dec, p->vec);
+  GLME_FAST_DECODE_FLD_STRING(dec, p->s);
+  GLME_DECODE_FLD_STRUCT(dec, 33, p->other, decode_struct_other);
+  GLME_FAST_DECODE_FLD_INT(dec, p->h, -1);
+  GLME_FAST_DECODE_FLD_DOUBLE(dec, p->f, 1.0);
+  GLME_FAST_DECODE_FLD_UINT(dec, p->big, 0);
+  GLME_FAST_DECODE_FLD_INT(dec, p->neg, 0);
+  GLME_DECODE_STRUCT_END(dec);
+  GLME_DECODE_RETURN(dec);
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t ref, gbuf;
+  struct test t0, t1, t2, *tp;
+  int k, n;
+  size_t len;
+
+  glme_buf_init(&ref, 1024);
+  // small buffer; fast macros grow it
+  glme_buf_init(&gbuf, 8);
+
+  t0 = (struct test){.a = -10,
+                     .b = -17.0,
+                     .vec = {'w', 'o', 'r', 'l'},
+                     .s = "hello",
+                     .other = (struct other){67, -2},
+                     .h = 300,
+                     .f = 2.5,
+                     .big = 0xFFFFFFFFFFFFFFFFull,
+                     .neg = INT64_MIN
+  };
+
+  for (k = 0; k < 2; k++) {
+    glme_buf_clear(&ref);
+    glme_buf_clear(&gbuf);
+    n = glme_encode_struct(&ref, 32, &t0, encode_struct_test);
+    assert(n > 0);
+    assert(glme_encode_struct(&gbuf, 32, &t0, fast_encode_struct_test) == n);
+    assert(memcmp(glme_buf_data(&ref), glme_buf_data(&gbuf), n) == 0);
+    if (argc > 1)
+      write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+    // fast decoder and generic decoder give same values
+    tp = &t1;
+    memset(&t1, 0xff, sizeof(t1));
+    assert(glme_decode_struct(&gbuf, 32, (void **)&tp, 0, fast_decode_struct_test) == n);
+    tp = &t2;
+    memset(&t2, 0xff, sizeof(t2));
+    assert(glme_decode_struct(&ref, 32, (void **)&tp, 0, decode_struct_test) == n);
+
+    assert(t1.a == t0.a && t1.b == t0.b && t1.h == t0.h && t1.f == t0.f);
+    assert(t1.big == t0.big && t1.neg == t0.neg && memcmp(t1.vec, t0.vec, 4) == 0);
+    assert(t1.other.u == t0.other.u && t1.other.i == t0.other.i);
+    assert(t1.a == t2.a && t1.b == t2.b && t1.h == t2.h && t1.f == t2.f);
+    assert(t1.big == t2.big && t1.neg == t2.neg && memcmp(t1.vec, t2.vec, 4) == 0);
+    assert(t1.s ? strcmp(t1.s, t2.s) == 0 : t2.s == 0);
+    assert(*t0.s ? strcmp(t1.s, t0.s) == 0 : t1.s == 0);
+    free(t1.s);
+    free(t2.s);
+
+    // defaults and empty strings are omitted
+    t0 = (struct test){.a = 0, .f = 1.0, .h = -1, .s = ""};
+  }
+
+  // truncated input
+  t0.s = "truncated";
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 32, &t0, fast_encode_struct_test);
+  tp = &t1;
+  for (len = 1; len < n; len++) {
+    glme_buf_reset(&gbuf);
+    gbuf.count = len;
+    t1.s = (char *)0;
+    assert(glme_decode_struct(&gbuf, 32, (void **)&tp, 0, fast_decode_struct_test) < 0);
+    free(t1.s);
+  }
+
+  // wrong field type
+  t0.other = (struct other){67, -2};
+  glme_buf_clear(&gbuf);
+  glme_encode_struct(&gbuf, 33, &t0.other, encode_struct_other);
+  assert(gbuf.buf[2] == GLME_UINT << 1);
+  gbuf.buf[2] = GLME_INT << 1;
+  tp = (struct test *)&t0.other;
+  assert(glme_decode_struct(&gbuf, 33, (void **)&tp, 0, decode_struct_other) < 0);
+  assert(gbuf.last_error == GLME_E_TYPE);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,265 @@
+
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "glme.h"
+
+// Structures encoded and decoded with compiled descriptors
+
+struct point
+{
+  int x, y;
+};
+
+struct rec
+{
+  int8_t i8;
+  int16_t i16;
+  int32_t i32;
+  int64_t i64;
+  uint8_t u8;
+  uint16_t u16;
+  uint32_t u32;
+  uint64_t u64;
+  float f;
+  double d;
+  char tag[4];
+  char *name;
+  struct point origin;
+  struct point *next;
+  size_t vals_len;
+  double *vals;
+  int flags[3];
+  double nan;
+};
+
+glme_field_t point_fields[] = {
+  GLME_FIELD_INT(struct point, x, 0),
+  GLME_FIELD_INT(struct point, y, -1)
+};
+glme_desc_t point_desc = GLME_DESC(40, struct point, point_fields);
+
+glme_field_t rec_fields[] = {
+  GLME_FIELD_INT(struct rec, i8, -1),
+  GLME_FIELD_INT(struct rec, i16, 0),
+  GLME_FIELD_INT(struct rec, i32, 7),
+  GLME_FIELD_INT(struct rec, i64, INT64_MIN),
+  GLME_FIELD_UINT(struct rec, u8, 200),
+  GLME_FIELD_UINT(struct rec, u16, 0),
+  GLME_FIELD_UINT(struct rec, u32, 0xFFFFFFFF),
+  GLME_FIELD_UINT(struct rec, u64, 0),
+  GLME_FIELD_DOUBLE(struct rec, f, 1.5),
+  GLME_FIELD_DOUBLE(struct rec, d, 0.0),
+  GLME_FIELD_VECTOR(struct rec, tag),
+  GLME_FIELD_STRING(struct rec, name),
+  GLME_FIELD_STRUCT(struct rec, origin, 40, &point_desc),
+  GLME_FIELD_STRUCT_PTR(struct rec, next, 40, &point_desc),
+  GLME_FIELD_FLOAT_ARRAY(struct rec, vals, vals_len),
+  GLME_FIELD_INT_VECTOR(struct rec, flags),
+  GLME_FIELD_DOUBLE(struct rec, nan, 0.0)
+};
+glme_desc_t rec_desc = GLME_DESC(41, struct rec, rec_fields);
+
+// more fields than fit one byte field delta
+#define NWIDE 140
+
+struct wide
+{
+  int64_t v[NWIDE];
+};
+
+static
+int encode_both(glme_buf_t *ref, glme_buf_t *gbuf, glme_spec_t *spec,
+                const glme_desc_t *desc, const void *ptr)
+{
+  int n;
+  glme_buf_clear(ref);
+  glme_buf_clear(gbuf);
+  n = glme_encode_desc(ref, desc, ptr);
+  assert(n > 0);
+  assert((*spec->encoder)(gbuf, ptr) == n);
+  assert(glme_buf_len(gbuf) == n);
+  assert(memcmp(glme_buf_data(ref), glme_buf_data(gbuf), n) == 0);
+  return n;
+}
+
+static
+void rec_check(const struct rec *a, const struct rec *b)
+{
+  assert(a->i8 == b->i8 && a->i16 == b->i16 && a->i32 == b->i32 && a->i64 == b->i64);
+  assert(a->u8 == b->u8 && a->u16 == b->u16 && a->u32 == b->u32 && a->u64 == b->u64);
+  assert(a->f == b->f && a->d == b->d);
+  assert(memcmp(a->tag, b->tag, 4) == 0 && memcmp(a->flags, b->flags, sizeof(a->flags)) == 0);
+  assert(a->name ? strcmp(a->name, b->name) == 0 : b->name == 0);
+  assert(a->origin.x == b->origin.x && a->origin.y == b->origin.y);
+  assert(a->next ? a->next->x == b->next->x && a->next->y == b->next->y : b->next == 0);
+  assert(a->vals_len == b->vals_len);
+  assert(a->vals_len == 0 || memcmp(a->vals, b->vals, a->vals_len * sizeof(double)) == 0);
+  assert(isnan(a->nan) ? isnan(b->nan) : a->nan == b->nan);
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, ref;
+  glme_jit_t jit, wjit;
+  glme_spec_t spec, wspec;
+  glme_field_t wide_fields[NWIDE];
+  glme_desc_t wide_desc;
+  struct rec r0, r1, r2;
+  struct wide w0, w1, w2;
+  struct point pt = (struct point){7, 8};
+  double vals[3] = {1.0, -2.5, 1e100};
+  int k, n, native;
+  size_t len;
+  char path[64];
+
+  glme_buf_init(&gbuf, 8);
+  glme_buf_init(&ref, 1024);
+
+  native = glme_jit_compile(&jit, &spec, &rec_desc, 0);
+  assert(native >= 0);
+  assert(spec.typeid == 41 && spec.size == sizeof(struct rec) && spec.desc == &rec_desc);
+#if defined(__x86_64__) && defined(__linux__)
+  assert(native == 1 && jit.code != 0);
+#endif
+  if (!native) {
+    // interpreter fallback
+    assert(!spec.encoder && !spec.decoder && !jit.code);
+    return 0;
+  }
+
+  r0 = (struct rec){.i8 = -100, .i16 = -300, .i32 = 1 << 30, .i64 = -1,
+                    .u8 = 255, .u16 = 65535, .u32 = 12, .u64 = 0xFEDCBA9876543210ull,
+                    .f = 0.25, .d = -0.5, .tag = {'a', 'b', 'c', 'd'}, .name = "record",
+                    .origin = (struct point){-5, -1}, .next = &pt,
+                    .vals_len = 3, .vals = vals, .flags = {1, 200, -3}, .nan = NAN};
+
+  for (k = 0; k < 3; k++) {
+    n = encode_both(&ref, &gbuf, &spec, &rec_desc, &r0);
+    if (argc > 1)
+      write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+    memset(&r1, 0xff, sizeof(r1));
+    memset(&r2, 0xff, sizeof(r2));
+    assert((*spec.decoder)(&gbuf, &r1) == n);
+    assert(glme_decode_desc(&ref, &rec_desc, &r2) == n);
+    rec_check(&r0, &r1);
+    rec_check(&r1, &r2);
+    free(r1.name); free(r1.next); free(r1.vals);
+    free(r2.name); free(r2.next); free(r2.vals);
+
+    if (k == 0) {
+      // defaults, null pointers and empty arrays are omitted
+      r0 = (struct rec){.i8 = -1, .i32 = 7, .i64 = INT64_MIN, .u8 = 200, .u32 = 0xFFFFFFFF,
+                        .f = 1.5, .origin = (struct point){0, -1}};
+    } else {
+      // negative zero equals default
+      r0.d = -0.0;
+    }
+  }
+
+  // truncated input and wrong field type
+  r0.name = "truncated";
+  r0.u16 = 1000;
+  glme_buf_clear(&gbuf);
+  n = (*spec.encoder)(&gbuf, &r0);
+  for (len = 0; len < n; len++) {
+    glme_buf_reset(&gbuf);
+    gbuf.count = len;
+    r1.name = (char *)0;
+    assert((*spec.decoder)(&gbuf, &r1) < 0);
+    assert(gbuf.last_error == GLME_E_UFLOW);
+    free(r1.name);
+  }
+  gbuf.count = n;
+  glme_buf_reset(&gbuf);
+  // i8 .. u8 omitted, u16 is first field with delta 6
+  assert(gbuf.buf[0] == 6 && gbuf.buf[1] == GLME_UINT << 1);
+  gbuf.buf[1] = GLME_INT << 1;
+  assert((*spec.decoder)(&gbuf, &r1) == GLME_E_TYPE);
+  assert(gbuf.last_error == GLME_E_TYPE);
+  // field beyond descriptor is skipped, others get defaults
+  glme_buf_clear(&gbuf);
+  gbuf.buf[0] = 18;
+  gbuf.buf[1] = GLME_INT << 1;
+  gbuf.buf[2] = 2;
+  gbuf.buf[3] = 0;
+  gbuf.count = 4;
+  memset(&r1, 0, sizeof(r1));
+  assert((*spec.decoder)(&gbuf, &r1) == 4);
+  assert(r1.i8 == -1 && r1.i32 == 7 && r1.u8 == 200 && r1.f == 1.5f && r1.origin.y == 0);
+  glme_buf_reset(&gbuf);
+  gbuf.count = 3;
+  assert((*spec.decoder)(&gbuf, &r1) == GLME_E_UFLOW);
+  assert(gbuf.last_error == GLME_E_UFLOW);
+
+  // runtime built descriptor with multi-byte field deltas
+  for (k = 0; k < NWIDE; k++) {
+    wide_fields[k] = (glme_field_t){offsetof(struct wide, v) + k*sizeof(int64_t),
+                                    sizeof(int64_t), 1, 0, 0, GLME_K_INT, GLME_INT,
+                                    (const glme_desc_t *)0, { .i = k } };
+  }
+  wide_desc = (glme_desc_t){42, sizeof(struct wide), NWIDE, wide_fields,
+                            (struct glme_fieldop_s *)0};
+  assert(glme_jit_compile(&wjit, &wspec, &wide_desc, GLME_JIT_PERFMAP) == 1);
+
+  for (k = 0; k < NWIDE; k++)
+    w0.v[k] = k;
+  w0.v[0] = 1;
+  w0.v[NWIDE-1] = INT64_MAX;
+  n = encode_both(&ref, &gbuf, &wspec, &wide_desc, &w0);
+  assert(n == 3 + 12 + 1);
+  memset(&w1, 0xff, sizeof(w1));
+  memset(&w2, 0xff, sizeof(w2));
+  assert((*wspec.decoder)(&gbuf, &w1) == n);
+  assert(glme_decode_desc(&ref, &wide_desc, &w2) == n);
+  assert(memcmp(&w0, &w1, sizeof(w0)) == 0 && memcmp(&w1, &w2, sizeof(w1)) == 0);
+
+  for (k = 0; k < NWIDE; k++)
+    w0.v[k] = k % 3 ? -k * 1000000 : k;
+  n = encode_both(&ref, &gbuf, &wspec, &wide_desc, &w0);
+  assert((*wspec.decoder)(&gbuf, &w1) == n);
+  assert(memcmp(&w0, &w1, sizeof(w0)) == 0);
+
+  // registered compiled spec
+  glme_buf_clear(&gbuf);
+  glme_buf_clear(&ref);
+  {
+    glme_base_t base;
+    struct wide *wp = &w2;
+    glme_base_init(&base, &wspec, 1, (glme_allocator_t *)0);
+    gbuf.base = &base;
+    n = glme_encode_struct(&gbuf, 42, &w0, (glme_encoder_f)0);
+    assert(n > 0);
+    memset(&w2, 0, sizeof(w2));
+    assert(glme_decode_struct(&gbuf, 42, (void **)&wp, 0, (glme_decoder_f)0) == n);
+    assert(memcmp(&w0, &w2, sizeof(w0)) == 0);
+    gbuf.base = (glme_base_t *)0;
+    glme_base_release(&base);
+  }
+
+  // interpreter requested
+  glme_jit_release(&wjit);
+  assert(glme_jit_compile(&wjit, &wspec, &wide_desc, GLME_JIT_INTERP) == 0);
+  assert(!wjit.code && !wspec.encoder && wspec.desc == &wide_desc);
+
+  glme_jit_release(&jit);
+  glme_jit_release(&wjit);
+  glme_desc_release(&rec_desc);
+  glme_desc_release(&point_desc);
+  glme_desc_release(&wide_desc);
+
+  // symbols were written for perf
+  snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+  assert(access(path, R_OK) == 0);
+  unlink(path);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,254 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "glme.h"
+
+// Long linked list decoded iteratively with tail structure pointer fields
+
+#define NNODES 200000
+
+struct list
+{
+  struct link *head;
+};
+
+struct link
+{
+  int a;
+  double b;
+  struct link *next;
+};
+
+int encode_link(glme_buf_t *gb, const void *vptr)
+{
+  const struct link *lnk = (const struct link *)vptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, lnk->a, 0);
+  GLME_ENCODE_FLD_DOUBLE(gb, lnk->b, 0.0);
+  GLME_ENCODE_FLD_STRUCT(gb, 33, lnk->next, encode_link);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_list(glme_buf_t *gb, const void *ptr)
+{
+  const struct list *l = (const struct list *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_STRUCT(gb, 33, l->head, encode_link);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+// recursive decoders
+int decode_link(glme_buf_t *gb, void *ptr)
+{
+  struct link *lnk = (struct link *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, lnk->a, 0);
+  GLME_DECODE_FLD_DOUBLE(gb, lnk->b, 0.0);
+  GLME_DECODE_FLD_STRUCT_PTR(gb, 33, lnk->next, decode_link);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int decode_list(glme_buf_t *gb, void *ptr)
+{
+  struct list *l = (struct list *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_STRUCT_PTR(gb, 33, l->head, decode_link);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// iterative decoders
+int tail_decode_link(glme_buf_t *gb, void *ptr)
+{
+  struct link *lnk = (struct link *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, lnk->a, 0);
+  GLME_DECODE_FLD_DOUBLE(gb, lnk->b, 0.0);
+  GLME_DECODE_FLD_STRUCT_PTR_TAIL(gb, 33, lnk->next, tail_decode_link);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int tail_decode_list(glme_buf_t *gb, void *ptr)
+{
+  struct list *l = (struct list *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_STRUCT_PTR_TAIL(gb, 33, l->head, tail_decode_link);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// lists as array elements with descriptor table and registered functions
+struct lists
+{
+  size_t n;
+  struct list *v;
+};
+
+glme_field_t lists_fields[] = {
+  GLME_FIELD_STRUCT_ARRAY(struct lists, v, n, 32, (const glme_desc_t *)0)
+};
+glme_desc_t lists_desc = GLME_DESC(34, struct lists, lists_fields);
+
+static glme_buf_t gbuf;
+static struct list l0, l1;
+static int result;
+
+static
+void *encoder(void *arg)
+{
+  result = glme_encode_struct(&gbuf, 32, &l0, encode_list);
+  return (void *)0;
+}
+
+static
+void *decoder(void *arg)
+{
+  struct list *lp = &l1;
+  glme_buf_reset(&gbuf);
+  result = glme_decode_struct(&gbuf, 32, (void **)&lp, 0, tail_decode_list);
+  return (void *)0;
+}
+
+static
+void run(void *(*func)(void *), size_t stacksize)
+{
+  pthread_t th;
+  pthread_attr_t attr;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, stacksize);
+  assert(pthread_create(&th, &attr, func, (void *)0) == 0);
+  pthread_join(th, (void **)0);
+  pthread_attr_destroy(&attr);
+}
+
+static
+int listcmp(const struct list *a, const struct list *b)
+{
+  struct link *n0, *n1;
+  for (n0 = a->head, n1 = b->head; n0 && n1; n0 = n0->next, n1 = n1->next) {
+    if (n0->a != n1->a || n0->b != n1->b)
+      return 1;
+  }
+  return n0 || n1;
+}
+
+static
+void listfree(struct list *l)
+{
+  struct link *n, *next;
+  for (n = l->head; n; n = next) {
+    next = n->next;
+    free(n);
+  }
+  l->head = (struct link *)0;
+}
+
+int main(int argc, char **argv)
+{
+  struct link *nodes, t0[] = {
+    { .a = 1,  .b = -2.0, .next = (struct link *)0},
+    { .a = 0,  .b = -3.0, .next = (struct link *)0},
+    { .a = -2, .b =  0.0, .next = (struct link *)0}
+  };
+  struct list l2, *lp;
+  struct lists s0, s1;
+  struct list lv[2];
+  glme_spec_t specs[2];
+  glme_base_t base;
+  int k, n;
+  size_t len;
+
+  t0[0].next = &t0[1];
+  t0[1].next = &t0[2];
+  l0 = (struct list){t0};
+  glme_buf_init(&gbuf, 1024);
+
+  // same result as recursive decoding
+  n = glme_encode_struct(&gbuf, 32, &l0, encode_list);
+  lp = &l1;
+  assert(glme_decode_struct(&gbuf, 32, (void **)&lp, 0, tail_decode_list) == n);
+  glme_buf_reset(&gbuf);
+  lp = &l2;
+  assert(glme_decode_struct(&gbuf, 32, (void **)&lp, 0, decode_list) == n);
+  assert(listcmp(&l0, &l1) == 0 && listcmp(&l1, &l2) == 0);
+  listfree(&l1);
+  listfree(&l2);
+
+  // truncated input; nothing left linked
+  for (len = 1; len < n; len++) {
+    glme_buf_reset(&gbuf);
+    gbuf.count = len;
+    lp = &l1;
+    l1.head = t0;
+    assert(glme_decode_struct(&gbuf, 32, (void **)&lp, 0, tail_decode_list) < 0);
+    assert(l1.head == 0);
+  }
+  // missing end marker of a structure with deferred tail
+  gbuf.count = n;
+  assert(gbuf.buf[n-1] == 0 && gbuf.buf[n-2] == 0);
+  gbuf.buf[n-2] = 5;
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_struct(&gbuf, 32, (void **)&lp, 0, tail_decode_list) < 0);
+  assert(gbuf.last_error == GLME_E_TYPE && l1.head == 0);
+
+  // array elements
+  glme_spec_init(&specs[0], 32, encode_list, tail_decode_list, sizeof(struct list));
+  glme_spec_init(&specs[1], 33, encode_link, tail_decode_link, sizeof(struct link));
+  glme_base_init(&base, specs, 2, (glme_allocator_t *)0);
+  gbuf.base = &base;
+  assert(glme_desc_init(&lists_desc) == 0);
+  lv[0] = l0;
+  lv[1] = (struct list){&t0[1]};
+  s0 = (struct lists){2, lv};
+  glme_buf_clear(&gbuf);
+  n = glme_encode_desc(&gbuf, &lists_desc, &s0);
+  assert(n > 0);
+  assert(glme_decode_desc(&gbuf, &lists_desc, &s1) == n);
+  assert(s1.n == 2 && listcmp(&s1.v[0], &lv[0]) == 0 && listcmp(&s1.v[1], &lv[1]) == 0);
+  listfree(&s1.v[0]);
+  listfree(&s1.v[1]);
+  free(s1.v);
+  gbuf.base = (glme_base_t *)0;
+  glme_base_release(&base);
+
+  // long list; recursive encoder with large stack, decoder with small stack
+  nodes = (struct link *)calloc(NNODES, sizeof(struct link));
+  for (k = 0; k < NNODES; k++) {
+    nodes[k].a = k;
+    nodes[k].b = -k;
+    nodes[k].next = k < NNODES-1 ? &nodes[k+1] : (struct link *)0;
+  }
+  l0 = (struct list){nodes};
+  glme_buf_clear(&gbuf);
+  assert(glme_buf_reserve(&gbuf, NNODES * 24) == 0);
+  run(encoder, (size_t)512 << 20);
+  assert(result > 0);
+  n = result;
+  run(decoder, 64 << 10);
+  assert(result == n);
+  assert(listcmp(&l0, &l1) == 0);
+  listfree(&l1);
+  free(nodes);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,281 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "glme.h"
+
+// Long linked list encoded iteratively with tail structure pointer fields
+
+#define NNODES 200000
+
+struct list
+{
+  struct link *head;
+};
+
+struct link
+{
+  int a;
+  double b;
+  struct link *next;
+};
+
+struct lists
+{
+  size_t n;
+  struct list *v;
+};
+
+// recursive encoders
+int encode_link(glme_buf_t *gb, const void *vptr)
+{
+  const struct link *lnk = (const struct link *)vptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, lnk->a, 0);
+  GLME_ENCODE_FLD_DOUBLE(gb, lnk->b, 0.0);
+  GLME_ENCODE_FLD_STRUCT(gb, 33, lnk->next, encode_link);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_list(glme_buf_t *gb, const void *ptr)
+{
+  const struct list *l = (const struct list *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_STRUCT(gb, 33, l->head, encode_link);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_lists(glme_buf_t *gb, const void *ptr)
+{
+  const struct lists *s = (const struct lists *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  __e = glme_encode_field(gb, &__delta, 32, GLME_F_ARRAY, s->v, s->n,
+                          sizeof(struct list), encode_list);
+  if (__e < 0)
+    return __e;
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+// iterative encoders
+int tail_encode_link(glme_buf_t *gb, const void *vptr)
+{
+  const struct link *lnk = (const struct link *)vptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, lnk->a, 0);
+  GLME_ENCODE_FLD_DOUBLE(gb, lnk->b, 0.0);
+  GLME_ENCODE_FLD_STRUCT_TAIL(gb, 33, lnk->next, tail_encode_link);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int tail_encode_list(glme_buf_t *gb, const void *ptr)
+{
+  const struct list *l = (const struct list *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_STRUCT_TAIL(gb, 33, l->head, tail_encode_link);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int tail_encode_lists(glme_buf_t *gb, const void *ptr)
+{
+  const struct lists *s = (const struct lists *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  __e = glme_encode_field(gb, &__delta, 32, GLME_F_ARRAY, s->v, s->n,
+                          sizeof(struct list), tail_encode_list);
+  if (__e < 0)
+    return __e;
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+// registered encoder of links
+int reg_encode_link(glme_buf_t *gb, const void *vptr)
+{
+  const struct link *lnk = (const struct link *)vptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, lnk->a, 0);
+  GLME_ENCODE_FLD_DOUBLE(gb, lnk->b, 0.0);
+  GLME_ENCODE_FLD_STRUCT_TAIL(gb, 33, lnk->next, (glme_encoder_f)0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_link(glme_buf_t *gb, void *ptr)
+{
+  struct link *lnk = (struct link *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, lnk->a, 0);
+  GLME_DECODE_FLD_DOUBLE(gb, lnk->b, 0.0);
+  GLME_DECODE_FLD_STRUCT_PTR_TAIL(gb, 33, lnk->next, decode_link);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int decode_list(glme_buf_t *gb, void *ptr)
+{
+  struct list *l = (struct list *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_STRUCT_PTR_TAIL(gb, 33, l->head, decode_link);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+static glme_buf_t gbuf;
+static struct list l0, l1;
+static int result;
+
+static
+void *encoder(void *arg)
+{
+  result = glme_encode_struct(&gbuf, 32, &l0, (glme_encoder_f)arg);
+  return (void *)0;
+}
+
+static
+void run(void *(*func)(void *), void *arg, size_t stacksize)
+{
+  pthread_t th;
+  pthread_attr_t attr;
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, stacksize);
+  assert(pthread_create(&th, &attr, func, arg) == 0);
+  pthread_join(th, (void **)0);
+  pthread_attr_destroy(&attr);
+}
+
+static
+int listcmp(const struct list *a, const struct list *b)
+{
+  struct link *n0, *n1;
+  for (n0 = a->head, n1 = b->head; n0 && n1; n0 = n0->next, n1 = n1->next) {
+    if (n0->a != n1->a || n0->b != n1->b)
+      return 1;
+  }
+  return n0 || n1;
+}
+
+static
+void listfree(struct list *l)
+{
+  struct link *n, *next;
+  for (n = l->head; n; n = next) {
+    next = n->next;
+    free(n);
+  }
+  l->head = (struct link *)0;
+}
+
+static
+int encode_both(glme_buf_t *ref, glme_buf_t *gb, int typeid, const void *ptr,
+                glme_encoder_f rfunc, glme_encoder_f tfunc)
+{
+  int n;
+  glme_buf_clear(ref);
+  glme_buf_clear(gb);
+  n = glme_encode_struct(ref, typeid, ptr, rfunc);
+  assert(n > 0);
+  assert(glme_encode_struct(gb, typeid, ptr, tfunc) == n);
+  assert(glme_buf_len(gb) == n);
+  assert(memcmp(glme_buf_data(ref), glme_buf_data(gb), n) == 0);
+  return n;
+}
+
+int main(int argc, char **argv)
+{
+  struct link *nodes, t0[] = {
+    { .a = 1,  .b = -2.0, .next = (struct link *)0},
+    { .a = 0,  .b = -3.0, .next = (struct link *)0},
+    { .a = -2, .b =  0.0, .next = (struct link *)0}
+  };
+  struct list lv[3], *lp;
+  struct lists s0;
+  glme_buf_t ref;
+  glme_spec_t specs[1];
+  glme_base_t base;
+  int k, n;
+
+  t0[0].next = &t0[1];
+  t0[1].next = &t0[2];
+  l0 = (struct list){t0};
+  glme_buf_init(&ref, 1024);
+  // small buffer; grows while encoding
+  glme_buf_init(&gbuf, 4);
+
+  // same bytes as recursive encoding
+  n = encode_both(&ref, &gbuf, 32, &l0, encode_list, tail_encode_list);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+  lp = &l1;
+  assert(glme_decode_struct(&gbuf, 32, (void **)&lp, 0, decode_list) == n);
+  assert(listcmp(&l0, &l1) == 0);
+  listfree(&l1);
+
+  // empty list
+  l0 = (struct list){(struct link *)0};
+  encode_both(&ref, &gbuf, 32, &l0, encode_list, tail_encode_list);
+
+  // array elements
+  lv[0] = (struct list){t0};
+  lv[1] = (struct list){(struct link *)0};
+  lv[2] = (struct list){&t0[2]};
+  s0 = (struct lists){3, lv};
+  encode_both(&ref, &gbuf, 34, &s0, encode_lists, tail_encode_lists);
+
+  // registered encoder function
+  glme_spec_init(&specs[0], 33, reg_encode_link, decode_link, sizeof(struct link));
+  glme_base_init(&base, specs, 1, (glme_allocator_t *)0);
+  gbuf.base = &base;
+  encode_both(&ref, &gbuf, 33, t0, encode_link, (glme_encoder_f)0);
+  gbuf.base = (glme_base_t *)0;
+  glme_base_release(&base);
+
+  // long list; recursive encoder with large stack, iterative with small stack
+  nodes = (struct link *)calloc(NNODES, sizeof(struct link));
+  for (k = 0; k < NNODES; k++) {
+    nodes[k].a = k;
+    nodes[k].b = -k;
+    nodes[k].next = k < NNODES-1 ? &nodes[k+1] : (struct link *)0;
+  }
+  l0 = (struct list){nodes};
+  glme_buf_clear(&gbuf);
+  run(encoder, (void *)encode_list, (size_t)512 << 20);
+  assert(result > 0);
+  n = result;
+  glme_buf_close(&ref);
+  ref = gbuf;
+  glme_buf_init(&gbuf, 1024);
+  run(encoder, (void *)tail_encode_list, 64 << 10);
+  assert(result == n);
+  assert(memcmp(glme_buf_data(&ref), glme_buf_data(&gbuf), n) == 0);
+
+  glme_buf_reset(&gbuf);
+  lp = &l1;
+  assert(glme_decode_struct(&gbuf, 32, (void **)&lp, 0, decode_list) == n);
+  assert(listcmp(&l0, &l1) == 0);
+  listfree(&l1);
+  free(nodes);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,279 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Shared and cyclic structures with object identity tables
+
+#define NNODES 100000
+
+struct node
+{
+  int v;
+  struct node *left;
+  struct node *right;
+};
+
+int encode_node(glme_buf_t *gb, const void *ptr)
+{
+  const struct node *p = (const struct node *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->v, 0);
+  GLME_ENCODE_FLD_STRUCT(gb, 40, p->left, encode_node);
+  GLME_ENCODE_FLD_STRUCT(gb, 40, p->right, encode_node);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_node(glme_buf_t *gb, void *ptr)
+{
+  struct node *p = (struct node *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->v, 0);
+  GLME_DECODE_FLD_STRUCT_PTR(gb, 40, p->left, decode_node);
+  GLME_DECODE_FLD_STRUCT_PTR(gb, 40, p->right, decode_node);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// doubly linked ring; next pointer as tail field
+struct link
+{
+  int a;
+  struct link *prev;
+  struct link *next;
+};
+
+int encode_link(glme_buf_t *gb, const void *ptr)
+{
+  const struct link *p = (const struct link *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->a, 0);
+  GLME_ENCODE_FLD_STRUCT(gb, 41, p->prev, encode_link);
+  GLME_ENCODE_FLD_STRUCT_TAIL(gb, 41, p->next, encode_link);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_link(glme_buf_t *gb, void *ptr)
+{
+  struct link *p = (struct link *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->a, 0);
+  GLME_DECODE_FLD_STRUCT_PTR(gb, 41, p->prev, decode_link);
+  GLME_DECODE_FLD_STRUCT_PTR_TAIL(gb, 41, p->next, decode_link);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// embedded node; numbered but never sent as back-reference
+struct outer
+{
+  struct node *ptr;
+  struct node emb;
+};
+
+int encode_outer(glme_buf_t *gb, const void *ptr)
+{
+  const struct outer *p = (const struct outer *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_STRUCT(gb, 40, p->ptr, encode_node);
+  GLME_ENCODE_FLD_STRUCT_EMBED(gb, 40, p->emb, encode_node);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_outer(glme_buf_t *gb, void *ptr)
+{
+  struct outer *p = (struct outer *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_STRUCT_PTR(gb, 40, p->ptr, decode_node);
+  GLME_DECODE_FLD_STRUCT(gb, 40, p->emb, decode_node);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// same node with descriptor table
+glme_field_t node_fields[] = {
+  GLME_FIELD_INT(struct node, v, 0),
+  GLME_FIELD_STRUCT_PTR(struct node, left, 42, (const glme_desc_t *)0),
+  GLME_FIELD_STRUCT_PTR(struct node, right, 42, (const glme_desc_t *)0)
+};
+glme_desc_t node_desc = GLME_DESC(42, struct node, node_fields);
+
+glme_field_t outer_fields[] = {
+  GLME_FIELD_STRUCT_PTR(struct outer, ptr, 42, &node_desc),
+  GLME_FIELD_STRUCT(struct outer, emb, 42, &node_desc)
+};
+glme_desc_t outer_desc = GLME_DESC(44, struct outer, outer_fields);
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf;
+  glme_refs_t refs;
+  glme_spec_t spec;
+  glme_base_t base;
+  struct node n[4], *np;
+  struct link *ring, *lp;
+  struct outer o0, o1, *op;
+  int k, n0, n1;
+
+  glme_buf_init(&gbuf, 64);
+
+  // diamond; node 3 reached twice
+  n[3] = (struct node){3, (struct node *)0, (struct node *)0};
+  n[1] = (struct node){1, &n[3], (struct node *)0};
+  n[2] = (struct node){2, (struct node *)0, &n[3]};
+  n[0] = (struct node){0, &n[1], &n[2]};
+
+  n0 = glme_encode_struct(&gbuf, 40, &n[0], encode_node);
+  glme_buf_clear(&gbuf);
+  glme_refs_begin(&gbuf, &refs);
+  n1 = glme_encode_struct(&gbuf, 40, &n[0], encode_node);
+  glme_refs_end(&gbuf, &refs);
+  assert(n1 > 0 && n1 < n0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  np = (struct node *)0;
+  glme_refs_begin(&gbuf, &refs);
+  assert(glme_decode_struct(&gbuf, 40, (void **)&np, sizeof(struct node), decode_node) == n1);
+  glme_refs_end(&gbuf, &refs);
+  assert(np->v == 0 && np->left->v == 1 && np->right->v == 2);
+  assert(np->left->left == np->right->right && np->left->left->v == 3);
+  free(np->left->left);
+  free(np->left);
+  free(np->right);
+  free(np);
+
+  // back-reference without identity tables is an error
+  glme_buf_reset(&gbuf);
+  np = (struct node *)0;
+  assert(glme_decode_struct(&gbuf, 40, (void **)&np, sizeof(struct node), decode_node) < 0);
+
+  // cycle to the top level structure
+  n[3].left = &n[0];
+  glme_buf_clear(&gbuf);
+  glme_refs_begin(&gbuf, &refs);
+  n1 = glme_encode_struct(&gbuf, 40, &n[0], encode_node);
+  glme_refs_end(&gbuf, &refs);
+  np = (struct node *)0;
+  glme_refs_begin(&gbuf, &refs);
+  assert(glme_decode_struct(&gbuf, 40, (void **)&np, sizeof(struct node), decode_node) == n1);
+  glme_refs_end(&gbuf, &refs);
+  assert(np->left->left->left == np);
+  free(np->left->left);
+  free(np->left);
+  free(np->right);
+  free(np);
+
+  // descriptor tables and registered spec
+  glme_spec_init(&spec, 42, (glme_encoder_f)0, (glme_decoder_f)0, sizeof(struct node));
+  spec.desc = &node_desc;
+  glme_base_init(&base, &spec, 1, (glme_allocator_t *)0);
+  assert(glme_desc_init(&node_desc) == 0);
+  gbuf.base = &base;
+  glme_buf_clear(&gbuf);
+  glme_refs_begin(&gbuf, &refs);
+  assert(glme_encode_struct(&gbuf, 42, &n[0], (glme_encoder_f)0) > 0);
+  glme_refs_end(&gbuf, &refs);
+  np = (struct node *)0;
+  glme_refs_begin(&gbuf, &refs);
+  assert(glme_decode_struct(&gbuf, 42, (void **)&np, 0, (glme_decoder_f)0) > 0);
+  glme_refs_end(&gbuf, &refs);
+  assert(np->left->left == np->right->right && np->left->left->left == np);
+  free(np->left->left);
+  free(np->left);
+  free(np->right);
+  free(np);
+  gbuf.base = (glme_base_t *)0;
+  glme_base_release(&base);
+  glme_desc_release(&node_desc);
+
+  // pointer to embedded structure field
+  o0 = (struct outer){&n[3], (struct node){5, &n[3], (struct node *)0}};
+  n[3].left = (struct node *)0;
+  glme_buf_clear(&gbuf);
+  glme_refs_begin(&gbuf, &refs);
+  n1 = glme_encode_struct(&gbuf, 43, &o0, encode_outer);
+  glme_refs_end(&gbuf, &refs);
+  op = &o1;
+  glme_refs_begin(&gbuf, &refs);
+  assert(glme_decode_struct(&gbuf, 43, (void **)&op, 0, decode_outer) == n1);
+  glme_refs_end(&gbuf, &refs);
+  assert(o1.emb.left == o1.ptr && o1.ptr->v == 3);
+  free(o1.ptr);
+  o0.emb.left = (struct node *)0;
+  o0.ptr = &o0.emb;
+  glme_buf_clear(&gbuf);
+  glme_refs_begin(&gbuf, &refs);
+  n1 = glme_encode_struct(&gbuf, 43, &o0, encode_outer);
+  glme_refs_end(&gbuf, &refs);
+  glme_refs_begin(&gbuf, &refs);
+  assert(glme_decode_struct(&gbuf, 43, (void **)&op, 0, decode_outer) == n1);
+  glme_refs_end(&gbuf, &refs);
+  assert(o1.ptr->v == 5 && o1.emb.v == 5 && !o1.emb.left);
+  free(o1.ptr);
+
+  assert(glme_desc_init(&node_desc) == 0 && glme_desc_init(&outer_desc) == 0);
+  glme_buf_clear(&gbuf);
+  glme_refs_begin(&gbuf, &refs);
+  n1 = glme_encode_desc(&gbuf, &outer_desc, &o0);
+  glme_refs_end(&gbuf, &refs);
+  // both nodes in full
+  assert(n1 == 13);
+  memset(&o1, 0, sizeof(o1));
+  glme_refs_begin(&gbuf, &refs);
+  assert(glme_decode_desc(&gbuf, &outer_desc, &o1) == n1);
+  glme_refs_end(&gbuf, &refs);
+  assert(o1.ptr->v == 5 && o1.emb.v == 5);
+  free(o1.ptr);
+  glme_desc_release(&outer_desc);
+  glme_desc_release(&node_desc);
+
+  // long doubly linked list with last linked to first; linear size and time
+  ring = (struct link *)calloc(NNODES, sizeof(struct link));
+  for (k = 0; k < NNODES; k++) {
+    ring[k].a = k;
+    ring[k].next = &ring[(k + 1) % NNODES];
+    ring[k].prev = k > 0 ? &ring[k - 1] : (struct link *)0;
+  }
+  glme_buf_clear(&gbuf);
+  glme_refs_begin(&gbuf, &refs);
+  n1 = glme_encode_struct(&gbuf, 41, &ring[0], encode_link);
+  glme_refs_end(&gbuf, &refs);
+  assert(n1 > 0 && n1 < NNODES * 16);
+
+  lp = (struct link *)0;
+  glme_refs_begin(&gbuf, &refs);
+  assert(glme_decode_struct(&gbuf, 41, (void **)&lp, sizeof(struct link), decode_link) == n1);
+  glme_refs_end(&gbuf, &refs);
+  assert(lp->prev == 0);
+  for (k = 0; k < NNODES; k++, lp = lp->next) {
+    assert(lp->a == k && (k == NNODES-1 || lp->next->prev == lp));
+    assert(k == 0 || lp->prev->next == lp);
+  }
+  assert(lp->a == 0);
+  for (k = 0; k < NNODES; k++) {
+    struct link *next = lp->next;
+    free(lp);
+    lp = next;
+  }
+  free(ring);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,314 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+#define NDEEP 100000
+
+// Skipping elements with wire format only
+
+struct point
+{
+  int x, y;
+};
+
+struct msg
+{
+  int64_t i;
+  uint64_t u;
+  double d;
+  char tag[4];
+  char *name;
+  size_t ilen;
+  int64_t *ivals;
+  size_t dlen;
+  double *dvals;
+  struct point *pt;
+  size_t plen;
+  struct point *pts;
+  int64_t last;
+};
+
+int encode_point(glme_buf_t *gb, const void *ptr)
+{
+  const struct point *p = (const struct point *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->x, 0);
+  GLME_ENCODE_FLD_INT(gb, p->y, 0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_msg(glme_buf_t *gb, const void *ptr)
+{
+  const struct msg *m = (const struct msg *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, m->i, 0);
+  GLME_ENCODE_FLD_UINT(gb, m->u, 0);
+  GLME_ENCODE_FLD_DOUBLE(gb, m->d, 0.0);
+  GLME_ENCODE_FLD_VECTOR(gb, m->tag, sizeof(m->tag));
+  GLME_ENCODE_FLD_STRING(gb, m->name);
+  GLME_ENCODE_FLD_INT_ARRAY(gb, m->ivals, m->ilen, glme_encode_value_int64);
+  GLME_ENCODE_FLD_FLOAT_ARRAY(gb, m->dvals, m->dlen, glme_encode_value_double);
+  GLME_ENCODE_FLD_STRUCT(gb, 40, m->pt, encode_point);
+  __e = glme_encode_field(gb, &__delta, 40, GLME_F_ARRAY, m->pts, m->plen,
+                          sizeof(struct point), encode_point);
+  if (__e < 0)
+    return __e;
+  GLME_ENCODE_FLD_INT(gb, m->last, 0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+// older version of point without y
+int old_decode_point(glme_buf_t *gb, void *ptr)
+{
+  struct point *p = (struct point *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->x, 0);
+  GLME_DECODE_STRUCT_END_SKIP(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int strict_decode_point(glme_buf_t *gb, void *ptr)
+{
+  struct point *p = (struct point *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->x, 0);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// older version of msg as descriptor table
+struct old_msg
+{
+  int64_t i;
+  uint64_t u;
+  double d;
+};
+
+glme_field_t old_msg_fields[] = {
+  GLME_FIELD_INT(struct old_msg, i, 0),
+  GLME_FIELD_UINT(struct old_msg, u, 0),
+  GLME_FIELD_DOUBLE(struct old_msg, d, 2.5)
+};
+glme_desc_t old_msg_desc = GLME_DESC(42, struct old_msg, old_msg_fields);
+
+// newer version of link with a field after next pointer
+struct link
+{
+  int a;
+  struct link *next;
+  int b;
+};
+
+int new_encode_link(glme_buf_t *gb, const void *ptr)
+{
+  const struct link *p = (const struct link *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->a, 0);
+  GLME_ENCODE_FLD_STRUCT(gb, 41, p->next, new_encode_link);
+  GLME_ENCODE_FLD_INT(gb, p->b, 0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int old_decode_link(glme_buf_t *gb, void *ptr)
+{
+  struct link *p = (struct link *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->a, 0);
+  GLME_DECODE_FLD_STRUCT_PTR_TAIL(gb, 41, p->next, old_decode_link);
+  GLME_DECODE_STRUCT_END_SKIP(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, deep;
+  int64_t ivals[40];
+  double dvals[3] = {1.0, -2.5, 1e100};
+  struct point pt = {3, -4}, pts[3] = {{1, 2}, {0, 0}, {-100000, 7}}, p1, *pp;
+  struct link lv[3], *lp;
+  struct msg m0;
+  struct old_msg om;
+  glme_jit_t jit;
+  glme_spec_t spec;
+  int k, n, nf;
+  size_t len;
+  uint64_t delta;
+  int typeid;
+
+  glme_buf_init(&gbuf, 64);
+  // mix of single and multi-byte values
+  for (k = 0; k < 40; k++)
+    ivals[k] = k % 7 ? k : -((int64_t)1 << k);
+  m0 = (struct msg){.i = -12345, .u = 1ull << 63, .d = 0.5, .tag = {'a', 'b', 'c', 'd'},
+                    .name = "message", .ilen = 40, .ivals = ivals, .dlen = 3, .dvals = dvals,
+                    .pt = &pt, .plen = 3, .pts = pts, .last = 9};
+
+  // whole message
+  n = glme_encode_struct(&gbuf, 42, &m0, encode_msg);
+  assert(n > 0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == n);
+  assert(gbuf.current == n);
+
+  // field by field; last field found after skipping others
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_type(&gbuf, &typeid) > 0 && typeid == 42);
+  for (nf = 0; ; nf++) {
+    assert(glme_decode_value_uint64(&gbuf, &delta) > 0);
+    if (delta == 0)
+      break;
+    if (nf < 9) {
+      assert(glme_skip(&gbuf) > 0);
+      continue;
+    }
+    assert(glme_decode_type(&gbuf, &typeid) > 0 && typeid == GLME_INT);
+    assert(glme_decode_value_uint64(&gbuf, &delta) == 1 && delta == 9*2);
+  }
+  assert(nf == 10 && gbuf.current == n);
+  // skip the remaining fields
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_type(&gbuf, &typeid) > 0);
+  assert(glme_skip_fields(&gbuf) == n - 1);
+
+  // truncated input
+  for (len = 0; len < n; len++) {
+    glme_buf_reset(&gbuf);
+    gbuf.count = len;
+    assert(glme_skip(&gbuf) < 0);
+    assert(gbuf.current == 0);
+  }
+  gbuf.count = n;
+
+  // malformed value; byte count over eight
+  glme_buf_clear(&gbuf);
+  m0 = (struct msg){.i = 1000};
+  n = glme_encode_struct(&gbuf, 42, &m0, encode_msg);
+  assert(gbuf.buf[3] == (char)0xFE);
+  gbuf.buf[3] = (char)0x90;
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == GLME_E_INVAL);
+  assert(gbuf.last_error == GLME_E_INVAL);
+
+  // base type id without value encoding
+  glme_buf_clear(&gbuf);
+  gbuf.buf[0] = GLME_NAMED_MAP << 1;
+  gbuf.count = 1;
+  assert(glme_skip(&gbuf) == GLME_E_TYPE);
+
+  // back-reference as element, key or value type; count beyond input
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x14\x01\xff\xff\xff\xff\x0f", 7);
+  gbuf.count = 7;
+  assert(glme_skip(&gbuf) == GLME_E_TYPE && gbuf.current == 0);
+  memcpy(gbuf.buf, "\x16\x0c\x03\xff\xff\xff\xff\x0f", 8);
+  gbuf.count = 8;
+  assert(glme_skip(&gbuf) == GLME_E_TYPE);
+  memcpy(gbuf.buf, "\x14\x0c\x7f\x00\x00", 5);
+  gbuf.count = 5;
+  assert(glme_skip(&gbuf) == GLME_E_UFLOW);
+
+  // deeply nested structures do not recurse
+  glme_buf_init(&deep, 3 * NDEEP + 2);
+  deep.buf[0] = 32;
+  for (k = 0; k < NDEEP; k++) {
+    deep.buf[1 + 2*k] = 1;
+    deep.buf[2 + 2*k] = 32;
+  }
+  memset(&deep.buf[1 + 2*NDEEP], 0, NDEEP + 1);
+  deep.count = 3 * NDEEP + 2;
+  assert(glme_skip(&deep) == 3 * NDEEP + 2);
+  deep.count--;
+  glme_buf_reset(&deep);
+  assert(glme_skip(&deep) < 0 && deep.current == 0);
+  glme_buf_close(&deep);
+
+  // list and dictionary of the Python binding
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x14\x00\x02\x04\x02\x0c\x01" "a\x16\x0c\x04\x01\x01" "k\x06", 15);
+  gbuf.count = 15;
+  assert(glme_skip(&gbuf) == 8);
+  assert(glme_skip(&gbuf) == 7);
+
+  // older decoder skips unknown trailing fields
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 40, &pt, encode_point);
+  pp = &p1;
+  assert(glme_decode_struct(&gbuf, 40, (void **)&pp, 0, strict_decode_point) < 0);
+  glme_buf_reset(&gbuf);
+  p1 = (struct point){0, 0};
+  assert(glme_decode_struct(&gbuf, 40, (void **)&pp, 0, old_decode_point) == n);
+  assert(p1.x == 3 && p1.y == 0);
+
+  // descriptor skips fields of newer encoder; omitted ones get defaults
+  glme_buf_clear(&gbuf);
+  m0 = (struct msg){.i = -12345, .u = 1ull << 63, .tag = {'a', 'b', 'c', 'd'},
+                    .name = "message", .ilen = 40, .ivals = ivals, .dlen = 3, .dvals = dvals,
+                    .pt = &pt, .plen = 3, .pts = pts, .last = 9};
+  n = glme_encode_struct(&gbuf, 42, &m0, encode_msg);
+  assert(glme_desc_init(&old_msg_desc) == 0);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_type(&gbuf, &typeid) > 0 && typeid == 42);
+  assert(glme_decode_desc(&gbuf, &old_msg_desc, &om) == n - 1);
+  assert(om.i == -12345 && om.u == 1ull << 63 && om.d == 2.5);
+  // truncated trailing fields
+  for (len = 1; len < n; len++) {
+    glme_buf_reset(&gbuf);
+    gbuf.count = len;
+    assert(glme_decode_type(&gbuf, &typeid) > 0);
+    assert(glme_decode_desc(&gbuf, &old_msg_desc, &om) < 0);
+  }
+  gbuf.count = n;
+  if (glme_jit_compile(&jit, &spec, &old_msg_desc, 0) > 0) {
+    glme_buf_reset(&gbuf);
+    assert(glme_decode_type(&gbuf, &typeid) > 0);
+    om = (struct old_msg){0, 0, 0.0};
+    assert(spec.decoder(&gbuf, &om) == n - 1);
+    assert(om.i == -12345 && om.u == 1ull << 63 && om.d == 2.5);
+    for (len = 1; len < n; len++) {
+      glme_buf_reset(&gbuf);
+      gbuf.count = len;
+      assert(glme_decode_type(&gbuf, &typeid) > 0);
+      assert(spec.decoder(&gbuf, &om) < 0);
+    }
+    gbuf.count = n;
+    glme_jit_release(&jit);
+  }
+  glme_desc_release(&old_msg_desc);
+
+  // deferred end markers of tail decoder
+  lv[0] = (struct link){1, &lv[1], 10};
+  lv[1] = (struct link){2, &lv[2], 20};
+  lv[2] = (struct link){3, (struct link *)0, 30};
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 41, &lv[0], new_encode_link);
+  lp = (struct link *)0;
+  assert(glme_decode_struct(&gbuf, 41, (void **)&lp, sizeof(struct link), old_decode_link) == n);
+  assert(lp->a == 1 && lp->next->a == 2 && lp->next->next->a == 3 && !lp->next->next->next);
+  free(lp->next->next);
+  free(lp->next);
+  free(lp);
+
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,162 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Field index and projection decoding of wide messages
+
+#define NVALS 64
+
+struct wide
+{
+  int64_t id;
+  char *route;
+  size_t vlen;
+  int64_t *vals;
+  double price;
+  uint64_t seq;
+  char *note;
+  int64_t extra[4];
+};
+
+int encode_wide(glme_buf_t *gb, const void *ptr)
+{
+  const struct wide *w = (const struct wide *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, w->id, 0);
+  GLME_ENCODE_FLD_STRING(gb, w->route);
+  GLME_ENCODE_FLD_INT_ARRAY(gb, w->vals, w->vlen, glme_encode_value_int64);
+  GLME_ENCODE_FLD_DOUBLE(gb, w->price, 0.0);
+  GLME_ENCODE_FLD_UINT(gb, w->seq, 0);
+  GLME_ENCODE_FLD_STRING(gb, w->note);
+  GLME_ENCODE_FLD_INT(gb, w->extra[0], 0);
+  GLME_ENCODE_FLD_INT(gb, w->extra[1], 0);
+  GLME_ENCODE_FLD_INT(gb, w->extra[2], 0);
+  GLME_ENCODE_FLD_INT(gb, w->extra[3], 0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+// projection; id, price and seq only
+int decode_route(glme_buf_t *gb, void *ptr)
+{
+  struct wide *w = (struct wide *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, w->id, 0);
+  GLME_DECODE_FLD_SKIP(gb);
+  GLME_DECODE_FLD_SKIP(gb);
+  GLME_DECODE_FLD_DOUBLE(gb, w->price, 0.0);
+  GLME_DECODE_FLD_UINT(gb, w->seq, 0);
+  GLME_DECODE_STRUCT_END_SKIP(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf;
+  glme_index_t index;
+  const glme_index_entry_t *e;
+  struct wide w0, w1, *wp;
+  int64_t vals[NVALS], i64;
+  uint64_t u64;
+  double d;
+  char *s;
+  size_t nl, len;
+  int k, n, n0;
+
+  for (k = 0; k < NVALS; k++)
+    vals[k] = k * 1000;
+  w0 = (struct wide){.id = 77, .route = "east", .vlen = NVALS, .vals = vals, .price = 12.5,
+                     .seq = 1000000, .note = "wide message", .extra = {0, 1, 0, -3}};
+  glme_buf_init(&gbuf, 64);
+  glme_index_init(&index);
+
+  // two messages; second omits some fields
+  n0 = glme_encode_struct(&gbuf, 50, &w0, encode_wide);
+  assert(n0 > 0);
+  w0.route = (char *)0;
+  w0.price = 0.0;
+  n = glme_encode_struct(&gbuf, 50, &w0, encode_wide);
+  assert(n > 0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  glme_buf_reset(&gbuf);
+  assert(glme_index_struct(&gbuf, &index) == n0);
+  assert(gbuf.current == n0 && index.start == 0 && index.end == n0);
+  assert(index.typeid == 50 && index.count == 8);
+  assert(index.fields[0].fno == 0 && index.fields[0].typeid == GLME_INT);
+  assert(index.fields[2].typeid == GLME_ARRAY);
+  assert(index.fields[7].fno == 9 && !glme_index_find(&index, 6));
+  assert((e = glme_index_find(&index, 3)) && e->typeid == GLME_FLOAT);
+
+  // any order, read pointer not moved
+  d = 0.0;
+  assert(glme_decode_indexed(&gbuf, &index, 3, GLME_FLOAT, 0, &d, &nl, 1,
+                             (glme_decoder_f)glme_decode_double) > 0);
+  assert(d == 12.5 && gbuf.current == n0);
+  i64 = -1;
+  assert(glme_decode_indexed(&gbuf, &index, 0, GLME_INT, 0, &i64, &nl, 1,
+                             (glme_decoder_f)glme_decode_int64) > 0);
+  assert(i64 == 77);
+  s = (char *)0;
+  nl = 0;
+  assert(glme_decode_indexed(&gbuf, &index, 1, GLME_STRING, 0, &s, &nl, 1,
+                             (glme_decoder_f)0) > 0);
+  assert(strcmp(s, "east") == 0);
+  free(s);
+  // absent field; target not changed
+  i64 = 5;
+  assert(glme_decode_indexed(&gbuf, &index, 6, GLME_INT, 0, &i64, &nl, 1,
+                             (glme_decoder_f)glme_decode_int64) == 0);
+  assert(i64 == 5);
+  // wrong type
+  assert(glme_decode_indexed(&gbuf, &index, 4, GLME_INT, 0, &i64, &nl, 1,
+                             (glme_decoder_f)glme_decode_int64) < 0);
+  assert(gbuf.last_error == GLME_E_TYPE);
+
+  // same index for next message
+  assert(glme_index_struct(&gbuf, &index) == n);
+  assert(index.start == n0 && index.count == 6 && !glme_index_find(&index, 1));
+  u64 = 0;
+  assert(glme_decode_indexed(&gbuf, &index, 4, GLME_UINT, 0, &u64, &nl, 1,
+                             (glme_decoder_f)glme_decode_uint64) > 0);
+  assert(u64 == 1000000);
+
+  // projecting decoder
+  glme_buf_reset(&gbuf);
+  wp = &w1;
+  memset(&w1, 0, sizeof(w1));
+  assert(glme_decode_struct(&gbuf, 50, (void **)&wp, 0, decode_route) == n0);
+  assert(w1.id == 77 && w1.price == 12.5 && w1.seq == 1000000 && !w1.route && !w1.vals);
+  assert(glme_decode_struct(&gbuf, 50, (void **)&wp, 0, decode_route) == n);
+  assert(w1.id == 77 && w1.price == 0.0);
+
+  // truncated input; empty index and read pointer not moved
+  for (len = 0; len < n0; len++) {
+    glme_buf_reset(&gbuf);
+    gbuf.count = len;
+    assert(glme_index_struct(&gbuf, &index) < 0);
+    assert(index.count == 0 && gbuf.current == 0);
+  }
+  // not a structure
+  glme_buf_clear(&gbuf);
+  glme_encode_int64(&gbuf, &i64);
+  assert(glme_index_struct(&gbuf, &index) == GLME_E_TYPE);
+
+  glme_index_release(&gbuf, &index);
+  assert(index.fields == 0 && index.size == 0);
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,226 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Pull parser tokens over encoded stream
+
+struct point
+{
+  int x, y;
+};
+
+struct msg
+{
+  int64_t i;
+  uint64_t u;
+  double d;
+  char *name;
+  size_t ilen;
+  int64_t *ivals;
+  struct point *pt;
+  size_t plen;
+  struct point *pts;
+};
+
+int encode_point(glme_buf_t *gb, const void *ptr)
+{
+  const struct point *p = (const struct point *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->x, 0);
+  GLME_ENCODE_FLD_INT(gb, p->y, 0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_msg(glme_buf_t *gb, const void *ptr)
+{
+  const struct msg *m = (const struct msg *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, m->i, 0);
+  GLME_ENCODE_FLD_UINT(gb, m->u, 0);
+  GLME_ENCODE_FLD_DOUBLE(gb, m->d, 0.0);
+  GLME_ENCODE_FLD_STRING(gb, m->name);
+  GLME_ENCODE_FLD_INT_ARRAY(gb, m->ivals, m->ilen, glme_encode_value_int64);
+  GLME_ENCODE_FLD_STRUCT(gb, 40, m->pt, encode_point);
+  __e = glme_encode_field(gb, &__delta, 40, GLME_F_ARRAY, m->pts, m->plen,
+                          sizeof(struct point), encode_point);
+  if (__e < 0)
+    return __e;
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+// expected tokens; kind, type id and value or count
+struct expect
+{
+  int kind;
+  int typeid;
+  int64_t val;
+};
+
+static struct expect msg_tokens[] = {
+  {GLME_T_STRUCT, 42, 0},
+  {GLME_T_FIELD, 0, 0}, {GLME_T_SCALAR, GLME_INT, -5},
+  {GLME_T_FIELD, 0, 1}, {GLME_T_SCALAR, GLME_UINT, 300},
+  // field 2 omitted
+  {GLME_T_FIELD, 0, 3}, {GLME_T_BYTES, GLME_STRING, 4},
+  {GLME_T_FIELD, 0, 4}, {GLME_T_ARRAY, GLME_INT, 3},
+  {GLME_T_SCALAR, GLME_INT, 1}, {GLME_T_SCALAR, GLME_INT, -1000}, {GLME_T_SCALAR, GLME_INT, 0},
+  {GLME_T_ARRAY_END, GLME_INT, 0},
+  {GLME_T_FIELD, 0, 5}, {GLME_T_STRUCT, 40, 0},
+  {GLME_T_FIELD, 0, 0}, {GLME_T_SCALAR, GLME_INT, 3},
+  {GLME_T_STRUCT_END, 40, 0},
+  {GLME_T_FIELD, 0, 6}, {GLME_T_ARRAY, 40, 2},
+  {GLME_T_STRUCT, 40, 0},
+  {GLME_T_FIELD, 0, 1}, {GLME_T_SCALAR, GLME_INT, 2},
+  {GLME_T_STRUCT_END, 40, 0},
+  {GLME_T_STRUCT, 40, 0},
+  {GLME_T_STRUCT_END, 40, 0},
+  {GLME_T_ARRAY_END, 40, 0},
+  {GLME_T_STRUCT_END, 42, 0},
+  {GLME_T_EOF, 0, 0}
+};
+
+static
+void check(const glme_token_t *tok, const struct expect *e)
+{
+  assert(tok->kind == e->kind);
+  switch (e->kind) {
+  case GLME_T_FIELD:
+    assert(tok->fno == e->val);
+    break;
+  case GLME_T_SCALAR:
+    assert(tok->typeid == e->typeid);
+    assert(e->typeid == GLME_INT ? tok->v.i == e->val : tok->v.u == e->val);
+    break;
+  case GLME_T_BYTES:
+    assert(tok->typeid == e->typeid && tok->v.s.len == e->val);
+    break;
+  case GLME_T_ARRAY:
+    assert(tok->typeid == e->typeid && tok->count == e->val);
+    break;
+  case GLME_T_STRUCT:
+  case GLME_T_STRUCT_END:
+  case GLME_T_ARRAY_END:
+    assert(tok->typeid == e->typeid);
+    break;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf;
+  glme_reader_t rd;
+  glme_token_t tok;
+  struct point pt = {3, 0}, pts[2] = {{0, 2}, {0, 0}};
+  int64_t ivals[3] = {1, -1000, 0};
+  struct msg m0;
+  size_t k, len;
+  int n, t;
+
+  m0 = (struct msg){.i = -5, .u = 300, .name = "name", .ilen = 3, .ivals = ivals,
+                    .pt = &pt, .plen = 2, .pts = pts};
+  glme_buf_init(&gbuf, 64);
+  n = glme_encode_struct(&gbuf, 42, &m0, encode_msg);
+  assert(n > 0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  glme_buf_reset(&gbuf);
+  glme_reader_init(&rd, &gbuf);
+  for (k = 0; k < sizeof(msg_tokens)/sizeof(msg_tokens[0]); k++) {
+    assert(glme_reader_next(&rd, &tok) == msg_tokens[k].kind);
+    check(&tok, &msg_tokens[k]);
+    if (tok.kind == GLME_T_BYTES)
+      assert(memcmp(tok.v.s.ptr, "name", 4) == 0);
+  }
+  assert(gbuf.current == n && rd.depth == 0);
+
+  // input arriving a byte at a time; underflow is retried
+  glme_buf_reset(&gbuf);
+  glme_reader_init(&rd, &gbuf);
+  for (len = 0, k = 0; k < sizeof(msg_tokens)/sizeof(msg_tokens[0]) - 1; ) {
+    gbuf.count = len;
+    if ((t = glme_reader_next(&rd, &tok)) <= 0) {
+      // no complete token yet; end of input before first
+      assert(t == GLME_E_UFLOW || (t == GLME_T_EOF && len == 0));
+      len++;
+      continue;
+    }
+    check(&tok, &msg_tokens[k++]);
+  }
+  assert(gbuf.current == n && len == n);
+
+  // skip nested structure
+  glme_buf_reset(&gbuf);
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT);
+  assert(glme_reader_skip(&rd) == 0);
+  assert(rd.depth == 0 && glme_reader_next(&rd, &tok) == GLME_T_EOF);
+
+  // list and dictionary of the Python binding
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x14\x00\x02\x04\x02\x0c\x01" "a\x16\x0c\x04\x01\x01" "k\x06", 15);
+  gbuf.count = 15;
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_ARRAY && tok.typeid == GLME_ANY && tok.count == 2);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_SCALAR && tok.typeid == GLME_INT && tok.v.i == 1);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_BYTES && tok.typeid == GLME_STRING);
+  assert(tok.v.s.len == 1 && tok.v.s.ptr[0] == 'a');
+  assert(glme_reader_next(&rd, &tok) == GLME_T_ARRAY_END);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_MAP && tok.ktype == GLME_STRING && tok.count == 1);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_BYTES && tok.v.s.ptr[0] == 'k');
+  assert(glme_reader_next(&rd, &tok) == GLME_T_SCALAR && tok.v.i == 3);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_MAP_END);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_EOF);
+
+  // unknown base type and too deep nesting
+  glme_buf_clear(&gbuf);
+  gbuf.buf[0] = GLME_NAMED_MAP << 1;
+  gbuf.count = 1;
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_E_TYPE && gbuf.current == 0);
+  // back-reference element or value type, count beyond input
+  memcpy(gbuf.buf, "\x14\x01\xff\xff\xff\xff\x0f", 7);
+  gbuf.count = 7;
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_E_TYPE && gbuf.current == 0);
+  memcpy(gbuf.buf, "\x16\x0c\x03\x02\x02\x61", 6);
+  gbuf.count = 6;
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_E_TYPE && rd.depth == 0);
+  memcpy(gbuf.buf, "\x14\x04\x03\x02\x04", 5);
+  gbuf.count = 5;
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_E_UFLOW && gbuf.current == 0);
+  gbuf.buf[5] = 6;
+  gbuf.count = 6;
+  assert(glme_reader_next(&rd, &tok) == GLME_T_ARRAY && tok.count == 3);
+  glme_buf_clear(&gbuf);
+  assert(glme_buf_reserve(&gbuf, 2*GLME_READER_DEPTH + 2) == 0);
+  for (k = 0; k <= GLME_READER_DEPTH; k++) {
+    gbuf.buf[2*k] = 42 << 1;
+    gbuf.buf[2*k+1] = 1;
+  }
+  gbuf.count = 2*k;
+  glme_reader_init(&rd, &gbuf);
+  for (k = 0; k < 2*GLME_READER_DEPTH; k++)
+    assert(glme_reader_next(&rd, &tok) > 0);
+  assert(rd.depth == GLME_READER_DEPTH);
+  assert(glme_reader_next(&rd, &tok) == GLME_E_OFLOW);
+
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,214 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Dynamic value trees decoded to arena and encoded back
+
+struct point
+{
+  int x, y;
+};
+
+struct msg
+{
+  int64_t i;
+  uint64_t u;
+  double d;
+  char *name;
+  size_t ilen;
+  int64_t *ivals;
+  struct point *pt;
+  size_t plen;
+  struct point *pts;
+};
+
+int encode_point(glme_buf_t *gb, const void *ptr)
+{
+  const struct point *p = (const struct point *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->x, 0);
+  GLME_ENCODE_FLD_INT(gb, p->y, 0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_msg(glme_buf_t *gb, const void *ptr)
+{
+  const struct msg *m = (const struct msg *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, m->i, 0);
+  GLME_ENCODE_FLD_UINT(gb, m->u, 0);
+  GLME_ENCODE_FLD_DOUBLE(gb, m->d, 0.0);
+  GLME_ENCODE_FLD_STRING(gb, m->name);
+  GLME_ENCODE_FLD_INT_ARRAY(gb, m->ivals, m->ilen, glme_encode_value_int64);
+  GLME_ENCODE_FLD_STRUCT(gb, 40, m->pt, encode_point);
+  __e = glme_encode_field(gb, &__delta, 40, GLME_F_ARRAY, m->pts, m->plen,
+                          sizeof(struct point), encode_point);
+  if (__e < 0)
+    return __e;
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_point(glme_buf_t *gb, void *ptr)
+{
+  struct point *p = (struct point *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->x, 0);
+  GLME_DECODE_FLD_INT(gb, p->y, 0);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int decode_msg(glme_buf_t *gb, void *ptr)
+{
+  struct msg *m = (struct msg *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, m->i, 0);
+  GLME_DECODE_FLD_UINT(gb, m->u, 0);
+  GLME_DECODE_FLD_DOUBLE(gb, m->d, 0.0);
+  GLME_DECODE_FLD_STRING(gb, m->name);
+  GLME_DECODE_FLD_INT_ARRAY(gb, m->ivals, m->ilen, glme_decode_value_int64);
+  GLME_DECODE_FLD_STRUCT_PTR(gb, 40, m->pt, decode_point);
+  __flg = GLME_F_ARRAY|GLME_F_PTR; m->plen = 0;
+  __e = glme_decode_field(gb, &__delta, 40, __flg, &m->pts, &m->plen,
+                          sizeof(struct point), decode_point);
+  if (__e < 0)
+    return __e;
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// decode to tree and encode back; same bytes
+static
+glme_node_t *roundtrip(glme_buf_t *gbuf, glme_buf_t *out, glme_arena_t *arena)
+{
+  glme_node_t *root = (glme_node_t *)0;
+  int n = glme_buf_len(gbuf);
+
+  glme_buf_reset(gbuf);
+  assert(glme_node_decode(gbuf, arena, &root) == n);
+  glme_buf_clear(out);
+  assert(glme_node_encode(out, root) == n);
+  assert(memcmp(glme_buf_data(gbuf), glme_buf_data(out), n) == 0);
+  return root;
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, out;
+  glme_arena_t arena;
+  glme_node_t *root, *v;
+  struct glme_chunk_s *chunks;
+  struct point pt = {3, 0}, pts[2] = {{0, 2}, {-7, 7}};
+  int64_t ivals[3] = {1, -1000, 0};
+  double complex cv = 1.5 - 2.0*I;
+  struct msg m0, m1, *mp;
+  size_t len;
+  int k, n;
+
+  m0 = (struct msg){.i = -5, .u = 300, .d = 0.25, .name = "name", .ilen = 3, .ivals = ivals,
+                    .pt = &pt, .plen = 2, .pts = pts};
+  glme_buf_init(&gbuf, 64);
+  glme_buf_init(&out, 8);
+  glme_arena_init(&arena, 0);
+
+  n = glme_encode_struct(&gbuf, 42, &m0, encode_msg);
+  assert(n > 0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+  root = roundtrip(&gbuf, &out, &arena);
+  assert(root->kind == GLME_T_STRUCT && root->typeid == 42 && root->count == 7);
+  assert((v = glme_node_field(root, 3)) && v->kind == GLME_T_BYTES && v->v.s.len == 4);
+  assert((v = glme_node_field(root, 4)) && v->kind == GLME_T_ARRAY && v->count == 3);
+  assert(v->v.items[1].v.i == -1000 && v->v.items[1].next == &v->v.items[2]);
+  assert((v = glme_node_field(root, 6)) && v->typeid == 40 && v->v.items[1].count == 2);
+  assert(!glme_node_field(root, 7));
+
+  // transform; change a value and drop a field
+  glme_node_field(root, 0)->v.i = 1 << 20;
+  root->v.items->next->next->next = glme_node_field(root, 4);
+  glme_buf_clear(&out);
+  n = glme_node_encode(&out, root);
+  assert(n > 0);
+  mp = &m1;
+  memset(&m1, 0, sizeof(m1));
+  assert(glme_decode_struct(&out, 42, (void **)&mp, 0, decode_msg) == n);
+  assert(m1.i == 1 << 20 && m1.u == 300 && m1.d == 0.25 && !m1.name);
+  assert(m1.ilen == 3 && m1.ivals[1] == -1000 && m1.pt->x == 3 && m1.plen == 2);
+  assert(m1.pts[1].x == -7 && m1.pts[1].y == 7);
+  free(m1.ivals);
+  free(m1.pt);
+  free(m1.pts);
+
+  // fields out of order
+  v = glme_node_field(root, 4);
+  v->fno = 1;
+  glme_buf_clear(&out);
+  assert(glme_node_encode(&out, root) == GLME_E_INVAL && glme_buf_len(&out) == 0);
+
+  // list and dictionary of the Python binding, complex scalar
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x14\x00\x02\x04\x02\x0c\x01" "a\x16\x0c\x04\x01\x01" "k\x06", 15);
+  gbuf.count = 15;
+  glme_buf_clear(&out);
+  assert(glme_node_decode(&gbuf, &arena, &root) == 8);
+  assert(root->kind == GLME_T_ARRAY && root->typeid == GLME_ANY && root->count == 2);
+  assert(glme_node_encode(&out, root) == 8);
+  assert(glme_node_decode(&gbuf, &arena, &root) == 7);
+  assert(root->kind == GLME_T_MAP && root->count == 1 && root->v.items[1].v.i == 3);
+  assert(glme_node_encode(&out, root) == 7);
+  assert(memcmp(glme_buf_data(&gbuf), glme_buf_data(&out), 15) == 0);
+  glme_buf_clear(&gbuf);
+  glme_encode_complex128(&gbuf, &cv);
+  root = roundtrip(&gbuf, &out, &arena);
+  assert(root->kind == GLME_T_SCALAR && root->v.c == cv);
+
+  // truncated input and hostile element count
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 42, &m0, encode_msg);
+  for (len = 0; len < n; len++) {
+    glme_buf_reset(&gbuf);
+    gbuf.count = len;
+    assert(glme_node_decode(&gbuf, &arena, &root) < 0);
+    assert(gbuf.current == 0);
+  }
+  gbuf.count = n;
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x14\x04\xf8\x10\x00\x00\x00\x00\x00\x00\x00\x02", 12);
+  gbuf.count = 12;
+  assert(glme_node_decode(&gbuf, &arena, &root) == GLME_E_UFLOW);
+
+  // arena settles to one chunk
+  glme_buf_clear(&gbuf);
+  for (k = 0; k < 100; k++)
+    glme_encode_struct(&gbuf, 42, &m0, encode_msg);
+  for (k = 0; k < 3; k++) {
+    chunks = arena.chunks;
+    glme_arena_reset(&arena);
+    glme_buf_reset(&gbuf);
+    while (gbuf.current < gbuf.count)
+      assert(glme_node_decode(&gbuf, &arena, &root) > 0);
+  }
+  // no new chunk on last pass
+  assert(arena.chunks == chunks);
+
+  glme_arena_release(&arena);
+  glme_buf_close(&gbuf);
+  glme_buf_close(&out);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
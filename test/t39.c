@@ -0,0 +1,291 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Per-decode memory budget and nesting depth limits
+
+#define NNODES 100
+#define NSTRS  8
+#define NDEEP  1000
+
+struct nums
+{
+  size_t n;
+  int64_t *v;
+};
+
+int encode_nums(glme_buf_t *gb, const void *ptr)
+{
+  const struct nums *p = (const struct nums *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT_ARRAY(gb, p->v, p->n, glme_encode_value_int64);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_nums(glme_buf_t *gb, void *ptr)
+{
+  struct nums *p = (struct nums *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT_ARRAY(gb, p->v, p->n, glme_decode_value_int64);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+struct strs
+{
+  char *s[NSTRS];
+};
+
+int encode_strs(glme_buf_t *gb, const void *ptr)
+{
+  const struct strs *p = (const struct strs *)ptr;
+  int k;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  for (k = 0; k < NSTRS; k++)
+    GLME_ENCODE_FLD_STRING(gb, p->s[k]);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_strs(glme_buf_t *gb, void *ptr)
+{
+  struct strs *p = (struct strs *)ptr;
+  int k;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  for (k = 0; k < NSTRS; k++)
+    GLME_DECODE_FLD_STRING(gb, p->s[k]);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+struct link
+{
+  int a;
+  struct link *next;
+};
+
+int encode_link(glme_buf_t *gb, const void *ptr)
+{
+  const struct link *p = (const struct link *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->a, 0);
+  GLME_ENCODE_FLD_STRUCT(gb, 52, p->next, encode_link);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_link(glme_buf_t *gb, void *ptr)
+{
+  struct link *p = (struct link *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->a, 0);
+  GLME_DECODE_FLD_STRUCT_PTR(gb, 52, p->next, decode_link);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int tail_decode_link(glme_buf_t *gb, void *ptr)
+{
+  struct link *p = (struct link *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->a, 0);
+  GLME_DECODE_FLD_STRUCT_PTR_TAIL(gb, 52, p->next, tail_decode_link);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// same list with self referencing descriptor
+extern glme_desc_t link_desc;
+glme_field_t link_fields[] = {
+  GLME_FIELD_INT(struct link, a, 0),
+  GLME_FIELD_STRUCT_PTR(struct link, next, 52, &link_desc)
+};
+glme_desc_t link_desc = GLME_DESC(52, struct link, link_fields);
+
+static
+void linkfree(struct link *p)
+{
+  struct link *next;
+  for (; p; p = next) {
+    next = p->next;
+    free(p);
+  }
+}
+
+static
+int linklen(const struct link *p)
+{
+  int k;
+  for (k = 0; p; p = p->next, k++)
+    assert(p->a == k);
+  return k;
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, other;
+  glme_limits_t limits;
+  struct nums m0, m1, *mp;
+  struct strs s0, s1, *sp;
+  struct link nodes[NNODES], l1, *lp;
+  int64_t v[2] = {5, 6};
+  char text[NSTRS][100];
+  int k, n;
+
+  glme_buf_init(&gbuf, 1024);
+  glme_buf_init(&other, 64);
+
+  // array count beyond input fails before allocating
+  m0 = (struct nums){2, v};
+  n = glme_encode_struct(&gbuf, 50, &m0, encode_nums);
+  assert(n == 8 && memcmp(glme_buf_data(&gbuf), "\x64\x01\x14\x04\x02\x0a\x0c\x00", 8) == 0);
+  mp = &m1;
+  m1 = (struct nums){0, (int64_t *)0};
+  assert(glme_decode_struct(&gbuf, 50, (void **)&mp, 0, decode_nums) == n);
+  assert(m1.n == 2 && m1.v[0] == 5 && m1.v[1] == 6);
+  free(m1.v);
+
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x64\x01\x14\x04" "\xfb\x01\x00\x00\x00\x00" "\x0a\x0c\x00", 13);
+  gbuf.count = 13;
+  glme_limits_begin(&gbuf, &limits, 0, 0);
+  m1 = (struct nums){0, (int64_t *)0};
+  assert(glme_decode_struct(&gbuf, 50, (void **)&mp, 0, decode_nums) < 0);
+  assert(gbuf.last_error == GLME_E_UFLOW && m1.v == 0);
+  // count of four with three bytes left
+  memcpy(gbuf.buf, "\x64\x01\x14\x04\x04\x0a\x0c\x00", 8);
+  gbuf.count = 8;
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_struct(&gbuf, 50, (void **)&mp, 0, decode_nums) < 0);
+  assert(gbuf.last_error == GLME_E_UFLOW && m1.v == 0);
+  glme_limits_end(&gbuf, &limits);
+  assert(limits.allocated == 0 && !limits.exceeded);
+
+  // memory budget
+  for (k = 0; k < NSTRS; k++) {
+    memset(text[k], 'a' + k, 99);
+    text[k][99] = '\0';
+    s0.s[k] = text[k];
+  }
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 51, &s0, encode_strs);
+  assert(n > NSTRS * 100);
+  sp = &s1;
+  glme_limits_begin(&gbuf, &limits, 4 * 100, 0);
+  assert(glme_decode_struct(&gbuf, 51, (void **)&sp, 0, decode_strs) < 0);
+  glme_limits_end(&gbuf, &limits);
+  assert(gbuf.last_error == GLME_E_NOMEM && limits.exceeded);
+  assert(limits.allocated == 4 * 100 && s1.s[4] == 0);
+  for (k = 0; k < 4; k++)
+    free(s1.s[k]);
+
+  glme_buf_reset(&gbuf);
+  glme_limits_begin(&gbuf, &limits, NSTRS * 100, 0);
+  assert(glme_decode_struct(&gbuf, 51, (void **)&sp, 0, decode_strs) == n);
+  glme_limits_end(&gbuf, &limits);
+  assert(limits.allocated == NSTRS * 100 && !limits.exceeded);
+  for (k = 0; k < NSTRS; k++) {
+    assert(strcmp(s1.s[k], text[k]) == 0);
+    free(s1.s[k]);
+  }
+
+  // nesting depth
+  for (k = 0; k < NNODES; k++)
+    nodes[k] = (struct link){k, k < NNODES-1 ? &nodes[k+1] : (struct link *)0};
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 52, nodes, encode_link);
+  assert(n > 0);
+
+  lp = &l1;
+  glme_limits_begin(&gbuf, &limits, 0, NNODES / 2);
+  assert(glme_decode_struct(&gbuf, 52, (void **)&lp, 0, decode_link) < 0);
+  assert(gbuf.last_error == GLME_E_LIMIT && limits.exceeded && limits.depth == 0);
+  // limits of another buffer do not apply
+  glme_buf_clear(&other);
+  assert(glme_encode_struct(&other, 52, nodes, encode_link) == n);
+  assert(glme_decode_struct(&other, 52, (void **)&lp, 0, decode_link) == n);
+  assert(linklen(&l1) == NNODES);
+  linkfree(l1.next);
+  glme_limits_end(&gbuf, &limits);
+
+  glme_buf_reset(&gbuf);
+  glme_limits_begin(&gbuf, &limits, 0, NNODES);
+  assert(glme_decode_struct(&gbuf, 52, (void **)&lp, 0, decode_link) == n);
+  glme_limits_end(&gbuf, &limits);
+  assert(!limits.exceeded && limits.depth == 0);
+  assert(linklen(&l1) == NNODES);
+  assert(limits.allocated == (NNODES-1) * sizeof(struct link));
+  linkfree(l1.next);
+
+  // tail fields do not nest
+  glme_buf_reset(&gbuf);
+  glme_limits_begin(&gbuf, &limits, 0, 2);
+  assert(glme_decode_struct(&gbuf, 52, (void **)&lp, 0, tail_decode_link) == n);
+  glme_limits_end(&gbuf, &limits);
+  assert(!limits.exceeded && linklen(&l1) == NNODES);
+  linkfree(l1.next);
+
+  // skipping counts nested structures
+  glme_buf_reset(&gbuf);
+  glme_limits_begin(&gbuf, &limits, 0, NNODES / 2);
+  assert(glme_skip(&gbuf) == GLME_E_LIMIT);
+  assert(limits.exceeded && limits.depth == 0 && gbuf.current == 0);
+  glme_limits_end(&gbuf, &limits);
+  glme_limits_begin(&gbuf, &limits, 0, NNODES);
+  assert(glme_skip(&gbuf) == n);
+  glme_limits_end(&gbuf, &limits);
+  assert(!limits.exceeded);
+
+  glme_buf_clear(&other);
+  glme_buf_resize(&other, 3 * NDEEP + 2);
+  other.buf[0] = 32;
+  for (k = 0; k < NDEEP; k++) {
+    other.buf[1 + 2*k] = 1;
+    other.buf[2 + 2*k] = 32;
+  }
+  memset(&other.buf[1 + 2*NDEEP], 0, NDEEP + 1);
+  other.count = 3 * NDEEP + 2;
+  glme_limits_begin(&other, &limits, 0, 64);
+  assert(glme_skip(&other) == GLME_E_LIMIT && other.last_error == GLME_E_LIMIT);
+  glme_limits_end(&other, &limits);
+  assert(limits.exceeded && other.current == 0);
+  assert(glme_skip(&other) == 3 * NDEEP + 2);
+
+  // descriptor decoding; first element is type id of top level structure
+  assert(glme_desc_init(&link_desc) == 0);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_type(&gbuf, &k) > 0 && k == 52);
+  glme_limits_begin(&gbuf, &limits, 0, NNODES / 2);
+  assert(glme_decode_desc(&gbuf, &link_desc, &l1) < 0);
+  assert(gbuf.last_error == GLME_E_LIMIT && limits.exceeded && limits.depth == 0);
+  glme_limits_end(&gbuf, &limits);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_type(&gbuf, &k) > 0 && k == 52);
+  glme_limits_begin(&gbuf, &limits, 0, NNODES);
+  assert(glme_decode_desc(&gbuf, &link_desc, &l1) == n - 1);
+  glme_limits_end(&gbuf, &limits);
+  assert(linklen(&l1) == NNODES);
+  linkfree(l1.next);
+  glme_desc_release(&link_desc);
+  glme_buf_close(&other);
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
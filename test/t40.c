@@ -0,0 +1,198 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "glme.h"
+
+// Decoding from segmented input
+
+#define NMSGS 50
+#define NSEGS 65536
+#define NDEEP 100000
+
+struct msg
+{
+  int64_t id;
+  double v;
+  char *name;
+  size_t n;
+  int64_t *vals;
+};
+
+int encode_msg(glme_buf_t *gb, const void *ptr)
+{
+  const struct msg *p = (const struct msg *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->id, 0);
+  GLME_ENCODE_FLD_DOUBLE(gb, p->v, 0.0);
+  GLME_ENCODE_FLD_STRING(gb, p->name);
+  GLME_ENCODE_FLD_INT_ARRAY(gb, p->vals, p->n, glme_encode_value_int64);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_msg(glme_buf_t *gb, void *ptr)
+{
+  struct msg *p = (struct msg *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->id, 0);
+  GLME_DECODE_FLD_DOUBLE(gb, p->v, 0.0);
+  GLME_DECODE_FLD_STRING(gb, p->name);
+  GLME_DECODE_FLD_INT_ARRAY(gb, p->vals, p->n, glme_decode_value_int64);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+static char names[NMSGS][400];
+static int64_t vals[NMSGS][NMSGS];
+static struct iovec iov[NSEGS];
+
+static
+void msg_make(struct msg *m, int k)
+{
+  int j;
+  memset(names[k], 'a' + k % 26, k * 7);
+  names[k][k * 7] = '\0';
+  for (j = 0; j < k; j++)
+    vals[k][j] = (int64_t)j * j * j * (j & 1 ? -1 : 1);
+  *m = (struct msg){k * 1000, k / 3.0, names[k], k, vals[k]};
+}
+
+// split data to segments of len bytes; empty segment every tenth
+static
+int split(char *data, size_t count, size_t len)
+{
+  size_t off;
+  int n = 0;
+
+  for (off = 0; off < count; off += len) {
+    if (n % 10 == 3)
+      iov[n++] = (struct iovec){data, 0};
+    iov[n++] = (struct iovec){&data[off], off + len < count ? len : count - off};
+    assert(n < NSEGS - 1);
+  }
+  return n;
+}
+
+// decode all messages; returns number of copied ones
+static
+int decode_all(glme_buf_t *dec, int iovcnt, int nmsgs)
+{
+  glme_segbuf_t sb;
+  struct msg m0, m1, *mp = &m1;
+  int k, n, ncopied = 0;
+  char *data;
+
+  glme_segbuf_init(&sb, iov, iovcnt);
+  for (k = 0; k < nmsgs; k++) {
+    n = glme_segbuf_next(&sb, dec);
+    assert(n > 0 && glme_buf_len(dec) == n);
+    data = glme_buf_data(dec);
+    if (sb.copied)
+      ncopied++;
+    else
+      assert(data >= (char *)iov[sb.seg].iov_base &&
+             data + n <= (char *)iov[sb.seg].iov_base + iov[sb.seg].iov_len);
+    msg_make(&m0, k);
+    memset(&m1, 0, sizeof(m1));
+    assert(glme_decode_struct(dec, 60, (void **)&mp, 0, decode_msg) == n);
+    assert(m1.id == m0.id && m1.v == m0.v);
+    assert(m1.name ? strcmp(m1.name, m0.name) == 0 : m0.name[0] == 0);
+    assert(m1.n == m0.n && (m1.n == 0 || memcmp(m1.vals, m0.vals, m1.n * sizeof(int64_t)) == 0));
+    free(m1.name);
+    free(m1.vals);
+  }
+  assert(glme_segbuf_next(&sb, dec) == 0);
+  assert(glme_segbuf_next(&sb, dec) == 0 && glme_buf_len(dec) == 0);
+  glme_segbuf_release(dec, &sb);
+  return ncopied;
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, dec;
+  glme_segbuf_t sb;
+  glme_limits_t limits;
+  struct msg m;
+  size_t count, lens[] = {1, 2, 3, 7, 64, 333, 4096, 1 << 20};
+  size_t offsets[NMSGS+1];
+  int k, n, nseg;
+
+  glme_buf_init(&gbuf, 1024);
+  glme_buf_init(&dec, 0);
+  for (k = 0; k < NMSGS; k++) {
+    offsets[k] = glme_buf_len(&gbuf);
+    msg_make(&m, k);
+    assert(glme_encode_struct(&gbuf, 60, &m, encode_msg) > 0);
+  }
+  count = offsets[NMSGS] = glme_buf_len(&gbuf);
+
+  for (k = 0; k < sizeof(lens)/sizeof(lens[0]); k++) {
+    nseg = split(glme_buf_data(&gbuf), count, lens[k]);
+    n = decode_all(&dec, nseg, NMSGS);
+    // whole input in one segment is decoded in place
+    assert(lens[k] < count ? n > 0 : n == 0);
+  }
+
+  // ring buffer wrapped in the middle of a message
+  iov[0] = (struct iovec){glme_buf_data(&gbuf), offsets[20] + 5};
+  iov[1] = (struct iovec){glme_buf_data(&gbuf) + offsets[20] + 5, count - offsets[20] - 5};
+  assert(decode_all(&dec, 2, NMSGS) == 1);
+
+  // input ends within a message; position left at its start
+  nseg = split(glme_buf_data(&gbuf), offsets[NMSGS-1] + 10, 100);
+  glme_segbuf_init(&sb, iov, nseg);
+  for (k = 0; k < NMSGS-1; k++)
+    assert(glme_segbuf_next(&sb, &dec) == offsets[k+1] - offsets[k]);
+  assert(glme_segbuf_next(&sb, &dec) == GLME_E_UFLOW);
+  assert(dec.last_error == GLME_E_UFLOW && sb.offset == offsets[NMSGS-1]);
+  assert(glme_segbuf_next(&sb, &dec) == GLME_E_UFLOW && sb.offset == offsets[NMSGS-1]);
+  glme_segbuf_release(&dec, &sb);
+  assert(sb.scratch == 0);
+
+  // malformed element is reported as is
+  gbuf.buf[offsets[1]] = GLME_NAMED_MAP << 1;
+  nseg = split(glme_buf_data(&gbuf), count, 1 << 20);
+  glme_segbuf_init(&sb, iov, nseg);
+  assert(glme_segbuf_next(&sb, &dec) > 0);
+  assert(glme_segbuf_next(&sb, &dec) < 0 && dec.last_error == GLME_E_TYPE);
+  glme_segbuf_release(&dec, &sb);
+
+  // deeply nested structures and reference element type with huge count
+  glme_buf_clear(&gbuf);
+  assert(glme_buf_reserve(&gbuf, 3*NDEEP + 9) == 0);
+  gbuf.buf[0] = 32;
+  for (k = 0; k < NDEEP; k++) {
+    gbuf.buf[1 + 2*k] = 1;
+    gbuf.buf[2 + 2*k] = 32;
+  }
+  memset(&gbuf.buf[1 + 2*NDEEP], 0, NDEEP + 1);
+  memcpy(&gbuf.buf[3*NDEEP + 2], "\x14\x01\xff\xff\xff\xff\x0f", 7);
+  gbuf.count = 3*NDEEP + 9;
+  nseg = split(glme_buf_data(&gbuf), gbuf.count, 4096);
+  glme_segbuf_init(&sb, iov, nseg);
+  glme_limits_begin(&dec, &limits, 0, 64);
+  assert(glme_segbuf_next(&sb, &dec) == GLME_E_LIMIT && sb.offset == 0);
+  glme_limits_end(&dec, &limits);
+  assert(limits.exceeded);
+  assert(glme_segbuf_next(&sb, &dec) == 3*NDEEP + 2);
+  assert(glme_segbuf_next(&sb, &dec) == GLME_E_TYPE && sb.offset == 3*NDEEP + 2);
+  glme_segbuf_release(&dec, &sb);
+
+  // empty input
+  glme_segbuf_init(&sb, iov, 0);
+  assert(glme_segbuf_next(&sb, &dec) == 0);
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,277 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Maps encoded from and decoded to hash tables
+
+#define NKEYS 1000
+
+struct point
+{
+  int x, y;
+};
+
+int encode_point(glme_buf_t *gb, const void *ptr)
+{
+  const struct point *p = (const struct point *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->x, 0);
+  GLME_ENCODE_FLD_INT(gb, p->y, 0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_point(glme_buf_t *gb, void *ptr)
+{
+  struct point *p = (struct point *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->x, 0);
+  GLME_DECODE_FLD_INT(gb, p->y, 0);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// structure with map field
+struct doc
+{
+  int id;
+  glme_map_t attrs;
+};
+
+int encode_doc(glme_buf_t *gb, const void *ptr)
+{
+  const struct doc *p = (const struct doc *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->id, 0);
+  GLME_ENCODE_FLD_MAP(gb, p->attrs);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_doc(glme_buf_t *gb, void *ptr)
+{
+  struct doc *p = (struct doc *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->id, 0);
+  GLME_DECODE_FLD_MAP(gb, p->attrs);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// user table; sum of keys and values
+struct sums
+{
+  int presized;
+  uint64_t count, keys;
+  int64_t vals;
+};
+
+static
+int sum_insert(void *table, int ktype, int etype, uint64_t count, const glme_mapent_t *e)
+{
+  struct sums *s = (struct sums *)table;
+  assert(ktype == GLME_UINT && etype == GLME_INT);
+  if (!e) {
+    s->presized++;
+    s->count = count;
+    return 0;
+  }
+  s->keys += e->key.u;
+  s->vals += e->v.i;
+  return 0;
+}
+
+static
+int str_put(glme_buf_t *gb, glme_map_t *map, const char *key, int type)
+{
+  glme_mapent_t e;
+  memset(&e, 0, sizeof(e));
+  e.key.s.ptr = key;
+  e.key.s.len = strlen(key);
+  e.type = type;
+  return glme_map_put(gb, map, &e) == 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, tmp, view;
+  glme_map_t m0, m1;
+  glme_mapent_t e, *ep;
+  struct point pt = {3, -4}, p1;
+  struct doc d0, d1, *dp;
+  struct sums sums;
+  int64_t isum;
+  uint64_t k;
+  char keys[20][8];
+  int n, typ;
+
+  glme_buf_init(&gbuf, 64);
+  glme_buf_init(&tmp, 64);
+
+  // unsigned keys, integer values
+  glme_map_init(&m0, GLME_UINT, GLME_INT);
+  for (k = 0, isum = 0; k < NKEYS; k++) {
+    memset(&e, 0, sizeof(e));
+    e.key.u = k * 7919;
+    e.type = GLME_INT;
+    e.v.i = -(int64_t)k;
+    isum += e.v.i;
+    assert(glme_map_put(&gbuf, &m0, &e) == 0);
+  }
+  // replaced value
+  e.v.i = 42;
+  assert(glme_map_put(&gbuf, &m0, &e) == 0);
+  isum += 42 + (NKEYS-1);
+  assert(m0.count == NKEYS && m0.size >= 2*NKEYS);
+
+  n = glme_encode_map(&gbuf, &m0);
+  assert(n > 2*NKEYS);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+  glme_map_init(&m1, 0, 0);
+  assert(glme_decode_map(&gbuf, &m1) == n);
+  assert(m1.ktype == GLME_UINT && m1.etype == GLME_INT && m1.count == NKEYS);
+  assert(m1.blocks == 0);
+  for (k = 0; k < NKEYS; k++) {
+    ep = glme_map_find(&m1, k * 7919);
+    assert(ep && ep->type == GLME_INT && ep->v.i == (k < NKEYS-1 ? -(int64_t)k : 42));
+  }
+  assert(glme_map_find(&m1, 1) == 0);
+  assert(glme_map_find_str(&m1, "a", 1) == 0);
+  glme_map_release(&gbuf, &m1);
+  assert(m1.slots == 0 && m1.count == 0);
+
+  // user table presized once
+  glme_buf_reset(&gbuf);
+  memset(&sums, 0, sizeof(sums));
+  assert(glme_decode_map_to(&gbuf, sum_insert, &sums) == n);
+  assert(sums.presized == 1 && sums.count == NKEYS && sums.vals == isum);
+  assert(sums.keys == 7919ull * NKEYS * (NKEYS-1) / 2);
+  glme_map_release(&gbuf, &m0);
+
+  // string keys with values of any type
+  glme_map_init(&m0, GLME_STRING, GLME_ANY);
+  assert(str_put(&gbuf, &m0, "int", GLME_INT) == 0);
+  glme_map_find_str(&m0, "int", 3)->v.i = -5;
+  assert(str_put(&gbuf, &m0, "float", GLME_FLOAT) == 0);
+  glme_map_find_str(&m0, "float", 5)->v.f = 2.5;
+  assert(str_put(&gbuf, &m0, "name", GLME_STRING) == 0);
+  ep = glme_map_find_str(&m0, "name", 4);
+  ep->v.s.ptr = "glme";
+  ep->v.s.len = 4;
+  // structure value as its encoded bytes without type id
+  glme_buf_clear(&tmp);
+  assert(glme_encode_struct(&tmp, 50, &pt, encode_point) > 0);
+  assert(str_put(&gbuf, &m0, "point", 50) == 0);
+  ep = glme_map_find_str(&m0, "point", 5);
+  ep->v.s.ptr = glme_buf_data(&tmp) + 1;
+  ep->v.s.len = glme_buf_len(&tmp) - 1;
+  for (k = 0; k < 20; k++) {
+    // keys are not copied
+    snprintf(keys[k], sizeof(keys[k]), "key%d", (int)k);
+    assert(str_put(&gbuf, &m0, keys[k], GLME_UINT) == 0);
+    glme_map_find_str(&m0, keys[k], strlen(keys[k]))->v.u = k;
+  }
+  glme_buf_clear(&gbuf);
+  n = glme_encode_map(&gbuf, &m0);
+  assert(n > 0);
+
+  glme_map_init(&m1, 0, 0);
+  assert(glme_decode_map(&gbuf, &m1) == n);
+  assert(m1.count == 24 && m1.ktype == GLME_STRING && m1.etype == GLME_ANY);
+  assert((ep = glme_map_find_str(&m1, "int", 3)) && ep->type == GLME_INT && ep->v.i == -5);
+  assert((ep = glme_map_find_str(&m1, "float", 5)) && ep->type == GLME_FLOAT && ep->v.f == 2.5);
+  assert((ep = glme_map_find_str(&m1, "name", 4)) && ep->type == GLME_STRING);
+  assert(ep->v.s.len == 4 && strcmp(ep->v.s.ptr, "glme") == 0);
+  assert((ep = glme_map_find_str(&m1, "key19", 5)) && ep->type == GLME_UINT && ep->v.u == 19);
+  assert(strcmp(ep->key.s.ptr, "key19") == 0);
+  assert(ep->key.s.ptr < glme_buf_data(&gbuf) || ep->key.s.ptr >= glme_buf_data(&gbuf) + n);
+  assert((ep = glme_map_find_str(&m1, "point", 5)) && ep->type == 50);
+  glme_buf_make(&view, (char *)ep->v.s.ptr, ep->v.s.len, ep->v.s.len);
+  assert(decode_point(&view, &p1) == ep->v.s.len && p1.x == 3 && p1.y == -4);
+  assert(glme_map_find_str(&m1, "key", 3) == 0);
+  assert(glme_map_find(&m1, 0) == 0);
+
+  // merged with same key type; other key type is an error
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_map(&gbuf, &m1) == n && m1.count == 24);
+  glme_map_release(&gbuf, &m0);
+  glme_map_init(&m0, GLME_INT, GLME_INT);
+  memset(&e, 0, sizeof(e));
+  e.key.i = -1;
+  assert(glme_map_put(&gbuf, &m0, &e) == 0);
+  glme_buf_clear(&gbuf);
+  n = glme_encode_map(&gbuf, &m0);
+  assert(n == 6 && memcmp(glme_buf_data(&gbuf), "\x16\x04\x04\x01\x01\x00", 6) == 0);
+  assert(glme_decode_map(&gbuf, &m1) == GLME_E_TYPE && glme_buf_at(&gbuf) == 0);
+  glme_map_release(&gbuf, &m1);
+  glme_map_release(&gbuf, &m0);
+
+  // dictionaries of the Python binding
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x16\x0c\x04\x01\x01" "k\x06"
+         "\x16\x0c\x00\x02\x01" "a\x04\x02\x01" "b\x0c\x02" "hi", 21);
+  gbuf.count = 21;
+  glme_map_init(&m1, 0, 0);
+  assert(glme_decode_map(&gbuf, &m1) == 7);
+  assert((ep = glme_map_find_str(&m1, "k", 1)) && ep->v.i == 3);
+  glme_map_release(&gbuf, &m1);
+  assert(glme_decode_map(&gbuf, &m1) == 14 && m1.etype == GLME_ANY);
+  assert((ep = glme_map_find_str(&m1, "a", 1)) && ep->type == GLME_INT && ep->v.i == 1);
+  assert((ep = glme_map_find_str(&m1, "b", 1)) && ep->type == GLME_STRING);
+  assert(strcmp(ep->v.s.ptr, "hi") == 0);
+  glme_map_release(&gbuf, &m1);
+
+  // count beyond input and unsupported key type
+  memcpy(gbuf.buf, "\x16\x0c\x04\xfe\x10\x00\x01" "k\x06", 9);
+  gbuf.count = 9;
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_map_to(&gbuf, sum_insert, &sums) == GLME_E_UFLOW);
+  memcpy(gbuf.buf, "\x16\x08\x04\x01\x00\x06", 6);
+  gbuf.count = 6;
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_map(&gbuf, &m1) == GLME_E_TYPE && m1.count == 0);
+
+  // map field
+  d0.id = 7;
+  glme_map_init(&d0.attrs, GLME_STRING, GLME_STRING);
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 51, &d0, encode_doc);
+  // empty map omitted
+  assert(n == 5);
+  assert(str_put(&gbuf, &d0.attrs, "lang", GLME_STRING) == 0);
+  ep = glme_map_find_str(&d0.attrs, "lang", 4);
+  ep->v.s.ptr = "fi";
+  ep->v.s.len = 2;
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 51, &d0, encode_doc);
+  dp = &d1;
+  glme_map_init(&d1.attrs, 0, 0);
+  assert(glme_decode_struct(&gbuf, 51, (void **)&dp, 0, decode_doc) == n);
+  assert(d1.id == 7 && d1.attrs.count == 1);
+  assert((ep = glme_map_find_str(&d1.attrs, "lang", 4)) && strcmp(ep->v.s.ptr, "fi") == 0);
+  // skipped and parsed by wire format
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == n);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_type(&gbuf, &typ) > 0 && typ == 51);
+  glme_map_release(&gbuf, &d0.attrs);
+  glme_map_release(&gbuf, &d1.attrs);
+  glme_buf_close(&gbuf);
+  glme_buf_close(&tmp);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
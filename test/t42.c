@@ -0,0 +1,237 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Packed fixed width numeric arrays
+
+#define NVALS 1000
+
+struct series
+{
+  int64_t id;
+  size_t nt;
+  uint32_t *t;
+  size_t nv;
+  double *v;
+  size_t nd;
+  int16_t *d;
+};
+
+// view of decoded series
+struct series_view
+{
+  int64_t id;
+  size_t nt;
+  const uint32_t *t;
+  size_t nv;
+  const double *v;
+  size_t nd;
+  const int16_t *d;
+};
+
+int encode_series(glme_buf_t *gb, const void *ptr)
+{
+  const struct series *p = (const struct series *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->id, 0);
+  GLME_ENCODE_FLD_PACKED(gb, GLME_UINT, p->t, p->nt, GLME_F_ALIGN);
+  GLME_ENCODE_FLD_PACKED(gb, GLME_FLOAT, p->v, p->nv, GLME_F_ALIGN);
+  GLME_ENCODE_FLD_PACKED(gb, GLME_INT, p->d, p->nd, 0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_series(glme_buf_t *gb, void *ptr)
+{
+  struct series *p = (struct series *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->id, 0);
+  GLME_DECODE_FLD_PACKED(gb, GLME_UINT, p->t, p->nt);
+  GLME_DECODE_FLD_PACKED(gb, GLME_FLOAT, p->v, p->nv);
+  GLME_DECODE_FLD_PACKED(gb, GLME_INT, p->d, p->nd);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int decode_series_view(glme_buf_t *gb, void *ptr)
+{
+  struct series_view *p = (struct series_view *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->id, 0);
+  GLME_DECODE_FLD_PACKED_VIEW(gb, GLME_UINT, p->t, p->nt);
+  GLME_DECODE_FLD_PACKED_VIEW(gb, GLME_FLOAT, p->v, p->nv);
+  GLME_DECODE_FLD_PACKED_VIEW(gb, GLME_INT, p->d, p->nd);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+// same fields as element arrays; int16 array omitted
+int encode_series_array(glme_buf_t *gb, const void *ptr)
+{
+  const struct series *p = (const struct series *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->id, 0);
+  GLME_ENCODE_FLD_UINT_ARRAY(gb, p->t, p->nt, glme_encode_value_uint);
+  GLME_ENCODE_FLD_FLOAT_ARRAY(gb, p->v, p->nv, glme_encode_value_double);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+static uint32_t tv[NVALS];
+static double vv[NVALS];
+static int16_t dv[NVALS];
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, out;
+  glme_reader_t rd;
+  glme_token_t tok;
+  glme_arena_t arena;
+  glme_node_t *root, *v;
+  glme_limits_t limits;
+  struct series s0, s1, *sp = &s1;
+  struct series_view w, *wp = &w;
+  int16_t d[2] = {1, -2}, *dp;
+  const void *data;
+  size_t count;
+  int k, n, n0, kind;
+
+  glme_buf_init(&gbuf, 64);
+  glme_buf_init(&out, 64);
+
+  // int16 {1, -2}: type, kind, count, no padding, little-endian values
+  n = glme_encode_packed(&gbuf, GLME_PACKED_KIND(GLME_INT, sizeof(int16_t)), d, 2, 0);
+  assert(n == 8 && memcmp(glme_buf_data(&gbuf), "\x10\x22\x02\x00\x01\x00\xfe\xff", 8) == 0);
+  assert(glme_decode_packed(&gbuf, &kind, &data, &count) == n);
+  assert(kind == 0x22 && count == 2 && data == glme_buf_data(&gbuf) + 4);
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == n);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_packed_copy(&gbuf, GLME_PACKED_KIND(GLME_INT, 2), (void **)&dp, &count) == n);
+  assert(count == 2 && dp[0] == 1 && dp[1] == -2);
+  free(dp);
+  // other kind
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_packed_copy(&gbuf, GLME_PACKED_KIND(GLME_UINT, 2), (void **)&dp, &count) < 0);
+  assert(gbuf.last_error == GLME_E_TYPE && gbuf.current == 0);
+
+  // aligned to element size from start of buffer
+  glme_buf_clear(&gbuf);
+  k = 1;
+  glme_encode_value_int(&gbuf, &k);
+  for (k = 0; k < NVALS; k++)
+    vv[k] = k / 7.0;
+  n = glme_encode_packed(&gbuf, GLME_PACKED_KIND(GLME_FLOAT, 8), vv, NVALS, GLME_F_ALIGN);
+  assert(n > 0 && (glme_buf_len(&gbuf) - NVALS * 8) % 8 == 0);
+  assert(gbuf.buf[4] == 3 && glme_buf_len(&gbuf) == 8 + NVALS * 8);
+
+  // malformed input
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x10\x22\x03\x00\x01\x00\xfe\xff", 8);
+  gbuf.count = 8;
+  assert(glme_decode_packed(&gbuf, &kind, &data, &count) == GLME_E_UFLOW && gbuf.current == 0);
+  assert(glme_skip(&gbuf) == GLME_E_UFLOW && gbuf.current == 0);
+  gbuf.buf[2] = 2;
+  gbuf.buf[1] = 0x23;
+  assert(glme_decode_packed(&gbuf, &kind, &data, &count) == GLME_E_TYPE);
+  gbuf.buf[1] = 0x41;
+  assert(glme_decode_packed(&gbuf, &kind, &data, &count) == GLME_E_TYPE);
+  gbuf.buf[1] = 0x22;
+  gbuf.buf[3] = 8;
+  assert(glme_decode_packed(&gbuf, &kind, &data, &count) == GLME_E_INVAL);
+  gbuf.buf[2] = 0xfa;
+  assert(glme_decode_packed(&gbuf, &kind, &data, &count) == GLME_E_UFLOW);
+
+  // structure fields
+  for (k = 0; k < NVALS; k++) {
+    tv[k] = k * 1000003u;
+    dv[k] = (int16_t)(k * (k & 1 ? -37 : 37));
+  }
+  s0 = (struct series){77, NVALS, tv, NVALS, vv, NVALS, dv};
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 50, &s0, encode_series);
+  glme_buf_clear(&out);
+  n0 = glme_encode_struct(&out, 50, &s0, encode_series_array);
+  assert(n > NVALS * 14 && n < NVALS * 14 + 48 && n0 > 0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&gbuf, 50, (void **)&sp, 0, decode_series) == n);
+  assert(s1.id == 77 && s1.nt == NVALS && s1.nv == NVALS && s1.nd == NVALS);
+  assert(memcmp(s1.t, tv, sizeof(tv)) == 0 && memcmp(s1.v, vv, sizeof(vv)) == 0);
+  assert(memcmp(s1.d, dv, sizeof(dv)) == 0);
+  free(s1.t);
+  free(s1.v);
+  free(s1.d);
+
+  // elements in place; int16 array is not aligned
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_struct(&gbuf, 50, (void **)&wp, 0, decode_series_view) < 0);
+  assert(gbuf.last_error == GLME_E_INVAL);
+  s0.nd = 0;
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 50, &s0, encode_series);
+  memset(&w, 0, sizeof(w));
+  assert(glme_decode_struct(&gbuf, 50, (void **)&wp, 0, decode_series_view) == n);
+  assert(w.t > (const uint32_t *)gbuf.buf && w.v < (const double *)&gbuf.buf[n]);
+  assert(memcmp(w.t, tv, sizeof(tv)) == 0 && memcmp(w.v, vv, sizeof(vv)) == 0);
+  assert(w.nd == 0 && w.d == 0);
+
+  // element arrays are not packed arrays
+  glme_buf_reset(&out);
+  assert(glme_decode_struct(&out, 50, (void **)&sp, 0, decode_series) < 0);
+  assert(out.last_error == GLME_E_TYPE);
+  free(s1.t);
+
+  // memory budget applies to copies
+  glme_buf_reset(&gbuf);
+  glme_limits_begin(&gbuf, &limits, NVALS * 8, 0);
+  assert(glme_decode_struct(&gbuf, 50, (void **)&sp, 0, decode_series) < 0);
+  glme_limits_end(&gbuf, &limits);
+  assert(gbuf.last_error == GLME_E_NOMEM && limits.exceeded);
+  free(s1.t);
+
+  // pull parser and value tree
+  glme_buf_reset(&gbuf);
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_SCALAR && tok.v.i == 77);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_BYTES && tok.typeid == GLME_PACKED);
+  assert(tok.ktype == GLME_PACKED_KIND(GLME_UINT, 4) && tok.count == NVALS);
+  assert(tok.v.s.len == sizeof(tv) && memcmp(tok.v.s.ptr, tv, sizeof(tv)) == 0);
+
+  glme_buf_reset(&gbuf);
+  glme_arena_init(&arena, 0);
+  root = (glme_node_t *)0;
+  assert(glme_node_decode(&gbuf, &arena, &root) == n);
+  assert((v = glme_node_field(root, 2)) && v->typeid == GLME_PACKED && v->count == NVALS);
+  glme_buf_clear(&out);
+  assert(glme_node_encode(&out, root) > 0);
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&out, 50, (void **)&sp, 0, decode_series) == glme_buf_len(&out));
+  assert(s1.nv == NVALS && memcmp(s1.v, vv, sizeof(vv)) == 0 && s1.nd == 0);
+  free(s1.t);
+  free(s1.v);
+  glme_arena_release(&arena);
+
+  glme_buf_close(&gbuf);
+  glme_buf_close(&out);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
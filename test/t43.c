@@ -0,0 +1,236 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Delta encoded integer arrays
+
+#define NVALS 1000
+
+struct ticks
+{
+  size_t nt;
+  int64_t *t;
+  size_t ns;
+  uint32_t *s;
+  int32_t v[8];
+};
+
+int encode_ticks(glme_buf_t *gb, const void *ptr)
+{
+  const struct ticks *p = (const struct ticks *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT_DELTA(gb, p->t, p->nt, 2);
+  GLME_ENCODE_FLD_UINT_DELTA(gb, p->s, p->ns, 1);
+  GLME_ENCODE_FLD_INT_DELTA(gb, p->v, 8, 1);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_ticks_plain(glme_buf_t *gb, const void *ptr)
+{
+  const struct ticks *p = (const struct ticks *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT_ARRAY(gb, p->t, p->nt, glme_encode_value_int64);
+  GLME_ENCODE_FLD_UINT_ARRAY(gb, p->s, p->ns, glme_encode_value_uint);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+// plain array decoders accept delta arrays
+int decode_ticks(glme_buf_t *gb, void *ptr)
+{
+  struct ticks *p = (struct ticks *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT_ARRAY(gb, p->t, p->nt, glme_decode_value_int64);
+  GLME_DECODE_FLD_UINT_ARRAY(gb, p->s, p->ns, glme_decode_value_uint);
+  GLME_DECODE_FLD_INT_VECTOR(gb, p->v, glme_decode_value_int);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+glme_field_t ticks_fields[] = {
+  GLME_FIELD_INT_ARRAY(struct ticks, t, nt),
+  GLME_FIELD_UINT_ARRAY(struct ticks, s, ns),
+  GLME_FIELD_INT_VECTOR(struct ticks, v)
+};
+glme_desc_t ticks_desc = GLME_DESC(50, struct ticks, ticks_fields);
+
+static int64_t tv[NVALS];
+static uint32_t sv[NVALS];
+
+static
+void ticks_check(const struct ticks *p)
+{
+  int k;
+  assert(p->nt == NVALS && memcmp(p->t, tv, sizeof(tv)) == 0);
+  assert(p->ns == NVALS && memcmp(p->s, sv, sizeof(sv)) == 0);
+  for (k = 0; k < 8; k++)
+    assert(p->v[k] == (k & 1 ? INT32_MIN : INT32_MAX));
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf;
+  glme_reader_t rd;
+  glme_token_t tok;
+  glme_arena_t arena;
+  glme_node_t *root;
+  struct ticks t0, t1, *tp = &t1;
+  int64_t i3[3] = {100, 101, 103}, *ip;
+  uint64_t u4[4] = {0, UINT64_MAX, 1, 0x8000000000000000ull}, ub[4], *up = ub;
+  uint8_t b[5] = {250, 255, 0, 5, 1}, bb[5], *bp = bb;
+  size_t len;
+  int k, n, n1, n2, n0, typeid;
+
+  glme_buf_init(&gbuf, 64);
+
+  // first value then differences; zigzag encoded
+  n = glme_encode_delta(&gbuf, GLME_INT, i3, 3, sizeof(int64_t), 1);
+  assert(n == 8 && memcmp(glme_buf_data(&gbuf), "\x12\x04\x01\x03\xff\xc8\x02\x04", 8) == 0);
+  ip = (int64_t *)0;
+  typeid = 0;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&ip, &len, sizeof(int64_t)) == n);
+  assert(typeid == GLME_INT && len == 3 && ip[0] == 100 && ip[1] == 101 && ip[2] == 103);
+  free(ip);
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == n);
+
+  // order two; second difference of 1, 2 is 1
+  glme_buf_clear(&gbuf);
+  n = glme_encode_delta(&gbuf, GLME_INT, i3, 3, sizeof(int64_t), 2);
+  assert(n == 8 && memcmp(glme_buf_data(&gbuf), "\x12\x04\x02\x03\xff\xc8\x02\x02", 8) == 0);
+  // decoded with array decoder
+  ip = (int64_t *)0;
+  len = 0;
+  assert(glme_decode_array(&gbuf, &typeid, (void **)&ip, &len, sizeof(int64_t),
+                           (glme_decoder_f)glme_decode_value_int64) == n);
+  assert(len == 3 && ip[0] == 100 && ip[1] == 101 && ip[2] == 103);
+  free(ip);
+
+  // differences wrap around
+  for (k = 1; k <= 2; k++) {
+    glme_buf_clear(&gbuf);
+    assert(glme_encode_delta(&gbuf, GLME_UINT, u4, 4, sizeof(uint64_t), k) > 0);
+    memset(ub, 0, sizeof(ub));
+    len = 4;
+    typeid = GLME_UINT;
+    assert(glme_decode_delta(&gbuf, &typeid, (void **)&up, &len, sizeof(uint64_t)) > 0);
+    assert(len == 4 && memcmp(ub, u4, sizeof(u4)) == 0);
+    glme_buf_clear(&gbuf);
+    assert(glme_encode_delta(&gbuf, GLME_UINT, b, 5, 1, k) > 0);
+    len = 5;
+    assert(glme_decode_delta(&gbuf, &typeid, (void **)&bp, &len, 1) > 0);
+    assert(len == 5 && memcmp(bb, b, sizeof(b)) == 0);
+    // too short target; other element type
+    glme_buf_reset(&gbuf);
+    len = 4;
+    assert(glme_decode_delta(&gbuf, &typeid, (void **)&bp, &len, 1) == GLME_E_OFLOW);
+    typeid = GLME_INT;
+    len = 5;
+    assert(glme_decode_delta(&gbuf, &typeid, (void **)&bp, &len, 1) == GLME_E_TYPE);
+    assert(gbuf.current == 0);
+  }
+
+  // malformed input
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x12\x04\x01\x04\xff\xc8\x02\x04", 8);
+  gbuf.count = 8;
+  ip = (int64_t *)0;
+  typeid = 0;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&ip, &len, 8) == GLME_E_UFLOW && ip == 0);
+  assert(glme_skip(&gbuf) < 0 && gbuf.current == 0);
+  gbuf.buf[3] = 3;
+  gbuf.buf[2] = 3;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&ip, &len, 8) == GLME_E_TYPE);
+  gbuf.buf[2] = 1;
+  gbuf.buf[1] = GLME_STRING << 1;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&ip, &len, 8) == GLME_E_TYPE);
+  assert(glme_encode_delta(&gbuf, GLME_STRING, i3, 3, 8, 1) == GLME_E_INVAL);
+  assert(glme_encode_delta(&gbuf, GLME_INT, i3, 3, 3, 1) == GLME_E_INVAL);
+  assert(glme_encode_delta(&gbuf, GLME_INT, i3, 3, 8, 3) == GLME_E_INVAL);
+
+  // regularly spaced time stamps and sorted sequence numbers
+  for (k = 0; k < NVALS; k++) {
+    tv[k] = 1600000000000ll + 250 * k + (k % 7 == 3 ? 1 : 0);
+    sv[k] = 1000000 + 3 * k + k % 5;
+  }
+  t0.nt = t0.ns = NVALS;
+  t0.t = tv;
+  t0.s = sv;
+  for (k = 0; k < 8; k++)
+    t0.v[k] = k & 1 ? INT32_MIN : INT32_MAX;
+
+  glme_buf_clear(&gbuf);
+  n0 = glme_encode_struct(&gbuf, 50, &t0, encode_ticks_plain);
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 50, &t0, encode_ticks);
+  assert(n > 0 && 3 * n < n0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  memset(&t1, 0, sizeof(t1));
+  assert(glme_decode_struct(&gbuf, 50, (void **)&tp, 0, decode_ticks) == n);
+  ticks_check(&t1);
+  free(t1.t);
+  free(t1.s);
+
+  // descriptor table decoding
+  assert(glme_desc_init(&ticks_desc) == 0);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_type(&gbuf, &typeid) > 0 && typeid == 50);
+  memset(&t1, 0, sizeof(t1));
+  assert(glme_decode_desc(&gbuf, &ticks_desc, &t1) == n - 1);
+  ticks_check(&t1);
+  free(t1.t);
+  free(t1.s);
+  glme_desc_release(&ticks_desc);
+
+  // order one and two of time stamps
+  glme_buf_clear(&gbuf);
+  n1 = glme_encode_delta(&gbuf, GLME_INT, tv, NVALS, sizeof(int64_t), 1);
+  n2 = glme_encode_delta(&gbuf, GLME_INT, tv, NVALS, sizeof(int64_t), 2);
+  assert(n1 > 2 * NVALS && n2 < n1);
+
+  // pull parser reconstructs elements
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_struct(&gbuf, 50, &t0, encode_ticks) == n);
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_ARRAY && tok.typeid == GLME_INT && tok.count == NVALS);
+  for (k = 0; k < NVALS; k++)
+    assert(glme_reader_next(&rd, &tok) == GLME_T_SCALAR && tok.v.i == tv[k]);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_ARRAY_END);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_skip(&rd) == 0);
+
+  // value tree encodes plain arrays
+  glme_buf_reset(&gbuf);
+  glme_arena_init(&arena, 0);
+  root = (glme_node_t *)0;
+  assert(glme_node_decode(&gbuf, &arena, &root) == n);
+  glme_buf_clear(&gbuf);
+  assert(glme_node_encode(&gbuf, root) > n);
+  memset(&t1, 0, sizeof(t1));
+  assert(glme_decode_struct(&gbuf, 50, (void **)&tp, 0, decode_ticks) == glme_buf_len(&gbuf));
+  ticks_check(&t1);
+  free(t1.t);
+  free(t1.s);
+  glme_arena_release(&arena);
+
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,234 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "glme.h"
+
+// XOR compressed floating point arrays
+
+#define NVALS 1000
+
+struct series
+{
+  size_t np;
+  double *p;
+  size_t ng;
+  float *g;
+  double v[4];
+};
+
+int encode_series(glme_buf_t *gb, const void *ptr)
+{
+  const struct series *p = (const struct series *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_FLOAT_XOR(gb, p->p, p->np);
+  GLME_ENCODE_FLD_FLOAT_XOR(gb, p->g, p->ng);
+  GLME_ENCODE_FLD_FLOAT_XOR(gb, p->v, 4);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_series_plain(glme_buf_t *gb, const void *ptr)
+{
+  const struct series *p = (const struct series *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_FLOAT_ARRAY(gb, p->p, p->np, glme_encode_value_double);
+  GLME_ENCODE_FLD_FLOAT_ARRAY(gb, p->g, p->ng, glme_encode_value_float);
+  GLME_ENCODE_FLD_FLOAT_VECTOR(gb, p->v, glme_encode_value_double);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+// plain array decoders accept XOR arrays
+int decode_series(glme_buf_t *gb, void *ptr)
+{
+  struct series *p = (struct series *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_FLOAT_ARRAY(gb, p->p, p->np, glme_decode_value_double);
+  GLME_DECODE_FLD_FLOAT_ARRAY(gb, p->g, p->ng, glme_decode_value_float);
+  GLME_DECODE_FLD_FLOAT_VECTOR(gb, p->v, glme_decode_value_double);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+glme_field_t series_fields[] = {
+  GLME_FIELD_FLOAT_ARRAY(struct series, p, np),
+  GLME_FIELD_FLOAT_ARRAY(struct series, g, ng),
+  GLME_FIELD_FLOAT_VECTOR(struct series, v)
+};
+glme_desc_t series_desc = GLME_DESC(51, struct series, series_fields);
+
+static double pv[NVALS];
+static float gv[NVALS];
+static const double vv[4] = {INFINITY, -0.0, 1e-310, -INFINITY};
+
+static
+void series_check(const struct series *p)
+{
+  assert(p->np == NVALS && memcmp(p->p, pv, sizeof(pv)) == 0);
+  assert(p->ng == NVALS && memcmp(p->g, gv, sizeof(gv)) == 0);
+  assert(memcmp(p->v, vv, sizeof(vv)) == 0);
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf;
+  glme_reader_t rd;
+  glme_token_t tok;
+  glme_arena_t arena;
+  glme_node_t *root;
+  struct series s0, s1, *sp = &s1;
+  double d4[4] = {1.0, 1.0, 1.5, -2.0}, db[4], *dp;
+  float f3[3] = {NAN, 0.25f, 0.25f}, fb[3], *fp = fb;
+  size_t len;
+  int k, n, n0, typeid, cents;
+
+  glme_buf_init(&gbuf, 64);
+
+  // first value as is; equal value one zero bit; new windows
+  n = glme_encode_delta(&gbuf, GLME_FLOAT, d4, 4, sizeof(double), 1);
+  assert(n == 19 && memcmp(glme_buf_data(&gbuf),
+                           "\x12\x08\x01\x04\x0e" "\x3f\xf0\x00\x00\x00\x00\x00\x00"
+                           "\x66\x01\xc0\x33\xff\xe0", 19) == 0);
+  dp = (double *)0;
+  typeid = 0;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&dp, &len, sizeof(double)) == n);
+  assert(typeid == GLME_FLOAT && len == 4 && memcmp(dp, d4, sizeof(d4)) == 0);
+  free(dp);
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == n);
+
+  // decoded with array decoder
+  glme_buf_reset(&gbuf);
+  dp = db;
+  len = 4;
+  assert(glme_decode_array(&gbuf, &typeid, (void **)&dp, &len, sizeof(double),
+                           (glme_decoder_f)glme_decode_value_double) == n);
+  assert(len == 4 && memcmp(db, d4, sizeof(d4)) == 0);
+
+  // float elements; NaN kept
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_delta(&gbuf, GLME_FLOAT, f3, 3, sizeof(float), 1) > 0);
+  len = 3;
+  typeid = GLME_FLOAT;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&fp, &len, sizeof(float)) > 0);
+  assert(len == 3 && isnan(fb[0]) && fb[1] == 0.25f && fb[2] == 0.25f);
+  // too short target; integer target
+  glme_buf_reset(&gbuf);
+  len = 2;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&fp, &len, sizeof(float)) == GLME_E_OFLOW);
+  typeid = GLME_INT;
+  len = 3;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&fp, &len, sizeof(float)) == GLME_E_TYPE);
+  assert(gbuf.current == 0);
+
+  // empty array
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_delta(&gbuf, GLME_FLOAT, d4, 0, sizeof(double), 1) == 5);
+  dp = (double *)0;
+  typeid = 0;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&dp, &len, sizeof(double)) == 5 && len == 0);
+  free(dp);
+
+  // malformed input
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_delta(&gbuf, GLME_FLOAT, d4, 4, sizeof(double), 2) == GLME_E_INVAL);
+  assert(glme_encode_delta(&gbuf, GLME_FLOAT, d4, 4, 2, 1) == GLME_E_INVAL);
+  assert(glme_encode_delta(&gbuf, GLME_FLOAT, d4, 4, sizeof(double), 1) == 19);
+  // stream longer than input
+  gbuf.count = 18;
+  dp = (double *)0;
+  typeid = 0;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&dp, &len, 8) == GLME_E_UFLOW && dp == 0);
+  assert(glme_skip(&gbuf) < 0 && gbuf.current == 0);
+  // more elements than stream can hold
+  gbuf.count = 19;
+  gbuf.buf[3] = 0x7f;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&dp, &len, 8) == GLME_E_UFLOW && dp == 0);
+  // stream ends before last element
+  gbuf.buf[3] = 0x20;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&dp, &len, 8) == GLME_E_UFLOW && dp == 0);
+  // window reuse before first window
+  gbuf.buf[3] = 0x04;
+  gbuf.buf[13] = 0x80;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&dp, &len, 8) == GLME_E_INVAL && dp == 0);
+  // window beyond 64 bits
+  gbuf.buf[13] = 0x7f;
+  gbuf.buf[14] = 0xff;
+  assert(glme_decode_delta(&gbuf, &typeid, (void **)&dp, &len, 8) == GLME_E_INVAL && dp == 0);
+  assert(gbuf.current == 0);
+
+  // random walk price in cents and slowly varying gauge
+  srand(44);
+  for (k = 0, cents = 10000; k < NVALS; k++, cents += rand() % 5 - 2) {
+    pv[k] = cents / 100.0;
+    gv[k] = 20.0f + (float)((k / 50) % 4) * 0.5f;
+  }
+  s0 = (struct series){NVALS, pv, NVALS, gv, {0}};
+  memcpy(s0.v, vv, sizeof(vv));
+
+  glme_buf_clear(&gbuf);
+  n0 = glme_encode_struct(&gbuf, 51, &s0, encode_series_plain);
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 51, &s0, encode_series);
+  assert(n > 0 && 2 * n < n0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&gbuf, 51, (void **)&sp, 0, decode_series) == n);
+  series_check(&s1);
+  free(s1.p);
+  free(s1.g);
+
+  // descriptor table decoding
+  assert(glme_desc_init(&series_desc) == 0);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_type(&gbuf, &typeid) > 0 && typeid == 51);
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_desc(&gbuf, &series_desc, &s1) == n - 1);
+  series_check(&s1);
+  free(s1.p);
+  free(s1.g);
+  glme_desc_release(&series_desc);
+
+  // pull parser returns bit stream as bytes
+  glme_buf_reset(&gbuf);
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_BYTES);
+  assert(tok.typeid == GLME_DELTA && tok.ktype == GLME_FLOAT && tok.count == NVALS);
+  assert(tok.v.s.len > 8 && tok.v.s.len < NVALS * 6);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_skip(&rd) == 0);
+
+  // value tree encodes bit stream as is
+  glme_buf_reset(&gbuf);
+  glme_arena_init(&arena, 0);
+  root = (glme_node_t *)0;
+  assert(glme_node_decode(&gbuf, &arena, &root) == n);
+  glme_buf_clear(&gbuf);
+  assert(glme_node_encode(&gbuf, root) == n);
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&gbuf, 51, (void **)&sp, 0, decode_series) == n);
+  series_check(&s1);
+  free(s1.p);
+  free(s1.g);
+  glme_arena_release(&arena);
+
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
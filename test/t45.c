@@ -0,0 +1,243 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Single precision floating point wire type
+
+#define NVALS 1000
+
+struct sensor
+{
+  float t;
+  double h;
+  size_t ns;
+  float *s;
+  float v[4];
+};
+
+int encode_sensor(glme_buf_t *gb, const void *ptr)
+{
+  const struct sensor *p = (const struct sensor *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_FLOAT32(gb, p->t, 0.0);
+  GLME_ENCODE_FLD_FLOAT32(gb, p->h, 0.0);
+  GLME_ENCODE_FLD_FLOAT32_ARRAY(gb, p->s, p->ns);
+  GLME_ENCODE_FLD_FLOAT32_VECTOR(gb, p->v);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int encode_sensor_double(glme_buf_t *gb, const void *ptr)
+{
+  const struct sensor *p = (const struct sensor *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_DOUBLE(gb, p->t, 0.0);
+  GLME_ENCODE_FLD_DOUBLE(gb, p->h, 0.0);
+  GLME_ENCODE_FLD_FLOAT_ARRAY(gb, p->s, p->ns, glme_encode_value_float);
+  GLME_ENCODE_FLD_FLOAT_VECTOR(gb, p->v, glme_encode_value_float);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int fast_encode_sensor(glme_buf_t *gb, const void *ptr)
+{
+  const struct sensor *p = (const struct sensor *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_FAST_ENCODE_FLD_FLOAT32(gb, p->t, 0.0);
+  GLME_FAST_ENCODE_FLD_FLOAT32(gb, p->h, 0.0);
+  GLME_ENCODE_FLD_FLOAT32_ARRAY(gb, p->s, p->ns);
+  GLME_ENCODE_FLD_FLOAT32_VECTOR(gb, p->v);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+// floating point decoders accept both precisions
+int decode_sensor(glme_buf_t *gb, void *ptr)
+{
+  struct sensor *p = (struct sensor *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_DOUBLE(gb, p->t, 0.0);
+  GLME_DECODE_FLD_DOUBLE(gb, p->h, 0.0);
+  GLME_DECODE_FLD_FLOAT_ARRAY(gb, p->s, p->ns, glme_decode_value_float);
+  GLME_DECODE_FLD_FLOAT_VECTOR(gb, p->v, glme_decode_value_float);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int fast_decode_sensor(glme_buf_t *gb, void *ptr)
+{
+  struct sensor *p = (struct sensor *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_FAST_DECODE_FLD_DOUBLE(gb, p->t, 0.0);
+  GLME_FAST_DECODE_FLD_DOUBLE(gb, p->h, 0.0);
+  GLME_DECODE_FLD_FLOAT_ARRAY(gb, p->s, p->ns, glme_decode_value_float);
+  GLME_DECODE_FLD_FLOAT_VECTOR(gb, p->v, glme_decode_value_float);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+glme_field_t sensor_fields[] = {
+  GLME_FIELD_DOUBLE(struct sensor, t, 0.0),
+  GLME_FIELD_DOUBLE(struct sensor, h, 0.0),
+  GLME_FIELD_FLOAT_ARRAY(struct sensor, s, ns),
+  GLME_FIELD_FLOAT_VECTOR(struct sensor, v)
+};
+glme_desc_t sensor_desc = GLME_DESC(52, struct sensor, sensor_fields);
+
+static float sv[NVALS];
+
+static
+void sensor_check(const struct sensor *p)
+{
+  assert(p->t == 21.5f && p->h == (double)0.1f);
+  assert(p->ns == NVALS && memcmp(p->s, sv, sizeof(sv)) == 0);
+  assert(p->v[0] == 1.0f && p->v[1] == -1.0f && p->v[2] == 0.0f && p->v[3] == 3.25f);
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf;
+  glme_reader_t rd;
+  glme_token_t tok;
+  glme_arena_t arena;
+  glme_node_t *root;
+  glme_jit_t jit;
+  glme_spec_t spec;
+  struct sensor s0, s1, *sp = &s1;
+  float f = 1.5f, fv[3] = {0.1f, -2.0f, 1e30f}, fb[3], *fp = fb;
+  double d, db[3], *dp = db;
+  size_t len;
+  int k, n, n0, typeid;
+
+  glme_buf_init(&gbuf, 64);
+
+  // 32 bits byte reversed; one byte less than widened double
+  n = glme_encode_float32(&gbuf, &f);
+  assert(n == 4 && memcmp(glme_buf_data(&gbuf), "\x1c\xfe\xc0\x3f", 4) == 0);
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_float32(&gbuf, &fv[0]) == 6);
+  assert(glme_encode_float(&gbuf, &fv[0]) == 7);
+  assert(glme_decode_float32(&gbuf, &f) == 6 && f == 0.1f);
+  assert(glme_decode_double(&gbuf, &d) == 7 && d == (double)0.1f);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_double(&gbuf, &d) == 6 && d == (double)0.1f);
+  assert(glme_decode_float(&gbuf, &f) == 7 && f == 0.1f);
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == 6 && glme_skip(&gbuf) == 7);
+  // truncated value
+  gbuf.count = 5;
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_double(&gbuf, &d) < 0 && gbuf.last_error == GLME_E_UFLOW);
+  // other types rejected
+  glme_buf_clear(&gbuf);
+  k = 5;
+  assert(glme_encode_int(&gbuf, &k) > 0);
+  assert(glme_decode_float(&gbuf, &f) < 0);
+
+  // arrays decoded to either precision
+  glme_buf_clear(&gbuf);
+  n = glme_encode_array(&gbuf, GLME_FLOAT32, fv, 3, sizeof(float),
+                        (glme_encoder_f)glme_encode_value_float32);
+  assert(n > 0);
+  len = 3;
+  assert(glme_decode_array(&gbuf, &typeid, (void **)&dp, &len, sizeof(double),
+                           (glme_decoder_f)glme_decode_value_double) == n);
+  assert(typeid == GLME_FLOAT32 && db[0] == (double)fv[0] && db[2] == (double)fv[2]);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_array(&gbuf, &typeid, (void **)&fp, &len, sizeof(float),
+                           (glme_decoder_f)glme_decode_value_float) == n);
+  assert(memcmp(fb, fv, sizeof(fv)) == 0);
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == n);
+
+  // sensor readings with two decimals
+  for (k = 0; k < NVALS; k++)
+    sv[k] = (float)(2000 + (k * 37) % 500) / 100.0f;
+  s0 = (struct sensor){21.5f, 0.1f, NVALS, sv, {1.0f, -1.0f, 0.0f, 3.25f}};
+
+  glme_buf_clear(&gbuf);
+  n0 = glme_encode_struct(&gbuf, 52, &s0, encode_sensor_double);
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 52, &s0, encode_sensor);
+  assert(n > 0 && n + NVALS * 3 / 4 < n0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&gbuf, 52, (void **)&sp, 0, decode_sensor) == n);
+  sensor_check(&s1);
+  free(s1.s);
+
+  // fast field macros
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_struct(&gbuf, 52, &s0, fast_encode_sensor) == n);
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&gbuf, 52, (void **)&sp, 0, fast_decode_sensor) == n);
+  sensor_check(&s1);
+  free(s1.s);
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_struct(&gbuf, 52, &s0, encode_sensor_double) == n0);
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&gbuf, 52, (void **)&sp, 0, fast_decode_sensor) == n0);
+  sensor_check(&s1);
+  free(s1.s);
+
+  // descriptor table; interpreted and compiled
+  assert(glme_desc_init(&sensor_desc) == 0);
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_struct(&gbuf, 52, &s0, encode_sensor) == n);
+  assert(glme_decode_type(&gbuf, &typeid) > 0 && typeid == 52);
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_desc(&gbuf, &sensor_desc, &s1) == n - 1);
+  sensor_check(&s1);
+  free(s1.s);
+  if (glme_jit_compile(&jit, &spec, &sensor_desc, 0) > 0) {
+    glme_buf_reset(&gbuf);
+    assert(glme_decode_type(&gbuf, &typeid) > 0 && typeid == 52);
+    memset(&s1, 0, sizeof(s1));
+    assert(spec.decoder(&gbuf, &s1) == n - 1);
+    sensor_check(&s1);
+    free(s1.s);
+    glme_jit_release(&jit);
+  }
+  glme_desc_release(&sensor_desc);
+
+  // pull parser and value tree keep the type
+  glme_buf_reset(&gbuf);
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_SCALAR);
+  assert(tok.typeid == GLME_FLOAT32 && tok.v.f == 21.5);
+  assert(glme_reader_skip(&rd) == 0);
+
+  glme_buf_reset(&gbuf);
+  glme_arena_init(&arena, 0);
+  root = (glme_node_t *)0;
+  assert(glme_node_decode(&gbuf, &arena, &root) == n);
+  glme_buf_clear(&gbuf);
+  assert(glme_node_encode(&gbuf, root) == n);
+  memset(&s1, 0, sizeof(s1));
+  assert(glme_decode_struct(&gbuf, 52, (void **)&sp, 0, decode_sensor) == n);
+  sensor_check(&s1);
+  free(s1.s);
+  glme_arena_release(&arena);
+
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
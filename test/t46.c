@@ -0,0 +1,319 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Stream string dictionary
+
+#define NMSGS 200
+
+struct quote
+{
+  int64_t seq;
+  char *sym;
+  char *venue;
+  double px;
+};
+
+int encode_quote(glme_buf_t *gb, const void *ptr)
+{
+  const struct quote *p = (const struct quote *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->seq, 0);
+  GLME_ENCODE_FLD_STRING(gb, p->sym);
+  GLME_ENCODE_FLD_STRING(gb, p->venue);
+  GLME_ENCODE_FLD_DOUBLE(gb, p->px, 0.0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_quote(glme_buf_t *gb, void *ptr)
+{
+  struct quote *p = (struct quote *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->seq, 0);
+  GLME_DECODE_FLD_STRING(gb, p->sym);
+  GLME_DECODE_FLD_STRING(gb, p->venue);
+  GLME_DECODE_FLD_DOUBLE(gb, p->px, 0.0);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+int fast_encode_quote(glme_buf_t *gb, const void *ptr)
+{
+  const struct quote *p = (const struct quote *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_FAST_ENCODE_FLD_INT(gb, p->seq, 0);
+  GLME_FAST_ENCODE_FLD_STRING(gb, p->sym);
+  GLME_FAST_ENCODE_FLD_STRING(gb, p->venue);
+  GLME_FAST_ENCODE_FLD_DOUBLE(gb, p->px, 0.0);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int fast_decode_quote(glme_buf_t *gb, void *ptr)
+{
+  struct quote *p = (struct quote *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_FAST_DECODE_FLD_INT(gb, p->seq, 0);
+  GLME_FAST_DECODE_FLD_STRING(gb, p->sym);
+  GLME_FAST_DECODE_FLD_STRING(gb, p->venue);
+  GLME_FAST_DECODE_FLD_DOUBLE(gb, p->px, 0.0);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+glme_field_t quote_fields[] = {
+  GLME_FIELD_INT(struct quote, seq, 0),
+  GLME_FIELD_STRING(struct quote, sym),
+  GLME_FIELD_STRING(struct quote, venue),
+  GLME_FIELD_DOUBLE(struct quote, px, 0.0)
+};
+glme_desc_t quote_desc = GLME_DESC(53, struct quote, quote_fields);
+
+static const char *syms[] = {"AAPL", "MSFT", "NOKIA", "ORCL", "IBM"};
+static const char *venues[] = {"XNAS", "XHEL", "a venue name longer than the limit"};
+
+static
+void quote_make(struct quote *q, int k)
+{
+  *q = (struct quote){k, (char *)syms[k % 5], (char *)venues[k % 3], 100.0 + k / 4.0};
+}
+
+static
+void quote_check(glme_buf_t *gb, struct quote *q, int k)
+{
+  struct quote q0;
+  quote_make(&q0, k);
+  assert(q->seq == q0.seq && q->px == q0.px);
+  assert(strcmp(q->sym, q0.sym) == 0 && strcmp(q->venue, q0.venue) == 0);
+  glme_dict_free(gb, q->sym);
+  glme_dict_free(gb, q->venue);
+}
+
+typedef int (*quote_decoder_f)(glme_buf_t *, struct quote *);
+
+static
+int quote_struct(glme_buf_t *gb, struct quote *q)
+{
+  return glme_decode_struct(gb, 53, (void **)&q, 0, decode_quote);
+}
+
+static
+int quote_fast(glme_buf_t *gb, struct quote *q)
+{
+  return glme_decode_struct(gb, 53, (void **)&q, 0, fast_decode_quote);
+}
+
+static
+int quote_desc_dec(glme_buf_t *gb, struct quote *q)
+{
+  int n, typeid;
+  if ((n = glme_decode_type(gb, &typeid)) < 0 || typeid != 53)
+    return -1;
+  return glme_decode_desc(gb, &quote_desc, q);
+}
+
+static glme_spec_t jspec;
+
+static
+int quote_jit(glme_buf_t *gb, struct quote *q)
+{
+  int n, typeid;
+  if ((n = glme_decode_type(gb, &typeid)) < 0 || typeid != 53)
+    return -1;
+  return jspec.decoder(gb, q);
+}
+
+// encode messages with dictionary reset at every 100th; returns stream length
+static
+size_t encode_all(glme_buf_t *gb, glme_encoder_f efunc, int dict)
+{
+  glme_dict_t d;
+  struct quote q;
+  int k;
+
+  glme_buf_clear(gb);
+  if (dict)
+    glme_dict_begin(gb, &d, 4, 16);
+  for (k = 0; k < NMSGS; k++) {
+    if (dict && k == 100)
+      glme_dict_reset(gb, &d);
+    quote_make(&q, k);
+    if (efunc)
+      assert(glme_encode_struct(gb, 53, &q, efunc) > 0);
+    else
+      assert(glme_encode_type(gb, 53) > 0 && glme_encode_desc(gb, &quote_desc, &q) > 0);
+  }
+  if (dict)
+    glme_dict_end(gb, &d);
+  return glme_buf_len(gb);
+}
+
+static
+void decode_all(glme_buf_t *gb, quote_decoder_f dfunc)
+{
+  glme_dict_t d;
+  struct quote q;
+  char *aapl = (char *)0;
+  int k;
+
+  glme_buf_reset(gb);
+  glme_dict_begin(gb, &d, 4, 16);
+  for (k = 0; k < NMSGS; k++) {
+    if (k == 100) {
+      glme_dict_reset(gb, &d);
+      aapl = (char *)0;
+    }
+    memset(&q, 0, sizeof(q));
+    assert((*dfunc)(gb, &q) > 0);
+    // repeated string shares one copy
+    if (k % 5 == 0) {
+      assert(!aapl || q.sym == aapl);
+      aapl = q.sym;
+    }
+    quote_check(gb, &q, k);
+  }
+  assert(gb->current == gb->count && d.count == 4);
+  glme_dict_end(gb, &d);
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, out;
+  glme_dict_t dict;
+  glme_reader_t rd;
+  glme_token_t tok;
+  glme_arena_t arena;
+  glme_node_t *root;
+  glme_jit_t jit;
+  struct quote q;
+  char fixed[64], *s, *t;
+  size_t n0, n;
+  int k;
+
+  glme_buf_init(&gbuf, 64);
+
+  // first occurrence as is, then reference in place of type id
+  glme_dict_begin(&gbuf, &dict, 0, 0);
+  assert(glme_encode_string(&gbuf, "abc") == 5);
+  assert(glme_encode_string(&gbuf, "xy") == 4);
+  assert(glme_encode_string(&gbuf, "abc") == 1);
+  assert(glme_encode_string(&gbuf, "xy") == 1);
+  assert(glme_encode_string(&gbuf, "") == 2);
+  assert(glme_encode_string(&gbuf, "") == 2);
+  assert(memcmp(glme_buf_data(&gbuf), "\x0c\x03" "abc" "\x0c\x02xy" "\x01\x03\x0c\x00\x0c\x00", 15) == 0);
+  assert(dict.count == 2);
+  glme_dict_end(&gbuf, &dict);
+  assert(dict.table == 0);
+
+  glme_dict_begin(&gbuf, &dict, 0, 0);
+  assert(glme_decode_string(&gbuf, &s) == 5 && strcmp(s, "abc") == 0);
+  assert(glme_decode_string(&gbuf, &t) == 4 && strcmp(t, "xy") == 0);
+  assert(glme_decode_string(&gbuf, &s) == 1 && strcmp(s, "abc") == 0);
+  assert(glme_decode_string(&gbuf, &s) == 1 && s == t);
+  assert(glme_decode_string(&gbuf, &s) == 2 && *s == '\0');
+  glme_dict_free(&gbuf, s);
+  // unknown reference
+  glme_buf_reset(&gbuf);
+  gbuf.current = 10;
+  gbuf.buf[10] = 0x05;
+  assert(glme_decode_string(&gbuf, &s) == GLME_E_INVAL && gbuf.current == 10);
+  gbuf.buf[10] = 0x01;
+  glme_dict_end(&gbuf, &dict);
+  // reference without dictionary
+  glme_buf_reset(&gbuf);
+  gbuf.current = 10;
+  assert(glme_decode_string(&gbuf, &s) < 0);
+  // skipped as back-references
+  glme_buf_reset(&gbuf);
+  for (k = 0; k < 6; k++)
+    assert(glme_skip(&gbuf) > 0);
+  assert(gbuf.current == gbuf.count);
+
+  // repeated symbols take one byte; long and extra strings sent as is
+  n0 = encode_all(&gbuf, encode_quote, 0);
+  n = encode_all(&gbuf, encode_quote, 1);
+  assert(n + NMSGS * 4 < n0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+  decode_all(&gbuf, quote_struct);
+  decode_all(&gbuf, quote_fast);
+
+  // fast field macros and descriptor tables produce the same stream
+  assert(encode_all(&gbuf, fast_encode_quote, 1) == n);
+  decode_all(&gbuf, quote_struct);
+  assert(glme_desc_init(&quote_desc) == 0);
+  assert(encode_all(&gbuf, (glme_encoder_f)0, 1) == n);
+  decode_all(&gbuf, quote_desc_dec);
+  if (glme_jit_compile(&jit, &jspec, &quote_desc, 0) > 0) {
+    decode_all(&gbuf, quote_jit);
+    glme_jit_release(&jit);
+  }
+  decode_all(&gbuf, quote_fast);
+
+  // pull parser and value tree keep references
+  glme_buf_reset(&gbuf);
+  for (k = 0; k < 5; k++)
+    assert(glme_skip(&gbuf) > 0);
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_SCALAR);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_REF && tok.v.u == 0);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_BYTES && tok.v.s.len > 16);
+
+  glme_buf_reset(&gbuf);
+  glme_buf_init(&out, 64);
+  glme_arena_init(&arena, 0);
+  for (k = 0; k < NMSGS; k++) {
+    root = (glme_node_t *)0;
+    assert(glme_node_decode(&gbuf, &arena, &root) > 0);
+    assert(glme_node_encode(&out, root) > 0);
+  }
+  glme_arena_release(&arena);
+  assert(glme_buf_len(&out) == n && memcmp(glme_buf_data(&out), glme_buf_data(&gbuf), n) == 0);
+  decode_all(&out, quote_struct);
+  glme_buf_close(&out);
+
+  // failed encode to fixed buffer drops strings it entered; retry sends them
+  glme_buf_make(&out, fixed, 4, 0);
+  glme_dict_begin(&out, &dict, 0, 0);
+  assert(glme_encode_string(&out, "hello") < 0 && dict.count == 0);
+  glme_buf_make(&out, fixed, sizeof(fixed), 0);
+  assert(glme_encode_string(&out, "hello") == 7 && dict.count == 1);
+  // end marker of message does not fit
+  q = (struct quote){1, "abc", "xyz", 0.0};
+  glme_buf_make(&out, fixed, 7 + 15, 7);
+  assert(glme_encode_desc(&out, &quote_desc, &q) < 0 && dict.count == 1);
+  glme_buf_make(&out, fixed, sizeof(fixed), 7);
+  assert(glme_encode_desc(&out, &quote_desc, &q) == 16 && dict.count == 3);
+  glme_dict_end(&out, &dict);
+  // peer with fresh dictionary
+  glme_buf_make(&out, fixed, sizeof(fixed), 7 + 16);
+  glme_dict_begin(&out, &dict, 0, 0);
+  assert(glme_decode_string(&out, &s) == 7 && strcmp(s, "hello") == 0);
+  memset(&q, 0, sizeof(q));
+  assert(glme_decode_desc(&out, &quote_desc, &q) == 16);
+  assert(q.seq == 1 && strcmp(q.sym, "abc") == 0 && strcmp(q.venue, "xyz") == 0);
+  glme_dict_end(&out, &dict);
+
+  glme_desc_release(&quote_desc);
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
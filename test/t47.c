@@ -0,0 +1,280 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Columnar structure arrays
+
+#define NROWS 1000
+
+struct tick
+{
+  int64_t ts;
+  double px;
+  float sz;
+  uint32_t qty;
+  int16_t flag;
+  uint8_t side;
+};
+
+struct batch
+{
+  size_t n;
+  struct tick *t;
+};
+
+struct named
+{
+  int64_t id;
+  char *name;
+};
+
+glme_field_t tick_fields[] = {
+  GLME_FIELD_INT(struct tick, ts, 0),
+  GLME_FIELD_DOUBLE(struct tick, px, 0.0),
+  GLME_FIELD_DOUBLE(struct tick, sz, 0.0),
+  GLME_FIELD_UINT(struct tick, qty, 0),
+  GLME_FIELD_INT(struct tick, flag, -1),
+  GLME_FIELD_UINT(struct tick, side, 0)
+};
+glme_desc_t tick_desc = GLME_DESC(54, struct tick, tick_fields);
+
+glme_field_t batch_fields[] = {
+  GLME_FIELD_STRUCT_ARRAY(struct batch, t, n, 54, &tick_desc)
+};
+glme_desc_t batch_desc = GLME_DESC(55, struct batch, batch_fields);
+
+glme_field_t named_fields[] = {
+  GLME_FIELD_INT(struct named, id, 0),
+  GLME_FIELD_STRING(struct named, name)
+};
+glme_desc_t named_desc = GLME_DESC(56, struct named, named_fields);
+
+int encode_batch(glme_buf_t *gb, const void *ptr)
+{
+  const struct batch *p = (const struct batch *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_COLUMNS(gb, &tick_desc, p->t, p->n);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_batch(glme_buf_t *gb, void *ptr)
+{
+  struct batch *p = (struct batch *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_COLUMNS(gb, &tick_desc, p->t, p->n);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+static struct tick rows[NROWS];
+
+static
+void ticks_make(void)
+{
+  int k, cents;
+
+  memset(rows, 0, sizeof(rows));
+  srand(47);
+  for (k = 0, cents = 10000; k < NROWS; k++, cents += rand() % 5 - 2) {
+    rows[k].ts = 1700000000000LL + k * 250;
+    rows[k].px = cents / 100.0;
+    rows[k].sz = (float)(k % 7) * 0.5f;
+    rows[k].qty = 100 + (k * 13) % 50;
+    rows[k].flag = -1;
+    rows[k].side = k % 3 == 0;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, out;
+  glme_reader_t rd;
+  glme_token_t tok;
+  glme_arena_t arena;
+  glme_limits_t limits;
+  glme_node_t *root;
+  struct tick *tp, t3[3], few[10];
+  struct batch b0, b1, *bp = &b1;
+  struct named nm = {1, "a"};
+  int64_t ts[NROWS];
+  double px[NROWS];
+  float sz[NROWS];
+  uint32_t qty[NROWS];
+  int16_t flag[NROWS];
+  void *cols[6];
+  size_t len;
+  int k, n, n0, typeid;
+
+  glme_buf_init(&gbuf, 64);
+  assert(glme_desc_init(&tick_desc) == 0);
+  assert(glme_desc_init(&batch_desc) == 0);
+  assert(glme_desc_init(&named_desc) == 0);
+
+  // one column of small integers as plain array; default columns omitted
+  memset(t3, 0, sizeof(t3));
+  for (k = 0; k < 3; k++) {
+    t3[k].ts = k + 1;
+    t3[k].flag = -1;
+  }
+  n = glme_encode_columns(&gbuf, &tick_desc, t3, 3);
+  assert(n == 11 && memcmp(glme_buf_data(&gbuf),
+                           "\x1e\x6c\x03" "\x01\x14\x04\x03\x02\x04\x06" "\x00", 11) == 0);
+  tp = (struct tick *)0;
+  assert(glme_decode_columns(&gbuf, &tick_desc, (void **)&tp, &len) == n);
+  assert(len == 3 && memcmp(tp, t3, sizeof(t3)) == 0);
+  free(tp);
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == n);
+
+  // empty array
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_columns(&gbuf, &tick_desc, t3, 0) == 4);
+  tp = (struct tick *)0;
+  assert(glme_decode_columns(&gbuf, &tick_desc, (void **)&tp, &len) == 4 && len == 0 && !tp);
+
+  // only scalar fields; type id must match
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_columns(&gbuf, &named_desc, &nm, 1) == GLME_E_TYPE);
+  assert(glme_buf_len(&gbuf) == 0);
+  assert(glme_encode_columns(&gbuf, &tick_desc, t3, 3) == 11);
+  len = 0;
+  tp = (struct tick *)0;
+  assert(glme_decode_columns(&gbuf, &batch_desc, (void **)&tp, &len) == GLME_E_TYPE);
+  assert(gbuf.current == 0);
+
+  // time stamps, prices, sizes and flags; columns smaller than rows
+  ticks_make();
+  glme_buf_clear(&gbuf);
+  b0 = (struct batch){NROWS, rows};
+  assert(glme_encode_type(&gbuf, 55) > 0);
+  n0 = glme_encode_desc(&gbuf, &batch_desc, &b0);
+  glme_buf_clear(&gbuf);
+  n = glme_encode_columns(&gbuf, &tick_desc, rows, NROWS);
+  assert(n > 0 && 2 * n < n0);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  tp = (struct tick *)0;
+  assert(glme_decode_columns(&gbuf, &tick_desc, (void **)&tp, &len) == n);
+  assert(len == NROWS && memcmp(tp, rows, sizeof(rows)) == 0);
+  free(tp);
+  // target too short
+  glme_buf_reset(&gbuf);
+  tp = few;
+  len = 10;
+  assert(glme_decode_columns(&gbuf, &tick_desc, (void **)&tp, &len) == GLME_E_OFLOW);
+  assert(gbuf.current == 0 && len == 10);
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == n);
+  // scratch column is charged to limits
+  glme_buf_reset(&gbuf);
+  tp = (struct tick *)0;
+  glme_limits_begin(&gbuf, &limits, sizeof(rows), 0);
+  assert(glme_decode_columns(&gbuf, &tick_desc, (void **)&tp, &len) == GLME_E_NOMEM);
+  glme_limits_end(&gbuf, &limits);
+  assert(limits.exceeded && !tp && gbuf.current == 0);
+
+  // malformed header; rows beyond input without target array
+  glme_buf_clear(&gbuf);
+  memcpy(gbuf.buf, "\x1e\x6c\xfc\x01\x00\x00\x00\x00", 8);
+  gbuf.count = 8;
+  tp = (struct tick *)0;
+  assert(glme_decode_columns(&gbuf, &tick_desc, (void **)&tp, &len) == GLME_E_UFLOW);
+  assert(gbuf.last_error == GLME_E_UFLOW && !tp && gbuf.current == 0);
+  // all default rows into target array
+  memcpy(gbuf.buf, "\x1e\x6c\x05\x00", 4);
+  gbuf.count = 4;
+  assert(glme_decode_columns(&gbuf, &tick_desc, (void **)&tp, &len) == GLME_E_UFLOW);
+  tp = few;
+  len = 10;
+  assert(glme_decode_columns(&gbuf, &tick_desc, (void **)&tp, &len) == 4 && len == 5);
+  assert(few[0].ts == 0 && few[4].flag == -1);
+
+  // straight to column arrays; side skipped, missing flag filled with default
+  glme_buf_clear(&gbuf);
+  for (k = 0; k < NROWS; k++)
+    rows[k].flag = -1;
+  assert(glme_encode_columns(&gbuf, &tick_desc, rows, NROWS) == n);
+  cols[0] = ts;
+  cols[1] = px;
+  cols[2] = sz;
+  cols[3] = qty;
+  cols[4] = flag;
+  cols[5] = (void *)0;
+  memset(flag, 0, sizeof(flag));
+  len = NROWS;
+  assert(glme_decode_column_arrays(&gbuf, &tick_desc, cols, &len) == n && len == NROWS);
+  for (k = 0; k < NROWS; k++) {
+    assert(ts[k] == rows[k].ts && px[k] == rows[k].px && sz[k] == rows[k].sz);
+    assert(qty[k] == rows[k].qty && flag[k] == -1);
+  }
+  glme_buf_reset(&gbuf);
+  len = NROWS - 1;
+  assert(glme_decode_column_arrays(&gbuf, &tick_desc, cols, &len) == GLME_E_OFLOW);
+  assert(gbuf.current == 0);
+
+  // structure field; field macros and descriptor table decoding
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 55, &b0, encode_batch);
+  assert(n > 0);
+  memset(&b1, 0, sizeof(b1));
+  assert(glme_decode_struct(&gbuf, 55, (void **)&bp, 0, decode_batch) == n);
+  assert(b1.n == NROWS && memcmp(b1.t, rows, sizeof(rows)) == 0);
+  free(b1.t);
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_type(&gbuf, &typeid) > 0 && typeid == 55);
+  memset(&b1, 0, sizeof(b1));
+  assert(glme_decode_desc(&gbuf, &batch_desc, &b1) == n - 1);
+  assert(b1.n == NROWS && memcmp(b1.t, rows, sizeof(rows)) == 0);
+  free(b1.t);
+
+  // pull parser returns columns as structure fields
+  glme_buf_reset(&gbuf);
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT && tok.typeid == 55 && tok.ktype == 0);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT);
+  assert(tok.typeid == 54 && tok.ktype == GLME_COLUMNS && tok.count == NROWS);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD && tok.fno == 0);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_ARRAY && tok.typeid == GLME_INT);
+  assert(glme_reader_skip(&rd) == 0);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD && tok.fno == 1);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_BYTES && tok.typeid == GLME_DELTA);
+  assert(glme_reader_skip(&rd) == 0);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT_END && tok.typeid == 55);
+
+  // value tree keeps columns; delta integer columns are encoded as plain arrays
+  glme_buf_reset(&gbuf);
+  glme_arena_init(&arena, 0);
+  root = (glme_node_t *)0;
+  assert(glme_node_decode(&gbuf, &arena, &root) == n);
+  assert(root->count == 1 && root->v.items->ktype == GLME_COLUMNS);
+  assert(root->v.items->count == NROWS);
+  glme_buf_init(&out, 64);
+  assert((n = glme_node_encode(&out, root)) > 0);
+  memset(&b1, 0, sizeof(b1));
+  assert(glme_decode_struct(&out, 55, (void **)&bp, 0, decode_batch) == n);
+  assert(b1.n == NROWS && memcmp(b1.t, rows, sizeof(rows)) == 0);
+  free(b1.t);
+  glme_arena_release(&arena);
+  glme_buf_close(&out);
+
+  glme_desc_release(&named_desc);
+  glme_desc_release(&batch_desc);
+  glme_desc_release(&tick_desc);
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,177 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "glme.h"
+
+// Bit packed boolean arrays
+
+#define NFEATS 1000
+
+struct mask
+{
+  int64_t id;
+  size_t nf;
+  bool *f;
+  uint8_t v[12];
+};
+
+int encode_mask(glme_buf_t *gb, const void *ptr)
+{
+  const struct mask *p = (const struct mask *)ptr;
+  GLME_ENCODE_STDDEF(gb);
+  GLME_ENCODE_STRUCT_START(gb);
+  GLME_ENCODE_FLD_INT(gb, p->id, 0);
+  GLME_ENCODE_FLD_BOOL_ARRAY(gb, p->f, p->nf);
+  GLME_ENCODE_FLD_BOOL_VECTOR(gb, p->v);
+  GLME_ENCODE_STRUCT_END(gb);
+  GLME_ENCODE_RETURN(gb);
+}
+
+int decode_mask(glme_buf_t *gb, void *ptr)
+{
+  struct mask *p = (struct mask *)ptr;
+  GLME_DECODE_STDDEF(gb);
+  GLME_DECODE_STRUCT_START(gb);
+  GLME_DECODE_FLD_INT(gb, p->id, 0);
+  GLME_DECODE_FLD_BOOL_ARRAY(gb, p->f, p->nf);
+  GLME_DECODE_FLD_BOOL_VECTOR(gb, p->v);
+  GLME_DECODE_STRUCT_END(gb);
+  GLME_DECODE_RETURN(gb);
+}
+
+static bool feats[NFEATS];
+
+int main(int argc, char **argv)
+{
+  glme_buf_t gbuf, out;
+  glme_reader_t rd;
+  glme_token_t tok;
+  glme_arena_t arena;
+  glme_node_t *root;
+  struct mask m0, m1, *mp = &m1;
+  uint8_t v11[11] = {1, 0, 0, 1, 0, 0, 0, 1, 1, 0, 1}, v[24], *vp, bits[4];
+  unsigned int u11[11];
+  const void *data;
+  size_t len;
+  int k, n, kind;
+
+  glme_buf_init(&gbuf, 64);
+
+  // first element in lowest bit; nonzero bytes are set bits
+  glme_pack_bits(bits, "\x01\x00\x00\x07\x00\x00\x00\xff\x01\x00\x01", 11);
+  assert(bits[0] == 0x89 && bits[1] == 0x05);
+  memset(v, 0xaa, sizeof(v));
+  glme_unpack_bits(v, bits, 11);
+  assert(memcmp(v, v11, 11) == 0 && v[11] == 0xaa);
+
+  n = glme_encode_bits(&gbuf, v11, 11);
+  assert(n == 6 && memcmp(glme_buf_data(&gbuf), "\x10\x10\x0b\x00\x89\x05", 6) == 0);
+  vp = (uint8_t *)0;
+  assert(glme_decode_bits(&gbuf, (void **)&vp, &len) == n);
+  assert(len == 11 && memcmp(vp, v11, 11) == 0);
+  free(vp);
+  // bitmap view with packed array decoder
+  glme_buf_reset(&gbuf);
+  assert(glme_decode_packed(&gbuf, &kind, &data, &len) == n);
+  assert(kind == GLME_PACKED_BITS && len == 11 && memcmp(data, bits, 2) == 0);
+  glme_buf_reset(&gbuf);
+  assert(glme_skip(&gbuf) == n);
+  // target too short
+  glme_buf_reset(&gbuf);
+  vp = v;
+  len = 10;
+  assert(glme_decode_bits(&gbuf, (void **)&vp, &len) == GLME_E_OFLOW && gbuf.current == 0);
+
+  // bitmap written as is; unused bits cleared
+  glme_buf_clear(&gbuf);
+  bits[1] = 0xfd;
+  assert(glme_encode_packed(&gbuf, GLME_PACKED_BITS, bits, 11, GLME_F_ALIGN) == n);
+  assert(memcmp(glme_buf_data(&gbuf), "\x10\x10\x0b\x00\x89\x05", 6) == 0);
+
+  // plain boolean arrays accepted
+  glme_buf_clear(&gbuf);
+  for (k = 0; k < 11; k++)
+    u11[k] = v11[k];
+  assert(glme_encode_array(&gbuf, GLME_BOOLEAN, u11, 11, sizeof(u11[0]),
+                           (glme_encoder_f)glme_encode_value_uint) > 0);
+  vp = v;
+  len = sizeof(v);
+  assert(glme_decode_bits(&gbuf, (void **)&vp, &len) > 0);
+  assert(len == 11 && memcmp(v, v11, 11) == 0);
+  // other types rejected
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_packed(&gbuf, GLME_PACKED_KIND(GLME_UINT, 1), v11, 11, 0) > 0);
+  assert(glme_decode_bits(&gbuf, (void **)&vp, &len) == GLME_E_TYPE && gbuf.current == 0);
+
+  // truncated bitmap
+  glme_buf_clear(&gbuf);
+  assert(glme_encode_bits(&gbuf, v11, 11) == 6);
+  gbuf.count = 5;
+  vp = (uint8_t *)0;
+  assert(glme_decode_bits(&gbuf, (void **)&vp, &len) == GLME_E_UFLOW && !vp);
+  assert(glme_skip(&gbuf) < 0 && gbuf.current == 0);
+
+  // feature mask; one bit per feature
+  for (k = 0; k < NFEATS; k++)
+    feats[k] = k % 3 == 0 || k % 7 == 0;
+  m0 = (struct mask){47, NFEATS, feats, {1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1}};
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 57, &m0, encode_mask);
+  assert(n > NFEATS / 8 && n < NFEATS / 8 + 20);
+  if (argc > 1)
+    write(1, glme_buf_data(&gbuf), glme_buf_len(&gbuf));
+
+  memset(&m1, 0xff, sizeof(m1));
+  assert(glme_decode_struct(&gbuf, 57, (void **)&mp, 0, decode_mask) == n);
+  assert(m1.id == 47 && m1.nf == NFEATS && memcmp(m1.f, feats, sizeof(feats)) == 0);
+  assert(memcmp(m1.v, m0.v, sizeof(m0.v)) == 0);
+  free(m1.f);
+
+  // empty array omitted; vector always sent
+  m0.nf = 0;
+  memset(m0.v, 0, sizeof(m0.v));
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 57, &m0, encode_mask);
+  assert(n == 12);
+  memset(&m1, 0xff, sizeof(m1));
+  assert(glme_decode_struct(&gbuf, 57, (void **)&mp, 0, decode_mask) == n);
+  assert(m1.nf == 0 && !m1.f && m1.v[0] == 0 && m1.v[11] == 0);
+
+  // pull parser and value tree keep the bitmap
+  m0.nf = NFEATS;
+  m0.v[3] = 1;
+  glme_buf_clear(&gbuf);
+  n = glme_encode_struct(&gbuf, 57, &m0, encode_mask);
+  glme_reader_init(&rd, &gbuf);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_STRUCT);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_SCALAR);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_FIELD);
+  assert(glme_reader_next(&rd, &tok) == GLME_T_BYTES);
+  assert(tok.typeid == GLME_PACKED && tok.ktype == GLME_PACKED_BITS && tok.count == NFEATS);
+  assert(tok.v.s.len == (NFEATS + 7) / 8);
+  assert(glme_reader_skip(&rd) == 0);
+
+  glme_buf_reset(&gbuf);
+  glme_arena_init(&arena, 0);
+  root = (glme_node_t *)0;
+  assert(glme_node_decode(&gbuf, &arena, &root) == n);
+  glme_buf_init(&out, 64);
+  assert(glme_node_encode(&out, root) == n);
+  assert(memcmp(glme_buf_data(&out), glme_buf_data(&gbuf), n) == 0);
+  glme_arena_release(&arena);
+  glme_buf_close(&out);
+
+  glme_buf_close(&gbuf);
+  return 0;
+}
+
+/* Local Variables:
+ * indent-tabs-mode: nil
+ * End:
+ */
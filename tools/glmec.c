@@ -0,0 +1,1298 @@
+/*
+ * Copyright (c)  Harri Rautila, 2015
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    * Redistributions of source code must retain the above copyright notice,
+ *      this list of conditions and the following disclaimer.
+ *    * Redistributions in binary form must reproduce the above copyright notice,
+ *      this list of conditions and the following disclaimer in the documentation
+ *      and/or other materials provided with the distribution.
+ *    * Neither the name of the Authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this software
+ *      without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is part of https://github.com/hrautila/glme repository. */
+
+/*
+ * glmec - GLME schema compiler.
+ *
+ * Reads message schema and writes C header with structure definitions and
+ * C source with straight-line encoder, decoder, sizing and free functions
+ * for each message.
+ *
+ * Schema syntax:
+ *
+ *   # comment, also // and C style comments
+ *   message point 32 {
+ *     int x;
+ *     int y = -1;              // default value, not encoded if equal
+ *   }
+ *   message path 33 {
+ *     string name;             // char *name
+ *     bytes tag[8];            // char tag[8]
+ *     uint16 flags[4];         // fixed size vector
+ *     double vals[];           // size_t vals_len; double *vals
+ *     point origin;            // embedded structure
+ *     point *next;             // structure pointer
+ *     point pts[];             // size_t pts_len; struct point *pts
+ *   }
+ *
+ * Scalar types: int8, int16, int32, int64, int, long, uint8, uint16, uint32,
+ * uint64, uint, ulong, float and double.
+ *
+ * Usage: glmec [-o basename] schema
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+// encoded type bytes; base type id shifted left
+#define T_INT     0x04
+#define T_UINT    0x06
+#define T_FLOAT   0x08
+#define T_VECTOR  0x0a
+#define T_STRING  0x0c
+#define T_ARRAY   0x14
+
+#define TYPEID_MIN 16
+// field deltas are written as single bytes
+#define MAX_FIELDS 127
+#define MAX_MESSAGES 256
+#define MAX_NAME 64
+// maximum encoded size of varint
+#define VARINT_MAX 9
+
+enum kinds {
+  K_INT = 1,
+  K_UINT,
+  K_FLOAT,
+  K_STRING,
+  K_BYTES,
+  K_MSG
+};
+
+enum arrays {
+  A_NONE = 0,
+  A_FIXED,
+  A_DYNAMIC
+};
+
+struct ftype {
+  const char *name;
+  const char *ctype;
+  int kind;
+};
+
+static const struct ftype base_types[] = {
+  {"int8",   "int8_t",        K_INT},
+  {"int16",  "int16_t",       K_INT},
+  {"int32",  "int32_t",       K_INT},
+  {"int64",  "int64_t",       K_INT},
+  {"int",    "int",           K_INT},
+  {"long",   "long",          K_INT},
+  {"uint8",  "uint8_t",       K_UINT},
+  {"uint16", "uint16_t",      K_UINT},
+  {"uint32", "uint32_t",      K_UINT},
+  {"uint64", "uint64_t",      K_UINT},
+  {"uint",   "unsigned int",  K_UINT},
+  {"ulong",  "unsigned long", K_UINT},
+  {"float",  "float",         K_FLOAT},
+  {"double", "double",        K_FLOAT},
+  {"string", "char *",        K_STRING},
+  {"bytes",  "char",          K_BYTES},
+  {(const char *)0, (const char *)0, 0}
+};
+
+struct message;
+
+struct field {
+  char name[MAX_NAME];
+  char tname[MAX_NAME];         // type name as written
+  const struct ftype *type;     // base type or null
+  struct message *msg;          // message type or null
+  int kind;
+  int ptr;
+  int array;
+  unsigned long nelem;
+  char defval[MAX_NAME];        // default value or empty
+  int line;
+};
+
+struct message {
+  char name[MAX_NAME];
+  int typeid;
+  int nfields;
+  struct field fields[MAX_FIELDS];
+  int line;
+};
+
+static struct message messages[MAX_MESSAGES];
+static int nmessages = 0;
+
+// ---------------------------------------------------------------------------
+// Lexer
+
+enum tokens {
+  TOK_EOF = 0,
+  TOK_IDENT,
+  TOK_NUMBER,
+  TOK_PUNCT
+};
+
+static const char *srcname;
+static char *src;
+static size_t srcpos = 0;
+static int srcline = 1;
+
+static int tok;
+static char tokval[MAX_NAME];
+static int tokline;
+
+static void fatal(int line, const char *fmt, ...)
+{
+  va_list ap;
+  fprintf(stderr, "%s:%d: ", srcname, line);
+  va_start(ap, fmt);
+  vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  fputc('\n', stderr);
+  exit(1);
+}
+
+static void skip_space(void)
+{
+  for (;;) {
+    if (src[srcpos] == '\n') {
+      srcline++;
+      srcpos++;
+    } else if (isspace((unsigned char)src[srcpos])) {
+      srcpos++;
+    } else if (src[srcpos] == '#' || (src[srcpos] == '/' && src[srcpos+1] == '/')) {
+      while (src[srcpos] && src[srcpos] != '\n')
+        srcpos++;
+    } else if (src[srcpos] == '/' && src[srcpos+1] == '*') {
+      for (srcpos += 2; src[srcpos] && !(src[srcpos] == '*' && src[srcpos+1] == '/'); srcpos++) {
+        if (src[srcpos] == '\n')
+          srcline++;
+      }
+      if (!src[srcpos])
+        fatal(srcline, "unterminated comment");
+      srcpos += 2;
+    } else {
+      return;
+    }
+  }
+}
+
+static void next(void)
+{
+  size_t n = 0;
+  char c;
+
+  skip_space();
+  tokline = srcline;
+  c = src[srcpos];
+  if (!c) {
+    tok = TOK_EOF;
+    tokval[0] = '\0';
+    return;
+  }
+  if (isalpha((unsigned char)c) || c == '_') {
+    tok = TOK_IDENT;
+    while (isalnum((unsigned char)src[srcpos]) || src[srcpos] == '_') {
+      if (n == MAX_NAME-1)
+        fatal(srcline, "name too long");
+      tokval[n++] = src[srcpos++];
+    }
+  } else if (isdigit((unsigned char)c) || c == '-' || c == '+' || c == '.') {
+    tok = TOK_NUMBER;
+    do {
+      if (n == MAX_NAME-1)
+        fatal(srcline, "number too long");
+      c = src[srcpos];
+      tokval[n++] = src[srcpos++];
+      // sign allowed after exponent
+      if ((c == 'e' || c == 'E') && (src[srcpos] == '-' || src[srcpos] == '+') &&
+          !(tokval[0] == '0' && (tokval[1] == 'x' || tokval[1] == 'X')))
+        tokval[n++] = src[srcpos++];
+    } while (isalnum((unsigned char)src[srcpos]) || src[srcpos] == '.');
+  } else if (strchr("{}[];*=", c)) {
+    tok = TOK_PUNCT;
+    tokval[n++] = src[srcpos++];
+  } else {
+    fatal(srcline, "unexpected character '%c'", c);
+  }
+  tokval[n] = '\0';
+}
+
+static int accept(const char *s)
+{
+  if (tok != TOK_EOF && strcmp(tokval, s) == 0) {
+    next();
+    return 1;
+  }
+  return 0;
+}
+
+static void expect(const char *s)
+{
+  if (!accept(s))
+    fatal(tokline, "expected '%s' before '%s'", s, tokval);
+}
+
+static void expect_ident(char *dst, const char *what)
+{
+  if (tok != TOK_IDENT)
+    fatal(tokline, "expected %s before '%s'", what, tokval);
+  strcpy(dst, tokval);
+  next();
+}
+
+static long expect_integer(const char *what)
+{
+  char *end;
+  long v;
+  if (tok != TOK_NUMBER)
+    fatal(tokline, "expected %s before '%s'", what, tokval);
+  v = strtol(tokval, &end, 0);
+  if (*end)
+    fatal(tokline, "invalid %s '%s'", what, tokval);
+  next();
+  return v;
+}
+
+// ---------------------------------------------------------------------------
+// Parser
+
+static struct message *find_message(const char *name)
+{
+  int k;
+  for (k = 0; k < nmessages; k++) {
+    if (strcmp(messages[k].name, name) == 0)
+      return &messages[k];
+  }
+  return (struct message *)0;
+}
+
+static const struct ftype *find_type(const char *name)
+{
+  const struct ftype *t;
+  for (t = base_types; t->name; t++) {
+    if (strcmp(t->name, name) == 0)
+      return t;
+  }
+  return (const struct ftype *)0;
+}
+
+static void parse_field(struct message *m)
+{
+  struct field *f;
+  char *end;
+  int k;
+
+  if (m->nfields == MAX_FIELDS)
+    fatal(tokline, "message %s: too many fields", m->name);
+  f = &m->fields[m->nfields++];
+  memset(f, 0, sizeof(*f));
+  f->line = tokline;
+
+  expect_ident(f->tname, "field type");
+  f->ptr = accept("*");
+  expect_ident(f->name, "field name");
+  if (accept("[")) {
+    f->array = A_DYNAMIC;
+    if (tok == TOK_NUMBER) {
+      long n = expect_integer("array size");
+      if (n <= 0)
+        fatal(f->line, "field %s: invalid array size", f->name);
+      f->array = A_FIXED;
+      f->nelem = n;
+    }
+    expect("]");
+  }
+  if (accept("=")) {
+    if (tok != TOK_NUMBER)
+      fatal(tokline, "field %s: expected default value", f->name);
+    strtod(tokval, &end);
+    if (*end)
+      fatal(tokline, "field %s: invalid default value '%s'", f->name, tokval);
+    strcpy(f->defval, tokval);
+    next();
+  }
+  expect(";");
+
+  for (k = 0; k < m->nfields-1; k++) {
+    if (strcmp(m->fields[k].name, f->name) == 0)
+      fatal(f->line, "field %s: duplicate name", f->name);
+  }
+}
+
+static void parse_message(void)
+{
+  struct message *m;
+  long typeid;
+  int k;
+
+  if (nmessages == MAX_MESSAGES)
+    fatal(tokline, "too many messages");
+  m = &messages[nmessages];
+  m->line = tokline;
+  expect_ident(m->name, "message name");
+  if (find_message(m->name) || find_type(m->name))
+    fatal(m->line, "message %s: name already in use", m->name);
+  typeid = expect_integer("message typeid");
+  if (typeid < TYPEID_MIN || typeid > INT32_MAX)
+    fatal(m->line, "message %s: typeid must be at least %d", m->name, TYPEID_MIN);
+  m->typeid = (int)typeid;
+  for (k = 0; k < nmessages; k++) {
+    if (messages[k].typeid == m->typeid)
+      fatal(m->line, "message %s: typeid %d already used by %s",
+            m->name, m->typeid, messages[k].name);
+  }
+  nmessages++;
+  expect("{");
+  while (!accept("}")) {
+    if (tok == TOK_EOF)
+      fatal(tokline, "message %s: missing '}'", m->name);
+    parse_field(m);
+  }
+  accept(";");
+}
+
+// resolve field types and check usage
+static void resolve(void)
+{
+  struct message *m;
+  struct field *f;
+  int j, k;
+
+  for (k = 0; k < nmessages; k++) {
+    m = &messages[k];
+    for (j = 0; j < m->nfields; j++) {
+      f = &m->fields[j];
+      if ((f->type = find_type(f->tname))) {
+        f->kind = f->type->kind;
+      } else if ((f->msg = find_message(f->tname))) {
+        f->kind = K_MSG;
+      } else {
+        fatal(f->line, "field %s: unknown type %s", f->name, f->tname);
+      }
+
+      if (f->ptr && (f->kind != K_MSG || f->array))
+        fatal(f->line, "field %s: only single message fields can be pointers", f->name);
+      if (f->defval[0] && (f->kind > K_FLOAT || f->array))
+        fatal(f->line, "field %s: default value for non-scalar field", f->name);
+      switch (f->kind) {
+      case K_STRING:
+        if (f->array)
+          fatal(f->line, "field %s: arrays of strings not supported", f->name);
+        break;
+      case K_BYTES:
+        if (f->array != A_FIXED)
+          fatal(f->line, "field %s: bytes needs fixed size", f->name);
+        break;
+      case K_MSG:
+        if (f->array == A_FIXED)
+          fatal(f->line, "field %s: fixed size arrays of messages not supported", f->name);
+        // embedded structures must be complete
+        if (!f->ptr && !f->array && f->msg >= m)
+          fatal(f->line, "field %s: message %s must be defined before %s",
+                f->name, f->msg->name, m->name);
+        break;
+      }
+      if (!f->defval[0] && f->kind <= K_FLOAT)
+        strcpy(f->defval, "0");
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Code generation helpers
+
+static FILE *out;
+
+static void emit(const char *fmt, ...)
+{
+  va_list ap;
+  va_start(ap, fmt);
+  vfprintf(out, fmt, ap);
+  va_end(ap);
+}
+
+static uint64_t zigzag(int64_t v)
+{
+  return v < 0 ? ((uint64_t)~v << 1) | 1 : (uint64_t)v << 1;
+}
+
+// emit byte writes of precomputed varint
+static void emit_varint_bytes(const char *indent, uint64_t u)
+{
+  unsigned char b[VARINT_MAX];
+  int k, nb = 0;
+
+  if (u < 128) {
+    emit("%s*w++ = (char)0x%02x;\n", indent, (unsigned)u);
+    return;
+  }
+  for (; u > 0; u >>= 8)
+    b[nb++] = (unsigned char)(u & 0xff);
+  emit("%s*w++ = (char)0x%02x;\n", indent, (unsigned)(256 - nb));
+  for (k = nb-1; k >= 0; k--)
+    emit("%s*w++ = (char)0x%02x;\n", indent, b[k]);
+}
+
+static int scalar_type(int kind)
+{
+  return kind == K_INT ? T_INT : kind == K_UINT ? T_UINT : T_FLOAT;
+}
+
+static const char *scalar_put(int kind)
+{
+  return kind == K_INT ? "__glmec_put_int(w, (int64_t)" :
+    kind == K_UINT ? "__glmec_put_uint(w, (uint64_t)" : "__glmec_put_double(w, (double)";
+}
+
+static const char *scalar_get(int kind)
+{
+  return kind == K_INT ? "__glmec_get_int(dec, &i)" :
+    kind == K_UINT ? "__glmec_get_uint(dec, &u)" : "__glmec_get_float(dec, t, &d)";
+}
+
+static const char *scalar_var(int kind)
+{
+  return kind == K_INT ? "i" : kind == K_UINT ? "u" : "d";
+}
+
+static const char *ctype(const struct field *f)
+{
+  static char buf[MAX_NAME+16];
+  if (f->kind == K_MSG) {
+    sprintf(buf, "struct %s", f->msg->name);
+    return buf;
+  }
+  return f->type->ctype;
+}
+
+static void upper(char *dst, const char *s)
+{
+  for (; *s; s++)
+    *dst++ = isalnum((unsigned char)*s) ? toupper((unsigned char)*s) : '_';
+  *dst = '\0';
+}
+
+// ---------------------------------------------------------------------------
+// Header
+
+static void gen_header(const char *base, const char *schema)
+{
+  struct message *m;
+  struct field *f;
+  char guard[1024], uname[MAX_NAME];
+  const char *p;
+  int j, k;
+
+  upper(guard, (p = strrchr(base, '/')) ? p+1 : base);
+  emit("/* Generated by glmec from %s; do not edit. */\n\n", schema);
+  emit("#ifndef _%s_H\n#define _%s_H\n\n", guard, guard);
+  emit("#include <stdint.h>\n#include <stddef.h>\n\n#include \"glme.h\"\n\n");
+  emit("#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n");
+
+  for (k = 0; k < nmessages; k++) {
+    upper(uname, messages[k].name);
+    emit("#define %s_ID %d\n", uname, messages[k].typeid);
+  }
+  emit("\n");
+  for (k = 0; k < nmessages; k++)
+    emit("struct %s;\n", messages[k].name);
+
+  for (k = 0; k < nmessages; k++) {
+    m = &messages[k];
+    upper(uname, m->name);
+    emit("\nstruct %s\n{\n", m->name);
+    for (j = 0; j < m->nfields; j++) {
+      f = &m->fields[j];
+      switch (f->array) {
+      case A_FIXED:
+        emit("  %s %s[%lu];\n", ctype(f), f->name, f->nelem);
+        break;
+      case A_DYNAMIC:
+        emit("  size_t %s_len;\n", f->name);
+        emit("  %s *%s;\n", ctype(f), f->name);
+        break;
+      default:
+        if (f->kind == K_STRING)
+          emit("  char *%s;\n", f->name);
+        else
+          emit("  %s %s%s;\n", ctype(f), f->ptr ? "*" : "", f->name);
+        break;
+      }
+    }
+    emit("};\n\n");
+    emit("#define %s_SPEC \\\n  {%s_ID, sizeof(struct %s), %s_encode, %s_decode, (const glme_desc_t *)0}\n\n",
+         uname, uname, m->name, m->name, m->name);
+    emit("/**\n * Encode struct %s value. Returns number of bytes written or negative error.\n */\n",
+         m->name);
+    emit("extern int %s_encode(glme_buf_t *enc, const void *ptr);\n\n", m->name);
+    emit("/**\n * Decode struct %s value. Returns number of bytes consumed or negative error;\n"
+         " * on error memory allocated for the value is released.\n */\n", m->name);
+    emit("extern int %s_decode(glme_buf_t *dec, void *ptr);\n\n", m->name);
+    emit("/**\n * Maximum encoded size of struct %s value.\n */\n", m->name);
+    emit("extern size_t %s_size(const struct %s *p);\n\n", m->name, m->name);
+    emit("/**\n * Release memory allocated for decoded struct %s value; not the structure itself.\n */\n",
+         m->name);
+    emit("extern void %s_free(glme_buf_t *gb, struct %s *p);\n", m->name, m->name);
+  }
+
+  emit("\n#ifdef __cplusplus\n}\n#endif\n\n#endif\n");
+}
+
+// ---------------------------------------------------------------------------
+// Source prelude; static inline primitives used by generated functions
+
+static const char *prelude =
+  "static inline\n"
+  "int __glmec_reserve(glme_buf_t *enc, size_t n)\n"
+  "{\n"
+  "  size_t avail = enc->buflen - enc->count;\n"
+  "  if (avail >= n)\n"
+  "    return 0;\n"
+  "  n -= avail;\n"
+  "  if (glme_buf_resize(enc, n < 1024 ? 1024 : n) == 0) {\n"
+  "    enc->last_error = GLME_E_NOMEM;\n"
+  "    return GLME_E_NOMEM;\n"
+  "  }\n"
+  "  return 0;\n"
+  "}\n"
+  "\n"
+  "static inline\n"
+  "char *__glmec_put_uint(char *w, uint64_t u)\n"
+  "{\n"
+  "  int nb;\n"
+  "  if (u < 128) {\n"
+  "    *w++ = (char)u;\n"
+  "    return w;\n"
+  "  }\n"
+  "  nb = (71 - __builtin_clzll(u)) >> 3;\n"
+  "  *w++ = (char)(-nb);\n"
+  "  while (nb-- > 0)\n"
+  "    *w++ = (char)(u >> (nb << 3));\n"
+  "  return w;\n"
+  "}\n"
+  "\n"
+  "static inline\n"
+  "char *__glmec_put_int(char *w, int64_t v)\n"
+  "{\n"
+  "  return __glmec_put_uint(w, v < 0 ? ((uint64_t)~v << 1) | 1 : (uint64_t)v << 1);\n"
+  "}\n"
+  "\n"
+  "static inline\n"
+  "char *__glmec_put_double(char *w, double d)\n"
+  "{\n"
+  "  union { double d; uint64_t u; } v;\n"
+  "  v.d = d;\n"
+  "  return __glmec_put_uint(w, __builtin_bswap64(v.u));\n"
+  "}\n"
+  "\n"
+  "static inline\n"
+  "char *__glmec_put_bytes(char *w, const char *s, size_t len)\n"
+  "{\n"
+  "  w = __glmec_put_uint(w, len);\n"
+  "  memcpy(w, s, len);\n"
+  "  return w + len;\n"
+  "}\n"
+  "\n"
+  "static inline\n"
+  "int __glmec_get_uint(glme_buf_t *dec, uint64_t *u)\n"
+  "{\n"
+  "  const unsigned char *b = (const unsigned char *)&dec->buf[dec->current];\n"
+  "  size_t avail = dec->count - dec->current;\n"
+  "  uint64_t v;\n"
+  "  int k, nb;\n"
+  "\n"
+  "  if (avail == 0)\n"
+  "    return GLME_E_UFLOW;\n"
+  "  if (b[0] < 128) {\n"
+  "    *u = b[0];\n"
+  "    dec->current++;\n"
+  "    return 1;\n"
+  "  }\n"
+  "  if ((nb = 256 - b[0]) > 8)\n"
+  "    return GLME_E_INPUT;\n"
+  "  if ((size_t)nb >= avail)\n"
+  "    return GLME_E_UFLOW;\n"
+  "  for (v = 0, k = 1; k <= nb; k++)\n"
+  "    v = (v << 8) | b[k];\n"
+  "  *u = v;\n"
+  "  dec->current += nb + 1;\n"
+  "  return nb + 1;\n"
+  "}\n"
+  "\n"
+  "static inline\n"
+  "int __glmec_get_int(glme_buf_t *dec, int64_t *i)\n"
+  "{\n"
+  "  uint64_t u;\n"
+  "  int n;\n"
+  "  if ((n = __glmec_get_uint(dec, &u)) < 0)\n"
+  "    return n;\n"
+  "  *i = u & 1 ? (int64_t)~(u >> 1) : (int64_t)(u >> 1);\n"
+  "  return n;\n"
+  "}\n"
+  "\n"
+  "static inline\n"
+  "int __glmec_get_double(glme_buf_t *dec, double *d)\n"
+  "{\n"
+  "  union { double d; uint64_t u; } v;\n"
+  "  int n;\n"
+  "  if ((n = __glmec_get_uint(dec, &v.u)) < 0)\n"
+  "    return n;\n"
+  "  v.u = __builtin_bswap64(v.u);\n"
+  "  *d = v.d;\n"
+  "  return n;\n"
+  "}\n"
+  "\n"
+  "// floating point value of type t, double or single precision\n"
+  "static inline\n"
+  "int __glmec_get_float(glme_buf_t *dec, int t, double *d)\n"
+  "{\n"
+  "  union { float f; uint32_t u; } v;\n"
+  "  uint64_t u;\n"
+  "  int n;\n"
+  "  if (t == 0x08)\n"
+  "    return __glmec_get_double(dec, d);\n"
+  "  if ((n = __glmec_get_uint(dec, &u)) < 0)\n"
+  "    return n;\n"
+  "  v.u = (uint32_t)(__builtin_bswap64(u) >> 32);\n"
+  "  *d = v.f;\n"
+  "  return n;\n"
+  "}\n"
+  "\n"
+  "// check encoded base type byte\n"
+  "static inline\n"
+  "int __glmec_type(glme_buf_t *dec, int t)\n"
+  "{\n"
+  "  if (dec->current >= dec->count)\n"
+  "    return GLME_E_UFLOW;\n"
+  "  if ((unsigned char)dec->buf[dec->current] != t)\n"
+  "    return GLME_E_TYPE;\n"
+  "  dec->current++;\n"
+  "  return 1;\n"
+  "}\n"
+  "\n"
+  "// check floating point type byte; double (0x08) or single precision (0x1c)\n"
+  "static inline\n"
+  "int __glmec_ftype(glme_buf_t *dec, int *t)\n"
+  "{\n"
+  "  if (dec->current >= dec->count)\n"
+  "    return GLME_E_UFLOW;\n"
+  "  *t = (unsigned char)dec->buf[dec->current];\n"
+  "  if (*t != 0x08 && *t != 0x1c)\n"
+  "    return GLME_E_TYPE;\n"
+  "  dec->current++;\n"
+  "  return 1;\n"
+  "}\n"
+  "\n"
+  "// check structure typeid; zz is zigzag encoded typeid\n"
+  "static inline\n"
+  "int __glmec_typeid(glme_buf_t *dec, uint64_t zz)\n"
+  "{\n"
+  "  uint64_t u;\n"
+  "  int n;\n"
+  "  if ((n = __glmec_get_uint(dec, &u)) < 0)\n"
+  "    return n;\n"
+  "  return u == zz ? n : GLME_E_TYPE;\n"
+  "}\n"
+  "\n"
+  "// read array header; et is zigzag encoded element type\n"
+  "static inline\n"
+  "int __glmec_array(glme_buf_t *dec, uint64_t et, uint64_t *len)\n"
+  "{\n"
+  "  int n;\n"
+  "  if ((n = __glmec_type(dec, 0x14)) < 0 || (n = __glmec_typeid(dec, et)) < 0)\n"
+  "    return n;\n"
+  "  if ((n = __glmec_get_uint(dec, len)) < 0)\n"
+  "    return n;\n"
+  "  // every element takes at least one byte\n"
+  "  return *len > dec->count - dec->current ? GLME_E_UFLOW : 0;\n"
+  "}\n"
+  "\n"
+  "// read floating point array header; element type to t\n"
+  "static inline\n"
+  "int __glmec_farray(glme_buf_t *dec, int *t, uint64_t *len)\n"
+  "{\n"
+  "  int n;\n"
+  "  if ((n = __glmec_type(dec, 0x14)) < 0 || (n = __glmec_ftype(dec, t)) < 0)\n"
+  "    return n;\n"
+  "  if ((n = __glmec_get_uint(dec, len)) < 0)\n"
+  "    return n;\n"
+  "  return *len > dec->count - dec->current ? GLME_E_UFLOW : 0;\n"
+  "}\n"
+  "\n"
+  "static inline\n"
+  "int __glmec_get_bytes(glme_buf_t *dec, char *s, size_t len)\n"
+  "{\n"
+  "  uint64_t n;\n"
+  "  int e;\n"
+  "  // byte vectors accept strings\n"
+  "  if ((e = __glmec_type(dec, 0x0a)) < 0 && (e = __glmec_type(dec, 0x0c)) < 0)\n"
+  "    return e;\n"
+  "  if ((e = __glmec_get_uint(dec, &n)) < 0)\n"
+  "    return e;\n"
+  "  if (n > dec->count - dec->current)\n"
+  "    return GLME_E_UFLOW;\n"
+  "  memcpy(s, &dec->buf[dec->current], n < len ? n : len);\n"
+  "  if (n < len)\n"
+  "    memset(&s[n], 0, len - n);\n"
+  "  dec->current += n;\n"
+  "  return 0;\n"
+  "}\n"
+  "\n"
+  "static inline\n"
+  "int __glmec_get_string(glme_buf_t *dec, char **s)\n"
+  "{\n"
+  "  uint64_t n;\n"
+  "  int e;\n"
+  "  if ((e = __glmec_type(dec, 0x0c)) < 0 || (e = __glmec_get_uint(dec, &n)) < 0)\n"
+  "    return e;\n"
+  "  if (n > dec->count - dec->current)\n"
+  "    return GLME_E_UFLOW;\n"
+  "  if (!(*s = (char *)glme_malloc(dec, n + 1)))\n"
+  "    return GLME_E_NOMEM;\n"
+  "  memcpy(*s, &dec->buf[dec->current], n);\n"
+  "  (*s)[n] = '\\0';\n"
+  "  dec->current += n;\n"
+  "  return 0;\n"
+  "}\n"
+  "\n"
+  "// read next field delta; end of structure sets field number past all fields\n"
+  "static inline\n"
+  "int __glmec_next(glme_buf_t *dec, unsigned int *fno)\n"
+  "{\n"
+  "  uint64_t delta;\n"
+  "  int n;\n"
+  "  if ((n = __glmec_get_uint(dec, &delta)) < 0)\n"
+  "    return n;\n"
+  "  if (delta == 0)\n"
+  "    *fno = ~0u;\n"
+  "  else if (delta > 255)\n"
+  "    *fno = 256; // beyond any field\n"
+  "  else\n"
+  "    *fno += (unsigned int)delta;\n"
+  "  return n;\n"
+  "}\n";
+
+// ---------------------------------------------------------------------------
+// Sizing functions
+
+static void gen_size(struct message *m)
+{
+  struct field *f;
+  unsigned long n = 1;
+  int j, loops = 0;
+
+  // constant part
+  for (j = 0; j < m->nfields; j++) {
+    f = &m->fields[j];
+    switch (f->kind) {
+    case K_STRING:
+      n += 2 + VARINT_MAX;
+      break;
+    case K_BYTES:
+      n += 2 + VARINT_MAX + f->nelem;
+      break;
+    case K_MSG:
+      n += f->array ? 2 + 2*VARINT_MAX : 1 + VARINT_MAX;
+      loops |= f->array != A_NONE;
+      break;
+    default:
+      if (f->array == A_FIXED)
+        n += 3 + VARINT_MAX + f->nelem*VARINT_MAX;
+      else if (f->array == A_DYNAMIC)
+        n += 3 + VARINT_MAX;
+      else
+        n += 2 + VARINT_MAX;
+    }
+  }
+
+  emit("size_t %s_size(const struct %s *p)\n{\n", m->name, m->name);
+  emit("  size_t n = %lu;\n", n);
+  if (loops)
+    emit("  size_t k;\n");
+  emit("\n");
+  for (j = 0; j < m->nfields; j++) {
+    f = &m->fields[j];
+    switch (f->kind) {
+    case K_STRING:
+      emit("  if (p->%s)\n    n += strlen(p->%s);\n", f->name, f->name);
+      break;
+    case K_MSG:
+      if (f->array) {
+        emit("  if (p->%s) {\n    for (k = 0; k < p->%s_len; k++)\n", f->name, f->name);
+        emit("      n += %s_size(&p->%s[k]);\n  }\n", f->msg->name, f->name);
+      } else if (f->ptr) {
+        emit("  if (p->%s)\n    n += %s_size(p->%s);\n", f->name, f->msg->name, f->name);
+      } else {
+        emit("  n += %s_size(&p->%s);\n", f->msg->name, f->name);
+      }
+      break;
+    case K_INT:
+    case K_UINT:
+    case K_FLOAT:
+      if (f->array == A_DYNAMIC)
+        emit("  if (p->%s)\n    n += p->%s_len * %d;\n", f->name, f->name, VARINT_MAX);
+      break;
+    }
+  }
+  emit("  return n;\n}\n\n");
+}
+
+// ---------------------------------------------------------------------------
+// Encoders
+
+// Field delta is known at generation time after fields that are always
+// encoded; otherwise it is kept in variable.
+static int delta_known;
+
+static void emit_delta(const char *indent)
+{
+  if (delta_known)
+    emit("%s*w++ = (char)%d;\n", indent, delta_known);
+  else
+    emit("%s*w++ = (char)delta;\n", indent);
+}
+
+static void gen_write(struct message *m)
+{
+  struct field *f;
+  char cond[4*MAX_NAME+64];
+  const char *in;
+  int j, optional, loops = 0;
+
+  for (j = 0; j < m->nfields; j++) {
+    f = &m->fields[j];
+    loops |= f->array != A_NONE && f->kind != K_BYTES;
+  }
+
+  emit("static\nchar *__%s_write(char *w, const struct %s *p)\n{\n", m->name, m->name);
+  emit("  unsigned int delta = 1;\n");
+  if (loops)
+    emit("  size_t k;\n");
+  emit("\n");
+
+  delta_known = 1;
+  for (j = 0; j < m->nfields; j++) {
+    f = &m->fields[j];
+    // condition of optional fields
+    cond[0] = '\0';
+    if (f->array == A_DYNAMIC)
+      sprintf(cond, "p->%s_len > 0 && p->%s", f->name, f->name);
+    else if (f->kind == K_STRING)
+      sprintf(cond, "p->%s && p->%s[0]", f->name, f->name);
+    else if (f->ptr)
+      sprintf(cond, "p->%s", f->name);
+    else if (f->kind <= K_FLOAT && f->array == A_NONE)
+      sprintf(cond, "p->%s != %s", f->name, f->defval);
+    optional = cond[0] != '\0';
+
+    emit("  // %s\n", f->name);
+    in = "  ";
+    if (optional) {
+      emit("  if (%s) {\n", cond);
+      in = "    ";
+    }
+    emit_delta(in);
+
+    switch (f->kind) {
+    case K_STRING:
+      emit("%s*w++ = (char)0x%02x;\n", in, T_STRING);
+      emit("%sw = __glmec_put_bytes(w, p->%s, strlen(p->%s));\n", in, f->name, f->name);
+      break;
+    case K_BYTES:
+      emit("%s*w++ = (char)0x%02x;\n", in, T_VECTOR);
+      emit("%sw = __glmec_put_bytes(w, p->%s, %lu);\n", in, f->name, f->nelem);
+      break;
+    case K_MSG:
+      if (f->array) {
+        emit("%s*w++ = (char)0x%02x;\n", in, T_ARRAY);
+        emit_varint_bytes(in, zigzag(f->msg->typeid));
+        emit("%sw = __glmec_put_uint(w, p->%s_len);\n", in, f->name);
+        emit("%sfor (k = 0; k < p->%s_len; k++)\n", in, f->name);
+        emit("%s  w = __%s_write(w, &p->%s[k]);\n", in, f->msg->name, f->name);
+      } else {
+        emit_varint_bytes(in, zigzag(f->msg->typeid));
+        emit("%sw = __%s_write(w, %sp->%s);\n", in, f->msg->name, f->ptr ? "" : "&", f->name);
+      }
+      break;
+    default:
+      if (f->array) {
+        emit("%s*w++ = (char)0x%02x;\n", in, T_ARRAY);
+        emit("%s*w++ = (char)0x%02x;\n", in, scalar_type(f->kind));
+        if (f->array == A_FIXED) {
+          emit_varint_bytes(in, f->nelem);
+          emit("%sfor (k = 0; k < %lu; k++)\n", in, f->nelem);
+        } else {
+          emit("%sw = __glmec_put_uint(w, p->%s_len);\n", in, f->name);
+          emit("%sfor (k = 0; k < p->%s_len; k++)\n", in, f->name);
+        }
+        emit("%s  w = %sp->%s[k]);\n", in, scalar_put(f->kind), f->name);
+      } else {
+        emit("%s*w++ = (char)0x%02x;\n", in, scalar_type(f->kind));
+        emit("%sw = %sp->%s);\n", in, scalar_put(f->kind), f->name);
+      }
+      break;
+    }
+
+    if (optional) {
+      emit("    delta = 1;\n  } else {\n");
+      if (delta_known)
+        emit("    delta = %d;\n  }\n", delta_known + 1);
+      else
+        emit("    delta++;\n  }\n");
+      delta_known = 0;
+    } else {
+      delta_known = 1;
+    }
+  }
+  emit("  // end of structure\n  *w++ = 0;\n");
+  emit("  (void)delta;\n  return w;\n}\n\n");
+}
+
+static void gen_encode(struct message *m)
+{
+  emit("int %s_encode(glme_buf_t *enc, const void *ptr)\n{\n", m->name);
+  emit("  const struct %s *p = (const struct %s *)ptr;\n", m->name, m->name);
+  emit("  char *w;\n  int n;\n\n");
+  emit("  if (__glmec_reserve(enc, %s_size(p)) < 0)\n    return GLME_E_NOMEM;\n", m->name);
+  emit("  w = __%s_write(&enc->buf[enc->count], p);\n", m->name);
+  emit("  n = w - &enc->buf[enc->count];\n");
+  emit("  enc->count += n;\n  return n;\n}\n\n");
+}
+
+// ---------------------------------------------------------------------------
+// Decoders
+
+static void gen_decode(struct message *m)
+{
+  struct field *f;
+  int j, vi = 0, vu = 0, vd = 0, vk = 0, ninit = 0;
+  const char *ct;
+
+  for (j = 0; j < m->nfields; j++) {
+    f = &m->fields[j];
+    vi |= f->kind == K_INT;
+    vu |= f->kind == K_UINT || f->array != A_NONE;
+    vd |= f->kind == K_FLOAT;
+    vk |= f->array != A_NONE && f->kind != K_BYTES;
+  }
+
+  emit("int %s_decode(glme_buf_t *dec, void *ptr)\n{\n", m->name);
+  emit("  struct %s *p = (struct %s *)ptr;\n", m->name, m->name);
+  emit("  size_t __at_start = dec->current;\n");
+  emit("  unsigned int fno = 0;\n");
+  if (vi)
+    emit("  int64_t i;\n");
+  if (vu)
+    emit("  uint64_t u;\n");
+  if (vd)
+    emit("  double d;\n");
+  if (vk)
+    emit("  size_t k;\n");
+  if (vd)
+    emit("  int t;\n");
+  emit("  int e;\n\n");
+  // owned memory is null until decoded; partial result can be released
+  for (j = 0; j < m->nfields; j++) {
+    f = &m->fields[j];
+    if (f->array == A_DYNAMIC)
+      emit("  p->%s = (%s *)0;\n  p->%s_len = 0;\n", f->name, ctype(f), f->name);
+    else if (f->kind == K_STRING || f->ptr)
+      emit("  p->%s = (%s%s)0;\n", f->name, ctype(f), f->kind == K_STRING ? "" : " *");
+    else if (f->kind == K_MSG && f->array == A_NONE)
+      emit("  memset(&p->%s, 0, sizeof(p->%s));\n", f->name, f->name);
+    else
+      continue;
+    ninit++;
+  }
+  if (ninit > 0)
+    emit("\n");
+  emit("  if ((e = __glmec_next(dec, &fno)) < 0)\n    goto error;\n\n");
+
+  for (j = 0; j < m->nfields; j++) {
+    f = &m->fields[j];
+    ct = ctype(f);
+    emit("  // %s\n  if (fno == %d) {\n", f->name, j+1);
+
+    switch (f->kind) {
+    case K_STRING:
+      emit("    if ((e = __glmec_get_string(dec, &p->%s)) < 0)\n      goto error;\n", f->name);
+      break;
+    case K_BYTES:
+      emit("    if ((e = __glmec_get_bytes(dec, p->%s, %lu)) < 0)\n      goto error;\n",
+           f->name, f->nelem);
+      break;
+    case K_MSG:
+      if (f->array) {
+        emit("    if ((e = __glmec_array(dec, %llu, &u)) < 0)\n      goto error;\n",
+             (unsigned long long)zigzag(f->msg->typeid));
+        emit("    if (u > 0 && !(p->%s = (%s *)glme_calloc(dec, u, sizeof(%s)))) {\n",
+             f->name, ct, ct);
+        emit("      e = GLME_E_NOMEM;\n      goto error;\n    }\n");
+        // zeroed elements are released with decoded ones on error
+        emit("    p->%s_len = u;\n", f->name);
+        emit("    for (k = 0; k < u; k++) {\n");
+        emit("      if ((e = %s_decode(dec, &p->%s[k])) < 0)\n        goto error;\n    }\n",
+             f->msg->name, f->name);
+      } else {
+        emit("    if ((e = __glmec_typeid(dec, %llu)) < 0)\n      goto error;\n",
+             (unsigned long long)zigzag(f->msg->typeid));
+        if (f->ptr) {
+          emit("    if (!(p->%s = (%s *)glme_calloc(dec, 1, sizeof(%s)))) {\n", f->name, ct, ct);
+          emit("      e = GLME_E_NOMEM;\n      goto error;\n    }\n");
+          emit("    if ((e = %s_decode(dec, p->%s)) < 0)\n      goto error;\n",
+               f->msg->name, f->name);
+        } else {
+          emit("    if ((e = %s_decode(dec, &p->%s)) < 0)\n      goto error;\n",
+               f->msg->name, f->name);
+        }
+      }
+      break;
+    default:
+      if (f->array && f->kind == K_FLOAT) {
+        // either precision
+        emit("    if ((e = __glmec_farray(dec, &t, &u)) < 0)\n      goto error;\n");
+      } else if (f->array) {
+        emit("    if ((e = __glmec_array(dec, 0x%02x, &u)) < 0)\n      goto error;\n",
+             scalar_type(f->kind));
+      }
+      if (f->array) {
+        if (f->array == A_FIXED) {
+          emit("    if (u > %lu) {\n      e = GLME_E_OFLOW;\n      goto error;\n    }\n", f->nelem);
+        } else {
+          emit("    if (u > 0 && !(p->%s = (%s *)glme_calloc(dec, u, sizeof(%s)))) {\n",
+               f->name, ct, ct);
+          emit("      e = GLME_E_NOMEM;\n      goto error;\n    }\n");
+          emit("    p->%s_len = u;\n", f->name);
+        }
+        emit("    for (k = 0; k < u; k++) {\n");
+        // element reads may not clobber u of fixed vector loop
+        if (f->kind == K_UINT) {
+          emit("      uint64_t v;\n");
+          emit("      if ((e = __glmec_get_uint(dec, &v)) < 0)\n        goto error;\n");
+          emit("      p->%s[k] = (%s)v;\n    }\n", f->name, ct);
+        } else {
+          emit("      if ((e = %s) < 0)\n        goto error;\n", scalar_get(f->kind));
+          emit("      p->%s[k] = (%s)%s;\n    }\n", f->name, ct, scalar_var(f->kind));
+        }
+        if (f->array == A_FIXED) {
+          emit("    for (; k < %lu; k++)\n      p->%s[k] = 0;\n", f->nelem, f->name);
+        }
+      } else if (f->kind == K_FLOAT) {
+        emit("    if ((e = __glmec_ftype(dec, &t)) < 0 || (e = %s) < 0)\n      goto error;\n",
+             scalar_get(f->kind));
+        emit("    p->%s = (%s)%s;\n", f->name, ct, scalar_var(f->kind));
+      } else {
+        emit("    if ((e = __glmec_type(dec, 0x%02x)) < 0 || (e = %s) < 0)\n      goto error;\n",
+             scalar_type(f->kind), scalar_get(f->kind));
+        emit("    p->%s = (%s)%s;\n", f->name, ct, scalar_var(f->kind));
+      }
+      break;
+    }
+    emit("    if ((e = __glmec_next(dec, &fno)) < 0)\n      goto error;\n");
+    emit("  } else {\n");
+    if (f->array == A_DYNAMIC) {
+      emit("    p->%s_len = 0;\n    p->%s = (%s *)0;\n", f->name, f->name, ct);
+    } else if (f->array == A_FIXED || (f->kind == K_MSG && !f->ptr)) {
+      emit("    memset(&p->%s, 0, sizeof(p->%s));\n", f->name, f->name);
+    } else if (f->kind == K_STRING || f->ptr) {
+      emit("    p->%s = (%s%s)0;\n", f->name, ct, f->kind == K_STRING ? "" : " *");
+    } else {
+      emit("    p->%s = %s;\n", f->name, f->defval);
+    }
+    emit("  }\n");
+  }
+
+  emit("  if (fno != ~0u) {\n    // fields from newer encoder\n"
+       "    if (glme_skip(dec) < 0 || glme_skip_fields(dec) < 0) {\n"
+       "      e = dec->last_error;\n      goto error;\n    }\n  }\n");
+  emit("  return dec->current - __at_start;\n\n");
+  emit(" error:\n  // release partial result\n  %s_free(dec, p);\n", m->name);
+  emit("  dec->last_error = e;\n  return e;\n}\n\n");
+}
+
+// ---------------------------------------------------------------------------
+// Free functions
+
+static void gen_free(struct message *m)
+{
+  struct field *f;
+  int j, vk = 0;
+
+  for (j = 0; j < m->nfields; j++) {
+    f = &m->fields[j];
+    vk |= f->kind == K_MSG && f->array;
+  }
+
+  emit("void %s_free(glme_buf_t *gb, struct %s *p)\n{\n", m->name, m->name);
+  if (vk)
+    emit("  size_t k;\n\n");
+  for (j = 0; j < m->nfields; j++) {
+    f = &m->fields[j];
+    if (f->kind == K_MSG && f->array) {
+      emit("  if (p->%s) {\n    for (k = 0; k < p->%s_len; k++)\n", f->name, f->name);
+      emit("      %s_free(gb, &p->%s[k]);\n", f->msg->name, f->name);
+      emit("    glme_free(gb, p->%s);\n  }\n", f->name);
+      emit("  p->%s = (%s *)0;\n  p->%s_len = 0;\n", f->name, ctype(f), f->name);
+    } else if (f->kind == K_MSG && f->ptr) {
+      emit("  if (p->%s) {\n    %s_free(gb, p->%s);\n", f->name, f->msg->name, f->name);
+      emit("    glme_free(gb, p->%s);\n  }\n", f->name);
+      emit("  p->%s = (%s *)0;\n", f->name, ctype(f));
+    } else if (f->kind == K_MSG) {
+      emit("  %s_free(gb, &p->%s);\n", f->msg->name, f->name);
+    } else if (f->kind == K_STRING || f->array == A_DYNAMIC) {
+      emit("  if (p->%s)\n    glme_free(gb, p->%s);\n", f->name, f->name);
+      emit("  p->%s = (%s%s)0;\n", f->name, ctype(f), f->kind == K_STRING ? "" : " *");
+      if (f->array)
+        emit("  p->%s_len = 0;\n", f->name);
+    }
+  }
+  emit("}\n\n");
+}
+
+static void gen_source(const char *base, const char *schema)
+{
+  const char *p;
+  int k;
+
+  p = strrchr(base, '/');
+  emit("/* Generated by glmec from %s; do not edit. */\n\n", schema);
+  emit("#include <stdint.h>\n#include <stddef.h>\n#include <string.h>\n\n");
+  emit("#include \"%s.h\"\n\n", p ? p+1 : base);
+  emit("%s\n", prelude);
+
+  for (k = 0; k < nmessages; k++)
+    emit("static char *__%s_write(char *w, const struct %s *p);\n",
+         messages[k].name, messages[k].name);
+  emit("\n");
+
+  for (k = 0; k < nmessages; k++) {
+    emit("// ---------------------------------------------------------------------------\n");
+    emit("// struct %s\n\n", messages[k].name);
+    gen_size(&messages[k]);
+    gen_write(&messages[k]);
+    gen_encode(&messages[k]);
+    gen_decode(&messages[k]);
+    gen_free(&messages[k]);
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+static char *read_file(const char *path)
+{
+  FILE *fp;
+  char *buf;
+  long len;
+
+  if (!(fp = fopen(path, "r"))) {
+    perror(path);
+    exit(1);
+  }
+  fseek(fp, 0, SEEK_END);
+  len = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  if (!(buf = (char *)malloc(len + 1)) || fread(buf, 1, len, fp) != (size_t)len) {
+    perror(path);
+    exit(1);
+  }
+  buf[len] = '\0';
+  fclose(fp);
+  return buf;
+}
+
+static void write_file(const char *base, const char *ext, const char *schema,
+                       void (*gen)(const char *, const char *))
+{
+  char path[1024];
+
+  snprintf(path, sizeof(path), "%s%s", base, ext);
+  if (!(out = fopen(path, "w"))) {
+    perror(path);
+    exit(1);
+  }
+  (*gen)(base, schema);
+  if (fclose(out) != 0) {
+    perror(path);
+    exit(1);
+  }
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: glmec [-o basename] schema\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  char base[1024], *p;
+  const char *outbase = (const char *)0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:h")) != -1) {
+    switch (opt) {
+    case 'o':
+      outbase = optarg;
+      break;
+    default:
+      usage();
+    }
+  }
+  if (optind != argc - 1)
+    usage();
+
+  srcname = argv[optind];
+  src = read_file(srcname);
+
+  next();
+  while (tok != TOK_EOF) {
+    if (!accept("message"))
+      fatal(tokline, "expected 'message' before '%s'", tokval);
+    parse_message();
+  }
+  resolve();
+
+  if (outbase) {
+    snprintf(base, sizeof(base), "%s", outbase);
+  } else {
+    // schema file name without extension
+    snprintf(base, sizeof(base), "%s", srcname);
+    if ((p = strrchr(base, '.')) && !strchr(p, '/'))
+      *p = '\0';
+  }
+  write_file(base, ".h", srcname, gen_header);
+  write_file(base, ".c", srcname, gen_source);
+  return 0;
+}
+
+// Local Variables:
+// indent-tabs-mode: nil
+// End:
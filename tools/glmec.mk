@@ -0,0 +1,16 @@
+# Rules for generating message encoders and decoders from schema files.
+#
+# Include from Makefile.am and list generated sources in BUILT_SOURCES:
+#
+#   include $(top_srcdir)/tools/glmec.mk
+#   BUILT_SOURCES = msg.c
+#   nodist_prog_SOURCES = msg.c
+#
+# Schema msg.glme produces msg.c and msg.h in build directory.
+
+GLMEC = $(top_builddir)/tools/glmec
+
+SUFFIXES = .glme
+
+.glme.c:
+	$(GLMEC) -o $* $<